@@ -21,6 +21,7 @@
 #include "map_model.h"
 #include "tileset_model.h"
 #include <QList>
+#include <QSet>
 #include <set>
 #include <vector>
 
@@ -30,17 +31,47 @@ class MapModel;
 
 /**
  * @brief Generates border tiles around some entities.
+ *
+ * Borders can be generated from scratch around a selection with
+ * generate_border_tiles(), or updated incrementally after an edit with
+ * update_border_tiles(), which only replaces the border tiles that
+ * actually change around the edited area.
  */
 class AutoTiler {
 
 public:
 
+  /**
+   * @brief Border tiles to replace to update the borders of a region.
+   */
+  struct BorderTilesUpdate {
+    EntityIndexes tiles_to_remove;     /**< Obsolete border tiles (sorted). */
+    AddableEntities tiles_to_add;      /**< New border tiles and their index once
+                                        * obsolete ones are removed. */
+  };
+
   AutoTiler(MapModel& map, const EntityIndexes& entity_indexes, const QString& border_set_id);
 
   AddableEntities generate_border_tiles();
 
+  static BorderTilesUpdate update_border_tiles(
+      MapModel& map,
+      const QString& border_set_id,
+      int layer,
+      const QSet<QString>& region_pattern_ids,
+      const QRect& dirty_area
+  );
+
 private:
 
+  /**
+   * @brief Description of a border tile to create.
+   */
+  struct BorderTile {
+    QString pattern_id;                /**< Pattern of the tile. */
+    QRect box;                         /**< Position and size of the tile on the map. */
+  };
+
   int get_num_cells() const;
   int to_grid_index(const QPoint& xy) const;
   QPoint to_map_xy(int grid_index) const;
@@ -60,6 +91,8 @@ private:
   const TilesetModel& get_tileset() const;
   const QSize& get_pattern_size(BorderKind which_border) const;
   void make_tile(BorderKind which_border, int grid_index, int num_cells_repeat);
+  EntityModelPtr create_tile(const BorderTile& border_tile) const;
+  QList<BorderTile> compute_border_tiles();
 
   void compute_pattern_sizes();
   void compute_bounding_box();
@@ -71,15 +104,19 @@ private:
 
   MapModel& map;                       /**< The map that will be modified. */
   EntityIndexes entity_indexes;        /**< Entities where to create a border. */
+  int layer;                           /**< Layer where to create border tiles. */
   QString border_set_id;               /**< Border patterns to generate and how. */
   QList<QRect> entity_rectangles;      /**< Rectangles of entities where to create a border. */
   QRect bounding_box;                  /**< Rectangle containing the entities plus 8 pixels of margin. */
   QSize grid_size;                     /**< Number of cells in the 8x8 grid in X and Y. */
-  std::vector<bool> occupied_squares;  /**< Squares of the 8x8 grid that are occupied by an entity. */
-  std::map<int, BorderKind>
-      which_borders;                   /**< Which kind of border to create in each square of the 8x8 grid. */
+  std::vector<quint8>
+      occupied_squares;                /**< Squares of the 8x8 grid that are occupied by an entity
+                                        * (one byte per square, row by row). */
+  std::vector<qint8>
+      which_borders;                   /**< Which kind of border to create in each square of the 8x8 grid
+                                        * (one byte per square, row by row). */
   QList<QSize> pattern_sizes;          /**< Size of each border pattern in pixels. */
-  EntityModels tiles;                  /**< Border tiles created. */
+  QList<BorderTile> tiles;             /**< Border tiles to create. */
 };
 
 }
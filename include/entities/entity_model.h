@@ -52,6 +52,8 @@ public:
       MapModel& map, EntityType type);
   static EntityModelPtr create(
       MapModel& map, const QString& entity_string);
+  static EntityModelPtr create(
+      MapModel& map, const Solarus::EntityData& entity_data);
   static EntityModelPtr create(
       MapModel& map, const EntityIndex& index);
   static EntityModelPtr clone(
@@ -145,9 +147,12 @@ public:
 
   // Displaying in the editor.
   virtual void draw(QPainter& painter) const;
+  virtual bool is_animated() const;
+  virtual void draw_animated(QPainter& painter, qint64 animation_time) const;
   virtual void notify_tileset_changed(const QString& tileset_id);
 
   void reload_sprite();
+  bool notify_sprites_changed(const QStringList& sprite_ids);
 
 protected:
 
@@ -271,9 +276,9 @@ private:
   DrawSpriteInfo
       draw_sprite_info;           /**< How to draw the entity
                                    * when it is drawn as a sprite. */
-  mutable std::unique_ptr<SpriteModel>
+  mutable std::shared_ptr<const SpriteModel>
       sprite_model;               /**< Sprite to show when the entity is drawn
-                                   * as a sprite. */
+                                   * as a sprite, shared with other entities. */
   mutable QPixmap sprite_image;   /**< Fixed image from the sprite. */
   DrawShapeInfo draw_shape_info;  /**< Shape to use when the entity is drawn as
                                    * a shape. */
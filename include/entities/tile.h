@@ -28,6 +28,9 @@ class Tile : public EntityModel {
 
 public:
 
+  static constexpr int pattern_frame_delay = 250;  /**< Delay between frames of
+                                                    * multi-frame patterns in ms. */
+
   Tile(MapModel& map, const EntityIndex& index);
   static EntityModelPtr create_from_dynamic_tile(MapModel& map, const EntityIndex& dynamic_tile_index);
 
@@ -35,6 +38,8 @@ public:
   void set_pattern_id(const QString& pattern_id);
 
   void draw(QPainter& painter) const override;
+  bool is_animated() const override;
+  void draw_animated(QPainter& painter, qint64 animation_time) const override;
   void notify_tileset_changed(const QString& tileset_id) override;
 
 protected:
@@ -46,9 +51,13 @@ protected:
 private:
 
   void update_pattern();
+  int get_pattern_index() const;
   ResizeMode get_pattern_resize_mode() const;
 
-  mutable QPixmap pattern_image;     /**< Cached image of the tile pattern. */
+  QString pattern_id;                /**< Value of the pattern field. */
+  mutable int pattern_index;         /**< Index of the pattern in the tileset
+                                      * when it was last resolved, or -1. */
+  bool animated;                     /**< Whether the pattern has several frames. */
 
 };
 
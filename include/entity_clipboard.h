@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_ENTITY_CLIPBOARD_H
+#define SOLARUSEDITOR_ENTITY_CLIPBOARD_H
+
+#include "entities/entity_traits.h"
+#include "map_model.h"
+#include <QByteArray>
+#include <QString>
+
+class QMimeData;
+
+namespace SolarusEditor {
+
+/**
+ * @brief Clipboard formats of map entities.
+ *
+ * Entities copied from a map are put in the clipboard in two formats:
+ * - a compact binary format, used when pasting in the editor,
+ * - their text in the map data file syntax, for other applications
+ *   and as a fallback.
+ *
+ * The binary format stores each string once (pattern ids, field keys...)
+ * and the coordinates of each entity relative to the previous one,
+ * with variable-length integers.
+ */
+namespace EntityClipboard {
+
+QString get_mime_type();
+
+QByteArray entities_to_binary(const MapModel& map, const EntityIndexes& indexes);
+QByteArray entities_to_binary(const AddableEntities& entities);
+EntityModels create_entities_from_binary(MapModel& map, const QByteArray& data);
+
+QMimeData* create_mime_data(const MapModel& map, const EntityIndexes& indexes);
+EntityModels create_entities(MapModel& map, const QMimeData& mime_data);
+
+}
+
+}
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_ENTITY_SPATIAL_INDEX_H
+#define SOLARUSEDITOR_ENTITY_SPATIAL_INDEX_H
+
+#include "entities/entity_traits.h"
+#include <QHash>
+#include <QMap>
+#include <QRect>
+#include <QVector>
+
+namespace SolarusEditor {
+
+class EntityModel;
+
+/**
+ * @brief Finds the entities of a map from their position.
+ *
+ * Each layer is divided in square buckets of a fixed size,
+ * and each entity is stored in the buckets its bounding box overlaps.
+ * Point and rectangle queries only look at the buckets they overlap,
+ * so their cost depends on the number of entities found and not on the
+ * total number of entities of the map.
+ *
+ * Entities are identified by their model, whose address does not change
+ * when their index does.
+ * The owner of the index must call update() when the bounding box or the
+ * layer of an entity may have changed.
+ */
+class EntitySpatialIndex {
+
+public:
+
+  EntitySpatialIndex();
+
+  void clear();
+  void add(const EntityModel& entity);
+  void remove(const EntityModel& entity);
+  void update(const EntityModel& entity);
+
+  EntityIndexes find_entities_in_rectangle(int layer, const QRect& rectangle) const;
+  EntityIndexes find_entities_at_point(int layer, const QPoint& xy) const;
+
+private:
+
+  /**
+   * @brief Position of an entity in the index.
+   */
+  struct Location {
+    int layer;                             /**< Layer of the entity. */
+    QRect box;                             /**< Bounding box of the entity,
+                                            * at least 1x1 pixel. */
+  };
+
+  using Bucket = QVector<const EntityModel*>;
+  using Buckets = QHash<quint64, Bucket>;
+
+  static constexpr int bucket_size = 256; /**< Size of a bucket in pixels. */
+
+  static quint64 get_bucket_key(int bucket_x, int bucket_y);
+  static QRect get_bucket_range(const QRect& box);
+  static QRect get_location_box(const EntityModel& entity);
+
+  void insert(const EntityModel& entity, const Location& location);
+  void erase(const EntityModel& entity, const Location& location);
+
+  QMap<int, Buckets> buckets;              /**< Entities in each bucket, by layer. */
+  QHash<const EntityModel*, Location>
+      locations;                           /**< Where each entity is stored. */
+
+};
+
+}
+
+#endif
@@ -19,7 +19,8 @@
 
 #include "natural_comparator.h"
 #include <QString>
-#include <map>
+#include <QStringList>
+#include <vector>
 
 namespace SolarusEditor {
 
@@ -27,6 +28,10 @@ namespace SolarusEditor {
  * @brief Tree of indexed string keys.
  * This class provides methods to manage a map indexed by string like a tree
  * for a QAbstractItemModel (see StringsModel and DialogsModel).
+ *
+ * Children of a node are stored in a vector sorted by sub key,
+ * so that accessing a row is immediate and finding a key or the row of a key
+ * is a binary search.
  */
 class IndexedStringTree {
 
@@ -55,6 +60,7 @@ public:
   bool can_remove_ref(const QString& key, QString& parent_key, int& index);
   bool remove_ref(const QString& key, bool keep_key = false);
 
+  void build(const QStringList& keys);
   void clear();
 
 private:
@@ -69,24 +75,29 @@ private:
   struct Node {
 
     /** Constructor. */
-    Node() : parent(nullptr), index(0), type(CONTAINER) {
+    Node() : parent(nullptr), type(CONTAINER) {
     }
 
     Node* parent;   /**< The parent node. */
-    int index;      /**< The index of the node. */
 
+    QString sub_key; /**< The last part of the key,
+                      * used to sort the node among its siblings. */
     QString key;    /**< The internal key of the node
                      * (complete key from the root). */
 
     int type;       /**< Type of the node. */
 
-    std::map<QString, Node*, NaturalComparator>
-      children;     /**< Children of the node. */
+    std::vector<Node*>
+      children;     /**< Children of the node sorted by sub key. */
   };
 
   Node* get_child(const QString& key) const;
 
   Node* get_sub_child(const Node* node, const QString& sub_key) const;
+  int get_sub_child_position(const Node* node, const QString& sub_key) const;
+  int get_node_index(const Node* node) const;
+
+  Node* create_child(Node* parent, const QString& sub_key, int position);
 
   bool add_child(const QString& key, int type, QString& parent_key, int& index);
 
@@ -94,12 +105,12 @@ private:
       const QString& key, int type, QString& parent_key, int& index);
   bool remove_child(const QString& key, int type, bool keep_key = false);
 
-  void build_index_map(const Node* node) const;
-
   void clear_children(Node *node);
 
   QString separator;  /**< The separator character. */
   Node* root;         /**< The root node of the tree. */
+  NaturalComparator
+      comparator;     /**< Order of sub keys among siblings. */
 
 };
 
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_MAP_INDEX_H
+#define SOLARUSEDITOR_MAP_INDEX_H
+
+#include "entities/entity_traits.h"
+#include "quest_resources.h"
+#include <QDateTime>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QSet>
+#include <QSize>
+
+namespace SolarusEditor {
+
+class Quest;
+
+/**
+ * @brief Summary of the maps of a quest.
+ *
+ * Many parts of the editor only need a few properties of a map,
+ * like its tileset or the names of its entities.
+ * This index keeps such information for all maps so that they can be
+ * queried without creating a MapModel, which would load the tileset
+ * and build a model for each entity.
+ *
+ * A map is only read the first time it is queried and again when its
+ * data file has changed on the disk.
+ */
+class MapIndex : public QObject {
+  Q_OBJECT
+
+public:
+
+  /**
+   * @brief A named entity of a map.
+   */
+  struct NamedEntity {
+    QString name;                  /**< Name of the entity. */
+    EntityType type;               /**< Type of the entity. */
+    int layer;                     /**< Layer of the entity. */
+  };
+
+  /**
+   * @brief Information about a map.
+   */
+  struct MapInfo {
+    bool valid = false;            /**< false if the map file could not be read. */
+    QString tileset_id;            /**< Tileset of the map. */
+    QString music_id;              /**< Music of the map, "none" or "same". */
+    QSize size;                    /**< Size of the map in pixels. */
+    int min_layer = 0;             /**< Lowest layer of the map. */
+    int max_layer = 0;             /**< Highest layer of the map. */
+    QString world;                 /**< World of the map if any. */
+    QList<NamedEntity>
+        named_entities;            /**< Named entities sorted by name. */
+    QSet<QString> pattern_ids;     /**< Tile patterns used by tiles. */
+    QSet<QString>
+        destination_maps;          /**< Maps targeted by teletransporters. */
+    QSet<QString> enemy_breeds;    /**< Breeds of enemies. */
+    QSet<QString>
+        custom_entity_models;      /**< Models of custom entities. */
+  };
+
+  explicit MapIndex(Quest& quest);
+
+  MapInfo get_map_info(const QString& map_id);
+  QStringList get_maps_using(ResourceType resource_type, const QString& element_id);
+  QStringList get_maps_using_pattern(const QString& tileset_id, const QString& pattern_id);
+
+public slots:
+
+  void clear();
+  void invalidate(const QString& map_id);
+
+private slots:
+
+  void resource_element_changed(ResourceType type, const QString& id);
+  void resource_element_renamed(ResourceType type, const QString& old_id, const QString& new_id);
+
+private:
+
+  /**
+   * @brief A map known by the index.
+   */
+  struct Entry {
+    MapInfo info;                  /**< Information about the map. */
+    QDateTime last_modified;       /**< Date of the data file when
+                                    * the map was read. */
+    qint64 file_size = -1;         /**< Size of the data file when
+                                    * the map was read. */
+  };
+
+  const Entry& get_entry(const QString& map_id);
+  MapInfo read_map_info(const QString& map_id) const;
+
+  Quest& quest;                    /**< The quest. */
+  QMap<QString, Entry> entries;    /**< Information of maps already read. */
+
+};
+
+}
+
+#endif
@@ -18,7 +18,9 @@
 #define SOLARUSEDITOR_MAP_MODEL_H
 
 #include "entities/entity_model.h"
+#include "entity_spatial_index.h"
 #include "sprite_model.h"
+#include <QThreadPool>
 #include <array>
 #include <memory>
 
@@ -28,6 +30,7 @@ struct AddableEntity;
 class Quest;
 class QuestResources;
 class TilesetModel;
+class TilesetSelectionModel;
 class ViewSettings;
 
 using AddableEntities = std::deque<AddableEntity>;
@@ -48,11 +51,17 @@ public:
 
   // Creation.
   MapModel(Quest& quest, const QString& map_id, QObject* parent = nullptr);
+  ~MapModel();
 
   const Quest& get_quest() const;
   Quest& get_quest();
   QString get_map_id() const;
 
+  // Saving.
+  void start_save() const;
+  bool is_saving() const;
+  void wait_for_save() const;
+
   // Map properties.
   QSize get_size() const;
   void set_size(const QSize& size);
@@ -70,6 +79,7 @@ public:
   QPoint get_location() const;
   void set_location(const QPoint& location);
   TilesetModel* get_tileset_model() const;
+  TilesetSelectionModel* get_tileset_selection_model() const;
   QString get_tileset_id() const;
   void set_tileset_id(const QString& tileset_id);
   void reload_tileset();
@@ -89,6 +99,8 @@ public:
   bool is_common_type(const EntityIndexes& indexes, EntityType& type) const;
   bool are_tiles(const EntityIndexes& indexes) const;
   EntityIndexes find_entities_of_type(EntityType type) const;
+  EntityIndexes find_entities_in_rectangle(int layer, const QRect& rectangle) const;
+  EntityIndexes find_entities_at_point(int layer, const QPoint& xy) const;
   EntityIndex find_default_destination_index() const;
   QString get_entity_name(const EntityIndex& index) const;
   bool set_entity_name(const EntityIndex& index, const QString& name);
@@ -106,11 +118,13 @@ public:
   QPoint get_entity_xy(const EntityIndex& index) const;
   void set_entity_xy(const EntityIndex& index, const QPoint& xy);
   void add_entity_xy(const EntityIndex& index, const QPoint& translation);
+  void add_entities_xy(const EntityIndexes& indexes, const QPoint& translation);
   QPoint get_entity_top_left(const EntityIndex& index) const;
   void set_entity_top_left(const EntityIndex& index, const QPoint& top_left);
   QPoint get_entity_origin(const EntityIndex& index) const;
   QSize get_entity_size(const EntityIndex& index) const;
   void set_entity_size(const EntityIndex& index, const QSize& size);
+  void set_entities_size(const QMap<EntityIndex, QSize>& sizes);
   QSize get_entity_closest_base_size_multiple(const EntityIndex& index) const;
   QSize get_entity_closest_base_size_multiple(const EntityIndex& index, const QSize& size) const;
   bool is_entity_size_valid(const EntityIndex& index) const;
@@ -118,6 +132,7 @@ public:
   QSize get_entity_valid_size(const EntityIndex& index) const;
   QRect get_entity_bounding_box(const EntityIndex& index) const;
   void set_entity_bounding_box(const EntityIndex& index, const QRect& bounding_box);
+  void set_entities_bounding_box(const QMap<EntityIndex, QRect>& bounding_boxes);
   bool has_entity_direction_field(const EntityIndex& index) const;
   bool is_entity_no_direction_allowed(const EntityIndex& index) const;
   QString get_entity_no_direction_text(const EntityIndex& index) const;
@@ -125,6 +140,7 @@ public:
   bool is_common_direction_rules(const EntityIndexes& indexes, int& num_directions, QString& no_direction_text) const;
   int get_entity_direction(const EntityIndex& index) const;
   void set_entity_direction(const EntityIndex& index, int direction);
+  void set_entities_direction(const EntityIndexes& indexes, int direction);
   bool is_common_direction(const EntityIndexes& indexes, int& direction) const;
   int get_entity_user_property_count(const EntityIndex& index) const;
   QPair<QString, QString> get_entity_user_property(const EntityIndex& index, int property_index) const;
@@ -134,8 +150,11 @@ public:
   bool has_entity_field(const EntityIndex& index, const QString& key) const;
   QVariant get_entity_field(const EntityIndex& index, const QString& key) const;
   void set_entity_field(const EntityIndex& index, const QString& key, const QVariant& value);
+  void set_entities_field(const EntityIndexes& indexes, const QString& key, const QVariant& value);
   void add_entities(AddableEntities&& entities);
   AddableEntities remove_entities(const EntityIndexes& indexes);
+  QString entities_to_string(const EntityIndexes& indexes) const;
+  EntityModels create_entities_from_string(const QString& text);
 
   const Solarus::EntityData& get_internal_entity(const EntityIndex& index) const;
   Solarus::EntityData& get_internal_entity(const EntityIndex& index);
@@ -152,38 +171,73 @@ signals:
   void location_changed(const QPoint& location);
   void tileset_id_changed(const QString& tileset_id);
   void tileset_reloaded();
+  void sprites_reloaded(const EntityIndexes& indexes);
   void music_id_changed(const QString& music_id);
 
   void entities_about_to_be_added(const EntityIndexes& indexes);
   void entities_added(const EntityIndexes& indexes);
   void entities_about_to_be_removed(const EntityIndexes& indexes);
   void entities_removed(const EntityIndexes& indexes);
-  void entity_layer_changed(const EntityIndex& index_before, const EntityIndex& index_after);
+  void entities_layer_changed(const EntityIndexes& indexes_before, const EntityIndexes& indexes_after);
   void entity_order_changed(const EntityIndex& index_before, int order_after);
   void entity_name_changed(const EntityIndex& index, const QString& name);
   void entity_xy_changed(const EntityIndex& index, const QPoint& xy);
+  void entities_xy_changed(const EntityIndexes& indexes);
   void entity_size_changed(const EntityIndex& index, const QSize& size);
+  void entities_size_changed(const EntityIndexes& indexes);
   void entity_direction_changed(const EntityIndex& index, int direction);
+  void entities_direction_changed(const EntityIndexes& indexes, int direction);
   void entity_user_property_changed(const EntityIndex& index, int property_index, const QPair<QString, QString>& property);
   void entity_user_property_added(const EntityIndex& index, int property_index, const QPair<QString, QString>& property);
   void entity_user_property_removed(const EntityIndex& index, int property_index);
   void entity_field_changed(const EntityIndex& index, const QString& key, const QVariant& value);
+  void entities_field_changed(const EntityIndexes& indexes, const QString& key, const QVariant& value);
+
+  void save_failed(const QString& message);
 
 public slots:
 
   void save() const;
 
+private slots:
+
+  void cached_tileset_reloaded(const QString& tileset_id);
+  void cached_sprites_changed(const QStringList& sprite_ids);
+  void tileset_content_changed();
+  void notify_tileset_content_changed();
+  void save_task_finished();
+
 private:
 
+  struct SaveState;
+  class SaveTask;
+
+  void update_tileset_model();
+  void connect_tileset();
+  void move_entity_to_layer(EntityModel& entity, int layer_before, int layer_after);
+  void move_entity_to_order(EntityModel& entity, int layer, int order_after);
   void rebuild_entity_indexes(int layer);
 
   Quest& quest;                   /**< The quest the tileset belongs to. */
   const QString map_id;           /**< Id of the map. */
   Solarus::MapData map;           /**< Map data wrapped by this model. */
-  TilesetModel* tileset_model;    /**< Tileset of this map. nullptr if not set. */
+  std::shared_ptr<TilesetModel>
+      tileset_model;              /**< Tileset of this map, shared with other maps.
+                                   * nullptr if not set. */
+  TilesetSelectionModel*
+      tileset_selection_model;    /**< Patterns selected in the tileset view
+                                   * of this map. nullptr if no tileset. */
+  bool tileset_content_dirty;     /**< Whether entities need to be notified of
+                                   * changes in the tileset. */
   std::map<int, EntityModels>
       entities;                   /**< All entities by layer. */
+  EntitySpatialIndex
+      spatial_index;              /**< Entities by position. */
   QString current_border_set_id;  /**< Border set currently selected by the user. */
+  mutable QThreadPool
+      save_thread_pool;           /**< Writes the map file, one save at a time. */
+  std::shared_ptr<SaveState>
+      save_state;                 /**< Result of the saves in progress. */
 
 };
 
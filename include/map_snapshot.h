@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_MAP_SNAPSHOT_H
+#define SOLARUSEDITOR_MAP_SNAPSHOT_H
+
+#include <QString>
+
+namespace Solarus {
+class MapData;
+}
+
+namespace SolarusEditor {
+
+/**
+ * @brief Binary snapshots of parsed map data files.
+ *
+ * Parsing a map data file runs it as Lua code, which is slow for big maps.
+ * After a map is parsed or saved, a snapshot of the parsed data is written
+ * to the cache directory of the editor, outside the quest.
+ * Opening the map again reads the snapshot instead, as long as the data
+ * file still has the same path, size and modification date.
+ *
+ * Snapshots are only a cache: they can be deleted at any time
+ * and a snapshot that cannot be read is ignored.
+ */
+namespace MapSnapshot {
+
+QString get_snapshot_path(const QString& map_path);
+bool load(const QString& map_path, Solarus::MapData& map);
+bool save(const QString& map_path, const Solarus::MapData& map);
+
+}
+
+}
+
+#endif
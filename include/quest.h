@@ -17,8 +17,13 @@
 #ifndef SOLARUSEDITOR_QUEST_H
 #define SOLARUSEDITOR_QUEST_H
 
+#include <map_index.h>
+#include <quest_file_watcher.h>
 #include <quest_properties.h>
+#include <quest_search_index.h>
 #include <quest_resources.h>
+#include <sprite_cache.h>
+#include <tileset_cache.h>
 #include <solarus/core/ResourceType.h>
 #include <QObject>
 #include <QSet>
@@ -54,6 +59,12 @@ public:
   const QuestResources& get_resources() const;
   QuestResources& get_resources();
 
+  QuestFileWatcher& get_file_watcher() const;
+  MapIndex& get_map_index() const;
+  SpriteCache& get_sprite_cache() const;
+  TilesetCache& get_tileset_cache() const;
+  QuestSearchIndex& get_search_index() const;
+
   // Get paths.
   QString get_name() const;
   QString get_data_path() const;
@@ -176,6 +187,17 @@ private:
 
   QuestProperties properties;      /**< Properties given in quest.dat. */
   QuestResources resources;        /**< Resources declared in project_db.dat. */
+  // Caches and indexes are not part of the quest data:
+  // they are mutable so that they are available from a const quest too.
+  mutable QuestFileWatcher
+      file_watcher;                /**< Files loaded by the caches below. */
+  mutable MapIndex map_index;      /**< Summary of all maps. */
+  mutable SpriteCache
+      sprite_cache;                /**< Sprites shared by all maps. */
+  mutable TilesetCache
+      tileset_cache;               /**< Tilesets shared by all maps and editors. */
+  mutable QuestSearchIndex
+      search_index;                /**< Text of all text files. */
   QString current_music_id;        /**< Id of the music currently playing if any. */
 
 };
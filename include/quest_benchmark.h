@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_QUEST_BENCHMARK_H
+#define SOLARUSEDITOR_QUEST_BENCHMARK_H
+
+#include <QJsonArray>
+#include <QString>
+#include <functional>
+#include <vector>
+
+namespace SolarusEditor {
+
+class Quest;
+
+/**
+ * @brief Measures the time of expensive editor operations on a quest.
+ *
+ * The quest is expected to be generated by SyntheticQuestBuilder:
+ * benchmarks work on its first map, its tileset and its language.
+ *
+ * Each benchmark runs several times and keeps the mean, minimum
+ * and maximum durations, so that results of different versions of the
+ * editor can be compared to catch regressions.
+ *
+ * Scenes are painted into images, so this only needs the offscreen
+ * platform of Qt, but a QApplication must exist.
+ */
+class QuestBenchmark {
+
+public:
+
+  /**
+   * @brief Durations measured for a benchmark.
+   */
+  struct Result {
+    QString name;                  /**< Name of the benchmark. */
+    int iterations = 0;            /**< Number of runs. */
+    double mean_ms = 0.0;          /**< Mean duration in milliseconds. */
+    double min_ms = 0.0;           /**< Shortest duration in milliseconds. */
+    double max_ms = 0.0;           /**< Longest duration in milliseconds. */
+  };
+
+  QuestBenchmark(Quest& quest, int num_iterations);
+
+  void run();
+
+  const std::vector<Result>& get_results() const;
+  QJsonArray get_results_json() const;
+
+private:
+
+  void measure(
+      const QString& name,
+      const std::function<void()>& action,
+      const std::function<void()>& setup = nullptr);
+
+  void benchmark_map_load();
+  void benchmark_map_save();
+  void benchmark_auto_tiler();
+  void benchmark_scene();
+  void benchmark_copy_paste();
+  void benchmark_refactoring();
+  void benchmark_tree_models();
+  void benchmark_quest_check();
+
+  Quest& quest;                    /**< The quest to work on. */
+  int num_iterations;              /**< Number of runs of each benchmark. */
+  std::vector<Result> results;     /**< Results of benchmarks already run. */
+
+};
+
+}
+
+#endif
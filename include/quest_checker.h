@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_QUEST_CHECKER_H
+#define SOLARUSEDITOR_QUEST_CHECKER_H
+
+#include "entities/entity_traits.h"
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <memory>
+#include <vector>
+
+class QTextStream;
+
+namespace SolarusEditor {
+
+class MapModel;
+class Quest;
+class TilesetModel;
+
+/**
+ * @brief Loads all resources of a quest and reports problems.
+ *
+ * Every map, tileset, sprite, dialogs file and strings file is loaded
+ * with the same models as the editor, and broken references
+ * (missing patterns, sprites, destinations...) are reported,
+ * together with the time spent loading each file.
+ *
+ * Tilesets, sprites, dialogs and strings are loaded on worker threads.
+ * Maps are loaded on the calling thread at the same time,
+ * because they share tilesets through the quest.
+ * References to patterns and sprites are checked once everything is loaded.
+ *
+ * This does not need a display and is used by the command-line
+ * check mode.
+ */
+class QuestChecker : public QObject {
+  Q_OBJECT
+
+public:
+
+  /**
+   * @brief Result of loading a file.
+   */
+  struct FileReport {
+    QString file_type;             /**< Kind of file: map, tileset, sprite,
+                                    * dialogs or strings. */
+    QString element_id;            /**< Id of the resource element. */
+    bool loaded = false;           /**< Whether the model could be created. */
+    qint64 load_time = 0;          /**< Time to create the model in microseconds. */
+    QStringList errors;            /**< Problems found in this file. */
+  };
+
+  explicit QuestChecker(Quest& quest);
+
+  void check();
+
+  const std::vector<FileReport>& get_reports() const;
+  int get_num_errors() const;
+  qint64 get_total_time() const;
+
+  void print_report(QTextStream& out, bool verbose) const;
+
+private:
+
+  /**
+   * @brief A reference from a map to an element that is checked
+   * after all worker threads are done.
+   */
+  struct PendingReference {
+    int report_index;              /**< Report of the map. */
+    QString entity_description;    /**< Entity that makes the reference. */
+    QString tileset_id;            /**< Tileset of the pattern, if any. */
+    QString element_id;            /**< Pattern or sprite referenced. */
+  };
+
+  class LoadTask;
+
+  void load_map(const QString& map_id, FileReport& report, int report_index);
+  void check_entity(
+      const MapModel& map,
+      const EntityIndex& index,
+      FileReport& report,
+      int report_index);
+  void check_resource(
+      ResourceType resource_type,
+      const QString& element_id,
+      const QString& entity_description,
+      FileReport& report);
+  void check_destination(
+      const QString& map_id,
+      const QString& destination_name,
+      const QString& entity_description,
+      FileReport& report);
+  void check_pending_references();
+
+  Quest& quest;                    /**< The quest to check. */
+  std::vector<FileReport> reports; /**< Result of each file. */
+  std::vector<QSet<QString>>
+      defined_ids;                 /**< Patterns of each tileset report,
+                                    * in the same order as reports. */
+  QList<PendingReference>
+      pattern_references;          /**< Tile patterns used by maps. */
+  QList<PendingReference>
+      sprite_references;           /**< Sprites used by map entities. */
+  QHash<QString, std::shared_ptr<TilesetModel>>
+      map_tilesets;                /**< Tilesets kept for all maps. */
+  qint64 total_time;               /**< Time of the whole check in milliseconds. */
+
+};
+
+}
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_QUEST_FILE_WATCHER_H
+#define SOLARUSEDITOR_QUEST_FILE_WATCHER_H
+
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+
+namespace SolarusEditor {
+
+class Quest;
+
+/**
+ * @brief Watches files of a quest that are cached in memory.
+ *
+ * Caches of the quest register the files they have loaded.
+ * When a file is modified outside the editor, files_changed() is emitted
+ * so that each cache can forget or reload what depends on it.
+ *
+ * Image editors and version control tools often write a file several
+ * times in a row, or many files at once.
+ * Changes are coalesced: files_changed() is emitted once, a short delay
+ * after the last change of a burst, with all paths that changed.
+ */
+class QuestFileWatcher : public QObject {
+  Q_OBJECT
+
+public:
+
+  explicit QuestFileWatcher(Quest& quest);
+
+  void watch_file(const QString& path);
+  void watch_files(const QStringList& paths);
+
+public slots:
+
+  void clear();
+
+signals:
+
+  void files_changed(const QStringList& paths);
+
+private slots:
+
+  void file_changed(const QString& path);
+  void flush_changes();
+
+private:
+
+  static constexpr int flush_delay = 300;  /**< Delay in milliseconds without
+                                            * change before notifying. */
+
+  QFileSystemWatcher watcher;      /**< Watches registered files. */
+  QSet<QString> watched_paths;     /**< Files registered, including ones being
+                                    * replaced right now. */
+  QSet<QString> changed_paths;     /**< Files changed since the last notification. */
+  QTimer flush_timer;              /**< Notifies changes after a burst. */
+
+};
+
+}
+
+#endif
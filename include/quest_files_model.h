@@ -18,9 +18,12 @@
 #define SOLARUSEDITOR_QUEST_FILES_MODEL_H
 
 #include "quest_resources.h"
+#include <QHash>
+#include <QIcon>
 #include <QSet>
 #include <QSortFilterProxyModel>
 #include <array>
+#include <set>
 
 class QFileSystemModel;
 
@@ -41,6 +44,10 @@ class Quest;
  * Similarly, existing files whose name looks like a resource but that are not
  * declared in the resource list appear in the model with an interrogation mark
  * icon.
+ *
+ * How each path is classified (resource directory, resource element, icon,
+ * tooltip...) is computed once and kept in a cache until the resource list
+ * or the file changes.
  */
 class QuestFilesModel : public QSortFilterProxyModel {
   Q_OBJECT
@@ -109,6 +116,25 @@ private:
 
   using ExtraPathColumnPtrs = std::array<QString*, NUM_COLUMNS>;
 
+  /**
+   * @brief What a path represents in the quest.
+   */
+  struct PathInfo {
+    bool resource_path = false;             /**< Whether this is the directory
+                                             * of a resource type. */
+    bool in_resource_path = false;          /**< Whether this is under the directory
+                                             * of a resource type. */
+    bool potential_resource_element = false;/**< Whether this can be a resource element,
+                                             * declared or not. */
+    bool resource_element = false;          /**< Whether this is a declared resource element. */
+    ResourceType resource_type =
+        ResourceType::MAP;                  /**< The resource type if any of the above. */
+    QString element_id;                     /**< The resource element id if any. */
+    QString type_name;                      /**< Text of the type column or an empty string. */
+    QIcon icon;                             /**< Icon of the file column. */
+    QString tooltip;                        /**< Tooltip of the file column. */
+  };
+
   /**
    * @brief For a directory, list of the paths added by this model but that
    * do not exist on the filesystem.
@@ -130,8 +156,11 @@ private:
     void rebuild_index_cache();
   };
 
-  QIcon get_quest_file_icon(const QModelIndex& index) const;
-  QString get_quest_file_tooltip(const QModelIndex& index) const;
+  PathInfo get_path_info(const QString& path) const;
+  void invalidate_path_info(const QString& path);
+  QString get_quest_file_type_name(const QString& path, const PathInfo& info) const;
+  QIcon get_quest_file_icon(const QString& path, const PathInfo& info) const;
+  QString get_quest_file_tooltip(const QString& path, const PathInfo& info) const;
   bool is_quest_data_index(const QModelIndex& index) const;
 
   bool is_dir_on_filesystem(const QModelIndex& index) const;
@@ -139,6 +168,12 @@ private:
   int get_num_extra_paths(const QModelIndex& parent) const;
   ExtraPaths* get_extra_paths(const QModelIndex& parent) const;
   void compute_extra_paths(const QModelIndex& parent) const;
+  void build_extra_paths(ResourceType resource_type) const;
+  void build_extra_paths(
+      ResourceType resource_type,
+      const QString& dir_path,
+      const QStringList& element_ids) const;
+  void forget_extra_paths(const QString& dir_path);
   void insert_extra_path(const QModelIndex& parent, const QString& path);
   void remove_extra_path(const QModelIndex& parent, const QString& path);
   void rebuild_extra_path_indexes_cache(const QModelIndex& parent);
@@ -152,6 +187,17 @@ private:
   mutable QSet<const QString*>
       all_extra_paths;                 /**< List of all paths stored in extra_paths
                                         * (redundant info for performance). */
+  mutable std::set<ResourceType>
+      extra_paths_built_types;         /**< Resource types whose extra paths are
+                                        * computed for all directories. */
+  mutable QSet<QString>
+      outdated_extra_paths_dirs;       /**< Directories whose files changed while
+                                        * they were not in this model: their extra
+                                        * paths need to be computed again. */
+  mutable QMap<QString, PathInfo>
+      path_infos;                      /**< Classification of paths already
+                                        * shown (cache), sorted so that
+                                        * paths under a directory are contiguous. */
 
 };
 
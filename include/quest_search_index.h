@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_QUEST_SEARCH_INDEX_H
+#define SOLARUSEDITOR_QUEST_SEARCH_INDEX_H
+
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QRegularExpression>
+#include <QSet>
+#include <QThreadPool>
+#include <QTimer>
+#include <memory>
+
+namespace SolarusEditor {
+
+class Quest;
+
+/**
+ * @brief Finds text in all text files of a quest.
+ *
+ * The index keeps the content of every text file of the data directory
+ * (scripts, data files, dialogs, strings...) and, for each trigram
+ * (sequence of three lowercase characters), the files that contain it.
+ * A query only looks at the files that contain all trigrams of its text,
+ * or of the longest literal part of its regular expression.
+ *
+ * build() reads the files on worker threads.
+ * Afterwards, directories are watched and files that are created,
+ * replaced or deleted are indexed again one by one.
+ * Editors that write a file in place call update_file() after saving it,
+ * since modifying a file does not change its directory.
+ * Files modified in place by other programs are indexed again when
+ * a search finds that their date or size changed.
+ */
+class QuestSearchIndex : public QObject {
+  Q_OBJECT
+
+public:
+
+  /**
+   * @brief An occurrence of the searched text.
+   */
+  struct Match {
+    QString path;                  /**< File containing the match. */
+    int line = 0;                  /**< Line of the match, starting at 1. */
+    int column = 0;                /**< Column of the match in the line, starting at 0. */
+    int length = 0;                /**< Length of the match. */
+    QString line_text;             /**< Content of the whole line. */
+  };
+
+  explicit QuestSearchIndex(Quest& quest);
+  ~QuestSearchIndex();
+
+  bool is_building() const;
+  int get_num_files() const;
+
+  QList<Match> find_text(
+      const QString& pattern,
+      bool regex,
+      bool case_sensitive,
+      int max_matches = 10000);
+
+  static bool is_text_file(const QString& path);
+
+public slots:
+
+  void build();
+  void clear();
+  void update_file(const QString& path);
+  void remove_file(const QString& path);
+
+signals:
+
+  void build_finished();
+
+private slots:
+
+  void merge_built_files();
+  void directory_changed(const QString& path);
+
+private:
+
+  /**
+   * @brief A file of the index.
+   */
+  struct File {
+    QString path;                  /**< Path of the file. */
+    QString content;               /**< Text of the file. */
+    QSet<quint64> trigrams;        /**< Lowercase trigrams of the text. */
+    QDateTime last_modified;       /**< Date of the file when it was read. */
+    qint64 size = 0;               /**< Size of the file when it was read. */
+  };
+
+  struct BuildState;
+  class IndexTask;
+  class MatchTask;
+
+  static bool read_file(const QString& path, File& file);
+  static quint64 get_trigram(const QChar* characters);
+  static QSet<quint64> get_trigrams(const QString& text);
+  static QList<Match> find_matches(
+      const File& file,
+      const QRegularExpression& expression,
+      int max_matches);
+  static QString get_required_literal(const QString& regex_pattern);
+  static int find_class_end(const QString& regex_pattern, int start);
+  static int find_group_end(const QString& regex_pattern, int start);
+
+  void wait_for_build();
+  void add_file(const File& file);
+  void watch_directories(const QString& root_path);
+  QStringList list_text_files(const QString& root_path) const;
+  QStringList get_candidate_files(const QString& literal) const;
+
+  Quest& quest;                    /**< The quest. */
+  QHash<QString, File> files;      /**< Indexed files by path. */
+  QHash<quint64, QSet<QString>>
+      trigram_files;               /**< Paths of files containing each trigram. */
+  QFileSystemWatcher watcher;      /**< Watches directories of the data path. */
+  std::shared_ptr<BuildState>
+      build_state;                 /**< Files being read by workers, if any. */
+  QSet<QString> pending_paths;     /**< Files to index again after the build. */
+  QSet<QString> pending_directories;
+                                   /**< Directories to scan again after the build. */
+  QTimer merge_timer;              /**< Merges files read by workers while building. */
+  QThreadPool thread_pool;         /**< Workers that read and search files. */
+
+};
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_REFACTORING_ENGINE_H
+#define SOLARUSEDITOR_REFACTORING_ENGINE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QRegularExpression>
+#include <QStringList>
+
+class QWidget;
+
+namespace SolarusEditor {
+
+class Quest;
+
+/**
+ * @brief Replaces text in many quest files at once.
+ *
+ * Refactorings like renaming a resource element must update every map
+ * that refers to it.
+ * Instead of loading each map, the engine does a textual replacement
+ * in the data files, in two steps:
+ * - scan() reads the files in parallel on worker threads and computes
+ *   their new content in memory, showing a progress dialog that lets
+ *   the user cancel the operation.
+ *   Files that do not contain all the prefilter texts are skipped
+ *   before being decoded.
+ * - commit() writes the modified files, each one atomically.
+ *
+ * Nothing is written on the disk until commit() is called, so a
+ * refactoring canceled during the scan leaves the quest unchanged.
+ */
+class RefactoringEngine {
+
+public:
+
+  RefactoringEngine(const QRegularExpression& regex, const QString& replacement);
+
+  void add_prefilter(const QString& text);
+
+  bool scan(const QStringList& paths, QWidget* parent);
+  bool scan_maps(const Quest& quest, QWidget* parent, const QString& excluded_map_id = QString());
+  QStringList get_pending_paths() const;
+  void rename_pending_file(const QString& old_path, const QString& new_path);
+  QStringList commit();
+
+private:
+
+  QRegularExpression regex;        /**< Text to replace. */
+  QString replacement;             /**< Replacement text. */
+  QList<QByteArray> prefilters;    /**< UTF-8 texts that a file must all
+                                    * contain to be processed. */
+  QMap<QString, QByteArray>
+      pending_contents;            /**< New UTF-8 content of each file to modify,
+                                    * indexed by path. */
+
+};
+
+}
+
+#endif
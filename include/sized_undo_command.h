@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_SIZED_UNDO_COMMAND_H
+#define SOLARUSEDITOR_SIZED_UNDO_COMMAND_H
+
+#include <QUndoCommand>
+
+namespace SolarusEditor {
+
+/**
+ * @brief An undoable command that knows how much memory it uses.
+ *
+ * The undo history of an editor has a memory limit: when it is exceeded,
+ * the oldest commands are forgotten.
+ * Commands that keep a lot of data should derive from this class
+ * and report it.
+ */
+class SizedUndoCommand : public QUndoCommand {
+
+public:
+
+  /**
+   * @brief Creates a command.
+   * @param text Text of the command in the history.
+   */
+  explicit SizedUndoCommand(const QString& text) :
+    QUndoCommand(text) {
+  }
+
+  /**
+   * @brief Returns an estimation of the memory used by this command.
+   * @return The size in bytes.
+   */
+  virtual qint64 get_memory_size() const {
+    return sizeof(*this);
+  }
+
+};
+
+}
+
+#endif
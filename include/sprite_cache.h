@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_SPRITE_CACHE_H
+#define SOLARUSEDITOR_SPRITE_CACHE_H
+
+#include <QDateTime>
+#include <QMap>
+#include <QObject>
+#include <QPair>
+#include <QStringList>
+#include <memory>
+
+namespace SolarusEditor {
+
+class Quest;
+class SpriteModel;
+
+/**
+ * @brief Sprite models shared by all users of a quest.
+ *
+ * Displaying entities only needs read-only sprites, and many entities
+ * of a map usually show the same few sprites.
+ * This cache loads each sprite data file once and hands out the same
+ * SpriteModel to everyone who asks for it with the same tileset.
+ *
+ * Sprites are reference-counted: a sprite is kept in memory as long as
+ * someone holds it and is forgotten afterwards.
+ * A cached sprite is replaced by a fresh one when its data file
+ * was modified since it was loaded.
+ * When the data file or an image of a sprite in memory is modified,
+ * either outside the editor or by the sprite editor, the sprite
+ * is forgotten and sprites_changed() is emitted so that its holders
+ * get the fresh one.
+ *
+ * Sprites obtained from this cache must not be modified:
+ * the sprite editor works on its own SpriteModel.
+ */
+class SpriteCache : public QObject {
+  Q_OBJECT
+
+public:
+
+  explicit SpriteCache(Quest& quest);
+
+  std::shared_ptr<const SpriteModel> get_sprite(
+      const QString& sprite_id, const QString& tileset_id);
+  int get_num_sprites() const;
+
+public slots:
+
+  void clear();
+  void invalidate(const QString& sprite_id);
+
+signals:
+
+  void sprites_changed(const QStringList& sprite_ids);
+
+private slots:
+
+  void files_changed(const QStringList& paths);
+
+private:
+
+  /**
+   * @brief A sprite known by the cache.
+   */
+  struct Entry {
+    std::weak_ptr<const SpriteModel> sprite;  /**< The sprite if still alive. */
+    QDateTime last_modified;                  /**< Date of the data file when
+                                               * the sprite was loaded. */
+    QStringList files;                        /**< Data file and images
+                                               * of the sprite. */
+  };
+
+  using Key = QPair<QString, QString>;        /**< Sprite id and tileset id. */
+
+  bool remove_entries(const QString& sprite_id);
+  void remove_expired_entries();
+
+  Quest& quest;                    /**< The quest. */
+  QMap<Key, Entry> entries;        /**< Sprites currently shared. */
+
+};
+
+}
+
+#endif
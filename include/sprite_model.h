@@ -163,6 +163,7 @@ public:
 
   // Images.
   QImage get_animation_image(const Index& index) const;
+  QStringList get_image_paths() const;
   QList<QPixmap> get_direction_all_frames(const Index& index) const;
   QPixmap get_direction_first_frame(const Index& index) const;
   QPixmap get_direction_frame(const Index& index, int frame) const;
@@ -200,6 +201,7 @@ signals:
 public slots:
 
   void save() const;
+  void reload_images(const QStringList& paths);
 
 private:
 
@@ -272,6 +274,7 @@ private:
 
   void build_index_map();
 
+  QString get_animation_image_path(const Index& index) const;
   void set_animation_image_dirty(const Index& index);
   void set_direction_image_dirty(const Index& index);
 
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_SYNTHETIC_QUEST_BUILDER_H
+#define SOLARUSEDITOR_SYNTHETIC_QUEST_BUILDER_H
+
+#include <QString>
+
+namespace SolarusEditor {
+
+/**
+ * @brief Generates quests of a chosen size to measure the editor.
+ *
+ * The generated quest is the initial quest plus:
+ * - a tileset with a given number of patterns and a border set,
+ * - maps filled with tiles of this tileset on each layer,
+ *   linked to each other by teletransporters,
+ * - dialogs and strings in the initial language.
+ *
+ * Contents are pseudo-random but the same parameters always give
+ * the same quest.
+ */
+namespace SyntheticQuestBuilder {
+
+/**
+ * @brief Size of the quest to generate.
+ */
+struct Parameters {
+  int num_maps = 10;               /**< Number of maps. */
+  int num_layers = 3;              /**< Number of layers of each map. */
+  int num_tiles_per_layer = 10000; /**< Number of tiles of each layer of a map. */
+  int num_patterns = 500;          /**< Number of patterns of the tileset. */
+  int num_dialogs = 2000;          /**< Number of dialogs and of strings. */
+};
+
+QString get_tileset_id();
+QString get_border_set_id();
+QString get_language_id();
+QString get_map_id(int map_index);
+QString get_pattern_id(int pattern_index);
+
+void create_quest(const QString& quest_path, const Parameters& parameters);
+
+}
+
+}
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_TILESET_CACHE_H
+#define SOLARUSEDITOR_TILESET_CACHE_H
+
+#include <QMap>
+#include <QObject>
+#include <QSet>
+#include <memory>
+
+namespace SolarusEditor {
+
+class Quest;
+class TilesetModel;
+
+/**
+ * @brief Tileset models shared by all maps and the tileset editor.
+ *
+ * A tileset is loaded once, together with its image and pattern caches,
+ * no matter how many open maps use it.
+ * The tileset editor works on the same instance,
+ * so maps immediately see the modifications made there.
+ *
+ * Tilesets are reference-counted: a tileset is kept in memory as long as
+ * someone holds it and is forgotten afterwards.
+ * When the image of a tileset in memory is modified outside the editor,
+ * the tileset reloads it.
+ *
+ * The tileset editor marks the tileset it edits as modified while it has
+ * unsaved changes: such a tileset cannot be reloaded from its files,
+ * since this would silently discard the changes.
+ */
+class TilesetCache : public QObject {
+  Q_OBJECT
+
+public:
+
+  explicit TilesetCache(Quest& quest);
+
+  std::shared_ptr<TilesetModel> get_tileset(const QString& tileset_id);
+  int get_num_tilesets() const;
+  bool is_tileset_modified(const QString& tileset_id) const;
+  void set_tileset_modified(const QString& tileset_id, bool modified);
+
+public slots:
+
+  void clear();
+  void reload(const QString& tileset_id);
+
+signals:
+
+  void tileset_reloaded(const QString& tileset_id);
+
+private slots:
+
+  void files_changed(const QStringList& paths);
+
+private:
+
+  void remove_expired_entries();
+
+  Quest& quest;                    /**< The quest. */
+  QMap<QString, std::weak_ptr<TilesetModel>>
+      tilesets;                    /**< Tilesets currently shared. */
+  QSet<QString>
+      modified_tileset_ids;        /**< Tilesets with unsaved changes. */
+
+};
+
+}
+
+#endif
@@ -20,13 +20,13 @@
 #include "natural_comparator.h"
 #include "pattern_animation.h"
 #include "pattern_separation.h"
+#include "tileset_selection_model.h"
 #include <solarus/entities/TilesetData.h>
 #include <QAbstractItemModel>
+#include <QHash>
 #include <QImage>
-#include <QItemSelectionModel>
 #include <QList>
 #include <QPixmap>
-#include <map>
 
 namespace SolarusEditor {
 
@@ -45,7 +45,7 @@ using BorderKind = Solarus::BorderKind;
  * for performance.
  * Signals are sent when something changes in the wrapped tileset.
  * This model can be used as a model for a list view of tile patterns.
- * It also stores the selection information.
+ * It also stores the selection of the tileset editor.
  */
 class TilesetModel : public QAbstractListModel {
   Q_OBJECT
@@ -103,12 +103,14 @@ public:
 
   QPixmap get_pattern_image(int index) const;
   QPixmap get_pattern_image_all_frames(int index) const;
+  QPixmap get_pattern_frame_image(int index, int frame_index) const;
+  QPixmap get_pattern_tiled_image(int index) const;
   QPixmap get_pattern_icon(int index) const;
   QImage get_patterns_image() const;
   void reload_patterns_image();
 
-  // Selected patterns.
-  QItemSelectionModel& get_selection_model();
+  // Patterns selected in the tileset editor.
+  TilesetSelectionModel& get_selection_model();
   bool is_selection_empty() const;
   int get_selection_count() const;
   int get_selected_index() const;
@@ -194,6 +196,8 @@ private:
     void set_image_dirty() const {
       image = QPixmap();
       image_all_frames = QPixmap();
+      frame_images.clear();
+      tiled_image = QPixmap();
       icon = QPixmap();
     }
 
@@ -205,24 +209,40 @@ private:
         image_all_frames;         /**< Full-size image of the pattern,
                                    * with all frames for multi-frame
                                    * patterns. */
+    mutable QVector<QPixmap>
+        frame_images;             /**< Full-size image of each frame,
+                                   * created on demand. */
+    mutable QPixmap tiled_image;  /**< Image of the pattern repeated
+                                   * in the directions it can be resized,
+                                   * drawn by tiles of this pattern. */
     mutable QPixmap icon;         /**< 32x32 icon of the pattern. */
   };
 
+  static constexpr int min_tiled_image_size = 64;  /**< Minimum size of tiled images
+                                                    * in each repeated direction. */
+
   void build_index_map();
+  void update_stale_indexes() const;
+  int get_sorted_position(const QString& pattern_id, int ignored_index = -1) const;
 
   Quest& quest;                   /**< The quest the tileset belongs to. */
   const QString tileset_id;       /**< Id of the tileset. */
   Solarus::TilesetData tileset;   /**< Tileset data wrapped by this model. */
   QImage patterns_image;          /**< PNG image of all tile patterns. */
 
-  std::map<QString, int, NaturalComparator>
+  mutable QHash<QString, int>
       ids_to_indexes;             /**< Index in the list of each pattern.
-                                   * The order is determined here. */
+                                   * Indexes from first_stale_index
+                                   * may be outdated. */
+  mutable int first_stale_index;  /**< First index of the list whose pattern
+                                   * may have a wrong index in
+                                   * ids_to_indexes. */
+  NaturalComparator comparator;   /**< Order of patterns in the list. */
   QList<PatternModel>
-      patterns;                   /**< All patterns. */
+      patterns;                   /**< All patterns, in natural order of ids. */
 
-  QItemSelectionModel
-      selection_model;            /**< Patterns currently selected. */
+  TilesetSelectionModel
+      selection_model;            /**< Patterns selected in the tileset editor. */
 
 };
 
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_TILESET_SELECTION_MODEL_H
+#define SOLARUSEDITOR_TILESET_SELECTION_MODEL_H
+
+#include <QItemSelectionModel>
+#include <QList>
+
+namespace SolarusEditor {
+
+class TilesetModel;
+
+/**
+ * @brief Patterns selected in a view of a tileset.
+ *
+ * A tileset model is shared by all maps that use it and by the tileset editor,
+ * so the selection is not stored in the tileset itself:
+ * each map and each dialog showing the tileset has its own selection.
+ * The tileset model provides the selection of the tileset editor.
+ */
+class TilesetSelectionModel : public QItemSelectionModel {
+  Q_OBJECT
+
+public:
+
+  explicit TilesetSelectionModel(TilesetModel& tileset, QObject* parent = nullptr);
+
+  bool is_selection_empty() const;
+  int get_selection_count() const;
+  int get_selected_index() const;
+  QList<int> get_selected_indexes() const;
+  void set_selected_index(int index);
+  void set_selected_indexes(const QList<int>& indexes);
+  void add_to_selected(int index);
+  void add_to_selected(const QList<int>& indexes);
+  bool is_selected(int index) const;
+  void toggle_selected(int index);
+  void select_all();
+  void clear_selection();
+
+};
+
+}
+
+#endif
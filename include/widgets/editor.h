@@ -54,6 +54,7 @@ public:
   QIcon get_icon() const;
   const QUndoStack& get_undo_stack() const;
   QUndoStack& get_undo_stack();
+  qint64 get_undo_memory_size() const;
   const QMap<QString, QAction*>& get_common_actions() const;
   void set_common_actions(const QMap<QString, QAction*>& common_actions);
   bool has_unsaved_changes() const;
@@ -72,6 +73,8 @@ public:
   ViewSettings& get_view_settings();
 
   virtual void save() = 0;
+  virtual void wait_for_save();
+  virtual bool is_saving() const;
   virtual bool can_cut() const;
   virtual void cut();
   virtual bool can_copy() const;
@@ -90,6 +93,7 @@ signals:
   void can_paste_changed(bool can_paste);
   void open_file_requested(Quest& quest, const QString& path);
   void refactoring_requested(const Refactoring& refactoring);
+  void undo_memory_size_changed(qint64 size);
 
 public slots:
 
@@ -115,13 +119,18 @@ protected:
   void set_close_confirm_message(const QString& message);
 
   bool try_command(QUndoCommand* command);
+  bool try_attached_command(QUndoCommand* command);
 
 private slots:
 
   void application_state_changed(Qt::ApplicationState state);
+  void undo_stack_index_changed();
 
 private:
 
+  bool try_command(QUndoCommand* command, bool attach_to_last);
+  void limit_undo_memory();
+
   Quest& quest;                             /**< The quest the edited file belongs to. */
   QString file_path;                        /**< Path of the edited file. */
   QString title;                            /**< Title of the file. */
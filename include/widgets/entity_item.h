@@ -52,6 +52,9 @@ public:
   void update_xy();
   void update_size();
 
+  bool is_content_cached() const;
+  void set_content_cached(bool content_cached);
+
 protected:
 
   void paint(QPainter* painter,
@@ -64,6 +67,8 @@ private:
   QSize size;               /**< Current size of the item.
                              * TODO for some entities like NPC, it could be larger
                              * than the entity's bounding box because of sprites. */
+  bool content_cached;      /**< Whether the entity is drawn by another item
+                             * and this item only draws the selection. */
 
 };
 
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_FIND_IN_QUEST_DIALOG_H
+#define SOLARUSEDITOR_FIND_IN_QUEST_DIALOG_H
+
+#include <QDialog>
+
+class QCheckBox;
+class QLabel;
+class QLineEdit;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+namespace SolarusEditor {
+
+class Quest;
+
+/**
+ * @brief A dialog to find text in all text files of a quest.
+ *
+ * Results are grouped by file.
+ * Double-clicking a result asks to open its file at the matching line.
+ */
+class FindInQuestDialog : public QDialog {
+  Q_OBJECT
+
+public:
+
+  explicit FindInQuestDialog(Quest& quest, QWidget* parent = nullptr);
+
+signals:
+
+  void open_file_requested(const QString& path, int line);
+
+private slots:
+
+  void find();
+  void item_activated(QTreeWidgetItem* item);
+  void update_status();
+
+private:
+
+  Quest& quest;                   /**< The quest to search. */
+  QLineEdit* find_field;          /**< The text to find. */
+  QCheckBox* regex_check_box;     /**< Whether the text is a regular expression. */
+  QCheckBox* case_check_box;      /**< Whether the search is case sensitive. */
+  QTreeWidget* results_tree;      /**< Matches grouped by file. */
+  QLabel* status_label;           /**< Status of the index or number of matches. */
+
+};
+
+}
+
+#endif
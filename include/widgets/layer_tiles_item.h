@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUSEDITOR_LAYER_TILES_ITEM_H
+#define SOLARUSEDITOR_LAYER_TILES_ITEM_H
+
+#include <QCache>
+#include <QGraphicsItem>
+#include <QPixmap>
+
+namespace SolarusEditor {
+
+class MapScene;
+
+/**
+ * @brief Graphic item drawing all static tiles of a map layer.
+ *
+ * Painting tens of thousands of tile items one by one makes scrolling and
+ * zooming big maps slow.
+ * Instead, this item renders the static tiles of its layer into offscreen
+ * chunks of a fixed size and paints the chunks.
+ * A chunk is only rendered again when a tile that overlaps it changes.
+ *
+ * When the view is zoomed out, chunks of a coarser level of detail are
+ * painted instead: a chunk of level n covers 2^n times more map pixels
+ * in each direction and is downsampled from the four chunks of level n-1
+ * below it, so that zoomed-out views draw a few images
+ * of the size of the screen instead of many big ones.
+ *
+ * Tiles are always before dynamic entities in a layer, so this item is
+ * stacked below all entity items of the layer.
+ * Tile entity items still exist to handle selection and mouse events,
+ * but they no longer draw their content.
+ * Tiles with an animated pattern are the exception: they change over time,
+ * so their own item draws them above the chunks, as well as static tiles
+ * that overlap them to keep the order of the map.
+ */
+class LayerTilesItem : public QGraphicsItem {
+
+public:
+
+  // Enable the use of qgraphicsitem_cast with this item.
+  enum {
+    Type = UserType + 3
+  };
+
+  int type() const override {
+    return Type;
+  }
+
+  LayerTilesItem(const MapScene& scene, int layer, QGraphicsItem* parent = nullptr);
+
+  int get_layer() const;
+  QRectF boundingRect() const override;
+
+  void update_size();
+  void invalidate(const QRect& area);
+  void invalidate_all();
+
+protected:
+
+  void paint(QPainter* painter,
+             const QStyleOptionGraphicsItem* option,
+             QWidget* widget = nullptr) override;
+
+private:
+
+  static constexpr int chunk_size = 512;        /**< Size of a chunk image in pixels. */
+  static constexpr int max_cached_chunks = 48;  /**< Maximum number of non-empty
+                                                 * chunks kept in memory (1 MiB each),
+                                                 * enough to fill a full HD view. */
+  static constexpr int max_level = 2;           /**< Coarsest level of detail,
+                                                 * enough for the minimum zoom. */
+
+  static int get_level(qreal level_of_detail);
+  static quint64 get_chunk_key(int level, int chunk_x, int chunk_y);
+  static QRect get_chunk_area(int level, int chunk_x, int chunk_y);
+  static QRect get_chunk_range(int level, const QRect& area);
+
+  QPixmap get_chunk(int level, int chunk_x, int chunk_y);
+  QPixmap render_chunk(int level, int chunk_x, int chunk_y) const;
+  QPixmap render_tiles(int chunk_x, int chunk_y) const;
+
+  const MapScene& scene;                 /**< The map scene. */
+  int layer;                             /**< Layer whose tiles are drawn. */
+  QSize size;                            /**< Current size of the map. */
+  QCache<quint64, QPixmap> chunks;       /**< Chunks already rendered.
+                                          * A null pixmap means an empty chunk. */
+
+};
+
+}
+
+#endif
@@ -17,18 +17,20 @@
 #ifndef SOLARUSEDITOR_LUA_SYNTAX_HIGHLIGHTER_H
 #define SOLARUSEDITOR_LUA_SYNTAX_HIGHLIGHTER_H
 
-#include <QRegExp>
+#include <QSet>
 #include <QSyntaxHighlighter>
 #include <QTextCharFormat>
-#include <QVector>
 
 namespace SolarusEditor {
 
 /**
  * @brief A simple syntax highlighter for Lua code.
  *
- * This class is highly inspired from Qt syntax highlighter example:
- * http://qt-project.org/doc/qt-4.8/richtext-syntaxhighlighter.html
+ * Each block is tokenized in a single pass.
+ * The state of a block tells whether it ends inside a long string or a
+ * long comment, and with which level of brackets ([[, [=[, [==[...).
+ * QSyntaxHighlighter then only highlights the next blocks again
+ * when this state changes.
  */
 class LuaSyntaxHighlighter : public QSyntaxHighlighter {
     Q_OBJECT
@@ -41,19 +43,25 @@ protected:
 
   virtual void highlightBlock(const QString& text) override;
 
+private:
+
   /**
-   * @brief A single-line highlighting rule.
+   * @brief Kind of multi-line token a block can end in.
    */
-  struct HighlightingRule {
-    QRegExp pattern;                             /**< A regexp. If it contains a capture, only the
-                                                  * captured text will be highlighted. */
-    QTextCharFormat format;                      /**< Format to apply to text matching the regexp. */
+  enum LongBracketKind {
+    NO_LONG_BRACKET = 0,
+    LONG_STRING = 1,
+    LONG_COMMENT = 2
   };
 
-  QVector<HighlightingRule> rules;               /**< The rule set. */
+  static int get_block_state(LongBracketKind kind, int level);
+  static int get_long_bracket_level(const QString& text, int index);
+  static int find_long_bracket_end(const QString& text, int index, int level);
+
+  int highlight_long_bracket(
+      const QString& text, int index, LongBracketKind kind, int level);
 
-  QRegExp comment_start_pattern;                 /**< Regexp of multi-line comments start. */
-  QRegExp comment_end_pattern;                   /**< Regexp of multi-line comments end. */
+  QSet<QString> keywords;                        /**< Lua keywords. */
 
   QTextCharFormat keyword_format;                /**< Format applied to Lua keywords. */
   QTextCharFormat single_line_comment_format;    /**< Format applied to single-line comments. */
@@ -70,6 +70,7 @@ private slots:
   void on_action_select_all_triggered();
   void on_action_unselect_all_triggered();
   void on_action_find_triggered();
+  void on_action_find_in_quest_triggered();
   void on_action_run_quest_triggered();
   void on_action_stop_music_triggered();
   void on_action_show_grid_triggered();
@@ -87,6 +88,7 @@ private slots:
   void current_editor_changed(int index);
   void rename_file_requested(Quest& quest, const QString& path);
   void refactoring_requested(const Refactoring& refactoring);
+  void open_file_at_line_requested(const QString& path, int line);
 
   void update_zoom();
   void update_grid_visibility();
@@ -130,36 +132,17 @@ private:
   bool is_console_visible() const;
   void set_console_visible(bool console_visible);
 
-  void refactor_map_id(const QString& map_id_before, const QString& map_id_after);
-  bool update_destination_map_in_map(
-      const QString& map_id,
-      const QString& map_id_before,
-      const QString& map_id_after
+  void refactor_resource_id_in_maps(
+      ResourceType resource_type,
+      const QString& field,
+      const QString& id_before,
+      const QString& id_after
   );
+  void refactor_map_id(const QString& map_id_before, const QString& map_id_after);
   void refactor_tileset_id(const QString& tileset_id_before, const QString& tileset_id_after);
-  bool update_tileset_in_map(
-      const QString& map_id,
-      const QString& tileset_id_before,
-      const QString& tileset_id_after
-  );
   void refactor_music_id(const QString& music_id_before, const QString& music_id_after);
-  bool update_music_in_map(
-      const QString& map_id,
-      const QString& music_id_before,
-      const QString& music_id_after
-  );
   void refactor_enemy_id(const QString& enemy_id_before, const QString& enemy_id_after);
-  bool update_enemy_breed_in_map(
-      const QString& map_id,
-      const QString& enemy_id_before,
-      const QString& enemy_id_after
-  );
   void refactor_custom_entity_id(const QString& custom_entity_id_before, const QString& custom_entity_id_after);
-  bool update_custom_entity_model_in_map(
-      const QString& map_id,
-      const QString& custom_entity_id_before,
-      const QString& custom_entity_id_after
-  );
 
   Ui::MainWindow ui;              /**< The main window widgets. */
   Quest quest;                    /**< The current quest open if any. */
@@ -21,11 +21,14 @@
 #include "map_model.h"
 #include "ui_map_editor.h"
 
+class QLabel;
 class QStatusBar;
 class QToolBar;
 
 namespace SolarusEditor {
 
+class RefactoringEngine;
+
 /**
  * \brief A widget to edit graphically a map file.
  */
@@ -40,6 +43,8 @@ public:
   MapView& get_map_view();
 
   void save() override;
+  void wait_for_save() override;
+  bool is_saving() const override;
   bool can_cut() const override;
   void cut() override;
   bool can_copy() const override;
@@ -87,6 +92,8 @@ private slots:
   void map_selection_changed();
   void uncheck_entity_creation_buttons();
   void update_status_bar();
+  void update_undo_memory_label(qint64 size);
+  void map_save_failed(const QString& message);
 
   void edit_entity_requested(const EntityIndex& index,
                              EntityModelPtr& entity_after);
@@ -107,6 +114,8 @@ private slots:
   void bring_entities_to_back_requested(const EntityIndexes& indexes);
   void add_entities_requested(AddableEntities& entities, bool replace_selection);
   void remove_entities_requested(const EntityIndexes& indexes);
+  void replace_border_tiles_requested(const EntityIndexes& tiles_to_remove,
+                                      AddableEntities& tiles_to_add);
 
 private:
 
@@ -121,21 +130,17 @@ private:
       const QString& name_before,
       const QString& name_after
   );
-  QStringList update_destination_name_in_other_maps(
+  RefactoringEngine create_destination_name_refactoring(
       const QString& name_before,
       const QString& name_after
-  );
-  bool update_destination_name_in_map(
-      const QString& map_id,
-      const QString& name_before,
-      const QString& name_after
-  );
+  ) const;
 
   Ui::MapEditor ui;                         /**< The map editor widgets. */
   QString map_id;                           /**< Id of the map being edited. */
   MapModel* map;                            /**< Map model being edited. */
   QToolBar* entity_creation_toolbar;        /**< Toolbar allowing to add each type of entity. */
   QStatusBar* status_bar;                   /**< Status bar with information about the map view. */
+  QLabel* undo_memory_label;                /**< Memory used by the undo/redo history. */
   ViewSettings tileset_view_settings;       /**< What is shown and how in the tileset view. */
 
 };
@@ -19,16 +19,27 @@
 
 #include "map_model.h"
 #include "view_settings.h"
+#include <QElapsedTimer>
 #include <QGraphicsScene>
+#include <QSet>
+#include <QTimer>
 
 namespace SolarusEditor {
 
 class EntityItem;
+class LayerTilesItem;
 class Quest;
 class ViewSettings;
 
 /**
  * @brief The scene containing all entities in the map main view.
+ *
+ * Animated entities like tiles with a multi-frame pattern are all driven by
+ * one clock: at each frame, only the animated items that are visible
+ * in a view are repainted.
+ * Like in the engine, static tiles that overlap an animated tile
+ * are not drawn in the tile chunks but by their own item,
+ * so that tiles still appear in the order of the map.
  */
 class MapScene : public QGraphicsScene {
   Q_OBJECT
@@ -50,6 +61,9 @@ public:
   void update_traversables_visibility(const ViewSettings& view_settings);
   void update_obstacles_visibility(const ViewSettings& view_settings);
   void update_entity_type_visibility(EntityType type, const ViewSettings& view_settings);
+  bool is_entity_visible(const EntityIndex& index) const;
+  bool is_entity_content_cached(const EntityIndex& index) const;
+  qint64 get_animation_time() const;
 
   EntityIndexes get_selected_entities();
   void set_selected_entities(const EntityIndexes& indexes);
@@ -75,11 +89,18 @@ private slots:
   void layer_range_changed(int min_layer, int max_layer);
   void entities_added(const EntityIndexes& indexes);
   void entities_about_to_be_removed(const EntityIndexes& indexes);
-  void entity_layer_changed(const EntityIndex& index_before,
-                            const EntityIndex& index_after);
+  void entities_layer_changed(const EntityIndexes& indexes_before,
+                              const EntityIndexes& indexes_after);
   void entity_order_changed(const EntityIndex& index_before, int order_after);
   void entity_xy_changed(const EntityIndex& index, const QPoint& xy);
+  void entities_xy_changed(const EntityIndexes& indexes);
   void entity_size_changed(const EntityIndex& index, const QSize& size);
+  void entities_size_changed(const EntityIndexes& indexes);
+  void entity_field_changed(const EntityIndex& index, const QString& key, const QVariant& value);
+  void entities_field_changed(const EntityIndexes& indexes, const QString& key, const QVariant& value);
+  void tileset_reloaded();
+  void sprites_reloaded(const EntityIndexes& indexes);
+  void update_animations();
 
 private:
 
@@ -95,15 +116,29 @@ private:
   EntityItem* get_entity_item(const EntityIndex& index);
   const EntityItems& get_entity_items(int layer);
   const ByLayer<EntityItems>& get_entity_items() const;
+  static QRect get_item_area(const EntityItem& item);
+  void invalidate_tiles(int layer, const EntityItem& item);
+  void invalidate_tiles(const ByLayer<QRect>& areas);
+  void invalidate_all_tiles();
+  void update_item_caching(EntityItem& item);
+  void update_tiles_caching(int layer, const QRect& area);
+  void update_moved_item_caching(EntityItem& item, int old_layer, const QRect& old_area);
+  bool overlaps_animated_item(const EntityItem& item) const;
 
   MapModel& map;                            /**< The map represented. */
   ByLayer<EntityItems> entity_items;        /**< Entities items on each layer,
                                              * ordered as in the map. */
   ByLayer<QGraphicsItem*>
       layer_parent_items;                   /**< Artificial parent item of everything on a layer. */
+  ByLayer<LayerTilesItem*>
+      layer_tiles_items;                    /**< Item drawing the static tiles of each layer. */
 
   QPointer<const ViewSettings>
       view_settings;                        /**< Last view settings applied. */
+
+  QElapsedTimer animation_clock;            /**< Time of animations. */
+  QTimer animation_timer;                   /**< Repaints animated items at each frame. */
+  QSet<EntityItem*> animated_items;         /**< Items of animated entities. */
 };
 
 }
@@ -19,10 +19,13 @@
 
 #include "entities/entity_traits.h"
 #include <QGraphicsView>
+#include <QMap>
 #include <QPointer>
+#include <QSet>
 
 namespace SolarusEditor {
 
+class EntityItem;
 class MapModel;
 class MapScene;
 class ViewSettings;
@@ -90,6 +93,13 @@ public:
 
   // Information about entities.
   EntityIndex get_entity_index_under_cursor() const;
+  EntityItem* get_entity_item_at(const QPoint& xy) const;
+  QRect get_entities_area(const EntityIndexes& indexes) const;
+  QMap<int, QSet<QString>> get_tile_patterns_by_layer(const EntityIndexes& indexes) const;
+
+  // Borders.
+  bool is_auto_border_enabled() const;
+  void update_borders(const QRect& dirty_area, const QMap<int, QSet<QString>>& region_pattern_ids);
 
   // State of the view.
   void start_state_doing_nothing();
@@ -142,6 +152,9 @@ signals:
       AddableEntities& entities,
       bool replace_selection);
   void remove_entities_requested(const EntityIndexes& indexes);
+  void replace_border_tiles_requested(
+      const EntityIndexes& tiles_to_remove,
+      AddableEntities& tiles_to_add);
 
 public slots:
 
@@ -208,6 +221,8 @@ private:
       change_pattern_all_action;   /**< Action of changing the pattern of all tiles that
                                     * have the same pattern as the selected ones. */
   QAction* add_border_action;      /**< Action of adding border tiles to the selection. */
+  QAction* auto_border_action;     /**< Action of updating borders automatically
+                                    * when moving, resizing or deleting tiles. */
   QList<QAction*>
       set_layer_actions;           /**< Actions of changing the layer of the selected entities. */
   QActionGroup*
@@ -91,6 +91,10 @@ public slots:
   void change_direction_num_frames_columns_requested(
     int num_frames, int num_columns);
 
+private slots:
+
+  void watch_image_files();
+
 private:
 
   void load_settings();
@@ -48,6 +48,8 @@ public:
   void find() override;
   void reload_settings() override;
 
+  void go_to_line(int line);
+
 private slots:
 
   int find_text_requested(const QString& text);
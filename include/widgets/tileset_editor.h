@@ -19,9 +19,11 @@
 
 #include "widgets/editor.h"
 #include "ui_tileset_editor.h"
+#include <memory>
 
 namespace SolarusEditor {
 
+class RefactoringEngine;
 class TilesetModel;
 
 /**
@@ -33,6 +35,7 @@ class TilesetEditor : public Editor {
 public:
 
   TilesetEditor(Quest& quest, const QString& path, QWidget* parent = nullptr);
+  ~TilesetEditor();
 
   TilesetModel& get_model();
 
@@ -53,7 +56,6 @@ public slots:
   void set_description_from_gui();
 
   void update_pattern_view();
-  void tileset_image_changed();
   void update_pattern_id_field();
   void change_selected_patterns_position_requested(const QPoint& delta);
   void update_ground_field();
@@ -91,25 +93,32 @@ public slots:
       const QStringList& pattern_ids
   );
 
+private slots:
+
+  void update_tileset_modified();
+  void cached_tileset_reloaded(const QString& tileset_id);
+  void tileset_image_changed();
+
 protected:
 
   void editor_made_visible() override;
 
 private:
 
-  void set_model(TilesetModel* model);
-  QStringList change_pattern_id_in_maps(
-      const QString& old_pattern_id, const QString& new_pattern_id);
-  bool change_pattern_id_in_map(
-      const QString& map_id, const QString& old_pattern_id, const QString& new_pattern_id);
+  void set_model(const std::shared_ptr<TilesetModel>& model);
+  RefactoringEngine create_pattern_id_refactoring(
+      const QString& old_pattern_id, const QString& new_pattern_id) const;
   void load_settings();
 
 private:
 
   Ui::TilesetEditor ui;         /**< The tileset editor widgets. */
   QString tileset_id;           /**< Id of the tileset being edited. */
-  TilesetModel* model;          /**< Tileset model being edited. */
-  bool tileset_image_dirty;     /**< Whether the PNG image has changed externally. */
+  std::shared_ptr<TilesetModel>
+      model;                    /**< Tileset model being edited,
+                                 * shared with open maps. */
+  bool tileset_image_reloaded;  /**< Whether the PNG image was reloaded
+                                 * after an external change. */
 
 };
 
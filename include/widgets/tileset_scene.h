@@ -26,6 +26,7 @@ namespace SolarusEditor {
 class PatternItem;
 class Quest;
 class TilesetModel;
+class TilesetSelectionModel;
 
 /**
  * @brief The scene containing all patterns in the tileset main view.
@@ -35,7 +36,7 @@ class TilesetScene : public QGraphicsScene {
 
 public:
 
-  TilesetScene(TilesetModel& model, QObject* parent);
+  TilesetScene(TilesetModel& model, TilesetSelectionModel& selection_model, QObject* parent);
 
   const TilesetModel& get_model() const;
   const Quest& get_quest() const;
@@ -67,6 +68,8 @@ private:
   void build();
 
   TilesetModel& model;      /**< The tileset represented. */
+  TilesetSelectionModel&
+      selection_model;      /**< Patterns selected in this scene. */
   QList<PatternItem*>
       pattern_items;        /**< Each pattern item in the scene,
                              * ordered as in the model. */
@@ -30,6 +30,7 @@ namespace SolarusEditor {
 
 class TilesetModel;
 class TilesetScene;
+class TilesetSelectionModel;
 class ViewSettings;
 
 /**
@@ -43,8 +44,9 @@ public:
   TilesetView(QWidget* parent = nullptr);
 
   TilesetModel* get_model();
+  TilesetSelectionModel* get_selection_model();
   TilesetScene* get_scene();
-  void set_model(TilesetModel* tileset);
+  void set_model(TilesetModel* tileset, TilesetSelectionModel* selection_model = nullptr);
   void set_view_settings(ViewSettings& view_settings);
   bool is_read_only() const;
 
@@ -119,6 +121,8 @@ private:
   void dropEvent(QDropEvent* event) override;
 
   QPointer<TilesetModel> model;        /**< The tileset model. */
+  QPointer<TilesetSelectionModel>
+      selection_model;                 /**< Patterns selected in this view. */
   TilesetScene* scene;                 /**< The scene viewed. */
   QAction* change_pattern_id_action;   /**< Action of changing a pattern id. */
   QAction* delete_patterns_action;     /**< Action of deleting the selected
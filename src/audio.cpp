@@ -21,14 +21,63 @@
 #include <solarus/core/Arguments.h>
 #include <solarus/core/QuestFiles.h>
 #include <QApplication>
+#include <QDateTime>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHash>
 #include <QTimer>
 
 namespace SolarusEditor {
 
 namespace {
 
+/**
+ * @brief Delay between two updates of the sound system while audio is active.
+ */
+constexpr int update_interval = 10;
+
+/**
+ * @brief How long the sound system keeps being updated after a sound starts.
+ *
+ * Sounds are played by the audio device on its own:
+ * updates only release them once they are finished.
+ */
+constexpr int sound_update_duration = 5000;
+
 bool initialized = false;
+QTimer* update_timer = nullptr;
+QElapsedTimer last_sound_time;
+bool music_playing = false;
+QString mounted_quest_path;
+QHash<QString, QDateTime> loaded_sound_dates;
+
+void close_quest();
+
+/**
+ * @brief Updates the sound system and stops the updates when audio is idle.
+ */
+void update() {
+
+  Solarus::Sound::update();
+
+  if (!music_playing &&
+      (!last_sound_time.isValid() || last_sound_time.hasExpired(sound_update_duration))) {
+    update_timer->stop();
+  }
+}
+
+/**
+ * @brief Cleans up the audio session.
+ */
+void quit() {
+
+  close_quest();
+  Solarus::Sound::quit();
+  initialized = false;
+  music_playing = false;
+  loaded_sound_dates.clear();
+}
 
 /**
  * @brief Initializes the sound features.
@@ -38,43 +87,86 @@ void initialize() {
   Solarus::Sound::initialize(Solarus::Arguments());
   initialized = true;
 
+  if (update_timer != nullptr) {
+    // Already set up by a previous session.
+    return;
+  }
+
   // Cleanup Solarus sound system at exit.
   QObject::connect(
         QCoreApplication::instance(),
         &QApplication::aboutToQuit,
-        Solarus::Sound::quit
+        quit
   );
 
-  // Update the Solarus sound system from time to time.
-  QTimer* update_timer = new QTimer(QCoreApplication::instance());
+  // Update the Solarus sound system while something plays.
+  update_timer = new QTimer(QCoreApplication::instance());
   QObject::connect(
         update_timer,
         &QTimer::timeout,
-        Solarus::Sound::update
+        update
   );
   update_timer->setSingleShot(false);
-  update_timer->start(10);
+  update_timer->setInterval(update_interval);
+}
+
+/**
+ * @brief Makes sure that the sound system is updated for a while.
+ */
+void start_updates() {
+
+  if (!update_timer->isActive()) {
+    update_timer->start();
+  }
 }
 
 /**
  * @brief Opens a quest on the engine's side, making it the current one.
+ *
+ * The quest stays open for the next previews.
+ * If another quest was open, it is closed and the sound system is restarted
+ * so that sounds already loaded from that quest are forgotten.
+ *
  * @param quest The quest to open.
  * @return @c true in case of success.
  */
 bool open_quest(const Quest& quest) {
 
+  const QString& root_path = quest.get_root_path();
+  if (!mounted_quest_path.isEmpty() && root_path == mounted_quest_path) {
+    // Already open.
+    return true;
+  }
+
+  if (!mounted_quest_path.isEmpty()) {
+    quit();
+  }
+
+  if (!initialized) {
+    initialize();
+  }
+
   // TODO factorize this more.
   QStringList arguments = QApplication::arguments();
   QString program_name = arguments.isEmpty() ? QString() : arguments.first();
-  return Solarus::QuestFiles::open_quest(program_name.toStdString(),
-                                         quest.get_root_path().toStdString());
+  if (!Solarus::QuestFiles::open_quest(program_name.toStdString(),
+                                       root_path.toStdString())) {
+    return false;
+  }
+  mounted_quest_path = root_path;
+  return true;
 }
 
 /**
- * @brief Closes the current quest on the engine's side.
+ * @brief Closes the current quest on the engine's side if any.
  */
 void close_quest() {
+
+  if (mounted_quest_path.isEmpty()) {
+    return;
+  }
   Solarus::QuestFiles::close_quest();
+  mounted_quest_path.clear();
 }
 
 }  // Anonymous namespace.
@@ -89,10 +181,6 @@ namespace Audio {
  */
 void play_sound(const Quest& quest, const QString& sound_id) {
 
-  if (!initialized) {
-    initialize();
-  }
-
   if (!open_quest(quest)) {
     qWarning() << "Failed to open quest " << quest.get_root_path();
     return;
@@ -102,9 +190,26 @@ void play_sound(const Quest& quest, const QString& sound_id) {
     qWarning() << "Cannot open sound file " << sound_id;
     return;
   }
+
+  // The engine keeps sounds decoded once played,
+  // so playing the same sound again is immediate while the quest stays open.
+  // If the file has changed since it was decoded, restart the session
+  // unless this would interrupt a music.
+  const QDateTime& last_modified = QFileInfo(quest.get_sound_path(sound_id)).lastModified();
+  auto it = loaded_sound_dates.constFind(sound_id);
+  if (it != loaded_sound_dates.constEnd() && *it != last_modified && !music_playing) {
+    quit();
+    if (!open_quest(quest)) {
+      qWarning() << "Failed to open quest " << quest.get_root_path();
+      return;
+    }
+  }
+  loaded_sound_dates.insert(sound_id, last_modified);
+
   Solarus::Sound::play(sound_id.toStdString());
 
-  close_quest();
+  last_sound_time.start();
+  start_updates();
 }
 
 /**
@@ -115,10 +220,6 @@ void play_sound(const Quest& quest, const QString& sound_id) {
  */
 void play_music(Quest& quest, const QString& music_id) {
 
-  if (!initialized) {
-    initialize();
-  }
-
   if (!open_quest(quest)) {
     qWarning() << "Failed to open quest " << quest.get_root_path();
     return;
@@ -130,7 +231,9 @@ void play_music(Quest& quest, const QString& music_id) {
   }
   Solarus::Music::play(music_id.toStdString(), true);
 
-  close_quest();
+  // The music is streamed: keep updating the sound system until it stops.
+  music_playing = true;
+  start_updates();
 
   quest.set_current_music_id(music_id);
 }
@@ -141,11 +244,10 @@ void play_music(Quest& quest, const QString& music_id) {
  */
 void stop_music(Quest& quest) {
 
-  if (!initialized) {
-    initialize();
+  if (initialized) {
+    Solarus::Music::stop_playing();
   }
-
-  Solarus::Music::stop_playing();
+  music_playing = false;
 
   quest.set_current_music_id("");
 }
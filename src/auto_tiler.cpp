@@ -17,6 +17,7 @@
 #include "auto_tiler.h"
 #include "tileset_model.h"
 #include <QDebug>
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 
@@ -33,6 +34,7 @@ AutoTiler::AutoTiler(
     const QString& border_set_id) :
   map(map),
   entity_indexes(entity_indexes),
+  layer(entity_indexes.isEmpty() ? 0 : entity_indexes.first().layer),  // TODO choose the lowest layer.
   border_set_id(border_set_id) {
 
   for (const EntityIndex& index : entity_indexes) {
@@ -83,7 +85,7 @@ bool AutoTiler::is_cell_occupied(int grid_index) const {
   Q_ASSERT(grid_index >= 0);
   Q_ASSERT(grid_index < get_num_cells());
 
-  return occupied_squares[grid_index];
+  return occupied_squares[grid_index] != 0;
 }
 
 /**
@@ -173,11 +175,7 @@ BorderKind AutoTiler::get_which_border(int grid_index) const {
   Q_ASSERT(grid_index >= 0);
   Q_ASSERT(grid_index < get_num_cells());
 
-  const auto& it = which_borders.find(grid_index);
-  if (it == which_borders.end()) {
-    return BorderKind::NONE;
-  }
-  return it->second;
+  return static_cast<BorderKind>(which_borders[grid_index]);
 }
 
 /**
@@ -190,7 +188,7 @@ void AutoTiler::set_which_border(int grid_index, BorderKind which_border) {
   Q_ASSERT(grid_index >= 0);
   Q_ASSERT(grid_index < get_num_cells());
 
-  which_borders[grid_index] = which_border;
+  which_borders[grid_index] = static_cast<qint8>(which_border);
 }
 
 /**
@@ -532,16 +530,22 @@ void AutoTiler::make_tile(BorderKind which_border, int grid_index, int num_cells
 
   Q_ASSERT(!size.isEmpty());
 
-  const EntityIndex& first_entity_index = entity_indexes.first();
-  int layer = first_entity_index.layer;  // TODO choose the lowest layer.
+  tiles.append({ pattern_id, QRect(xy, size) });
+}
+
+/**
+ * @brief Creates a tile from a border tile description.
+ * @param border_tile The tile to create.
+ * @return The tile, ready to be added to the map.
+ */
+EntityModelPtr AutoTiler::create_tile(const BorderTile& border_tile) const {
 
   EntityModelPtr tile = EntityModel::create(map, EntityType::TILE);
-  tile->set_field("pattern", pattern_id);
-  tile->set_xy(xy);
-  tile->set_size(size);
+  tile->set_field("pattern", border_tile.pattern_id);
+  tile->set_xy(border_tile.box.topLeft());
+  tile->set_size(border_tile.box.size());
   tile->set_layer(layer);
-
-  tiles.emplace_back(std::move(tile));
+  return tile;
 }
 
 /**
@@ -610,59 +614,53 @@ void AutoTiler::compute_bounding_box() {
 void AutoTiler::compute_occupied_squares() {
 
   occupied_squares.clear();
-  occupied_squares.assign(get_num_cells(), false);
+  occupied_squares.assign(get_num_cells(), 0);
 
   for (const QRect& rectangle : entity_rectangles) {
 
-    for (int y = rectangle.y(); y < rectangle.y() + rectangle.height(); y += 8) {
-      for (int x = rectangle.x(); x < rectangle.x() + rectangle.width(); x += 8) {
-        int grid_index = to_grid_index(QPoint(x, y));
-        occupied_squares[grid_index] = true;
-      }
+    // Fill the rectangle one row span at a time.
+    const int num_cells_x = rectangle.width() / 8;
+    const int num_cells_y = rectangle.height() / 8;
+    int row_start = to_grid_index(rectangle.topLeft());
+    for (int i = 0; i < num_cells_y; ++i) {
+      auto span_begin = occupied_squares.begin() + row_start;
+      std::fill(span_begin, span_begin + num_cells_x, 1);
+      row_start += grid_size.width();
     }
   }
 }
 
 /**
  * @brief Detect the borders.
+ *
+ * The grid is scanned row by row with a sliding four-cells mask,
+ * so the cost is linear in the size of the grid no matter how many
+ * entities are selected.
+ * Only masks that are neither empty nor full can produce a border.
  */
 void AutoTiler::compute_borders() {
 
   which_borders.clear();
-
-  for (const QRect& rectangle : entity_rectangles) {
-
-    int num_cells_x = rectangle.width() / 8;
-    int num_cells_y = rectangle.height() / 8;
-
-    // Top side.
-    int rectangle_top_left_cell = to_grid_index(rectangle.topLeft());
-    int initial_position = rectangle_top_left_cell - 1 - grid_size.width();  // 1 cell above and to the left.
-    int cell_0 = initial_position;
-
-    for (int i = 0; i < num_cells_x; ++i) {
-      detect_border_info(cell_0);
-      ++cell_0;
-    }
-
-    // Right side.
-    for (int i = 0; i < num_cells_y; ++i) {
-      detect_border_info(cell_0);
-      cell_0 += grid_size.width();
-    }
-
-    // Bottom side.
-    for (int i = 0; i < num_cells_x; ++i) {
-      detect_border_info(cell_0);
-      --cell_0;
-    }
-
-    // Left side.
-    for (int i = 0; i < num_cells_y; ++i) {
-      detect_border_info(cell_0);
-      cell_0 -= grid_size.width();
+  which_borders.assign(get_num_cells(), static_cast<qint8>(BorderKind::NONE));
+
+  const int width = grid_size.width();
+  for (int grid_y = 0; grid_y < grid_size.height() - 1; ++grid_y) {
+
+    const int row_start = grid_y * width;
+    const quint8* top_row = &occupied_squares[row_start];
+    const quint8* bottom_row = top_row + width;
+
+    // Mask of the two cells of the previous column, in the position
+    // of the left cells of a four-cells mask.
+    int left_bits = (top_row[0] << 3) | (bottom_row[0] << 1);
+    for (int grid_x = 0; grid_x < width - 1; ++grid_x) {
+      int right_bits = (top_row[grid_x + 1] << 2) | bottom_row[grid_x + 1];
+      int mask = left_bits | right_bits;
+      if (mask != 0 && mask != 15) {
+        detect_border_info(row_start + grid_x);
+      }
+      left_bits = right_bits << 1;
     }
-
   }
 }
 
@@ -709,10 +707,11 @@ void AutoTiler::compute_tiles() {
 void AutoTiler::compute_tiles_inner() {
 
   // Generate sides first.
-  for (const auto& it : which_borders) {
+  const int num_cells = get_num_cells();
+  for (int cell = 0; cell < num_cells; ++cell) {
 
-    int start_index = it.first;
-    BorderKind which_border = it.second;
+    int start_index = cell;
+    BorderKind which_border = get_which_border(cell);
 
     int grid_x = start_index % grid_size.width();
     int grid_y = start_index / grid_size.width();
@@ -847,9 +846,13 @@ void AutoTiler::compute_tiles_inner() {
   }
 
   // Generate corners.
-  for (const auto& it : which_borders) {
-    int start_index = it.first;
-    BorderKind which_border = it.second;
+  for (int cell = 0; cell < num_cells; ++cell) {
+    int start_index = cell;
+    BorderKind which_border = get_which_border(cell);
+
+    if (which_border == BorderKind::NONE) {
+      continue;
+    }
 
     if (!get_tileset().has_border_set_pattern(border_set_id, which_border)) {
       continue;
@@ -889,10 +892,11 @@ void AutoTiler::compute_tiles_inner() {
 void AutoTiler::compute_tiles_outer() {
 
   // Generate sides first.
-  for (const auto& it : which_borders) {
+  const int num_cells = get_num_cells();
+  for (int cell = 0; cell < num_cells; ++cell) {
 
-    int start_index = it.first;
-    BorderKind which_border = it.second;
+    int start_index = cell;
+    BorderKind which_border = get_which_border(cell);
 
     int grid_x = start_index % grid_size.width();
     int grid_y = start_index / grid_size.width();
@@ -1027,9 +1031,13 @@ void AutoTiler::compute_tiles_outer() {
   }
 
   // Generate corners.
-  for (const auto& it : which_borders) {
-    int start_index = it.first;
-    BorderKind which_border = it.second;
+  for (int cell = 0; cell < num_cells; ++cell) {
+    int start_index = cell;
+    BorderKind which_border = get_which_border(cell);
+
+    if (which_border == BorderKind::NONE) {
+      continue;
+    }
 
     if (!get_tileset().has_border_set_pattern(border_set_id, which_border)) {
       continue;
@@ -1061,13 +1069,14 @@ void AutoTiler::compute_tiles_outer() {
 }
 
 /**
- * @brief Creates border tiles around the given entities.
- * @return The border tiles ready to be added to the map.  1 1
+ * @brief Computes the border tiles around the given entities.
+ * @return Description of the border tiles to create.
  */
-AddableEntities AutoTiler::generate_border_tiles() {
+QList<AutoTiler::BorderTile> AutoTiler::compute_border_tiles() {
 
+  tiles.clear();
   if (entity_rectangles.empty()) {
-    return AddableEntities();
+    return tiles;
   }
 
   // Determine the 8x8 grid.
@@ -1082,21 +1091,158 @@ AddableEntities AutoTiler::generate_border_tiles() {
 
   // Create the corresponding tiles.
   compute_tiles();
-  if (tiles.empty()) {
+
+  return tiles;
+}
+
+/**
+ * @brief Creates border tiles around the given entities.
+ * @return The border tiles ready to be added to the map.
+ */
+AddableEntities AutoTiler::generate_border_tiles() {
+
+  const QList<BorderTile> border_tiles = compute_border_tiles();
+  if (border_tiles.empty()) {
     return AddableEntities();
   }
 
-  const EntityModelPtr& first_tile = *tiles.begin();
-  int layer = first_tile->get_layer();
   int order = map.get_num_tiles(layer);
   AddableEntities addable_tiles;
-  for (EntityModelPtr& tile : tiles) {
+  for (const BorderTile& border_tile : border_tiles) {
     EntityIndex index = { layer, order };
-    addable_tiles.emplace_back(std::move(tile), index);
+    addable_tiles.emplace_back(create_tile(border_tile), index);
     ++order;
   }
 
   return addable_tiles;
 }
 
+/**
+ * @brief Determines the border tiles to replace after a region was edited.
+ *
+ * The region is made of the tiles of the layer whose pattern is one of
+ * the given ones.
+ * Borders are recomputed around the region near the dirty area only,
+ * and compared to the border tiles already on the map there.
+ * Border tiles that are still correct are kept: only obsolete ones are
+ * removed and only missing ones are added.
+ * The dirty area grows as needed until no replaced border tile
+ * crosses its limits, so that long borders are never cut.
+ *
+ * @param map The map.
+ * @param border_set_id Border set of the region.
+ * @param layer Layer of the region.
+ * @param region_pattern_ids Patterns of the tiles that form the region.
+ * @param dirty_area Area of the map that was edited.
+ * @return The border tiles to remove and the ones to add.
+ */
+AutoTiler::BorderTilesUpdate AutoTiler::update_border_tiles(
+    MapModel& map,
+    const QString& border_set_id,
+    int layer,
+    const QSet<QString>& region_pattern_ids,
+    const QRect& dirty_area
+) {
+  BorderTilesUpdate update;
+
+  const TilesetModel* tileset = map.get_tileset_model();
+  if (tileset == nullptr || !tileset->border_set_exists(border_set_id)) {
+    return update;
+  }
+
+  // Patterns of the border set and the size of the biggest one.
+  QSet<QString> border_pattern_ids;
+  QSize margin(8, 8);
+  for (int i = 0; i < 12; ++i) {
+    const QString& pattern_id = tileset->get_border_set_pattern(border_set_id, static_cast<BorderKind>(i));
+    if (tileset->pattern_exists(pattern_id)) {
+      border_pattern_ids.insert(pattern_id);
+      margin = margin.expandedTo(tileset->get_pattern_frame(tileset->id_to_index(pattern_id)).size());
+    }
+  }
+  const QSet<QString> region_ids = QSet<QString>(region_pattern_ids).subtract(border_pattern_ids);
+  if (border_pattern_ids.isEmpty() || region_ids.isEmpty()) {
+    return update;
+  }
+
+  const auto& get_key = [](const QString& pattern_id, const QRect& box) {
+    return QString("%1 %2 %3 %4 %5").arg(
+          pattern_id).arg(box.x()).arg(box.y()).arg(box.width()).arg(box.height());
+  };
+
+  const int num_tiles = map.get_num_tiles(layer);
+  QRect area = dirty_area;
+  QList<BorderTile> tiles_to_add;
+  while (true) {
+
+    // Region tiles around the area, with enough context to get
+    // correct borders inside the area.
+    const QRect context_area = area.adjusted(
+          -2 * margin.width(), -2 * margin.height(),
+          2 * margin.width(), 2 * margin.height());
+    EntityIndexes region_indexes;
+    QMap<QString, EntityIndex> existing_border_tiles;
+    for (const EntityIndex& index : map.find_entities_in_rectangle(layer, context_area)) {
+      if (index.order >= num_tiles) {
+        // Not a tile.
+        continue;
+      }
+      const QRect& box = map.get_entity_bounding_box(index);
+      const QString& pattern_id = map.get_entity_field(index, "pattern").toString();
+      if (region_ids.contains(pattern_id)) {
+        region_indexes << index;
+      }
+      else if (border_pattern_ids.contains(pattern_id) && box.intersects(area)) {
+        existing_border_tiles.insertMulti(get_key(pattern_id, box), index);
+      }
+    }
+
+    // Borders as they should be.
+    AutoTiler auto_tiler(map, region_indexes, border_set_id);
+    auto_tiler.layer = layer;
+    const QList<BorderTile>& border_tiles = auto_tiler.compute_border_tiles();
+
+    // Compare them to the existing ones.
+    QRect new_area = area;
+    tiles_to_add.clear();
+    for (const BorderTile& border_tile : border_tiles) {
+      if (!border_tile.box.intersects(area)) {
+        continue;
+      }
+      auto it = existing_border_tiles.find(get_key(border_tile.pattern_id, border_tile.box));
+      if (it != existing_border_tiles.end()) {
+        // Already there.
+        existing_border_tiles.erase(it);
+        continue;
+      }
+      tiles_to_add << border_tile;
+      new_area |= border_tile.box;
+    }
+    for (const EntityIndex& index : existing_border_tiles) {
+      new_area |= map.get_entity_bounding_box(index);
+    }
+
+    if (new_area == area) {
+      // Stable: replaced tiles don't go beyond the area.
+      update.tiles_to_remove = existing_border_tiles.values();
+      break;
+    }
+    area = new_area;
+  }
+
+  std::sort(update.tiles_to_remove.begin(), update.tiles_to_remove.end());
+
+  // New tiles are added after the remaining ones.
+  int order = num_tiles - update.tiles_to_remove.size();
+  AutoTiler auto_tiler(map, EntityIndexes(), border_set_id);
+  auto_tiler.layer = layer;
+  for (const BorderTile& border_tile : tiles_to_add) {
+    EntityIndex index = { layer, order };
+    update.tiles_to_add.emplace_back(auto_tiler.create_tile(border_tile), index);
+    ++order;
+  }
+
+  return update;
+}
+
 }
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "editor_exception.h"
+#include "quest.h"
+#include "quest_benchmark.h"
+#include "synthetic_quest_builder.h"
+#include "version.h"
+#include <QApplication>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+namespace SolarusEditor {
+
+namespace {
+
+/**
+ * @brief Makes Qt load images without needing a display.
+ *
+ * Must be called before the application is created.
+ */
+void use_offscreen_platform() {
+
+  if (qgetenv("QT_QPA_PLATFORM").isEmpty()) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+}
+
+/**
+ * @brief Sets the name and version of the application.
+ *
+ * The benchmark uses the same settings as the quest editor.
+ *
+ * @param application The application.
+ */
+void initialize_application(QCoreApplication& application) {
+
+  application.setApplicationName("solarus-quest-editor");
+  application.setApplicationVersion(SOLARUSEDITOR_VERSION);
+  application.setOrganizationName("solarus");
+}
+
+/**
+ * @brief Generates a synthetic quest and measures editor operations on it,
+ * without GUI.
+ *
+ * Results are written in JSON format on the standard output
+ * or in a file.
+ *
+ * @param argc Number of arguments of the command line.
+ * @param argv Command-line arguments.
+ * @return 0 in case of success, 2 in case of error.
+ */
+int benchmark_quest(int argc, char* argv[]) {
+
+  // Scenes are painted into images.
+  use_offscreen_platform();
+
+  QApplication application(argc, argv);
+  initialize_application(application);
+
+  QTextStream out(stdout);
+  SyntheticQuestBuilder::Parameters parameters;
+  int num_iterations = 5;
+  QString output_path;
+  QString quest_path;
+  bool valid_arguments = true;
+  const QStringList& arguments = application.arguments();
+  for (int i = 1; i < arguments.size() && valid_arguments; ++i) {
+    const QString& argument = arguments[i];
+    if (!argument.startsWith("-")) {
+      quest_path = argument;
+      continue;
+    }
+
+    if (i + 1 >= arguments.size()) {
+      valid_arguments = false;
+      break;
+    }
+    const QString& value = arguments[++i];
+    bool ok = true;
+    if (argument == "-o") {
+      output_path = value;
+    }
+    else if (argument == "-maps") {
+      parameters.num_maps = value.toInt(&ok);
+    }
+    else if (argument == "-layers") {
+      parameters.num_layers = value.toInt(&ok);
+    }
+    else if (argument == "-tiles") {
+      parameters.num_tiles_per_layer = value.toInt(&ok);
+    }
+    else if (argument == "-patterns") {
+      parameters.num_patterns = value.toInt(&ok);
+    }
+    else if (argument == "-dialogs") {
+      parameters.num_dialogs = value.toInt(&ok);
+    }
+    else if (argument == "-iterations") {
+      num_iterations = value.toInt(&ok);
+    }
+    else {
+      ok = false;
+    }
+    valid_arguments = ok;
+  }
+
+  if (!valid_arguments ||
+      parameters.num_maps < 1 ||
+      parameters.num_layers < 1 ||
+      parameters.num_tiles_per_layer < 1 ||
+      parameters.num_patterns < 1 ||
+      parameters.num_dialogs < 0 ||
+      num_iterations < 1) {
+    out << "Usage: solarus-quest-editor-benchmark [-maps N] [-layers N] [-tiles N] "
+           "[-patterns N] [-dialogs N] [-iterations N] [-o output_file] [quest_path]" << endl;
+    return 2;
+  }
+
+  // Without a quest path, the quest is generated in a temporary directory.
+  QTemporaryDir temporary_dir;
+  if (quest_path.isEmpty()) {
+    quest_path = temporary_dir.path();
+  }
+
+  QJsonObject root;
+  try {
+    SyntheticQuestBuilder::create_quest(quest_path, parameters);
+
+    Quest quest(quest_path);
+    QuestBenchmark benchmark(quest, num_iterations);
+    benchmark.run();
+
+    QJsonObject json_parameters;
+    json_parameters["maps"] = parameters.num_maps;
+    json_parameters["layers"] = parameters.num_layers;
+    json_parameters["tiles_per_layer"] = parameters.num_tiles_per_layer;
+    json_parameters["patterns"] = parameters.num_patterns;
+    json_parameters["dialogs"] = parameters.num_dialogs;
+    json_parameters["iterations"] = num_iterations;
+
+    root["version"] = SOLARUSEDITOR_VERSION;
+    root["parameters"] = json_parameters;
+    root["results"] = benchmark.get_results_json();
+  }
+  catch (const EditorException& ex) {
+    ex.print_message();
+    return 2;
+  }
+
+  const QByteArray& json = QJsonDocument(root).toJson();
+  if (output_path.isEmpty()) {
+    out << json;
+    return 0;
+  }
+
+  QFile output_file(output_path);
+  if (!output_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    out << "Cannot write file '" << output_path << "'" << endl;
+    return 2;
+  }
+  output_file.write(json);
+  return 0;
+}
+
+}  // Anonymous namespace
+
+}  // namespace SolarusEditor
+
+/**
+ * @brief Entry point of the quest editor benchmark.
+ *
+ * To generate a synthetic quest and measure editor operations on it:
+ *   solarus-quest-editor-benchmark [-maps N] [-layers N] [-tiles N]
+ *     [-patterns N] [-dialogs N] [-iterations N] [-o output_file] [quest_path]
+ *
+ * @param argc Number of arguments of the command line.
+ * @param argv Command-line arguments.
+ * @return 0 in case of success, 2 in case of error.
+ */
+int main(int argc, char* argv[]) {
+
+  return SolarusEditor::benchmark_quest(argc, argv);
+}
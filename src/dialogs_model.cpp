@@ -995,11 +995,11 @@ bool DialogsModel::has_missing_translation(const QString& id) const {
  */
 void DialogsModel::build_dialog_tree() {
 
-  dialog_tree.clear();
+  QStringList ids;
   for (const auto& kvp : resources.get_dialogs()) {
-    QString id = QString::fromStdString(kvp.first);
-    dialog_tree.add_key(id);
+    ids << QString::fromStdString(kvp.first);
   }
+  dialog_tree.build(ids);
 }
 
 /**
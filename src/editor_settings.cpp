@@ -31,6 +31,7 @@ const QString EditorSettings::restore_last_files = "restore_last_files";
 const QString EditorSettings::save_files_before_running = "save_files_before_running";
 const QString EditorSettings::no_audio = "no_audio";
 const QString EditorSettings::quest_size = "quest_size";
+const QString EditorSettings::undo_memory_limit = "undo_memory_limit";
 
 // Console keys.
 const QString EditorSettings::console_history = "console_history";
@@ -94,6 +95,7 @@ QMap<QString, QVariant> EditorSettings::default_values = {
   { EditorSettings::save_files_before_running, "ask" },
   { EditorSettings::no_audio, false },
   { EditorSettings::quest_size, QSize() },
+  { EditorSettings::undo_memory_limit, 64 },  // In MiB, 0 means no limit.
 
   // Console.
   { EditorSettings::console_history, QStringList() },
@@ -120,10 +120,25 @@ EntityModelPtr EntityModel::create(
     return nullptr;
   }
 
-  EntityModelPtr entity = create(map, EntityIndex(), data.get_type());
-  entity->set_entity(data);
+  return create(map, data);
+}
+
+/**
+ * @brief Creates an entity model for a new entity from its data.
+ *
+ * The created entity is not on the map yet.
+ *
+ * @param map The map that will contain the entity.
+ * @param entity_data The data of the entity.
+ * @return The created model.
+ */
+EntityModelPtr EntityModel::create(
+    MapModel& map, const Solarus::EntityData& entity_data) {
+
+  EntityModelPtr entity = create(map, EntityIndex(), entity_data.get_type());
+  entity->set_entity(entity_data);
   entity->index = EntityIndex();
-  entity->name = QString::fromStdString(data.get_name());
+  entity->name = QString::fromStdString(entity_data.get_name());
 
   return entity;
 }
@@ -1570,6 +1585,31 @@ void EntityModel::draw(QPainter& painter) const {
   draw_as_icon(painter);
 }
 
+/**
+ * @brief Returns whether this entity looks different over time.
+ *
+ * The default implementation returns @c false.
+ *
+ * @return @c true if draw_animated() depends on the time.
+ */
+bool EntityModel::is_animated() const {
+  return false;
+}
+
+/**
+ * @brief Draws this entity as it looks at a given time.
+ *
+ * The default implementation ignores the time and calls draw().
+ *
+ * @param painter The painter to draw.
+ * @param animation_time Time of the animation clock in milliseconds.
+ */
+void EntityModel::draw_animated(QPainter& painter, qint64 animation_time) const {
+
+  Q_UNUSED(animation_time);
+  draw(painter);
+}
+
 /**
  * @brief Attempts to draw this entity using its sprite if any.
  *
@@ -1633,9 +1673,10 @@ bool EntityModel::draw_as_sprite(
 
   try {
     if (sprite_model == nullptr ||
-        sprite_model->get_sprite_id() != sprite_id) {
-      sprite_model = std::unique_ptr<SpriteModel>(new SpriteModel(quest, sprite_id));
-      sprite_model->set_tileset_id(get_tileset_id());
+        sprite_model->get_sprite_id() != sprite_id ||
+        sprite_model->get_tileset_id() != get_tileset_id()) {
+      sprite_model = quest.get_sprite_cache().get_sprite(sprite_id, get_tileset_id());
+      sprite_image = QPixmap();
     }
 
     SpriteModel::Index index(animation, 0);
@@ -1824,8 +1865,11 @@ bool EntityModel::draw_as_icon(QPainter& painter) const {
  */
 void EntityModel::notify_tileset_changed(const QString& tileset_id) {
 
+  Q_UNUSED(tileset_id);
+
   if (sprite_model != nullptr) {
-    sprite_model->set_tileset_id(tileset_id);
+    // The sprite is shared: get the one of the new tileset at next drawing.
+    sprite_model = nullptr;
     sprite_image = QPixmap();  // Clear the cached image.
   }
 }
@@ -1838,4 +1882,25 @@ void EntityModel::reload_sprite() {
   sprite_image = QPixmap();
 }
 
+/**
+ * @brief Notifies this entity that sprites were modified outside the editor.
+ *
+ * If the entity is drawn with one of these sprites, it forgets it
+ * and gets the fresh one from the sprite cache at next drawing.
+ *
+ * @param sprite_ids Ids of the sprites that changed.
+ * @return @c true if the entity needs to be redrawn.
+ */
+bool EntityModel::notify_sprites_changed(const QStringList& sprite_ids) {
+
+  if (sprite_model == nullptr ||
+      !sprite_ids.contains(sprite_model->get_sprite_id())) {
+    return false;
+  }
+
+  sprite_model = nullptr;
+  sprite_image = QPixmap();
+  return true;
+}
+
 }
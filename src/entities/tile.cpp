@@ -39,7 +39,10 @@ Tile::Tile(MapModel& map, const EntityIndex& index) :
  * @param type Concrete type of entity: TILE or DYNAMIC_TILE.
  */
 Tile::Tile(MapModel& map, const EntityIndex& index, EntityType type) :
-  EntityModel(map, index, type) {
+  EntityModel(map, index, type),
+  pattern_id(),
+  pattern_index(-1),
+  animated(false) {
 
   set_resizable(true);
   set_has_preferred_layer(true);
@@ -67,7 +70,7 @@ EntityModelPtr Tile::create_from_dynamic_tile(MapModel& map, const EntityIndex&
  * @return The pattern id.
  */
 QString Tile::get_pattern_id() const {
-  return get_field("pattern").toString();
+  return pattern_id;
 }
 
 /**
@@ -87,6 +90,7 @@ void Tile::notify_field_changed(const QString& key, const QVariant& value) {
   EntityModel::notify_field_changed(key, value);
 
   if (key == "pattern") {
+    pattern_id = value.toString();
     update_pattern();
   }
 }
@@ -98,10 +102,12 @@ void Tile::notify_field_changed(const QString& key, const QVariant& value) {
  */
 void Tile::update_pattern() {
 
+  animated = false;
+  pattern_index = -1;
+
   const TilesetModel* tileset = get_tileset();
   if (tileset != nullptr) {
-    int pattern_index = tileset->id_to_index(get_pattern_id());
-    if (pattern_index != -1) {
+    if (get_pattern_index() != -1) {
       // Update the resizing rules.
       set_base_size(tileset->get_pattern_frame(pattern_index).size());
       set_resize_mode(get_pattern_resize_mode());
@@ -112,11 +118,33 @@ void Tile::update_pattern() {
       // Update the traversable property.
       Ground ground = tileset->get_pattern_ground(pattern_index);
       set_traversable(GroundTraits::is_traversable(ground));
+
+      // Multi-frame patterns are animated in the map view.
+      animated = tileset->is_pattern_multi_frame(pattern_index);
     }
   }
+}
+
+/**
+ * @brief Returns the index of the pattern of this tile in the tileset.
+ *
+ * The index is resolved from the pattern id once and then reused as long
+ * as it still designates the same pattern.
+ * It only changes when patterns are created, deleted or renamed.
+ *
+ * @return The pattern index, or -1 if there is no such pattern.
+ */
+int Tile::get_pattern_index() const {
+
+  const TilesetModel* tileset = get_tileset();
+  if (tileset == nullptr) {
+    return -1;
+  }
 
-  // Invalidate the cached image.
-  pattern_image = QPixmap();
+  if (pattern_index == -1 || tileset->index_to_id(pattern_index) != pattern_id) {
+    pattern_index = tileset->id_to_index(pattern_id);
+  }
+  return pattern_index;
 }
 
 /**
@@ -130,8 +158,7 @@ ResizeMode Tile::get_pattern_resize_mode() const {
     return ResizeMode::MULTI_DIMENSION_ALL;
   }
 
-  int pattern_index = tileset->id_to_index(get_pattern_id());
-  if (pattern_index == -1) {
+  if (get_pattern_index() == -1) {
     return ResizeMode::MULTI_DIMENSION_ALL;
   }
 
@@ -159,22 +186,60 @@ ResizeMode Tile::get_pattern_resize_mode() const {
  */
 void Tile::draw(QPainter& painter) const {
 
-  if (pattern_image.isNull()) {
-    // Lazily create the image.
-    const TilesetModel* tileset = get_tileset();
-    if (tileset != nullptr) {
-      int pattern_index = tileset->id_to_index(get_pattern_id());
-      if (pattern_index == -1) {
-        // The pattern no longer exists: fallback to a generic tile icon.
-        EntityModel::draw(painter);
-        return;
-      }
-      int pattern_width = tileset->get_pattern_frame(pattern_index).width();
-      pattern_image = tileset->get_pattern_image(pattern_index).scaledToWidth(pattern_width);
-    }
+  // The image belongs to the tileset and is shared by all tiles of the pattern.
+  const TilesetModel* tileset = get_tileset();
+  if (tileset == nullptr) {
+    return;
+  }
+
+  if (get_pattern_index() == -1) {
+    // The pattern no longer exists: fallback to a generic tile icon.
+    EntityModel::draw(painter);
+    return;
+  }
+
+  painter.drawTiledPixmap(0, 0, get_width(), get_height(),
+                          tileset->get_pattern_tiled_image(pattern_index));
+}
+
+/**
+ * @copydoc EntityModel::is_animated
+ */
+bool Tile::is_animated() const {
+  return animated;
+}
+
+/**
+ * @brief Draws the frame of the pattern shown at a given time.
+ *
+ * Frames of multi-frame patterns succeed each other
+ * every pattern_frame_delay milliseconds, like in the engine.
+ *
+ * @param painter The painter to draw.
+ * @param animation_time Time of the animation clock in milliseconds.
+ */
+void Tile::draw_animated(QPainter& painter, qint64 animation_time) const {
+
+  const TilesetModel* tileset = get_tileset();
+  if (!animated || tileset == nullptr) {
+    draw(painter);
+    return;
+  }
+
+  if (get_pattern_index() == -1) {
+    draw(painter);
+    return;
+  }
+
+  const int num_frames = tileset->get_pattern_num_frames(pattern_index);
+  const int frame_index = (animation_time / pattern_frame_delay) % num_frames;
+  const QPixmap& frame_image = tileset->get_pattern_frame_image(pattern_index, frame_index);
+  if (frame_image.isNull()) {
+    draw(painter);
+    return;
   }
 
-  painter.drawTiledPixmap(0, 0, get_width(), get_height(), pattern_image);
+  painter.drawTiledPixmap(0, 0, get_width(), get_height(), frame_image);
 }
 
 /**
@@ -0,0 +1,509 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "entities/entity_model.h"
+#include "entity_clipboard.h"
+#include "map_model.h"
+#include <solarus/core/MapData.h>
+#include <QMimeData>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace SolarusEditor {
+
+namespace EntityClipboard {
+
+namespace {
+
+constexpr quint32 magic = 0x53454E54;    // "SENT".
+constexpr quint32 format_version = 1;    // Increment when the format changes.
+
+/**
+ * @brief Type of an entity field in the binary format.
+ */
+enum class FieldType : quint8 {
+  STRING,
+  INTEGER,
+  BOOLEAN
+};
+
+/**
+ * @brief Writes entities in the binary format.
+ */
+class Writer {
+
+public:
+
+  /**
+   * @brief Appends an unsigned integer in 7-bit groups,
+   * the high bit telling if another group follows.
+   * @param value The value to write.
+   */
+  void write_unsigned(quint32 value) {
+
+    while (value >= 0x80) {
+      body.append(static_cast<char>((value & 0x7F) | 0x80));
+      value >>= 7;
+    }
+    body.append(static_cast<char>(value));
+  }
+
+  /**
+   * @brief Appends a signed integer, small absolute values taking less space.
+   * @param value The value to write.
+   */
+  void write_signed(qint32 value) {
+
+    // Zigzag encoding: 0, -1, 1, -2, 2... become 0, 1, 2, 3, 4...
+    write_unsigned((static_cast<quint32>(value) << 1) ^ static_cast<quint32>(value >> 31));
+  }
+
+  /**
+   * @brief Appends a string as its index in the string table.
+   * @param value The string to write.
+   */
+  void write_string(const std::string& value) {
+
+    auto it = string_indexes.find(value);
+    if (it == string_indexes.end()) {
+      it = string_indexes.emplace(value, static_cast<quint32>(strings.size())).first;
+      strings.push_back(value);
+    }
+    write_unsigned(it->second);
+  }
+
+  /**
+   * @brief Appends an entity.
+   *
+   * The layer and coordinates are relative to the previous entity.
+   *
+   * @param entity The entity to write.
+   */
+  void write_entity(const Solarus::EntityData& entity) {
+
+    const Solarus::Point& xy = entity.get_xy();
+    write_unsigned(static_cast<quint32>(entity.get_type()));
+    write_signed(entity.get_layer() - previous_layer);
+    write_signed(xy.x - previous_xy.x);
+    write_signed(xy.y - previous_xy.y);
+    write_string(entity.get_name());
+    previous_layer = entity.get_layer();
+    previous_xy = xy;
+
+    const auto& fields = entity.get_specific_properties();
+    write_unsigned(static_cast<quint32>(fields.size()));
+    for (const auto& kvp : fields) {
+      const std::string& key = kvp.first;
+      write_string(key);
+      if (entity.is_string(key)) {
+        body.append(static_cast<char>(FieldType::STRING));
+        write_string(entity.get_string(key));
+      }
+      else if (entity.is_integer(key)) {
+        body.append(static_cast<char>(FieldType::INTEGER));
+        write_signed(entity.get_integer(key));
+      }
+      else {
+        body.append(static_cast<char>(FieldType::BOOLEAN));
+        body.append(static_cast<char>(entity.get_boolean(key) ? 1 : 0));
+      }
+    }
+
+    const int num_user_properties = entity.get_user_property_count();
+    write_unsigned(static_cast<quint32>(num_user_properties));
+    for (int i = 0; i < num_user_properties; ++i) {
+      const Solarus::EntityData::UserProperty& property = entity.get_user_property(i);
+      write_string(property.first);
+      write_string(property.second);
+    }
+  }
+
+  /**
+   * @brief Returns the whole data: header, string table and entities.
+   * @param num_entities Number of entities written.
+   * @return The binary data.
+   */
+  QByteArray get_data(int num_entities) {
+
+    Writer header;
+    header.write_unsigned(magic);
+    header.write_unsigned(format_version);
+    header.write_unsigned(static_cast<quint32>(strings.size()));
+    for (const std::string& value : strings) {
+      header.write_unsigned(static_cast<quint32>(value.size()));
+      header.body.append(value.data(), static_cast<int>(value.size()));
+    }
+    header.write_unsigned(static_cast<quint32>(num_entities));
+    return header.body + body;
+  }
+
+private:
+
+  QByteArray body;                 /**< Data written so far. */
+  std::vector<std::string> strings;/**< Strings in the order of their index. */
+  std::unordered_map<std::string, quint32>
+      string_indexes;              /**< Index of each string in the table. */
+  int previous_layer = 0;          /**< Layer of the last entity written. */
+  Solarus::Point previous_xy;      /**< Coordinates of the last entity written. */
+
+};
+
+/**
+ * @brief Reads entities written by Writer.
+ *
+ * Every read function returns @c false if the data is corrupted.
+ */
+class Reader {
+
+public:
+
+  /**
+   * @brief Creates a reader.
+   * @param data The binary data.
+   */
+  explicit Reader(const QByteArray& data) :
+    data(data) {
+  }
+
+  /**
+   * @brief Returns whether all data was read.
+   * @return @c true if the end was reached.
+   */
+  bool at_end() const {
+    return position == data.size();
+  }
+
+  /**
+   * @brief Reads an integer written by Writer::write_unsigned().
+   * @param[out] value The value read.
+   */
+  bool read_unsigned(quint32& value) {
+
+    value = 0;
+    for (int shift = 0; shift < 32; shift += 7) {
+      if (position >= data.size()) {
+        return false;
+      }
+      const quint8 byte = static_cast<quint8>(data.at(position++));
+      value |= static_cast<quint32>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief Reads an integer written by Writer::write_signed().
+   * @param[out] value The value read.
+   */
+  bool read_signed(qint32& value) {
+
+    quint32 zigzag = 0;
+    if (!read_unsigned(zigzag)) {
+      return false;
+    }
+    value = static_cast<qint32>((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+    return true;
+  }
+
+  /**
+   * @brief Reads a single byte.
+   * @param[out] value The value read.
+   */
+  bool read_byte(quint8& value) {
+
+    if (position >= data.size()) {
+      return false;
+    }
+    value = static_cast<quint8>(data.at(position++));
+    return true;
+  }
+
+  /**
+   * @brief Reads a string written by Writer::write_string().
+   * @param[out] value The value read.
+   */
+  bool read_string(std::string& value) {
+
+    quint32 index = 0;
+    if (!read_unsigned(index) || index >= strings.size()) {
+      return false;
+    }
+    value = strings[index];
+    return true;
+  }
+
+  /**
+   * @brief Reads the header and the string table.
+   * @param[out] num_entities Number of entities that follow.
+   */
+  bool read_header(quint32& num_entities) {
+
+    quint32 value = 0;
+    if (!read_unsigned(value) || value != magic ||
+        !read_unsigned(value) || value != format_version) {
+      return false;
+    }
+
+    quint32 num_strings = 0;
+    if (!read_unsigned(num_strings) ||
+        num_strings > static_cast<quint32>(data.size() - position)) {
+      return false;
+    }
+    strings.reserve(num_strings);
+    for (quint32 i = 0; i < num_strings; ++i) {
+      quint32 size = 0;
+      if (!read_unsigned(size) || size > static_cast<quint32>(data.size() - position)) {
+        return false;
+      }
+      strings.emplace_back(data.constData() + position, size);
+      position += static_cast<int>(size);
+    }
+
+    return read_unsigned(num_entities) &&
+        num_entities <= static_cast<quint32>(data.size() - position);
+  }
+
+  /**
+   * @brief Reads an entity written by Writer::write_entity().
+   * @param[out] entity The entity read.
+   */
+  bool read_entity(Solarus::EntityData& entity) {
+
+    quint32 type_value = 0;
+    qint32 layer_delta = 0;
+    qint32 dx = 0;
+    qint32 dy = 0;
+    std::string name;
+    if (!read_unsigned(type_value) ||
+        !read_signed(layer_delta) ||
+        !read_signed(dx) ||
+        !read_signed(dy) ||
+        !read_string(name)) {
+      return false;
+    }
+
+    const EntityType type = static_cast<EntityType>(type_value);
+    if (!EntityTraits::get_values().contains(type) ||
+        !EntityTraits::can_be_stored_in_map_file(type)) {
+      return false;
+    }
+
+    previous_layer += layer_delta;
+    previous_xy = Solarus::Point(previous_xy.x + dx, previous_xy.y + dy);
+    entity = Solarus::EntityData(type);
+    entity.set_layer(previous_layer);
+    entity.set_xy(previous_xy);
+    entity.set_name(name);
+
+    quint32 num_fields = 0;
+    if (!read_unsigned(num_fields)) {
+      return false;
+    }
+    std::string key;
+    std::string string_value;
+    for (quint32 i = 0; i < num_fields; ++i) {
+      quint8 field_type = 0;
+      if (!read_string(key) || !read_byte(field_type)) {
+        return false;
+      }
+
+      switch (static_cast<FieldType>(field_type)) {
+
+      case FieldType::STRING:
+        if (!entity.is_string(key) || !read_string(string_value)) {
+          return false;
+        }
+        entity.set_string(key, string_value);
+        break;
+
+      case FieldType::INTEGER:
+      {
+        qint32 int_value = 0;
+        if (!entity.is_integer(key) || !read_signed(int_value)) {
+          return false;
+        }
+        entity.set_integer(key, int_value);
+        break;
+      }
+
+      case FieldType::BOOLEAN:
+      {
+        quint8 bool_value = 0;
+        if (!entity.is_boolean(key) || !read_byte(bool_value)) {
+          return false;
+        }
+        entity.set_boolean(key, bool_value != 0);
+        break;
+      }
+
+      default:
+        return false;
+      }
+    }
+
+    quint32 num_user_properties = 0;
+    if (!read_unsigned(num_user_properties)) {
+      return false;
+    }
+    for (quint32 i = 0; i < num_user_properties; ++i) {
+      Solarus::EntityData::UserProperty property;
+      if (!read_string(property.first) || !read_string(property.second)) {
+        return false;
+      }
+      entity.add_user_property(property);
+    }
+    return true;
+  }
+
+private:
+
+  const QByteArray& data;          /**< Data to read. */
+  int position = 0;                /**< Current position in the data. */
+  std::vector<std::string> strings;/**< The string table. */
+  int previous_layer = 0;          /**< Layer of the last entity read. */
+  Solarus::Point previous_xy;      /**< Coordinates of the last entity read. */
+
+};
+
+}  // Anonymous namespace.
+
+/**
+ * @brief Returns the MIME type of the binary format.
+ * @return The MIME type.
+ */
+QString get_mime_type() {
+  return "application/x-solarus-map-entities";
+}
+
+/**
+ * @brief Encodes entities of a map in the binary format.
+ * @param map The map.
+ * @param indexes Indexes of existing entities of the map.
+ * They are stored in the order of the map.
+ * @return The encoded entities.
+ */
+QByteArray entities_to_binary(const MapModel& map, const EntityIndexes& indexes) {
+
+  // Sort entities to respect their relative order on the map when pasting.
+  EntityIndexes sorted_indexes = indexes;
+  std::sort(sorted_indexes.begin(), sorted_indexes.end());
+
+  Writer writer;
+  for (const EntityIndex& index : sorted_indexes) {
+    Q_ASSERT(map.entity_exists(index));
+    writer.write_entity(map.get_entity(index).get_entity());
+  }
+  return writer.get_data(sorted_indexes.size());
+}
+
+/**
+ * @brief Encodes entities that are not on a map in the binary format.
+ * @param entities The entities, in the order to store them.
+ * Their index is not stored.
+ * @return The encoded entities.
+ */
+QByteArray entities_to_binary(const AddableEntities& entities) {
+
+  Writer writer;
+  for (const AddableEntity& entity : entities) {
+    writer.write_entity(entity.entity->get_entity());
+  }
+  return writer.get_data(static_cast<int>(entities.size()));
+}
+
+/**
+ * @brief Creates entities from their binary format.
+ *
+ * The created entities are not on the map yet.
+ *
+ * @param map The map that will contain the entities.
+ * @param data Entities as returned by entities_to_binary().
+ * @return The created entities, or an empty list if the data is not valid.
+ */
+EntityModels create_entities_from_binary(MapModel& map, const QByteArray& data) {
+
+  Reader reader(data);
+  quint32 num_entities = 0;
+  if (!reader.read_header(num_entities)) {
+    return EntityModels();
+  }
+
+  EntityModels entities;
+  Solarus::EntityData entity_data;
+  for (quint32 i = 0; i < num_entities; ++i) {
+    if (!reader.read_entity(entity_data)) {
+      return EntityModels();
+    }
+    entities.push_back(EntityModel::create(map, entity_data));
+  }
+
+  if (!reader.at_end()) {
+    return EntityModels();
+  }
+  return entities;
+}
+
+/**
+ * @brief Creates clipboard data for entities of a map.
+ *
+ * The data contains both the binary format and the text format.
+ *
+ * @param map The map.
+ * @param indexes Indexes of existing entities of the map.
+ * @return The clipboard data. The caller (usually the clipboard)
+ * takes ownership of it.
+ */
+QMimeData* create_mime_data(const MapModel& map, const EntityIndexes& indexes) {
+
+  QMimeData* mime_data = new QMimeData();
+  mime_data->setData(get_mime_type(), entities_to_binary(map, indexes));
+  mime_data->setText(map.entities_to_string(indexes));
+  return mime_data;
+}
+
+/**
+ * @brief Creates entities from clipboard data.
+ *
+ * The binary format is used if present, otherwise the text.
+ * The created entities are not on the map yet.
+ *
+ * @param map The map that will contain the entities.
+ * @param mime_data The clipboard data.
+ * @return The created entities, or an empty list if the clipboard
+ * contains no valid entities.
+ */
+EntityModels create_entities(MapModel& map, const QMimeData& mime_data) {
+
+  if (mime_data.hasFormat(get_mime_type())) {
+    EntityModels entities = create_entities_from_binary(map, mime_data.data(get_mime_type()));
+    if (!entities.empty()) {
+      return entities;
+    }
+  }
+
+  const QString& text = mime_data.text();
+  if (text.isEmpty()) {
+    return EntityModels();
+  }
+  return map.create_entities_from_string(text);
+}
+
+}
+
+}
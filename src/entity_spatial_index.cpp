@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "entities/entity_model.h"
+#include "entity_spatial_index.h"
+#include <algorithm>
+
+namespace SolarusEditor {
+
+/**
+ * @brief Creates an empty spatial index.
+ */
+EntitySpatialIndex::EntitySpatialIndex() :
+  buckets(),
+  locations() {
+
+}
+
+/**
+ * @brief Removes all entities from the index.
+ */
+void EntitySpatialIndex::clear() {
+
+  buckets.clear();
+  locations.clear();
+}
+
+/**
+ * @brief Adds an entity to the index.
+ * @param entity The entity to add. It must be on the map.
+ */
+void EntitySpatialIndex::add(const EntityModel& entity) {
+
+  Q_ASSERT(!locations.contains(&entity));
+
+  Location location = { entity.get_layer(), get_location_box(entity) };
+  insert(entity, location);
+}
+
+/**
+ * @brief Removes an entity from the index.
+ * @param entity The entity to remove.
+ */
+void EntitySpatialIndex::remove(const EntityModel& entity) {
+
+  auto it = locations.find(&entity);
+  if (it == locations.end()) {
+    return;
+  }
+
+  erase(entity, *it);
+}
+
+/**
+ * @brief Updates the position of an entity in the index.
+ *
+ * Call this function when the bounding box or the layer of the entity
+ * may have changed.
+ *
+ * @param entity The entity to update.
+ */
+void EntitySpatialIndex::update(const EntityModel& entity) {
+
+  Location location = { entity.get_layer(), get_location_box(entity) };
+
+  auto it = locations.find(&entity);
+  if (it != locations.end()) {
+    if (it->layer == location.layer && it->box == location.box) {
+      // No change.
+      return;
+    }
+    erase(entity, *it);
+  }
+  insert(entity, location);
+}
+
+/**
+ * @brief Returns the entities of a layer that overlap a rectangle.
+ * @param layer A layer.
+ * @param rectangle A rectangle in map coordinates.
+ * @return Indexes of the entities found, sorted.
+ */
+EntityIndexes EntitySpatialIndex::find_entities_in_rectangle(int layer, const QRect& rectangle) const {
+
+  EntityIndexes indexes;
+  auto layer_it = buckets.find(layer);
+  if (layer_it == buckets.end() || rectangle.isEmpty()) {
+    return indexes;
+  }
+  const Buckets& layer_buckets = *layer_it;
+
+  const QRect& range = get_bucket_range(rectangle);
+  for (int bucket_y = range.top(); bucket_y <= range.bottom(); ++bucket_y) {
+    for (int bucket_x = range.left(); bucket_x <= range.right(); ++bucket_x) {
+      auto bucket_it = layer_buckets.find(get_bucket_key(bucket_x, bucket_y));
+      if (bucket_it == layer_buckets.end()) {
+        continue;
+      }
+      for (const EntityModel* entity : *bucket_it) {
+        const QRect& box = locations.value(entity).box;
+        const QRect& intersection = box & rectangle;
+        if (intersection.isEmpty()) {
+          continue;
+        }
+        // An entity overlapping several buckets is only reported
+        // by the first bucket of its intersection with the rectangle.
+        const QRect& first_bucket = get_bucket_range(intersection);
+        if (first_bucket.left() == bucket_x && first_bucket.top() == bucket_y) {
+          indexes << entity->get_index();
+        }
+      }
+    }
+  }
+
+  std::sort(indexes.begin(), indexes.end());
+  return indexes;
+}
+
+/**
+ * @brief Returns the entities of a layer that contain a point.
+ * @param layer A layer.
+ * @param xy A point in map coordinates.
+ * @return Indexes of the entities found, sorted.
+ */
+EntityIndexes EntitySpatialIndex::find_entities_at_point(int layer, const QPoint& xy) const {
+
+  return find_entities_in_rectangle(layer, QRect(xy, QSize(1, 1)));
+}
+
+/**
+ * @brief Returns the key of a bucket in the hash of buckets.
+ * @param bucket_x X coordinate of the bucket in the grid of buckets.
+ * @param bucket_y Y coordinate of the bucket in the grid of buckets.
+ * @return The corresponding key.
+ */
+quint64 EntitySpatialIndex::get_bucket_key(int bucket_x, int bucket_y) {
+
+  return (static_cast<quint64>(static_cast<quint32>(bucket_x)) << 32) |
+      static_cast<quint32>(bucket_y);
+}
+
+/**
+ * @brief Returns the buckets overlapped by a rectangle.
+ * @param box A non-empty rectangle in map coordinates.
+ * @return The range of buckets, in bucket coordinates (inclusive).
+ */
+QRect EntitySpatialIndex::get_bucket_range(const QRect& box) {
+
+  // Floor division, also correct for entities outside the map.
+  const auto& to_bucket = [](int coordinate) {
+    return coordinate >= 0 ? coordinate / bucket_size : -((-coordinate - 1) / bucket_size) - 1;
+  };
+  return QRect(QPoint(to_bucket(box.left()), to_bucket(box.top())),
+               QPoint(to_bucket(box.right()), to_bucket(box.bottom())));
+}
+
+/**
+ * @brief Returns the box to store for an entity.
+ * @param entity An entity.
+ * @return Its bounding box, with a size of at least 1x1 pixel.
+ */
+QRect EntitySpatialIndex::get_location_box(const EntityModel& entity) {
+
+  const QRect& box = entity.get_bounding_box();
+  return QRect(box.topLeft(), box.size().expandedTo(QSize(1, 1)));
+}
+
+/**
+ * @brief Stores an entity in the buckets of its location.
+ * @param entity The entity.
+ * @param location Where to store it.
+ */
+void EntitySpatialIndex::insert(const EntityModel& entity, const Location& location) {
+
+  Buckets& layer_buckets = buckets[location.layer];
+  const QRect& range = get_bucket_range(location.box);
+  for (int bucket_y = range.top(); bucket_y <= range.bottom(); ++bucket_y) {
+    for (int bucket_x = range.left(); bucket_x <= range.right(); ++bucket_x) {
+      layer_buckets[get_bucket_key(bucket_x, bucket_y)].append(&entity);
+    }
+  }
+  locations.insert(&entity, location);
+}
+
+/**
+ * @brief Removes an entity from the buckets of its location.
+ * @param entity The entity.
+ * @param location Where it is stored.
+ */
+void EntitySpatialIndex::erase(const EntityModel& entity, const Location& location) {
+
+  const Location old_location = location;  // The reference is invalidated below.
+  locations.remove(&entity);
+
+  Buckets& layer_buckets = buckets[old_location.layer];
+  const QRect& range = get_bucket_range(old_location.box);
+  for (int bucket_y = range.top(); bucket_y <= range.bottom(); ++bucket_y) {
+    for (int bucket_x = range.left(); bucket_x <= range.right(); ++bucket_x) {
+      auto bucket_it = layer_buckets.find(get_bucket_key(bucket_x, bucket_y));
+      if (bucket_it == layer_buckets.end()) {
+        continue;
+      }
+      bucket_it->removeOne(&entity);
+      if (bucket_it->isEmpty()) {
+        layer_buckets.erase(bucket_it);
+      }
+    }
+  }
+}
+
+}
@@ -16,6 +16,7 @@
  */
 #include "indexed_string_tree.h"
 #include "editor_exception.h"
+#include <algorithm>
 
 namespace SolarusEditor {
 
@@ -25,7 +26,8 @@ namespace SolarusEditor {
  */
 IndexedStringTree::IndexedStringTree(const QString& separator) :
   separator(separator),
-  root(new Node()) {
+  root(new Node()),
+  comparator() {
 }
 
 /**
@@ -49,7 +51,7 @@ int IndexedStringTree::get_index(const QString& key) const {
   if (node == nullptr) {
     return -1;
   }
-  return node->index;
+  return get_node_index(node);
 }
 
 /**
@@ -99,9 +101,7 @@ QString IndexedStringTree::get_row_key(
     return "";
   }
 
-  auto it = node->children.begin();
-  std::advance(it, index);
-  return it->second->key;
+  return node->children[index]->key;
 }
 
 /**
@@ -215,6 +215,49 @@ bool IndexedStringTree::remove_ref(const QString& key, bool keep_key) {
   return remove_child(key, REF_KEY, keep_key);
 }
 
+/**
+ * @brief Clears the tree and fills it with some keys at once.
+ *
+ * This is much faster than adding keys one by one:
+ * keys are sorted first so that each node is appended to its parent.
+ *
+ * @param keys The keys to add.
+ */
+void IndexedStringTree::build(const QStringList& keys) {
+
+  clear();
+
+  // Sort keys part by part, like siblings are sorted in the tree.
+  std::vector<QStringList> sorted_keys;
+  sorted_keys.reserve(keys.size());
+  for (const QString& key : keys) {
+    sorted_keys.push_back(key.split(separator));
+  }
+  const auto sub_key_less = [this](const QString& lhs, const QString& rhs) {
+    return comparator(lhs, rhs);
+  };
+  std::sort(sorted_keys.begin(), sorted_keys.end(),
+            [&sub_key_less](const QStringList& lhs, const QStringList& rhs) {
+    return std::lexicographical_compare(
+          lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), sub_key_less);
+  });
+
+  // An existing child with the same sub key can only be the last one.
+  for (const QStringList& key_list : sorted_keys) {
+    Node* node = root;
+    for (const QString& sub_key : key_list) {
+      Node* last_child = node->children.empty() ? nullptr : node->children.back();
+      if (last_child != nullptr && !comparator(last_child->sub_key, sub_key)) {
+        node = last_child;
+      }
+      else {
+        node = create_child(node, sub_key, node->children.size());
+      }
+    }
+    node->type = REAL_KEY;
+  }
+}
+
 /**
  * @brief Clears the tree.
  */
@@ -254,11 +297,70 @@ IndexedStringTree::Node* IndexedStringTree::get_child(const QString& key) const
 IndexedStringTree::Node* IndexedStringTree::get_sub_child(
     const Node *node, const QString& sub_key) const {
 
-  auto it = node->children.find(sub_key);
-  if (it == node->children.end()) {
+  int position = get_sub_child_position(node, sub_key);
+  if (position >= (int) node->children.size()) {
+    return nullptr;
+  }
+
+  Node* child = node->children[position];
+  if (comparator(sub_key, child->sub_key)) {
     return nullptr;
   }
-  return it->second;
+  return child;
+}
+
+/**
+ * @brief Returns where a sub key is or would be among the children of a node.
+ * @param node The parent node.
+ * @param sub_key A sub key.
+ * @return Index of the first child whose sub key is not before this one.
+ */
+int IndexedStringTree::get_sub_child_position(
+    const Node* node, const QString& sub_key) const {
+
+  auto it = std::lower_bound(
+        node->children.begin(), node->children.end(), sub_key,
+        [this](const Node* child, const QString& value) {
+    return comparator(child->sub_key, value);
+  });
+  return it - node->children.begin();
+}
+
+/**
+ * @brief Returns the index of a node in its parent.
+ * @param node A node.
+ * @return The index of the node, or 0 for the root.
+ */
+int IndexedStringTree::get_node_index(const Node* node) const {
+
+  if (node->parent == nullptr) {
+    return 0;
+  }
+  return get_sub_child_position(node->parent, node->sub_key);
+}
+
+/**
+ * @brief Creates a node and inserts it in the children of another one.
+ * @param parent The parent node.
+ * @param sub_key The sub key of the new node.
+ * @param position Where to insert the node in the children of the parent.
+ * It must keep children sorted.
+ * @return The new node, whose type is container.
+ */
+IndexedStringTree::Node* IndexedStringTree::create_child(
+    Node* parent, const QString& sub_key, int position) {
+
+  Node* node = new Node();
+  node->parent = parent;
+  node->sub_key = sub_key;
+  if (!parent->key.isEmpty()) {
+    node->key = parent->key + separator + sub_key;
+  } else {
+    node->key = sub_key;
+  }
+
+  parent->children.insert(parent->children.begin() + position, node);
+  return node;
 }
 
 /**
@@ -307,22 +409,13 @@ bool IndexedStringTree::add_child(
 
     QString sub_key = key_list.front();
 
-    // Create the new node.
-    node = new Node();
-    node->parent = parent;
-    if (!parent->key.isEmpty()) {
-      node->key = parent->key + separator + sub_key;
-    } else {
-      node->key = sub_key;
-    }
-
-    // Add the node and rebuild the index map.
-    parent->children.emplace(sub_key, node);
-    build_index_map(parent);
+    // Create the new node at its sorted position.
+    int position = get_sub_child_position(parent, sub_key);
+    node = create_child(parent, sub_key, position);
 
     // Set the index of the first added child.
     if (index == -1) {
-      index = node->index;
+      index = position;
     }
 
     parent = node;
@@ -367,7 +460,7 @@ bool IndexedStringTree::can_remove_child(
 
   // Set the parent_key and the index, return true.
   parent_key = parent != nullptr ? parent->key : "";
-  index = node->index;
+  index = get_node_index(node);
   return true;
 }
 
@@ -409,44 +502,24 @@ bool IndexedStringTree::remove_child(const QString& key, int type, bool keep_key
 
   // Get the parent and the iterator of the node.
   Node* parent = get_child(parent_key);
-  auto it = parent->children.begin();
-  std::advance(it, index);
+  auto it = parent->children.begin() + index;
 
-  // Remove the node and rebuild the index map.
-  delete it->second;
+  // Remove the node.
+  clear_children(*it);
+  delete *it;
   parent->children.erase(it);
-  build_index_map(parent);
   return true;
 }
 
-/**
- * @brief Builds or rebuilds the internal mapping of a node that gives
- * indexes from keys.
- *
- * Nodes are indexed by string keys, but nodes also treats them as a map,
- * so we need an additional integer index.
- *
- * @param node The node where to rebuild the index.
- */
-void IndexedStringTree::build_index_map(const Node* node) const {
-
-  int index = 0;
-  for (auto& kvp : node->children) {
-    kvp.second->index = index++;
-  }
-}
-
 /**
  * @brief Clears childs of a node.
  * @param node The node.
  */
 void IndexedStringTree::clear_children(Node* node) {
 
-  auto it = node->children.begin();
-  while (it != node->children.end()) {
-    clear_children(it->second);
-    delete it->second;
-    it++;
+  for (Node* child : node->children) {
+    clear_children(child);
+    delete child;
   }
   node->children.clear();
 }
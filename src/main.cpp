@@ -15,7 +15,10 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "widgets/main_window.h"
+#include "editor_exception.h"
 #include "editor_settings.h"
+#include "quest.h"
+#include "quest_checker.h"
 #include "version.h"
 #include <solarus/core/Arguments.h>
 #include <solarus/core/Debug.h>
@@ -24,12 +27,36 @@
 #include <QDesktopWidget>
 #include <QLibraryInfo>
 #include <QStyleFactory>
+#include <QTextStream>
 #include <QTranslator>
 
 namespace SolarusEditor {
 
 namespace {
 
+/**
+ * @brief Makes Qt load images without needing a display.
+ *
+ * Must be called before the application is created.
+ */
+void use_offscreen_platform() {
+
+  if (qgetenv("QT_QPA_PLATFORM").isEmpty()) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+}
+
+/**
+ * @brief Sets the name and version of the application.
+ * @param application The application.
+ */
+void initialize_application(QCoreApplication& application) {
+
+  application.setApplicationName("solarus-quest-editor");
+  application.setApplicationVersion(SOLARUSEDITOR_VERSION);
+  application.setOrganizationName("solarus");
+}
+
 /**
  * @brief Runs the quest editor GUI.
  * @param argc Number of arguments of the command line.
@@ -51,9 +78,7 @@ int run_editor_gui(int argc, char* argv[]) {
 
   // Set up the application.
   QApplication application(argc, argv);
-  application.setApplicationName("solarus-quest-editor");
-  application.setApplicationVersion(SOLARUSEDITOR_VERSION);
-  application.setOrganizationName("solarus");
+  initialize_application(application);
 
   EditorSettings::load_default_application_settings();
 
@@ -136,6 +161,62 @@ int run_quest(int argc, char* argv[]) {
   return 0;
 }
 
+/**
+ * @brief Loads all resources of a quest and reports problems, without GUI.
+ *
+ * Errors and a summary of load times are printed on the standard output.
+ *
+ * @param argc Number of arguments of the command line.
+ * @param argv Command-line arguments.
+ * @return 0 if no problem was found, 1 if there are errors,
+ * 2 if the quest cannot be opened.
+ */
+int check_quest(int argc, char* argv[]) {
+
+  // Images are loaded but nothing is displayed.
+  use_offscreen_platform();
+
+  QApplication application(argc, argv);
+  initialize_application(application);
+
+  QTextStream out(stdout);
+  bool verbose = false;
+  QString quest_path;
+  const QStringList& arguments = application.arguments();
+  for (int i = 2; i < arguments.size(); ++i) {
+    if (arguments[i] == "-v") {
+      verbose = true;
+    }
+    else {
+      quest_path = arguments[i];
+    }
+  }
+
+  if (quest_path.isEmpty()) {
+    out << "Usage: solarus-quest-editor -check [-v] quest_path" << endl;
+    return 2;
+  }
+
+  Quest quest;
+  try {
+    quest.set_root_path(quest_path);
+    if (!quest.exists()) {
+      throw EditorException(QApplication::tr("No quest was found in directory\n'%1'").arg(quest_path));
+    }
+    quest.check_version();
+  }
+  catch (const EditorException& ex) {
+    ex.print_message();
+    return 2;
+  }
+
+  QuestChecker checker(quest);
+  checker.check();
+  checker.print_report(out, verbose);
+
+  return checker.get_num_errors() == 0 ? 0 : 1;
+}
+
 }  // Anonymous namespace
 
 }  // namespace SolarusEditor
@@ -147,6 +228,8 @@ int run_quest(int argc, char* argv[]) {
  *   solarus-quest-editor [quest_path [file_path]]
  * To directly run a quest (no GUI, similar to solarus-run):
  *   solarus-quest-editor -run quest_path
+ * To load all resources of a quest and report problems (no GUI):
+ *   solarus-quest-editor -check [-v] quest_path
  *
  * @param argc Number of arguments of the command line.
  * @param argv Command-line arguments.
@@ -158,6 +241,10 @@ int main(int argc, char* argv[]) {
     // Quest run mode.
     return SolarusEditor::run_quest(argc, argv);
   }
+  else if (argc > 1 && QString(argv[1]) == "-check") {
+    // Headless check mode.
+    return SolarusEditor::check_quest(argc, argv);
+  }
   else {
     // Editor GUI mode.
     return SolarusEditor::run_editor_gui(argc, argv);
@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "map_index.h"
+#include "map_snapshot.h"
+#include "quest.h"
+#include "size.h"
+#include <solarus/core/MapData.h>
+#include <QFileInfo>
+
+namespace SolarusEditor {
+
+namespace {
+
+/**
+ * @brief Returns the value of a string field of an entity.
+ * @param entity An entity.
+ * @param key Key of the field.
+ * @return The value, or an empty string if the entity has no such field.
+ */
+QString get_string_field(const Solarus::EntityData& entity, const std::string& key) {
+
+  if (!entity.is_string(key)) {
+    return QString();
+  }
+  return QString::fromStdString(entity.get_string(key));
+}
+
+}
+
+/**
+ * @brief Creates an empty map index for the specified quest.
+ * @param quest The quest.
+ */
+MapIndex::MapIndex(Quest& quest) :
+  quest(quest),
+  entries() {
+
+  connect(&quest, SIGNAL(root_path_changed(const QString&)),
+          this, SLOT(clear()));
+
+  QuestResources& resources = quest.get_resources();
+  connect(&resources, SIGNAL(element_added(ResourceType, const QString&, const QString&)),
+          this, SLOT(resource_element_changed(ResourceType, const QString&)));
+  connect(&resources, SIGNAL(element_removed(ResourceType, const QString&)),
+          this, SLOT(resource_element_changed(ResourceType, const QString&)));
+  connect(&resources, SIGNAL(element_renamed(ResourceType, const QString&, const QString&)),
+          this, SLOT(resource_element_renamed(ResourceType, const QString&, const QString&)));
+}
+
+/**
+ * @brief Returns information about a map.
+ *
+ * The map data file is only read if it has changed since the last call.
+ *
+ * @param map_id Id of a map.
+ * @return Information about this map.
+ * The result is marked invalid if the map file cannot be read.
+ */
+MapIndex::MapInfo MapIndex::get_map_info(const QString& map_id) {
+
+  return get_entry(map_id).info;
+}
+
+/**
+ * @brief Returns the maps that refer to a resource element.
+ *
+ * Supported resource types are maps (as teletransporter destinations),
+ * tilesets, musics, enemies (as breeds) and custom entity models.
+ *
+ * @param resource_type Type of the resource element.
+ * @param element_id Id of the resource element.
+ * @return Ids of maps that use this element.
+ */
+QStringList MapIndex::get_maps_using(ResourceType resource_type, const QString& element_id) {
+
+  QStringList map_ids;
+  const QStringList& all_map_ids = quest.get_resources().get_elements(ResourceType::MAP);
+  for (const QString& map_id : all_map_ids) {
+    const MapInfo& info = get_entry(map_id).info;
+    if (!info.valid) {
+      continue;
+    }
+
+    bool used = false;
+    switch (resource_type) {
+
+    case ResourceType::MAP:
+      used = info.destination_maps.contains(element_id);
+      break;
+
+    case ResourceType::TILESET:
+      used = info.tileset_id == element_id;
+      break;
+
+    case ResourceType::MUSIC:
+      used = info.music_id == element_id;
+      break;
+
+    case ResourceType::ENEMY:
+      used = info.enemy_breeds.contains(element_id);
+      break;
+
+    case ResourceType::ENTITY:
+      used = info.custom_entity_models.contains(element_id);
+      break;
+
+    default:
+      break;
+    }
+
+    if (used) {
+      map_ids << map_id;
+    }
+  }
+  return map_ids;
+}
+
+/**
+ * @brief Returns the maps that have tiles with a pattern.
+ * @param tileset_id Id of the tileset of the pattern.
+ * @param pattern_id Id of the pattern.
+ * @return Ids of maps using this tileset and having tiles with this pattern.
+ */
+QStringList MapIndex::get_maps_using_pattern(
+    const QString& tileset_id, const QString& pattern_id) {
+
+  QStringList map_ids;
+  const QStringList& all_map_ids = quest.get_resources().get_elements(ResourceType::MAP);
+  for (const QString& map_id : all_map_ids) {
+    const MapInfo& info = get_entry(map_id).info;
+    if (info.valid &&
+        info.tileset_id == tileset_id &&
+        info.pattern_ids.contains(pattern_id)) {
+      map_ids << map_id;
+    }
+  }
+  return map_ids;
+}
+
+/**
+ * @brief Forgets all maps.
+ */
+void MapIndex::clear() {
+
+  entries.clear();
+}
+
+/**
+ * @brief Forgets a map so that it is read again at the next query.
+ * @param map_id Id of the map to forget.
+ */
+void MapIndex::invalidate(const QString& map_id) {
+
+  entries.remove(map_id);
+}
+
+/**
+ * @brief Slot called when a resource element is added or removed.
+ * @param type Type of resource.
+ * @param id Id of the element.
+ */
+void MapIndex::resource_element_changed(ResourceType type, const QString& id) {
+
+  if (type == ResourceType::MAP) {
+    invalidate(id);
+  }
+}
+
+/**
+ * @brief Slot called when a resource element is renamed.
+ * @param type Type of resource.
+ * @param old_id Old id of the element.
+ * @param new_id New id of the element.
+ */
+void MapIndex::resource_element_renamed(
+    ResourceType type, const QString& old_id, const QString& new_id) {
+
+  if (type == ResourceType::MAP) {
+    invalidate(old_id);
+    invalidate(new_id);
+  }
+}
+
+/**
+ * @brief Returns the up-to-date entry of a map, reading it if necessary.
+ * @param map_id Id of a map.
+ * @return The entry of this map.
+ */
+const MapIndex::Entry& MapIndex::get_entry(const QString& map_id) {
+
+  QFileInfo file_info(quest.get_map_data_file_path(map_id));
+  const QDateTime last_modified = file_info.lastModified();
+  const qint64 file_size = file_info.exists() ? file_info.size() : -1;
+
+  auto it = entries.find(map_id);
+  if (it != entries.end() &&
+      it->last_modified == last_modified &&
+      it->file_size == file_size) {
+    // Up to date.
+    return *it;
+  }
+
+  Entry& entry = entries[map_id];
+  entry.info = read_map_info(map_id);
+  entry.last_modified = last_modified;
+  entry.file_size = file_size;
+  return entry;
+}
+
+/**
+ * @brief Reads the information of a map from its data file.
+ *
+ * Only the map data is parsed: no tileset or entity model is created.
+ *
+ * @param map_id Id of a map.
+ * @return The map information, invalid if the file could not be read.
+ */
+MapIndex::MapInfo MapIndex::read_map_info(const QString& map_id) const {
+
+  MapInfo info;
+
+  Solarus::MapData map;
+  QString path = quest.get_map_data_file_path(map_id);
+  if (!MapSnapshot::load(path, map)) {
+    if (!map.import_from_file(path.toStdString())) {
+      return info;
+    }
+    MapSnapshot::save(path, map);
+  }
+
+  info.valid = true;
+  info.tileset_id = QString::fromStdString(map.get_tileset_id());
+  info.music_id = QString::fromStdString(map.get_music_id());
+  info.size = Size::to_qsize(map.get_size());
+  info.min_layer = map.get_min_layer();
+  info.max_layer = map.get_max_layer();
+  info.world = QString::fromStdString(map.get_world());
+
+  // Named entities (the map gives them sorted by name).
+  for (const auto& kvp : map.get_named_entities_indexes()) {
+    const EntityIndex& index = kvp.second;
+    const Solarus::EntityData& entity = map.get_entity(index);
+    NamedEntity named_entity;
+    named_entity.name = QString::fromStdString(kvp.first);
+    named_entity.type = entity.get_type();
+    named_entity.layer = index.layer;
+    info.named_entities << named_entity;
+  }
+
+  // Resources referenced by entities.
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    const int num_entities = map.get_num_entities(layer);
+    for (int i = 0; i < num_entities; ++i) {
+      const Solarus::EntityData& entity = map.get_entity({ layer, i });
+      switch (entity.get_type()) {
+
+      case EntityType::TILE:
+      case EntityType::DYNAMIC_TILE:
+        info.pattern_ids.insert(get_string_field(entity, "pattern"));
+        break;
+
+      case EntityType::TELETRANSPORTER:
+        info.destination_maps.insert(get_string_field(entity, "destination_map"));
+        break;
+
+      case EntityType::ENEMY:
+        info.enemy_breeds.insert(get_string_field(entity, "breed"));
+        break;
+
+      case EntityType::CUSTOM:
+        info.custom_entity_models.insert(get_string_field(entity, "model"));
+        break;
+
+      default:
+        break;
+      }
+    }
+  }
+
+  return info;
+}
+
+}
@@ -17,15 +17,105 @@
 #include "entities/entity_model.h"
 #include "editor_exception.h"
 #include "map_model.h"
+#include "map_snapshot.h"
 #include "quest.h"
 #include "point.h"
 #include "size.h"
 #include "tileset_model.h"
+#include <QAtomicInt>
 #include <QIcon>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegExp>
+#include <QRunnable>
+#include <QSaveFile>
 #include <QSet>
+#include <QTimer>
+#include <algorithm>
 
 namespace SolarusEditor {
 
+/**
+ * @brief Result of the saves of a map running on the worker thread.
+ */
+struct MapModel::SaveState {
+  QAtomicInt num_pending_saves;        /**< Number of saves not finished yet. */
+  QMutex mutex;                        /**< Protects the field below. */
+  QString error_message;               /**< Error of the first save that failed
+                                        * since the last check, if any. */
+};
+
+/**
+ * @brief Task that writes a copy of the map data to the map file.
+ */
+class MapModel::SaveTask : public QRunnable {
+
+public:
+
+  /**
+   * @brief Creates a task.
+   * @param model The map model to notify when the file is written.
+   * @param state State shared by all saves of the map.
+   * @param path The map data file to write.
+   * @param map A copy of the map data to save.
+   */
+  SaveTask(MapModel& model,
+           const std::shared_ptr<SaveState>& state,
+           const QString& path,
+           const Solarus::MapData& map) :
+    model(model),
+    state(state),
+    path(path),
+    map(map) {
+  }
+
+  /**
+   * @brief Writes the file.
+   *
+   * The map is serialized in memory and written with QSaveFile,
+   * which writes a temporary file, syncs it to the disk and then renames it,
+   * so that the map file is never left half written.
+   */
+  void run() override {
+
+    QString error_message;
+    std::string buffer;
+    if (!map.export_to_buffer(buffer)) {
+      error_message = MapModel::tr("Cannot save map data file '%1'").arg(path);
+    }
+    else {
+      QSaveFile file(path);
+      if (!file.open(QIODevice::WriteOnly) ||
+          file.write(buffer.data(), buffer.size()) != static_cast<qint64>(buffer.size()) ||
+          !file.commit()) {
+        error_message = MapModel::tr("Cannot save map data file '%1'").arg(path);
+      }
+      else {
+        MapSnapshot::save(path, map);
+      }
+    }
+
+    if (!error_message.isEmpty()) {
+      QMutexLocker lock(&state->mutex);
+      if (state->error_message.isEmpty()) {
+        state->error_message = error_message;
+      }
+    }
+    state->num_pending_saves.fetchAndAddOrdered(-1);
+
+    // The model waits for this task before being destroyed.
+    QMetaObject::invokeMethod(&model, "save_task_finished", Qt::QueuedConnection);
+  }
+
+private:
+
+  MapModel& model;                     /**< The map model. */
+  std::shared_ptr<SaveState> state;    /**< State shared by all saves. */
+  QString path;                        /**< The file to write. */
+  Solarus::MapData map;                /**< Map data to write. */
+
+};
+
 /**
  * @brief Creates a map model.
  * @param quest The quest.
@@ -41,31 +131,64 @@ MapModel::MapModel(
   quest(quest),
   map_id(map_id),
   tileset_model(nullptr),
+  tileset_selection_model(nullptr),
+  tileset_content_dirty(false),
   entities(),
-  current_border_set_id() {
+  spatial_index(),
+  current_border_set_id(),
+  save_thread_pool(),
+  save_state(std::make_shared<SaveState>()) {
 
-  // Load the map data file.
+  // Saves of a map must be written in order.
+  save_thread_pool.setMaxThreadCount(1);
+
+  // Load the map data file, or its snapshot if it is up to date.
   QString path = quest.get_map_data_file_path(map_id);
 
-  if (!map.import_from_file(path.toStdString())) {
-    throw EditorException(tr("Cannot open map data file '%1'").arg(path));
+  if (!MapSnapshot::load(path, map)) {
+    if (!map.import_from_file(path.toStdString())) {
+      throw EditorException(tr("Cannot open map data file '%1'").arg(path));
+    }
+    MapSnapshot::save(path, map);
   }
 
-  // Create the tileset object.
+  // Get the tileset object, shared with other maps.
   QString tileset_id = get_tileset_id();
   if (!tileset_id.isEmpty()) {
-    tileset_model = new TilesetModel(quest, tileset_id, this);
+    tileset_model = quest.get_tileset_cache().get_tileset(tileset_id);
+    tileset_selection_model = new TilesetSelectionModel(*tileset_model, this);
+    connect_tileset();
   }
+  connect(&quest.get_tileset_cache(), SIGNAL(tileset_reloaded(QString)),
+          this, SLOT(cached_tileset_reloaded(QString)));
+  connect(&quest.get_sprite_cache(), SIGNAL(sprites_changed(QStringList)),
+          this, SLOT(cached_sprites_changed(QStringList)));
 
   // Create entities.
   for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
     for (int i = 0; i < get_num_entities(layer); ++i) {
       EntityIndex index = { layer, i };
       entities[layer].emplace_back(EntityModel::create(*this, index));
+      spatial_index.add(*entities[layer].back());
     }
   }
 }
 
+/**
+ * @brief Destructor.
+ *
+ * Waits for saves in progress and reports the error of a save
+ * that failed if nobody was notified yet.
+ */
+MapModel::~MapModel() {
+
+  save_thread_pool.waitForDone();
+
+  if (!save_state->error_message.isEmpty()) {
+    EditorException(save_state->error_message).show_dialog();
+  }
+}
+
 /**
  * @brief Returns the quest.
  */
@@ -92,14 +215,79 @@ QString MapModel::get_map_id() const {
 
 /**
  * @brief Saves the map to its data file.
+ *
+ * Returns when the file is written.
+ *
  * @throws EditorException If the file could not be saved.
  */
 void MapModel::save() const {
 
+  start_save();
+  wait_for_save();
+}
+
+/**
+ * @brief Starts saving the map to its data file in a worker thread.
+ *
+ * The map data is copied first, so it can be modified immediately.
+ * Saves of the same map are written in the order they are started.
+ * If a save fails, save_failed() is emitted later,
+ * unless wait_for_save() is called before and throws the error.
+ */
+void MapModel::start_save() const {
+
   QString path = quest.get_map_data_file_path(map_id);
 
-  if (!map.export_to_file(path.toStdString())) {
-    throw EditorException(tr("Cannot save map data file '%1'").arg(path));
+  save_state->num_pending_saves.fetchAndAddOrdered(1);
+  save_thread_pool.start(new SaveTask(
+      const_cast<MapModel&>(*this), save_state, path, map));
+}
+
+/**
+ * @brief Returns whether a save started by start_save() is not finished yet.
+ * @return @c true if the map file is being written.
+ */
+bool MapModel::is_saving() const {
+
+  return save_state->num_pending_saves.load() > 0;
+}
+
+/**
+ * @brief Waits until all saves started by start_save() are finished.
+ * @throws EditorException If one of them failed.
+ */
+void MapModel::wait_for_save() const {
+
+  save_thread_pool.waitForDone();
+
+  QString error_message;
+  {
+    QMutexLocker lock(&save_state->mutex);
+    std::swap(error_message, save_state->error_message);
+  }
+  if (!error_message.isEmpty()) {
+    throw EditorException(error_message);
+  }
+}
+
+/**
+ * @brief Slot called in the main thread when a save task is finished.
+ *
+ * Emits save_failed() if all saves are finished and one of them failed.
+ */
+void MapModel::save_task_finished() {
+
+  if (is_saving()) {
+    return;
+  }
+
+  QString error_message;
+  {
+    QMutexLocker lock(&save_state->mutex);
+    std::swap(error_message, save_state->error_message);
+  }
+  if (!error_message.isEmpty()) {
+    emit save_failed(error_message);
   }
 }
 
@@ -352,7 +540,7 @@ void MapModel::set_tileset_id(const QString& tileset_id) {
   }
   map.set_tileset_id(std_tileset_id);
 
-  reload_tileset();
+  update_tileset_model();
 
   emit tileset_id_changed(tileset_id);
 }
@@ -360,22 +548,170 @@ void MapModel::set_tileset_id(const QString& tileset_id) {
 /**
  * @brief Notifies this map that its tileset files may have changed.
  *
- * The tileset is refreshed.
+ * The tileset is loaded again from its files.
+ * Other maps using the same tileset and the tileset editor are refreshed too.
+ *
+ * Emits tileset_reloaded().
  *
- * Emis tileset_reloaded().
+ * @throws EditorException If the tileset has unsaved changes
+ * in the tileset editor.
  */
 void MapModel::reload_tileset() {
 
   const QString& tileset_id = get_tileset_id();
 
+  if (tileset_id.isEmpty()) {
+    update_tileset_model();
+    return;
+  }
+
+  if (quest.get_tileset_cache().is_tileset_modified(tileset_id)) {
+    throw EditorException(
+          tr("Tileset '%1' has unsaved changes in the tileset editor: "
+             "save or close it before refreshing").arg(tileset_id));
+  }
+
+  // This will call cached_tileset_reloaded() on all maps with this tileset.
+  quest.get_tileset_cache().reload(tileset_id);
+}
+
+/**
+ * @brief Gets the tileset model of the current tileset id from the cache.
+ *
+ * Emits tileset_reloaded().
+ */
+void MapModel::update_tileset_model() {
+
+  const QString& tileset_id = get_tileset_id();
+
+  if (tileset_model != nullptr) {
+    disconnect(tileset_model.get(), nullptr, this, nullptr);
+  }
+  if (tileset_selection_model != nullptr) {
+    // Views may still use it until they are notified.
+    tileset_selection_model->deleteLater();
+    tileset_selection_model = nullptr;
+  }
+
   if (tileset_id.isEmpty()) {
     tileset_model = nullptr;
   }
   else {
-    tileset_model = new TilesetModel(quest, tileset_id, this);
+    tileset_model = quest.get_tileset_cache().get_tileset(tileset_id);
+    tileset_selection_model = new TilesetSelectionModel(*tileset_model, this);
+    connect_tileset();
   }
 
   // Notify children.
+  tileset_content_dirty = false;
+  for (auto& kvp : entities) {
+    EntityModels& layer_entities = kvp.second;
+    for (EntityModelPtr& entity : layer_entities) {
+      entity->notify_tileset_changed(tileset_id);
+    }
+  }
+
+  emit tileset_reloaded();
+}
+
+/**
+ * @brief Watches modifications of the tileset model.
+ *
+ * The tileset is shared with the tileset editor,
+ * so it can change while the map is open.
+ */
+void MapModel::connect_tileset() {
+
+  TilesetModel* tileset = tileset_model.get();
+  connect(tileset, SIGNAL(image_changed()),
+          this, SLOT(tileset_content_changed()));
+  connect(tileset, SIGNAL(pattern_created(int, QString)),
+          this, SLOT(tileset_content_changed()));
+  connect(tileset, SIGNAL(pattern_deleted(int, QString)),
+          this, SLOT(tileset_content_changed()));
+  connect(tileset, SIGNAL(pattern_id_changed(int, QString, int, QString)),
+          this, SLOT(tileset_content_changed()));
+  connect(tileset, SIGNAL(pattern_position_changed(int, QPoint)),
+          this, SLOT(tileset_content_changed()));
+  connect(tileset, SIGNAL(pattern_ground_changed(int, Ground)),
+          this, SLOT(tileset_content_changed()));
+  connect(tileset, SIGNAL(pattern_default_layer_changed(int, int)),
+          this, SLOT(tileset_content_changed()));
+  connect(tileset, SIGNAL(pattern_repeat_mode_changed(int, TilePatternRepeatMode)),
+          this, SLOT(tileset_content_changed()));
+  connect(tileset, SIGNAL(pattern_animation_changed(int, PatternAnimation)),
+          this, SLOT(tileset_content_changed()));
+  connect(tileset, SIGNAL(pattern_separation_changed(int, PatternSeparation)),
+          this, SLOT(tileset_content_changed()));
+}
+
+/**
+ * @brief Slot called when a tileset was reloaded in the quest tileset cache.
+ * @param tileset_id Id of the reloaded tileset.
+ */
+void MapModel::cached_tileset_reloaded(const QString& tileset_id) {
+
+  if (tileset_id != get_tileset_id()) {
+    return;
+  }
+
+  update_tileset_model();
+}
+
+/**
+ * @brief Slot called when sprites were modified outside the editor.
+ *
+ * Emits sprites_reloaded() with the entities that showed these sprites.
+ *
+ * @param sprite_ids Ids of the sprites that changed.
+ */
+void MapModel::cached_sprites_changed(const QStringList& sprite_ids) {
+
+  EntityIndexes indexes;
+  for (auto& kvp : entities) {
+    EntityModels& layer_entities = kvp.second;
+    for (EntityModelPtr& entity : layer_entities) {
+      if (entity->notify_sprites_changed(sprite_ids)) {
+        indexes.append(entity->get_index());
+      }
+    }
+  }
+
+  if (!indexes.isEmpty()) {
+    emit sprites_reloaded(indexes);
+  }
+}
+
+/**
+ * @brief Slot called when the shared tileset model was modified.
+ *
+ * Entities are notified later, once for all modifications
+ * made in a row like deleting many patterns.
+ */
+void MapModel::tileset_content_changed() {
+
+  if (tileset_content_dirty) {
+    return;
+  }
+
+  tileset_content_dirty = true;
+  QTimer::singleShot(0, this, SLOT(notify_tileset_content_changed()));
+}
+
+/**
+ * @brief Notifies entities that the content of the tileset has changed.
+ *
+ * Emits tileset_reloaded().
+ */
+void MapModel::notify_tileset_content_changed() {
+
+  if (!tileset_content_dirty) {
+    // Already done.
+    return;
+  }
+  tileset_content_dirty = false;
+
+  const QString& tileset_id = get_tileset_id();
   for (auto& kvp : entities) {
     EntityModels& layer_entities = kvp.second;
     for (EntityModelPtr& entity : layer_entities) {
@@ -391,7 +727,19 @@ void MapModel::reload_tileset() {
  * @return The tileset. Returns nullptr if no tileset is set.
  */
 TilesetModel* MapModel::get_tileset_model() const {
-  return tileset_model;
+  return tileset_model.get();
+}
+
+/**
+ * @brief Returns the patterns selected in the tileset view of this map.
+ *
+ * The tileset model is shared with other maps and with the tileset editor,
+ * but each map has its own selection.
+ *
+ * @return The selection. Returns nullptr if no tileset is set.
+ */
+TilesetSelectionModel* MapModel::get_tileset_selection_model() const {
+  return tileset_selection_model;
 }
 
 /**
@@ -621,6 +969,30 @@ EntityIndexes MapModel::find_entities_of_type(EntityType type) const {
   return result;
 }
 
+/**
+ * @brief Returns the entities of a layer that overlap a rectangle.
+ * @param layer A layer.
+ * @param rectangle A rectangle in map coordinates.
+ * @return Indexes of the entities whose bounding box overlaps the rectangle,
+ * sorted.
+ */
+EntityIndexes MapModel::find_entities_in_rectangle(int layer, const QRect& rectangle) const {
+
+  return spatial_index.find_entities_in_rectangle(layer, rectangle);
+}
+
+/**
+ * @brief Returns the entities of a layer that contain a point.
+ * @param layer A layer.
+ * @param xy A point in map coordinates.
+ * @return Indexes of the entities whose bounding box contains the point,
+ * sorted.
+ */
+EntityIndexes MapModel::find_entities_at_point(int layer, const QPoint& xy) const {
+
+  return spatial_index.find_entities_at_point(layer, xy);
+}
+
 /**
  * @brief Returns the index of the default destination.
  * @return The default destination or an invalid index.
@@ -735,7 +1107,7 @@ int MapModel::get_entity_layer(const EntityIndex& index) const {
 /**
  * @brief Sets the layer of an entity on the map.
  *
- * Emits entity_layer_changed() if there is a change.
+ * Emits entities_layer_changed() if there is a change.
  *
  * @param index Index of the entity to change.
  * @param layer The new layer. The entity will be on top of other entities
@@ -749,39 +1121,7 @@ EntityIndex MapModel::set_entity_layer(const EntityIndex& index_before, int laye
     return EntityIndex();
   }
 
-  int layer_before = index_before.layer;
-  int order_before = index_before.order;
-  if (layer_after == layer_before) {
-    // No change.
-    return index_before;
-  }
-
-  EntityIndex index_after = map.set_entity_layer(index_before, layer_after);
-  int order_after = index_after.order;
-  Q_ASSERT(index_after.layer == layer_after);
-
-  auto it_before = entities[layer_before].begin() + order_before;
-  EntityModelPtr entity = std::move(*it_before);
-  Q_ASSERT(entity != nullptr);
-  EntityModel* entity_before = entity.get();
-  entities[layer_before].erase(it_before);
-
-  auto it_after = entities[layer_after].begin() + order_after;
-  entities[layer_after].insert(it_after, std::move(entity));
-
-  Q_ASSERT(entity_exists(index_after));
-  EntityModel* entity_after = &get_entity(index_after);
-  Q_ASSERT(entity_after == entity_before);
-  Q_UNUSED(entity_before);
-  entity_after->index_changed(index_after);
-
-  // FIXME set_entities_layer() for performance
-  rebuild_entity_indexes(layer_before);
-  rebuild_entity_indexes(layer_after);
-
-  emit entity_layer_changed(index_before, index_after);
-
-  return index_after;
+  return set_entities_layer({ index_before }, { layer_after }).first();
 }
 
 /**
@@ -808,7 +1148,7 @@ bool MapModel::is_common_layer(const EntityIndexes& indexes, int& layer) const {
 /**
  * @brief Sets the layer of some entities on the map.
  *
- * Emits entity_layer_changed() for each change.
+ * Emits entities_layer_changed() once if there is a change.
  *
  * @param indexes_before Sorted indexes of the entities to change.
  * @param layers_after The new layer for each entity.
@@ -828,20 +1168,38 @@ EntityIndexes MapModel::set_entities_layer(const EntityIndexes& indexes_before,
     entities.append(&get_entity(index_before));
   }
 
-  int i = 0;
-  for (const EntityModel* entity : entities) {
-    Q_ASSERT(entity != nullptr);
+  // Move all entities first and only update indexes at the end.
+  EntityIndexes changed_indexes_before;
+  QSet<int> layers_with_dirty_indexes;
+  for (int i = 0; i < entities.size(); ++i) {
+    const int layer_before = indexes_before[i].layer;
     const int layer_after = layers_after[i];
-    if (entity->get_layer() != layer_after) {
-      set_entity_layer(entity->get_index(), layer_after);
+    if (layer_after == layer_before) {
+      continue;
     }
-    ++i;
+    move_entity_to_layer(*entities[i], layer_before, layer_after);
+    changed_indexes_before.append(indexes_before[i]);
+    layers_with_dirty_indexes << layer_before << layer_after;
+  }
+
+  for (int layer : layers_with_dirty_indexes) {
+    rebuild_entity_indexes(layer);
   }
 
   // Now all indexes have finished their changes.
   EntityIndexes indexes_after;
-  for (const EntityModel* entity : entities) {
-    indexes_after.append(entity->get_index());
+  EntityIndexes changed_indexes_after;
+  for (int i = 0; i < entities.size(); ++i) {
+    const EntityModel& entity = *entities[i];
+    indexes_after.append(entity.get_index());
+    if (entity.get_layer() != indexes_before[i].layer) {
+      spatial_index.update(entity);
+      changed_indexes_after.append(entity.get_index());
+    }
+  }
+
+  if (!changed_indexes_before.isEmpty()) {
+    emit entities_layer_changed(changed_indexes_before, changed_indexes_after);
   }
 
   return indexes_after;
@@ -852,6 +1210,7 @@ EntityIndexes MapModel::set_entities_layer(const EntityIndexes& indexes_before,
  *
  * No other index change should have happened in the meantime.
  * The initial stacking order is restored.
+ * Emits entities_layer_changed() once if there is a change.
  *
  * @param indexes_after Indexes after the change, as returned by set_entities_layer().
  * @param indexes_before Indexes before the change, as passed to set_entities_layer().
@@ -862,21 +1221,49 @@ void MapModel::undo_set_entities_layer(const EntityIndexes& indexes_after, const
 
   // Work on entities instead of indexes, because indexes change during the traversal.
   QList<EntityModel*> entities;
-  for (const EntityIndex& index_after : indexes_after) {
-    entities.append(&get_entity(index_after));
-  }
-
-  for (int i = 0; i < entities.size(); ++i) {
-    EntityModel* entity = entities.at(i);
+  QMap<EntityIndex, int> changes;  // Rank in the lists, by index to restore.
+  QSet<int> layers_with_dirty_indexes;
+  for (int i = 0; i < indexes_after.size(); ++i) {
     const EntityIndex& index_before = indexes_before.at(i);
-    const EntityIndex& index_after = entity->get_index();  // The entity knows its own updated index.
+    const EntityIndex& index_after = indexes_after.at(i);
+    entities.append(&get_entity(index_after));
     if (index_before.layer == index_after.layer) {
       // Nothing to do for this entity.
       continue;
     }
-    EntityIndex tmp_index = set_entity_layer(index_after, index_before.layer);
-    set_entity_order(tmp_index, index_before.order);
+    changes.insert(index_before, i);
+    layers_with_dirty_indexes << index_before.layer << index_after.layer;
+  }
+
+  if (changes.isEmpty()) {
+    return;
   }
+
+  // First put all entities back on their initial layer.
+  for (int i : changes) {
+    move_entity_to_layer(*entities[i], indexes_after[i].layer, indexes_before[i].layer);
+  }
+
+  // Then restore their initial order, from the lowest one of each layer
+  // so that entities below them are already the initial ones.
+  for (int i : changes) {
+    move_entity_to_order(*entities[i], indexes_before[i].layer, indexes_before[i].order);
+  }
+
+  for (int layer : layers_with_dirty_indexes) {
+    rebuild_entity_indexes(layer);
+  }
+
+  EntityIndexes changed_indexes_after;
+  EntityIndexes changed_indexes_before;
+  for (int i : changes) {
+    Q_ASSERT(entities[i]->get_index() == indexes_before[i]);
+    spatial_index.update(*entities[i]);
+    changed_indexes_after.append(indexes_after[i]);
+    changed_indexes_before.append(indexes_before[i]);
+  }
+
+  emit entities_layer_changed(changed_indexes_after, changed_indexes_before);
 }
 
 /**
@@ -1018,6 +1405,7 @@ void MapModel::set_entity_xy(const EntityIndex& index, const QPoint& xy) {
   }
 
   entity.set_xy(xy);
+  spatial_index.update(entity);
   emit entity_xy_changed(index, xy);
 }
 
@@ -1039,6 +1427,39 @@ void MapModel::add_entity_xy(const EntityIndex& index, const QPoint& translation
   set_entity_xy(index, get_entity_xy(index) + translation);
 }
 
+/**
+ * @brief Applies a translation to several entities on the map.
+ *
+ * Emits entities_xy_changed() once for all entities if there is a change,
+ * instead of entity_xy_changed() for each entity.
+ *
+ * @param indexes Indexes of the entities to change.
+ * Indexes of entities that do not exist are ignored.
+ * @param translation The coordinates to add.
+ */
+void MapModel::add_entities_xy(const EntityIndexes& indexes, const QPoint& translation) {
+
+  if (translation.isNull()) {
+    return;
+  }
+
+  EntityIndexes changed_indexes;
+  for (const EntityIndex& index : indexes) {
+    if (!entity_exists(index)) {
+      continue;
+    }
+
+    EntityModel& entity = get_entity(index);
+    entity.set_xy(entity.get_xy() + translation);
+    spatial_index.update(entity);
+    changed_indexes.append(index);
+  }
+
+  if (!changed_indexes.isEmpty()) {
+    emit entities_xy_changed(changed_indexes);
+  }
+}
+
 /**
  * @brief Returns the coordinates of the upper-left corner of an entity.
  * @param index Index of the entity to get.
@@ -1125,9 +1546,43 @@ void MapModel::set_entity_size(const EntityIndex& index, const QSize& size) {
   }
 
   entity.set_size(size);
+  spatial_index.update(entity);
   emit entity_size_changed(index, size);
 }
 
+/**
+ * @brief Sets the size of several entities on the map.
+ *
+ * Emits entities_size_changed() once for all entities that change,
+ * instead of entity_size_changed() for each entity.
+ *
+ * @param sizes The new size of each entity to change.
+ * Entities that do not exist or already have this size are ignored.
+ */
+void MapModel::set_entities_size(const QMap<EntityIndex, QSize>& sizes) {
+
+  EntityIndexes changed_indexes;
+  for (auto it = sizes.begin(); it != sizes.end(); ++it) {
+    const EntityIndex& index = it.key();
+    if (!entity_exists(index)) {
+      continue;
+    }
+
+    EntityModel& entity = get_entity(index);
+    if (it.value() == entity.get_size()) {
+      continue;
+    }
+
+    entity.set_size(it.value());
+    spatial_index.update(entity);
+    changed_indexes.append(index);
+  }
+
+  if (!changed_indexes.isEmpty()) {
+    emit entities_size_changed(changed_indexes);
+  }
+}
+
 /**
  * @brief Returns an entity size rounded to the closest multiple of its base size.
  * @param index Index of the entity to check.
@@ -1233,6 +1688,53 @@ void MapModel::set_entity_bounding_box(const EntityIndex& index, const QRect& bo
   set_entity_size(index, bounding_box.size());
 }
 
+/**
+ * @brief Sets the bounding box of several entities on the map.
+ *
+ * Emits entities_xy_changed() once for all entities whose coordinates
+ * change and entities_size_changed() once for all entities whose size
+ * changes, instead of one signal per entity.
+ *
+ * @param bounding_boxes The new bounding box of each entity to change.
+ * Indexes of entities that do not exist are ignored.
+ */
+void MapModel::set_entities_bounding_box(const QMap<EntityIndex, QRect>& bounding_boxes) {
+
+  EntityIndexes xy_changed_indexes;
+  EntityIndexes size_changed_indexes;
+  for (auto it = bounding_boxes.begin(); it != bounding_boxes.end(); ++it) {
+    const EntityIndex& index = it.key();
+    if (!entity_exists(index)) {
+      continue;
+    }
+
+    EntityModel& entity = get_entity(index);
+    const QRect& bounding_box = it.value();
+    const QPoint& xy = bounding_box.topLeft() + entity.get_origin();
+    bool changed = false;
+    if (xy != entity.get_xy()) {
+      entity.set_xy(xy);
+      xy_changed_indexes.append(index);
+      changed = true;
+    }
+    if (bounding_box.size() != entity.get_size()) {
+      entity.set_size(bounding_box.size());
+      size_changed_indexes.append(index);
+      changed = true;
+    }
+    if (changed) {
+      spatial_index.update(entity);
+    }
+  }
+
+  if (!xy_changed_indexes.isEmpty()) {
+    emit entities_xy_changed(xy_changed_indexes);
+  }
+  if (!size_changed_indexes.isEmpty()) {
+    emit entities_size_changed(size_changed_indexes);
+  }
+}
+
 /**
  * @brief Returns whether an entity has a direction field.
  * @param index Index of an entity.
@@ -1375,10 +1877,44 @@ void MapModel::set_entity_direction(const EntityIndex& index, int direction) {
     return;
   }
 
-  get_entity(index).set_direction(direction);
+  entity.set_direction(direction);
+  spatial_index.update(entity);
   emit entity_direction_changed(index, direction);
 }
 
+/**
+ * @brief Sets the direction of several entities.
+ *
+ * Emits entities_direction_changed() once for all entities that change,
+ * instead of entity_direction_changed() for each entity.
+ *
+ * @param indexes Indexes of the entities to change.
+ * Entities that do not exist or already have this direction are ignored.
+ * @param direction The direction to set, or -1 to set no direction.
+ */
+void MapModel::set_entities_direction(const EntityIndexes& indexes, int direction) {
+
+  EntityIndexes changed_indexes;
+  for (const EntityIndex& index : indexes) {
+    if (!entity_exists(index)) {
+      continue;
+    }
+
+    EntityModel& entity = get_entity(index);
+    if (direction == entity.get_direction()) {
+      continue;
+    }
+
+    entity.set_direction(direction);
+    spatial_index.update(entity);
+    changed_indexes.append(index);
+  }
+
+  if (!changed_indexes.isEmpty()) {
+    emit entities_direction_changed(changed_indexes, direction);
+  }
+}
+
 /**
  * @brief Returns whether the given entities all have the same direction.
  *
@@ -1581,9 +2117,49 @@ void MapModel::set_entity_field(const EntityIndex& index, const QString& key, co
   }
 
   entity.set_field(key, value);
+  spatial_index.update(entity);
   emit entity_field_changed(index, key, value);
 }
 
+/**
+ * @brief Sets a field of several entities on the map to the same value.
+ *
+ * Emits entities_field_changed() once for all entities that change,
+ * instead of entity_field_changed() for each entity.
+ *
+ * @param indexes Indexes of the entities to change.
+ * Entities that do not exist or already have this value are ignored.
+ * @param key Key of the field to set.
+ * @param value The new value.
+ */
+void MapModel::set_entities_field(
+    const EntityIndexes& indexes, const QString& key, const QVariant& value) {
+
+  if (!value.isValid()) {
+    return;
+  }
+
+  EntityIndexes changed_indexes;
+  for (const EntityIndex& index : indexes) {
+    if (!entity_exists(index)) {
+      continue;
+    }
+
+    EntityModel& entity = get_entity(index);
+    if (value == entity.get_field(key)) {
+      continue;
+    }
+
+    entity.set_field(key, value);
+    spatial_index.update(entity);
+    changed_indexes.append(index);
+  }
+
+  if (!changed_indexes.isEmpty()) {
+    emit entities_field_changed(changed_indexes, key, value);
+  }
+}
+
 /**
  * @brief Adds entities to the map.
  *
@@ -1638,6 +2214,7 @@ void MapModel::add_entities(AddableEntities&& entities) {
     auto it = this->entities[layer].begin() + i;
     this->entities[layer].emplace(it, std::move(entity));
     get_entity(index).added_to_map(index);
+    spatial_index.add(get_entity(index));
 
     // Other indexes are now dirty, unless the entity was appended.
     if (i < (int) this->entities[layer].size() - 1) {
@@ -1654,6 +2231,68 @@ void MapModel::add_entities(AddableEntities&& entities) {
   emit entities_added(indexes);
 }
 
+/**
+ * @brief Returns the text representation of entities, as copied to the
+ * clipboard.
+ * @param indexes Indexes of existing entities.
+ * @return The entities in the map data file syntax,
+ * in the order of the map.
+ */
+QString MapModel::entities_to_string(const EntityIndexes& indexes) const {
+
+  // Sort entities to respect their relative order on the map when pasting.
+  EntityIndexes sorted_indexes = indexes;
+  std::sort(sorted_indexes.begin(), sorted_indexes.end());
+
+  QStringList entity_strings;
+  for (const EntityIndex& index : sorted_indexes) {
+    Q_ASSERT(entity_exists(index));
+    const QString& entity_string = get_entity(index).to_string();
+    Q_ASSERT(!entity_string.isEmpty());
+    entity_strings << entity_string;
+  }
+
+  return entity_strings.join("");
+}
+
+/**
+ * @brief Creates entities from their text representation.
+ *
+ * The created entities are not on the map yet.
+ *
+ * @param text Entities in the map data file syntax,
+ * as returned by entities_to_string().
+ * @return The created entities, or an empty list if the text is not valid.
+ */
+EntityModels MapModel::create_entities_from_string(const QString& text) {
+
+  QStringList entity_strings = text.split(QRegExp("[\n\r]\\}[\n\r]"), QString::SkipEmptyParts);
+
+  EntityModels entities;
+  for (int i = 0; i < entity_strings.size(); ++i) {
+
+    QString entity_string = entity_strings.at(i);
+
+    if (entity_string.simplified().isEmpty()) {
+      // Only whitespaces: skip.
+      continue;
+    }
+
+    if (i < entity_strings.size() - 1) {
+      entity_string = entity_string + "}";  // Restore the closing brace removed by split().
+    }
+    EntityModelPtr entity = EntityModel::create(*this, entity_string);
+    if (entity == nullptr) {
+      // The text is not a valid entity.
+      return EntityModels();
+    }
+
+    entities.push_back(std::move(entity));
+  }
+
+  return entities;
+}
+
 /**
  * @brief Remove entities from the map.
  *
@@ -1692,6 +2331,7 @@ AddableEntities MapModel::remove_entities(const EntityIndexes& indexes) {
     int i = index.order;
     auto it2 = this->entities[layer].begin() + i;
     EntityModelPtr entity = std::move(*it2);
+    spatial_index.remove(*entity);
     entity->about_to_be_removed_from_map();
     this->entities[layer].erase(it2);
 
@@ -1718,14 +2358,76 @@ AddableEntities MapModel::remove_entities(const EntityIndexes& indexes) {
   return entities;
 }
 
+/**
+ * @brief Moves an entity on top of another layer without updating indexes.
+ *
+ * The index stored in entities of both layers is not updated:
+ * rebuild_entity_indexes() has to be called on them afterwards.
+ *
+ * @param entity The entity to move.
+ * @param layer_before Its current layer.
+ * @param layer_after The new layer.
+ */
+void MapModel::move_entity_to_layer(EntityModel& entity, int layer_before, int layer_after) {
+
+  // The index stored in the entity may already be outdated.
+  auto& entities_before = entities[layer_before];
+  auto it_before = std::find_if(entities_before.begin(), entities_before.end(),
+                                [&entity](const EntityModelPtr& other) {
+    return other.get() == &entity;
+  });
+  Q_ASSERT(it_before != entities_before.end());
+  const int order_before = it_before - entities_before.begin();
+
+  EntityIndex index_after = map.set_entity_layer(EntityIndex(layer_before, order_before), layer_after);
+  Q_ASSERT(index_after.layer == layer_after);
+
+  EntityModelPtr entity_ptr = std::move(*it_before);
+  entities_before.erase(it_before);
+  auto it_after = entities[layer_after].begin() + index_after.order;
+  entities[layer_after].insert(it_after, std::move(entity_ptr));
+}
+
+/**
+ * @brief Changes the order of an entity in its layer without updating indexes.
+ *
+ * The index stored in entities of the layer is not updated:
+ * rebuild_entity_indexes() has to be called on it afterwards.
+ *
+ * @param entity The entity to move.
+ * @param layer Its current layer.
+ * @param order_after The new order. It must be valid.
+ */
+void MapModel::move_entity_to_order(EntityModel& entity, int layer, int order_after) {
+
+  auto& layer_entities = entities[layer];
+  auto it_before = std::find_if(layer_entities.begin(), layer_entities.end(),
+                                [&entity](const EntityModelPtr& other) {
+    return other.get() == &entity;
+  });
+  Q_ASSERT(it_before != layer_entities.end());
+  const int order_before = it_before - layer_entities.begin();
+  if (order_after == order_before) {
+    return;
+  }
+
+  map.set_entity_order(EntityIndex(layer, order_before), order_after);
+
+  auto it_after = layer_entities.begin() + order_after;
+  if (order_after < order_before) {
+    std::rotate(it_after, it_before, it_before + 1);
+  }
+  else {
+    std::rotate(it_before, it_before + 1, it_after + 1);
+  }
+}
+
 /**
  * @brief Sets the indexes of all entities on a layer from their rank in the
  * entities list.
  *
  * This function should be called when entities are added, moved or removed
  * because each entity stores its own index.
- * All entities of the layer should already know their correct layer,
- * only the order on this layer is updated.
  *
  * @param layer Layer to update.
  */
@@ -1736,9 +2438,7 @@ void MapModel::rebuild_entity_indexes(int layer) {
 
     const EntityModelPtr& entity = *it;
     Q_ASSERT(entity != nullptr);
-    EntityIndex index = entity->get_index();
-    index.order = i;
-    entity->index_changed(index);
+    entity->index_changed(EntityIndex(layer, i));
     ++i;
   }
 }
@@ -0,0 +1,414 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "entities/entity_traits.h"
+#include "map_snapshot.h"
+#include <solarus/core/MapData.h>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <utility>
+
+namespace SolarusEditor {
+
+namespace MapSnapshot {
+
+namespace {
+
+constexpr quint32 magic = 0x534D4150;    // "SMAP".
+constexpr quint32 format_version = 1;    // Increment when the format changes.
+constexpr int stream_version = QDataStream::Qt_5_0;
+
+/**
+ * @brief Type of an entity field in a snapshot.
+ */
+enum class FieldType : quint8 {
+  STRING,
+  INTEGER,
+  BOOLEAN
+};
+
+/**
+ * @brief Writes a string as its length followed by its bytes.
+ * @param stream The stream to write to.
+ * @param value The string to write.
+ */
+void write_string(QDataStream& stream, const std::string& value) {
+
+  stream << static_cast<quint32>(value.size());
+  stream.writeRawData(value.data(), static_cast<int>(value.size()));
+}
+
+/**
+ * @brief Reads a string written by write_string().
+ * @param stream The stream to read from.
+ * @param[out] value The string read.
+ * @return @c false if the stream is corrupted.
+ */
+bool read_string(QDataStream& stream, std::string& value) {
+
+  quint32 size = 0;
+  stream >> size;
+  if (stream.status() != QDataStream::Ok ||
+      size > static_cast<quint64>(stream.device()->bytesAvailable())) {
+    return false;
+  }
+
+  value.resize(size);
+  return size == 0 ||
+      stream.readRawData(&value[0], static_cast<int>(size)) == static_cast<int>(size);
+}
+
+/**
+ * @brief Writes an entity.
+ * @param stream The stream to write to.
+ * @param entity The entity to write.
+ */
+void write_entity(QDataStream& stream, const Solarus::EntityData& entity) {
+
+  stream << static_cast<quint8>(entity.get_type())
+         << static_cast<qint32>(entity.get_layer())
+         << static_cast<qint32>(entity.get_xy().x)
+         << static_cast<qint32>(entity.get_xy().y);
+  write_string(stream, entity.get_name());
+
+  const auto& fields = entity.get_specific_properties();
+  stream << static_cast<quint32>(fields.size());
+  for (const auto& kvp : fields) {
+    const std::string& key = kvp.first;
+    write_string(stream, key);
+    if (entity.is_string(key)) {
+      stream << static_cast<quint8>(FieldType::STRING);
+      write_string(stream, entity.get_string(key));
+    }
+    else if (entity.is_integer(key)) {
+      stream << static_cast<quint8>(FieldType::INTEGER)
+             << static_cast<qint32>(entity.get_integer(key));
+    }
+    else {
+      stream << static_cast<quint8>(FieldType::BOOLEAN)
+             << entity.get_boolean(key);
+    }
+  }
+
+  const int num_user_properties = entity.get_user_property_count();
+  stream << static_cast<quint32>(num_user_properties);
+  for (int i = 0; i < num_user_properties; ++i) {
+    const Solarus::EntityData::UserProperty& property = entity.get_user_property(i);
+    write_string(stream, property.first);
+    write_string(stream, property.second);
+  }
+}
+
+/**
+ * @brief Reads an entity written by write_entity() and adds it to a map.
+ * @param stream The stream to read from.
+ * @param map The map to add the entity to.
+ * @return @c false if the stream is corrupted.
+ */
+bool read_entity(QDataStream& stream, Solarus::MapData& map) {
+
+  quint8 type_value = 0;
+  qint32 layer = 0;
+  qint32 x = 0;
+  qint32 y = 0;
+  std::string name;
+  stream >> type_value >> layer >> x >> y;
+  if (!read_string(stream, name)) {
+    return false;
+  }
+
+  const EntityType type = static_cast<EntityType>(type_value);
+  if (!EntityTraits::get_values().contains(type) ||
+      !EntityTraits::can_be_stored_in_map_file(type) ||
+      layer < map.get_min_layer() ||
+      layer > map.get_max_layer()) {
+    return false;
+  }
+
+  Solarus::EntityData entity(type);
+  entity.set_layer(layer);
+  entity.set_xy(Solarus::Point(x, y));
+  entity.set_name(name);
+
+  quint32 num_fields = 0;
+  stream >> num_fields;
+  std::string key;
+  std::string string_value;
+  for (quint32 i = 0; i < num_fields; ++i) {
+    quint8 field_type = 0;
+    if (!read_string(stream, key)) {
+      return false;
+    }
+    stream >> field_type;
+
+    switch (static_cast<FieldType>(field_type)) {
+
+    case FieldType::STRING:
+      if (!entity.is_string(key) || !read_string(stream, string_value)) {
+        return false;
+      }
+      entity.set_string(key, string_value);
+      break;
+
+    case FieldType::INTEGER:
+    {
+      qint32 int_value = 0;
+      stream >> int_value;
+      if (!entity.is_integer(key)) {
+        return false;
+      }
+      entity.set_integer(key, int_value);
+      break;
+    }
+
+    case FieldType::BOOLEAN:
+    {
+      bool bool_value = false;
+      stream >> bool_value;
+      if (!entity.is_boolean(key)) {
+        return false;
+      }
+      entity.set_boolean(key, bool_value);
+      break;
+    }
+
+    default:
+      return false;
+    }
+  }
+
+  quint32 num_user_properties = 0;
+  stream >> num_user_properties;
+  for (quint32 i = 0; i < num_user_properties; ++i) {
+    Solarus::EntityData::UserProperty property;
+    if (!read_string(stream, property.first) ||
+        !read_string(stream, property.second)) {
+      return false;
+    }
+    entity.add_user_property(property);
+  }
+
+  if (stream.status() != QDataStream::Ok) {
+    return false;
+  }
+
+  return map.add_entity(entity).is_valid();
+}
+
+/**
+ * @brief Writes the header identifying the data file of a snapshot.
+ * @param stream The stream to write to.
+ * @param map_info The map data file.
+ */
+void write_header(QDataStream& stream, const QFileInfo& map_info) {
+
+  stream << magic
+         << format_version
+         << map_info.absoluteFilePath()
+         << static_cast<qint64>(map_info.size())
+         << static_cast<qint64>(map_info.lastModified().toMSecsSinceEpoch());
+}
+
+/**
+ * @brief Reads the header of a snapshot and checks that it is up to date.
+ * @param stream The stream to read from.
+ * @param map_info The map data file.
+ * @return @c true if the snapshot corresponds to the current data file.
+ */
+bool read_header(QDataStream& stream, const QFileInfo& map_info) {
+
+  quint32 snapshot_magic = 0;
+  quint32 snapshot_format_version = 0;
+  QString map_path;
+  qint64 map_size = 0;
+  qint64 map_last_modified = 0;
+  stream >> snapshot_magic >> snapshot_format_version;
+  if (stream.status() != QDataStream::Ok ||
+      snapshot_magic != magic ||
+      snapshot_format_version != format_version) {
+    return false;
+  }
+
+  stream >> map_path >> map_size >> map_last_modified;
+  return stream.status() == QDataStream::Ok &&
+      map_path == map_info.absoluteFilePath() &&
+      map_size == map_info.size() &&
+      map_last_modified == map_info.lastModified().toMSecsSinceEpoch();
+}
+
+}  // Anonymous namespace.
+
+/**
+ * @brief Returns the path of the snapshot of a map data file.
+ *
+ * Snapshots are in the cache directory of the editor,
+ * named after a hash of the absolute path of the data file.
+ *
+ * @param map_path Path of a map data file.
+ * @return Path of its snapshot, which may not exist.
+ */
+QString get_snapshot_path(const QString& map_path) {
+
+  const QByteArray& hash = QCryptographicHash::hash(
+        QFileInfo(map_path).absoluteFilePath().toUtf8(),
+        QCryptographicHash::Sha1).toHex();
+  return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+      "/map_snapshots/" + QString::fromLatin1(hash) + ".snapshot";
+}
+
+/**
+ * @brief Loads a map from the snapshot of its data file.
+ *
+ * The snapshot file is read at once and then decoded from memory.
+ *
+ * @param map_path Path of a map data file.
+ * @param[out] map The map loaded. Unchanged in case of failure.
+ * @return @c true in case of success, @c false if there is no valid
+ * snapshot for the current version of the data file.
+ */
+bool load(const QString& map_path, Solarus::MapData& map) {
+
+  const QFileInfo map_info(map_path);
+  if (!map_info.isFile()) {
+    return false;
+  }
+
+  QFile file(get_snapshot_path(map_path));
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  const QByteArray buffer = file.readAll();
+  file.close();
+
+  QDataStream stream(buffer);
+  stream.setVersion(stream_version);
+  if (!read_header(stream, map_info)) {
+    return false;
+  }
+
+  qint32 width = 0;
+  qint32 height = 0;
+  qint32 min_layer = 0;
+  qint32 max_layer = 0;
+  qint32 floor = 0;
+  qint32 location_x = 0;
+  qint32 location_y = 0;
+  std::string world;
+  std::string tileset_id;
+  std::string music_id;
+  stream >> width >> height >> min_layer >> max_layer
+         >> floor >> location_x >> location_y;
+  if (!read_string(stream, world) ||
+      !read_string(stream, tileset_id) ||
+      !read_string(stream, music_id) ||
+      min_layer > 0 ||
+      max_layer < 0) {
+    return false;
+  }
+
+  Solarus::MapData snapshot_map;
+  snapshot_map.set_size(Solarus::Size(width, height));
+  snapshot_map.set_min_layer(min_layer);
+  snapshot_map.set_max_layer(max_layer);
+  snapshot_map.set_floor(floor);
+  snapshot_map.set_location(Solarus::Point(location_x, location_y));
+  snapshot_map.set_world(world);
+  snapshot_map.set_tileset_id(tileset_id);
+  snapshot_map.set_music_id(music_id);
+
+  quint32 num_entities = 0;
+  stream >> num_entities;
+  for (quint32 i = 0; i < num_entities; ++i) {
+    if (!read_entity(stream, snapshot_map)) {
+      return false;
+    }
+  }
+
+  if (stream.status() != QDataStream::Ok || !stream.atEnd()) {
+    return false;
+  }
+
+  map = std::move(snapshot_map);
+  return true;
+}
+
+/**
+ * @brief Writes the snapshot of a map.
+ *
+ * Call this function right after the map was read from or written to
+ * its data file, so that the snapshot corresponds to the file.
+ *
+ * @param map_path Path of the map data file.
+ * @param map The map as in this data file.
+ * @return @c true in case of success.
+ */
+bool save(const QString& map_path, const Solarus::MapData& map) {
+
+  const QFileInfo map_info(map_path);
+  if (!map_info.isFile()) {
+    return false;
+  }
+
+  const QString& snapshot_path = get_snapshot_path(map_path);
+  if (!QDir().mkpath(QFileInfo(snapshot_path).path())) {
+    return false;
+  }
+
+  QByteArray buffer;
+  QDataStream stream(&buffer, QIODevice::WriteOnly);
+  stream.setVersion(stream_version);
+  write_header(stream, map_info);
+
+  stream << static_cast<qint32>(map.get_size().width)
+         << static_cast<qint32>(map.get_size().height)
+         << static_cast<qint32>(map.get_min_layer())
+         << static_cast<qint32>(map.get_max_layer())
+         << static_cast<qint32>(map.get_floor())
+         << static_cast<qint32>(map.get_location().x)
+         << static_cast<qint32>(map.get_location().y);
+  write_string(stream, map.get_world());
+  write_string(stream, map.get_tileset_id());
+  write_string(stream, map.get_music_id());
+
+  quint32 num_entities = 0;
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    num_entities += map.get_num_entities(layer);
+  }
+  stream << num_entities;
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    const int num_layer_entities = map.get_num_entities(layer);
+    for (int i = 0; i < num_layer_entities; ++i) {
+      write_entity(stream, map.get_entity({ layer, i }));
+    }
+  }
+
+  QSaveFile file(snapshot_path);
+  if (!file.open(QIODevice::WriteOnly) ||
+      file.write(buffer) != buffer.size()) {
+    return false;
+  }
+  return file.commit();
+}
+
+}
+
+}
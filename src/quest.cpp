@@ -54,7 +54,12 @@ const QMap<ResourceType, QString> resource_dirs = {
 Quest::Quest():
   root_path(),
   properties(*this),
-  resources(*this) {
+  resources(*this),
+  file_watcher(*this),
+  map_index(*this),
+  sprite_cache(*this),
+  tileset_cache(*this),
+  search_index(*this) {
 }
 
 /**
@@ -64,7 +69,12 @@ Quest::Quest():
 Quest::Quest(const QString& root_path):
   root_path(),
   properties(*this),
-  resources(*this) {
+  resources(*this),
+  file_watcher(*this),
+  map_index(*this),
+  sprite_cache(*this),
+  tileset_cache(*this),
+  search_index(*this) {
   set_root_path(root_path);
 }
 
@@ -188,6 +198,49 @@ QuestResources& Quest::get_resources() {
   return resources;
 }
 
+/**
+ * @brief Returns the watcher of files loaded by the caches of this quest.
+ * @return The file watcher.
+ */
+QuestFileWatcher& Quest::get_file_watcher() const {
+  return file_watcher;
+}
+
+/**
+ * @brief Returns the summary of all maps of this quest.
+ * @return The map index.
+ */
+MapIndex& Quest::get_map_index() const {
+  return map_index;
+}
+
+/**
+ * @brief Returns the sprites shared by all users of this quest.
+ * @return The sprite cache.
+ */
+SpriteCache& Quest::get_sprite_cache() const {
+  return sprite_cache;
+}
+
+/**
+ * @brief Returns the tilesets shared by all users of this quest.
+ * @return The tileset cache.
+ */
+TilesetCache& Quest::get_tileset_cache() const {
+  return tileset_cache;
+}
+
+/**
+ * @brief Returns the index to find text in all text files of this quest.
+ *
+ * It is empty until QuestSearchIndex::build() is called.
+ *
+ * @return The search index.
+ */
+QuestSearchIndex& Quest::get_search_index() const {
+  return search_index;
+}
+
 /**
  * @brief Returns the name of this quest.
  *
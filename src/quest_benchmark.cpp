@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "widgets/map_scene.h"
+#include "auto_tiler.h"
+#include "dialogs_model.h"
+#include "entity_clipboard.h"
+#include "map_model.h"
+#include "map_snapshot.h"
+#include "quest.h"
+#include "quest_benchmark.h"
+#include "quest_checker.h"
+#include "refactoring_engine.h"
+#include "strings_model.h"
+#include "synthetic_quest_builder.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QJsonObject>
+#include <QPainter>
+#include <QRegularExpression>
+#include <algorithm>
+#include <memory>
+
+namespace SolarusEditor {
+
+namespace {
+
+const QSize viewport_size(1024, 768);  // Size of the images where scenes are painted.
+constexpr int max_auto_tiled = 1024;   // Tiles given to the auto-tiler.
+
+/**
+ * @brief Paints an area of a scene into an image of the size of a viewport.
+ * @param scene The scene to paint.
+ * @param source Area of the scene to paint.
+ */
+void paint_scene(MapScene& scene, const QRectF& source) {
+
+  QImage image(viewport_size, QImage::Format_ARGB32_Premultiplied);
+  image.fill(Qt::transparent);
+  QPainter painter(&image);
+  scene.render(&painter, QRectF(QPointF(), viewport_size), source);
+}
+
+}  // Anonymous namespace.
+
+/**
+ * @brief Creates a benchmark of a quest.
+ * @param quest A quest generated by SyntheticQuestBuilder.
+ * @param num_iterations Number of runs of each benchmark.
+ */
+QuestBenchmark::QuestBenchmark(Quest& quest, int num_iterations) :
+  quest(quest),
+  num_iterations(std::max(1, num_iterations)),
+  results() {
+
+}
+
+/**
+ * @brief Runs all benchmarks.
+ * @throws EditorException If a file of the quest cannot be loaded.
+ */
+void QuestBenchmark::run() {
+
+  results.clear();
+  benchmark_map_load();
+  benchmark_map_save();
+  benchmark_auto_tiler();
+  benchmark_scene();
+  benchmark_copy_paste();
+  benchmark_refactoring();
+  benchmark_tree_models();
+  benchmark_quest_check();
+}
+
+/**
+ * @brief Returns the results of the benchmarks run.
+ * @return The results, in the order of benchmarks.
+ */
+const std::vector<QuestBenchmark::Result>& QuestBenchmark::get_results() const {
+  return results;
+}
+
+/**
+ * @brief Returns the results of the benchmarks run in JSON format.
+ * @return An array with one object per benchmark.
+ */
+QJsonArray QuestBenchmark::get_results_json() const {
+
+  QJsonArray array;
+  for (const Result& result : results) {
+    QJsonObject object;
+    object["name"] = result.name;
+    object["iterations"] = result.iterations;
+    object["mean_ms"] = result.mean_ms;
+    object["min_ms"] = result.min_ms;
+    object["max_ms"] = result.max_ms;
+    array.append(object);
+  }
+  return array;
+}
+
+/**
+ * @brief Runs an action several times and stores its durations.
+ * @param name Name of the benchmark.
+ * @param action The action to measure.
+ * @param setup Function to call before each run, not measured, or nullptr.
+ */
+void QuestBenchmark::measure(
+    const QString& name,
+    const std::function<void()>& action,
+    const std::function<void()>& setup) {
+
+  Result result;
+  result.name = name;
+  result.iterations = num_iterations;
+
+  double total_ms = 0.0;
+  QElapsedTimer timer;
+  for (int i = 0; i < num_iterations; ++i) {
+    if (setup) {
+      setup();
+    }
+    timer.start();
+    action();
+    const double duration_ms = timer.nsecsElapsed() / 1000000.0;
+
+    total_ms += duration_ms;
+    result.min_ms = (i == 0) ? duration_ms : std::min(result.min_ms, duration_ms);
+    result.max_ms = std::max(result.max_ms, duration_ms);
+  }
+  result.mean_ms = total_ms / num_iterations;
+
+  results.push_back(result);
+}
+
+/**
+ * @brief Measures the time to load a map, with and without its snapshot.
+ */
+void QuestBenchmark::benchmark_map_load() {
+
+  const QString& map_id = SyntheticQuestBuilder::get_map_id(0);
+  const QString& snapshot_path =
+      MapSnapshot::get_snapshot_path(quest.get_map_data_file_path(map_id));
+
+  // Parsing the Lua data file.
+  measure("map_load_lua", [&]() {
+    MapModel map(quest, map_id);
+  }, [&]() {
+    QFile::remove(snapshot_path);
+  });
+
+  // Reading the snapshot saved by the previous load.
+  measure("map_load_snapshot", [&]() {
+    MapModel map(quest, map_id);
+  });
+}
+
+/**
+ * @brief Measures the time to save a map, and how long the caller is blocked
+ * when the file is written in the background.
+ */
+void QuestBenchmark::benchmark_map_save() {
+
+  MapModel map(quest, SyntheticQuestBuilder::get_map_id(0));
+
+  measure("map_save", [&]() {
+    map.save();
+  });
+
+  measure("map_save_start", [&]() {
+    map.start_save();
+  }, [&]() {
+    map.wait_for_save();
+  });
+  map.wait_for_save();
+}
+
+/**
+ * @brief Measures the time to generate borders around a region of tiles.
+ */
+void QuestBenchmark::benchmark_auto_tiler() {
+
+  MapModel map(quest, SyntheticQuestBuilder::get_map_id(0));
+
+  // Tiles are the first entities of the layer.
+  EntityIndexes indexes;
+  const int num_tiles = std::min(map.get_num_tiles(0), max_auto_tiled);
+  for (int i = 0; i < num_tiles; ++i) {
+    indexes.append(EntityIndex(0, i));
+  }
+
+  measure("auto_tiler", [&]() {
+    AutoTiler auto_tiler(map, indexes, SyntheticQuestBuilder::get_border_set_id());
+    auto_tiler.generate_border_tiles();
+  });
+}
+
+/**
+ * @brief Measures the time to build a map scene and to paint it.
+ *
+ * Painting starts from a new scene each time, so tiles are really drawn
+ * and not only taken from the cache of the scene.
+ */
+void QuestBenchmark::benchmark_scene() {
+
+  MapModel map(quest, SyntheticQuestBuilder::get_map_id(0));
+
+  measure("scene_build", [&]() {
+    MapScene scene(map, nullptr);
+  });
+
+  std::unique_ptr<MapScene> scene;
+  const auto& create_scene = [&]() {
+    scene.reset();
+    scene.reset(new MapScene(map, nullptr));
+  };
+
+  // Top-left part of the map at zoom 1.
+  measure("scene_paint", [&]() {
+    paint_scene(*scene, QRectF(MapScene::get_margin_top_left(), viewport_size));
+  }, create_scene);
+
+  // The whole map, zoomed out to fit in the viewport.
+  measure("scene_paint_zoomed_out", [&]() {
+    paint_scene(*scene, scene->sceneRect());
+  }, create_scene);
+}
+
+/**
+ * @brief Measures the time to copy all entities of a layer and to paste them,
+ * in the text and binary clipboard formats.
+ */
+void QuestBenchmark::benchmark_copy_paste() {
+
+  MapModel map(quest, SyntheticQuestBuilder::get_map_id(0));
+
+  EntityIndexes indexes;
+  const int num_entities = map.get_num_entities(0);
+  for (int i = 0; i < num_entities; ++i) {
+    indexes.append(EntityIndex(0, i));
+  }
+
+  measure("copy_paste_text", [&]() {
+    const QString& text = map.entities_to_string(indexes);
+    map.create_entities_from_string(text);
+  });
+
+  measure("copy_paste_binary", [&]() {
+    const QByteArray& data = EntityClipboard::entities_to_binary(map, indexes);
+    EntityClipboard::create_entities_from_binary(map, data);
+  });
+}
+
+/**
+ * @brief Measures the time to find the changes of a pattern renaming.
+ *
+ * Only the scan of maps is measured:
+ * the changes are not written so that the quest stays the same.
+ */
+void QuestBenchmark::benchmark_refactoring() {
+
+  const QString& old_pattern_id = SyntheticQuestBuilder::get_pattern_id(0);
+  const QString& new_pattern_id = "renamed_pattern";
+
+  measure("refactoring_rename_pattern", [&]() {
+    QRegularExpression regex(
+          "\n  pattern = \"?" + QRegularExpression::escape(old_pattern_id) + "\"?,\n");
+    QString replacement("\n  pattern = \"" + new_pattern_id + "\",\n");
+    RefactoringEngine engine(regex, replacement);
+    engine.add_prefilter("\n  tileset = \"" + SyntheticQuestBuilder::get_tileset_id() + "\",\n");
+    engine.add_prefilter(old_pattern_id);
+    engine.scan_maps(quest, nullptr);
+  });
+}
+
+/**
+ * @brief Measures the time to populate the dialogs and strings trees.
+ */
+void QuestBenchmark::benchmark_tree_models() {
+
+  const QString& language_id = SyntheticQuestBuilder::get_language_id();
+
+  measure("dialogs_model", [&]() {
+    DialogsModel dialogs(quest, language_id);
+  });
+
+  measure("strings_model", [&]() {
+    StringsModel strings(quest, language_id);
+  });
+}
+
+/**
+ * @brief Measures the time to load and check the whole quest.
+ */
+void QuestBenchmark::benchmark_quest_check() {
+
+  measure("quest_check", [&]() {
+    QuestChecker checker(quest);
+    checker.check();
+  });
+}
+
+}
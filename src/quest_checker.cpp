@@ -0,0 +1,543 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "entities/entity_model.h"
+#include "dialogs_model.h"
+#include "editor_exception.h"
+#include "map_model.h"
+#include "quest.h"
+#include "quest_checker.h"
+#include "sprite_model.h"
+#include "strings_model.h"
+#include "tileset_model.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QTextStream>
+#include <QThreadPool>
+#include <map>
+
+namespace SolarusEditor {
+
+/**
+ * @brief Loads a tileset, a sprite, a dialogs file or a strings file
+ * on a worker thread.
+ *
+ * These models only read their own files, so they can be created
+ * on any thread.
+ */
+class QuestChecker::LoadTask : public QRunnable {
+
+public:
+
+  /**
+   * @brief Creates a task.
+   * @param quest The quest.
+   * @param report The report to fill. It must outlive the task.
+   * @param defined_ids Where to store the patterns of a tileset.
+   * It must outlive the task.
+   */
+  LoadTask(Quest& quest, FileReport& report, QSet<QString>& defined_ids) :
+    quest(quest),
+    report(report),
+    defined_ids(defined_ids) {
+  }
+
+  /**
+   * @brief Loads the file and fills the report.
+   */
+  void run() override {
+
+    QElapsedTimer timer;
+    timer.start();
+
+    try {
+      if (report.file_type == "tileset") {
+        TilesetModel tileset(quest, report.element_id);
+        set_loaded(timer);
+        check_tileset(tileset);
+      }
+      else if (report.file_type == "sprite") {
+        SpriteModel sprite(quest, report.element_id);
+        set_loaded(timer);
+        check_sprite(sprite);
+      }
+      else if (report.file_type == "dialogs") {
+        DialogsModel dialogs(quest, report.element_id);
+        set_loaded(timer);
+      }
+      else if (report.file_type == "strings") {
+        StringsModel strings(quest, report.element_id);
+        set_loaded(timer);
+      }
+    }
+    catch (const EditorException& ex) {
+      report.load_time = timer.nsecsElapsed() / 1000;
+      report.errors << ex.get_message();
+    }
+  }
+
+private:
+
+  /**
+   * @brief Marks the file as loaded.
+   * @param timer Timer started before creating the model.
+   */
+  void set_loaded(const QElapsedTimer& timer) {
+
+    report.load_time = timer.nsecsElapsed() / 1000;
+    report.loaded = true;
+  }
+
+  /**
+   * @brief Checks the image and the patterns of a tileset.
+   * @param tileset The tileset loaded.
+   */
+  void check_tileset(const TilesetModel& tileset) {
+
+    const QImage& image = tileset.get_patterns_image();
+    if (image.isNull()) {
+      report.errors << QuestChecker::tr("Missing tileset image '%1'").arg(
+                         quest.get_tileset_tiles_image_path(report.element_id));
+    }
+
+    const int num_patterns = tileset.get_num_patterns();
+    for (int i = 0; i < num_patterns; ++i) {
+      const QString& pattern_id = tileset.index_to_id(i);
+      defined_ids.insert(pattern_id);
+      if (!image.isNull() &&
+          !image.rect().contains(tileset.get_pattern_frames_bounding_box(i))) {
+        report.errors << QuestChecker::tr("Pattern '%1' is outside the tileset image").arg(
+                           pattern_id);
+      }
+    }
+  }
+
+  /**
+   * @brief Checks that the source images of a sprite exist.
+   *
+   * Images taken from a tileset are not checked because they depend on the map.
+   *
+   * @param sprite The sprite loaded.
+   */
+  void check_sprite(const SpriteModel& sprite) {
+
+    const QString& tileset_image_path =
+        quest.get_tileset_entities_image_path(sprite.get_tileset_id());
+    for (const QString& path : sprite.get_image_paths()) {
+      if (path != tileset_image_path && !QFileInfo(path).isFile()) {
+        report.errors << QuestChecker::tr("Missing source image '%1'").arg(path);
+      }
+    }
+  }
+
+  Quest& quest;                    /**< The quest. */
+  FileReport& report;              /**< The report to fill. */
+  QSet<QString>& defined_ids;      /**< Patterns found in a tileset. */
+
+};
+
+/**
+ * @brief Creates a checker for the specified quest.
+ * @param quest The quest to check. It must be valid.
+ */
+QuestChecker::QuestChecker(Quest& quest) :
+  quest(quest),
+  reports(),
+  defined_ids(),
+  pattern_references(),
+  sprite_references(),
+  map_tilesets(),
+  total_time(0) {
+
+}
+
+/**
+ * @brief Loads all resources of the quest and checks them.
+ *
+ * This function blocks until everything is loaded.
+ * Results are available in get_reports() afterwards.
+ */
+void QuestChecker::check() {
+
+  QElapsedTimer timer;
+  timer.start();
+
+  reports.clear();
+  defined_ids.clear();
+  pattern_references.clear();
+  sprite_references.clear();
+  map_tilesets.clear();
+
+  // Create all reports first: workers keep references to them.
+  const QuestResources& resources = quest.get_resources();
+  const auto& add_reports = [&](ResourceType resource_type, const QString& file_type) {
+    for (const QString& element_id : resources.get_elements(resource_type)) {
+      FileReport report;
+      report.file_type = file_type;
+      report.element_id = element_id;
+      reports.push_back(report);
+    }
+  };
+  add_reports(ResourceType::TILESET, "tileset");
+  add_reports(ResourceType::SPRITE, "sprite");
+  add_reports(ResourceType::LANGUAGE, "dialogs");
+  add_reports(ResourceType::LANGUAGE, "strings");
+  const int num_worker_reports = static_cast<int>(reports.size());
+  add_reports(ResourceType::MAP, "map");
+  defined_ids.resize(reports.size());
+
+  QThreadPool thread_pool;
+  for (int i = 0; i < num_worker_reports; ++i) {
+    thread_pool.start(new LoadTask(quest, reports[i], defined_ids[i]));
+  }
+
+  // Meanwhile, load maps here: they share tilesets through the quest.
+  for (int i = num_worker_reports; i < static_cast<int>(reports.size()); ++i) {
+    load_map(reports[i].element_id, reports[i], i);
+  }
+
+  thread_pool.waitForDone();
+  check_pending_references();
+
+  // Tilesets released by the cache are deleted later.
+  map_tilesets.clear();
+  QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+
+  total_time = timer.elapsed();
+}
+
+/**
+ * @brief Returns the result of each file checked.
+ * @return The reports.
+ */
+const std::vector<QuestChecker::FileReport>& QuestChecker::get_reports() const {
+  return reports;
+}
+
+/**
+ * @brief Returns the number of problems found.
+ * @return The total number of errors of all files.
+ */
+int QuestChecker::get_num_errors() const {
+
+  int num_errors = 0;
+  for (const FileReport& report : reports) {
+    num_errors += report.errors.size();
+  }
+  return num_errors;
+}
+
+/**
+ * @brief Returns the duration of the last check.
+ * @return The duration in milliseconds.
+ */
+qint64 QuestChecker::get_total_time() const {
+  return total_time;
+}
+
+/**
+ * @brief Prints the results of the last check.
+ *
+ * Files with errors are always printed with their errors.
+ * A summary of load times by kind of file follows.
+ *
+ * @param out Where to print.
+ * @param verbose @c true to also print the load time of files without error.
+ */
+void QuestChecker::print_report(QTextStream& out, bool verbose) const {
+
+  struct Summary {
+    int num_files = 0;
+    qint64 total_time = 0;
+    qint64 max_time = 0;
+    QString slowest_id;
+  };
+  std::map<QString, Summary> summaries;
+
+  for (const FileReport& report : reports) {
+    Summary& summary = summaries[report.file_type];
+    ++summary.num_files;
+    summary.total_time += report.load_time;
+    if (report.load_time >= summary.max_time) {
+      summary.max_time = report.load_time;
+      summary.slowest_id = report.element_id;
+    }
+
+    if (!verbose && report.errors.isEmpty()) {
+      continue;
+    }
+    out << QString("%1 ms  %2 %3").
+           arg(report.load_time / 1000.0, 9, 'f', 2).
+           arg(report.file_type, -8).
+           arg(report.element_id) << endl;
+    for (const QString& error : report.errors) {
+      out << "    " << tr("error: %1").arg(error) << endl;
+    }
+  }
+
+  out << endl;
+  for (const auto& kvp : summaries) {
+    const Summary& summary = kvp.second;
+    out << tr("%1: %2 files, %3 ms in total, slowest: '%4' (%5 ms)").
+           arg(kvp.first, -8).
+           arg(summary.num_files).
+           arg(summary.total_time / 1000.0, 0, 'f', 1).
+           arg(summary.slowest_id).
+           arg(summary.max_time / 1000.0, 0, 'f', 1) << endl;
+  }
+  out << tr("%1 files checked in %2 ms, %3 errors").
+         arg(reports.size()).
+         arg(total_time).
+         arg(get_num_errors()) << endl;
+}
+
+/**
+ * @brief Loads a map and checks its references.
+ * @param map_id Id of the map.
+ * @param report The report to fill.
+ * @param report_index Index of this report.
+ */
+void QuestChecker::load_map(const QString& map_id, FileReport& report, int report_index) {
+
+  QElapsedTimer timer;
+  timer.start();
+
+  std::unique_ptr<MapModel> map;
+  try {
+    map.reset(new MapModel(quest, map_id));
+  }
+  catch (const EditorException& ex) {
+    report.load_time = timer.nsecsElapsed() / 1000;
+    report.errors << ex.get_message();
+    return;
+  }
+  report.load_time = timer.nsecsElapsed() / 1000;
+  report.loaded = true;
+
+  const QString& tileset_id = map->get_tileset_id();
+  check_resource(ResourceType::TILESET, tileset_id, tr("Map"), report);
+  if (!tileset_id.isEmpty() && !map_tilesets.contains(tileset_id)) {
+    // Keep the tileset for the next maps, like when several maps are open.
+    map_tilesets.insert(tileset_id, quest.get_tileset_cache().get_tileset(tileset_id));
+  }
+
+  const QString& music_id = map->get_music_id();
+  if (music_id != "none" && music_id != "same") {
+    check_resource(ResourceType::MUSIC, music_id, tr("Map"), report);
+  }
+
+  for (int layer = map->get_min_layer(); layer <= map->get_max_layer(); ++layer) {
+    const int num_entities = map->get_num_entities(layer);
+    for (int i = 0; i < num_entities; ++i) {
+      check_entity(*map, { layer, i }, report, report_index);
+    }
+  }
+}
+
+/**
+ * @brief Checks the references of an entity of a map.
+ *
+ * References to patterns and sprites are only recorded:
+ * they are checked when all tilesets and sprites are loaded.
+ *
+ * @param map The map.
+ * @param index Index of the entity.
+ * @param report The report of the map.
+ * @param report_index Index of this report.
+ */
+void QuestChecker::check_entity(
+    const MapModel& map,
+    const EntityIndex& index,
+    FileReport& report,
+    int report_index) {
+
+  const EntityModel& entity = map.get_entity(index);
+  const EntityType type = entity.get_type();
+  const QString& type_name = EntityTraits::get_lua_name(type);
+  const QString& name = map.get_entity_name(index);
+  const QString& description = name.isEmpty() ?
+        tr("%1 %2 on layer %3").arg(type_name).arg(index.order).arg(index.layer) :
+        tr("%1 '%2'").arg(type_name, name);
+
+  switch (type) {
+
+  case EntityType::TILE:
+  case EntityType::DYNAMIC_TILE:
+    pattern_references << PendingReference{
+        report_index,
+        description,
+        map.get_tileset_id(),
+        entity.get_field("pattern").toString()
+    };
+    break;
+
+  case EntityType::TELETRANSPORTER:
+  {
+    const QString& destination_map = entity.get_field("destination_map").toString();
+    check_resource(ResourceType::MAP, destination_map, description, report);
+    if (quest.get_resources().exists(ResourceType::MAP, destination_map)) {
+      check_destination(
+            destination_map,
+            entity.get_field("destination").toString(),
+            description,
+            report);
+    }
+    break;
+  }
+
+  case EntityType::ENEMY:
+    check_resource(ResourceType::ENEMY, entity.get_field("breed").toString(), description, report);
+    break;
+
+  case EntityType::CUSTOM:
+  {
+    const QString& model = entity.get_field("model").toString();
+    if (!model.isEmpty()) {
+      check_resource(ResourceType::ENTITY, model, description, report);
+    }
+    break;
+  }
+
+  default:
+    break;
+  }
+
+  if (entity.has_field("sprite")) {
+    const QString& sprite_id = entity.get_field("sprite").toString();
+    if (!sprite_id.isEmpty()) {
+      sprite_references << PendingReference{
+          report_index,
+          description,
+          QString(),
+          sprite_id
+      };
+    }
+  }
+
+  if (entity.has_field("treasure_name")) {
+    const QString& item_id = entity.get_field("treasure_name").toString();
+    if (!item_id.isEmpty()) {
+      check_resource(ResourceType::ITEM, item_id, description, report);
+    }
+  }
+}
+
+/**
+ * @brief Checks that a resource element referenced by a map exists.
+ * @param resource_type Type of the resource.
+ * @param element_id Id of the element.
+ * @param entity_description What makes the reference.
+ * @param report The report of the map.
+ */
+void QuestChecker::check_resource(
+    ResourceType resource_type,
+    const QString& element_id,
+    const QString& entity_description,
+    FileReport& report) {
+
+  if (element_id.isEmpty() ||
+      !quest.get_resources().exists(resource_type, element_id)) {
+    report.errors << tr("%1: missing %2 '%3'").arg(
+                       entity_description,
+                       quest.get_resources().get_lua_name(resource_type),
+                       element_id);
+  }
+}
+
+/**
+ * @brief Checks that the destination of a teletransporter exists.
+ * @param map_id Id of the destination map.
+ * @param destination_name Name of the destination in this map.
+ * Special destinations like "_same" are always valid.
+ * @param entity_description The teletransporter.
+ * @param report The report of the map.
+ */
+void QuestChecker::check_destination(
+    const QString& map_id,
+    const QString& destination_name,
+    const QString& entity_description,
+    FileReport& report) {
+
+  if (destination_name.isEmpty() || destination_name.startsWith('_')) {
+    return;
+  }
+
+  const MapIndex::MapInfo& info = quest.get_map_index().get_map_info(map_id);
+  if (!info.valid) {
+    // Already reported with the destination map itself.
+    return;
+  }
+
+  for (const MapIndex::NamedEntity& named_entity : info.named_entities) {
+    if (named_entity.name == destination_name &&
+        named_entity.type == EntityType::DESTINATION) {
+      return;
+    }
+  }
+
+  report.errors << tr("%1: missing destination '%2' in map '%3'").arg(
+                     entity_description, destination_name, map_id);
+}
+
+/**
+ * @brief Checks references to patterns and sprites made by maps.
+ *
+ * Must be called once tilesets and sprites are loaded.
+ */
+void QuestChecker::check_pending_references() {
+
+  QHash<QString, int> tileset_reports;
+  QHash<QString, int> sprite_reports;
+  for (int i = 0; i < static_cast<int>(reports.size()); ++i) {
+    if (reports[i].file_type == "tileset") {
+      tileset_reports.insert(reports[i].element_id, i);
+    }
+    else if (reports[i].file_type == "sprite") {
+      sprite_reports.insert(reports[i].element_id, i);
+    }
+  }
+
+  for (const PendingReference& reference : pattern_references) {
+    const int tileset_report_index = tileset_reports.value(reference.tileset_id, -1);
+    if (tileset_report_index == -1 || !reports[tileset_report_index].loaded) {
+      // Already reported with the tileset.
+      continue;
+    }
+    if (!defined_ids[tileset_report_index].contains(reference.element_id)) {
+      reports[reference.report_index].errors <<
+          tr("%1: missing pattern '%2' in tileset '%3'").arg(
+            reference.entity_description, reference.element_id, reference.tileset_id);
+    }
+  }
+
+  for (const PendingReference& reference : sprite_references) {
+    const int sprite_report_index = sprite_reports.value(reference.element_id, -1);
+    if (sprite_report_index == -1) {
+      reports[reference.report_index].errors <<
+          tr("%1: missing sprite '%2'").arg(
+            reference.entity_description, reference.element_id);
+    }
+    else if (!reports[sprite_report_index].loaded) {
+      reports[reference.report_index].errors <<
+          tr("%1: sprite '%2' cannot be loaded").arg(
+            reference.entity_description, reference.element_id);
+    }
+  }
+}
+
+}
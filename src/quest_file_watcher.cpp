@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "quest.h"
+#include "quest_file_watcher.h"
+#include <QFileInfo>
+
+namespace SolarusEditor {
+
+/**
+ * @brief Creates a file watcher for the specified quest.
+ * @param quest The quest.
+ */
+QuestFileWatcher::QuestFileWatcher(Quest& quest) :
+  watcher(),
+  watched_paths(),
+  changed_paths(),
+  flush_timer() {
+
+  flush_timer.setSingleShot(true);
+  flush_timer.setInterval(flush_delay);
+
+  connect(&watcher, SIGNAL(fileChanged(QString)),
+          this, SLOT(file_changed(QString)));
+  connect(&flush_timer, SIGNAL(timeout()),
+          this, SLOT(flush_changes()));
+  connect(&quest, SIGNAL(root_path_changed(const QString&)),
+          this, SLOT(clear()));
+}
+
+/**
+ * @brief Starts watching a file.
+ *
+ * Does nothing if the file is already watched or does not exist.
+ *
+ * @param path Path of the file to watch.
+ */
+void QuestFileWatcher::watch_file(const QString& path) {
+
+  if (path.isEmpty() ||
+      watched_paths.contains(path) ||
+      !QFileInfo(path).isFile()) {
+    return;
+  }
+
+  watched_paths.insert(path);
+  watcher.addPath(path);
+}
+
+/**
+ * @brief Starts watching several files.
+ * @param paths Paths of the files to watch.
+ */
+void QuestFileWatcher::watch_files(const QStringList& paths) {
+
+  for (const QString& path : paths) {
+    watch_file(path);
+  }
+}
+
+/**
+ * @brief Stops watching all files and forgets pending changes.
+ */
+void QuestFileWatcher::clear() {
+
+  flush_timer.stop();
+  changed_paths.clear();
+  watched_paths.clear();
+
+  const QStringList& files = watcher.files();
+  if (!files.isEmpty()) {
+    watcher.removePaths(files);
+  }
+}
+
+/**
+ * @brief Slot called when a watched file was modified, replaced or deleted.
+ *
+ * The change is only notified when no other change happens for a while.
+ *
+ * @param path Path of the file.
+ */
+void QuestFileWatcher::file_changed(const QString& path) {
+
+  changed_paths.insert(path);
+  flush_timer.start();
+}
+
+/**
+ * @brief Notifies all files changed during the last burst.
+ *
+ * Files that were replaced (saving to a temporary file and renaming it
+ * is common) are no longer watched by the system: they are watched again.
+ * Files that were deleted are forgotten.
+ */
+void QuestFileWatcher::flush_changes() {
+
+  if (changed_paths.isEmpty()) {
+    return;
+  }
+
+  QStringList paths = changed_paths.toList();
+  changed_paths.clear();
+  paths.sort();
+
+  const QStringList& still_watched = watcher.files();
+  for (const QString& path : paths) {
+    if (still_watched.contains(path)) {
+      continue;
+    }
+    if (QFileInfo(path).isFile()) {
+      watcher.addPath(path);
+    }
+    else {
+      watched_paths.remove(path);
+    }
+  }
+
+  emit files_changed(paths);
+}
+
+}
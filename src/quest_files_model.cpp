@@ -18,6 +18,7 @@
 #include "natural_comparator.h"
 #include "quest.h"
 #include "quest_files_model.h"
+#include <QDir>
 #include <QFileSystemModel>
 #include <QItemSelection>
 
@@ -204,10 +205,10 @@ QModelIndex QuestFilesModel::sibling(int row, int column, const QModelIndex& idx
 bool QuestFilesModel::hasChildren(const QModelIndex& parent) const {
 
   QString file_path = get_file_path(parent);
-  ResourceType resource_type;
-  QString element_id;
+  const PathInfo& info = get_path_info(file_path);
+  ResourceType resource_type = info.resource_type;
 
-  if (quest.is_resource_element(file_path, resource_type, element_id)) {
+  if (info.resource_element) {
     // A resource element is always a leaf, even languages
     // that are actually directories on the filesystem.
     return false;
@@ -220,8 +221,7 @@ bool QuestFilesModel::hasChildren(const QModelIndex& parent) const {
   }
 
   // The directory is empty, but resources might be declared there and missing.
-  if (!quest.is_resource_path(file_path, resource_type) &&
-      !quest.is_in_resource_path(file_path, resource_type)) {
+  if (!info.resource_path && !info.in_resource_path) {
     // This is not a resource directory, nothing special was declared here.
     return false;
   }
@@ -292,16 +292,14 @@ QItemSelection QuestFilesModel::mapSelectionToSource(const QItemSelection& proxy
  */
 Qt::ItemFlags QuestFilesModel::flags(const QModelIndex& index) const {
 
-  QString file_path = get_file_path(index);
-  ResourceType resource_type;
-  QString element_id;
+  const PathInfo& info = get_path_info(get_file_path(index));
   Qt::ItemFlags flags =  Qt::ItemIsSelectable | Qt::ItemIsEnabled;
 
   switch (index.column()) {
 
   case FILE_COLUMN:  // File name.
 
-    if (quest.is_resource_element(file_path, resource_type, element_id)) {
+    if (info.resource_element) {
       // Resource elements never has children,
       // even languages that are actually directories on the filesystem.
       flags |= Qt::ItemNeverHasChildren;
@@ -310,7 +308,7 @@ Qt::ItemFlags QuestFilesModel::flags(const QModelIndex& index) const {
 
   case DESCRIPTION_COLUMN:  // Resource description.
 
-    if (quest.is_resource_element(file_path, resource_type, element_id)) {
+    if (info.resource_element) {
       // The description column of a resource element can be modified.
       return flags | Qt::ItemIsEditable;
     }
@@ -360,11 +358,9 @@ QVariant QuestFilesModel::headerData(int section, Qt::Orientation orientation, i
 QVariant QuestFilesModel::data(const QModelIndex& index, int role) const {
 
   const QuestResources& resources = quest.get_resources();
-  ResourceType resource_type;
-  QString element_id;
 
   QString path = get_file_path(index);
-  QString file_name = QFileInfo(path).fileName();
+  const PathInfo& info = get_path_info(path);
 
   switch (role) {
 
@@ -379,57 +375,25 @@ QVariant QuestFilesModel::data(const QModelIndex& index, int role) const {
         return quest.get_name();
       }
 
-      if (quest.is_resource_element(path, resource_type, element_id)) {
+      if (info.resource_element) {
         // A resource element: show its id (remove the extension).
         return QFileInfo(path).completeBaseName();
       }
-      return file_name;
+      return QFileInfo(path).fileName();
 
     case DESCRIPTION_COLUMN:  // Resource element description.
 
-      if (!quest.is_resource_element(path, resource_type, element_id)) {
+      if (!info.resource_element) {
         return QVariant();
       }
-      return resources.get_description(resource_type, element_id);
+      return resources.get_description(info.resource_type, info.element_id);
 
     case TYPE_COLUMN:  // Type.
-      if (is_quest_data_index(index)) {
-        // Quest data directory (top-level item).
-        return tr("Quest");
-      }
-
-      if (path == quest.get_main_script_path()) {
-        // main.lua
-        return tr("Main Lua script");
-      }
-
-      if (quest.is_resource_path(path, resource_type)) {
-        // A resource element folder.
-        return resources.get_directory_friendly_name(resource_type);
-      }
-
-      if (quest.is_resource_element(path, resource_type, element_id)) {
-        // A declared resource element.
-        return resources.get_friendly_name(resource_type);
-      }
-
-      if (quest.is_script(path)) {
-        // A Lua script.
-        return tr("Lua script");
-      }
-
-      if (quest.is_image(path)) {
-        // A PNG image.
-        return tr("Image");
-      }
-
-      if (quest.is_data_file(path)) {
-        // A .dat file.
-        return tr("Data file");
+      if (info.type_name.isEmpty()) {
+        // Not a file managed by Solarus.
+        return QVariant();
       }
-
-      // Not a file managed by Solarus.
-      return QVariant();
+      return info.type_name;
     }
 
   case Qt::EditRole:
@@ -437,27 +401,27 @@ QVariant QuestFilesModel::data(const QModelIndex& index, int role) const {
     switch (index.column()) {
 
     case FILE_COLUMN:  // File name.
-      return file_name;
+      return QFileInfo(path).fileName();
 
     case DESCRIPTION_COLUMN:
       // The resource element description can be edited.
-      if (!quest.is_resource_element(path, resource_type, element_id)) {
+      if (!info.resource_element) {
         return QVariant();
       }
-      return resources.get_description(resource_type, element_id);
+      return resources.get_description(info.resource_type, info.element_id);
     }
 
   case Qt::DecorationRole:
     // Icon.
     if (index.column() == FILE_COLUMN) {
-      return get_quest_file_icon(index);
+      return info.icon;
     }
     return QVariant();  // No icon in other columns.
 
   case Qt::ToolTipRole:
     // Tooltip.
     if (index.column() == FILE_COLUMN) {
-      return get_quest_file_tooltip(index);
+      return info.tooltip;
     }
     return QVariant();  // No tooltip in other columns.
 
@@ -514,25 +478,129 @@ bool QuestFilesModel::setData(
   }
 }
 
+/**
+ * @brief Returns the classification of a path, computing it if necessary.
+ *
+ * The result is cached until invalidate_path_info() is called for this path.
+ *
+ * @param path Path of a file item in the model.
+ * @return What this path represents in the quest.
+ */
+QuestFilesModel::PathInfo QuestFilesModel::get_path_info(const QString& path) const {
+
+  auto it = path_infos.constFind(path);
+  if (it != path_infos.constEnd()) {
+    return *it;
+  }
+
+  PathInfo info;
+  if (quest.is_resource_path(path, info.resource_type)) {
+    info.resource_path = true;
+  }
+  else if (quest.is_in_resource_path(path, info.resource_type)) {
+    info.in_resource_path = true;
+    if (quest.is_potential_resource_element(path, info.resource_type, info.element_id)) {
+      info.potential_resource_element = true;
+      info.resource_element = quest.get_resources().exists(info.resource_type, info.element_id);
+    }
+  }
+  info.type_name = get_quest_file_type_name(path, info);
+  info.icon = get_quest_file_icon(path, info);
+  info.tooltip = get_quest_file_tooltip(path, info);
+
+  path_infos.insert(path, info);
+  return info;
+}
+
+/**
+ * @brief Forgets the classification of a path and of paths under it.
+ *
+ * Call this function when the path is declared or undeclared as a resource
+ * element, or when it is created or removed on the filesystem.
+ *
+ * @param path Path of a file or directory.
+ */
+void QuestFilesModel::invalidate_path_info(const QString& path) {
+
+  path_infos.remove(path);
+
+  const QString& prefix = path + '/';
+  auto it = path_infos.lowerBound(prefix);
+  while (it != path_infos.end() && it.key().startsWith(prefix)) {
+    it = path_infos.erase(it);
+  }
+}
+
+/**
+ * @brief Returns the text of the type column for the specified quest file.
+ * @param path Path of a file item in the model.
+ * @param info Resource classification of this path.
+ * @return The type of file, or an empty string if it is not managed by Solarus.
+ */
+QString QuestFilesModel::get_quest_file_type_name(
+    const QString& path, const PathInfo& info) const {
+
+  const QuestResources& resources = quest.get_resources();
+
+  if (path == quest.get_data_path()) {
+    // Quest data directory (top-level item).
+    return tr("Quest");
+  }
+
+  if (path == quest.get_main_script_path()) {
+    // main.lua
+    return tr("Main Lua script");
+  }
+
+  if (info.resource_path) {
+    // A resource element folder.
+    return resources.get_directory_friendly_name(info.resource_type);
+  }
+
+  if (info.resource_element) {
+    // A declared resource element.
+    return resources.get_friendly_name(info.resource_type);
+  }
+
+  if (quest.is_script(path)) {
+    // A Lua script.
+    return tr("Lua script");
+  }
+
+  if (quest.is_image(path)) {
+    // A PNG image.
+    return tr("Image");
+  }
+
+  if (quest.is_data_file(path)) {
+    // A .dat file.
+    return tr("Data file");
+  }
+
+  // Not a file managed by Solarus.
+  return QString();
+}
+
 /**
  * @brief Returns an appropriate icon for the specified quest file.
- * @param index Index of a file item in the model.
+ * @param file_path Path of a file item in the model.
+ * @param info Resource classification of this path.
  * @return An appropriate icon name to represent this file.
  */
-QIcon QuestFilesModel::get_quest_file_icon(const QModelIndex& index) const {
+QIcon QuestFilesModel::get_quest_file_icon(
+    const QString& file_path, const PathInfo& info) const {
 
   QString icon_file_name;  // Relative to the icons directory.
-  QString file_path = get_file_path(index);
-  ResourceType resource_type;
-  QString element_id;
+  const ResourceType resource_type = info.resource_type;
+  const QString& element_id = info.element_id;
 
   // Quest data directory.
-  if (is_quest_data_index(index)) {
+  if (file_path == quest.get_data_path()) {
     icon_file_name = "icon_solarus.png";
   }
 
   // Resource element (possibly a directory for languages).
-  else if (quest.is_resource_element(file_path, resource_type, element_id)) {
+  else if (info.resource_element) {
 
     QString resource_type_name = quest.get_resources().get_lua_name(resource_type);
     if (quest.exists(quest.get_resource_element_path(resource_type, element_id))) {
@@ -548,7 +616,7 @@ QIcon QuestFilesModel::get_quest_file_icon(const QModelIndex& index) const {
   // Directory icon.
   else if (quest.is_dir(file_path)) {
 
-    if (quest.is_resource_path(file_path, resource_type)) {
+    if (info.resource_path) {
       QString resource_type_name = quest.get_resources().get_lua_name(resource_type);
       icon_file_name = "icon_folder_open_" + resource_type_name + ".png";
     }
@@ -581,23 +649,21 @@ QIcon QuestFilesModel::get_quest_file_icon(const QModelIndex& index) const {
 
 /**
  * @brief Returns an appropriate tooltip for the specified quest file.
- * @param index Index of a file item in the model.
+ * @param path Path of a file item in the model.
+ * @param info Resource classification of this path.
  * @return An appropriate tooltip for this file item.
  */
-QString QuestFilesModel::get_quest_file_tooltip(const QModelIndex& index) const {
-
-  QString path = get_file_path(index);
-  ResourceType resource_type;
-  QString element_id;
+QString QuestFilesModel::get_quest_file_tooltip(
+    const QString& path, const PathInfo& info) const {
 
   // Show a tooltip for resource elements because their item text is different
   // from the physical file name.
-  if (quest.is_potential_resource_element(path, resource_type, element_id)) {
+  if (info.potential_resource_element) {
 
     QString file_name = QFileInfo(path).fileName();
-    if (quest.get_resources().exists(resource_type, element_id)) {
+    if (info.resource_element) {
       // Declared in the resource list.
-      if (quest.exists(quest.get_resource_element_path(resource_type, element_id))) {
+      if (quest.exists(quest.get_resource_element_path(info.resource_type, info.element_id))) {
         // Declared in the resource list and existing on the filesystem.
         return file_name;
       }
@@ -686,9 +752,7 @@ bool QuestFilesModel::filterAcceptsRow(int source_row, const QModelIndex& source
 
   // Keep resources, and also files that could be resources
   // but are not declared in the resource list yet.
-  ResourceType resource_type;
-  QString element_id;
-  if (quest.is_potential_resource_element(file_path, resource_type, element_id)) {
+  if (get_path_info(file_path).potential_resource_element) {
     return true;
   }
 
@@ -919,54 +983,108 @@ void QuestFilesModel::compute_extra_paths(const QModelIndex& parent) const {
     return;
   }
 
-  ResourceType resource_type;
-  QString element_id;
-  if (quest.is_resource_element(parent_path, resource_type, element_id)) {
+  const PathInfo& info = get_path_info(parent_path);
+  if (info.resource_element) {
     // This is a leaf item. In particular, we ignore the subtree of languages.
     return;
   }
 
-  if (!quest.is_resource_path(parent_path, resource_type) &&
-      !quest.is_in_resource_path(parent_path, resource_type)) {
+  if (!info.resource_path && !info.in_resource_path) {
     // Parent is not a resource directory: we will not find resources there.
     return;
   }
 
-  ExtraPaths& extra_paths = extra_paths_by_dir[parent_path];
+  if (extra_paths_built_types.find(info.resource_type) == extra_paths_built_types.end()) {
+    build_extra_paths(info.resource_type);
+  }
+  else if (outdated_extra_paths_dirs.remove(parent_path)) {
+    // Files changed here since the extra paths were built.
+    QStringList element_ids;
+    const QStringList& all_element_ids = quest.get_resources().get_elements(info.resource_type);
+    for (const QString& element_id : all_element_ids) {
+      const QString& path = quest.get_resource_element_path(info.resource_type, element_id);
+      if (path.section('/', 0, -2) == parent_path) {
+        element_ids << element_id;
+      }
+    }
+    build_extra_paths(info.resource_type, parent_path, element_ids);
+  }
+
+  // Directories of this type without missing elements have no extra paths.
+  extra_paths_by_dir[parent_path];
+}
 
-  // Get all declared elements of this resource type that are directly in
-  // the directory.
+/**
+ * @brief Determines in a single pass the resource elements of a type
+ * that are declared but whose files are missing on the filesystem,
+ * for all directories.
+ *
+ * Elements are grouped by directory and each directory is listed only once,
+ * instead of walking all elements of the type for every directory expanded.
+ *
+ * @param resource_type A type of resource.
+ */
+void QuestFilesModel::build_extra_paths(ResourceType resource_type) const {
+
+  extra_paths_built_types.insert(resource_type);
+
+  // Group declared elements by directory, keeping the order of the resource list.
+  QMap<QString, QStringList> element_ids_by_dir;
   const QStringList& element_ids = quest.get_resources().get_elements(resource_type);
   for (const QString& element_id : element_ids) {
-    QString current_path = quest.get_resource_element_path(resource_type, element_id);
-    if (!current_path.startsWith(parent_path)) {
-      // The current element is not under our directory.
+    const QString& path = quest.get_resource_element_path(resource_type, element_id);
+    element_ids_by_dir[path.section('/', 0, -2)] << element_id;
+  }
+
+  for (auto it = element_ids_by_dir.constBegin(); it != element_ids_by_dir.constEnd(); ++it) {
+    const QString& dir_path = it.key();
+    if (extra_paths_by_dir.contains(dir_path)) {
+      // Already known.
       continue;
     }
+    build_extra_paths(resource_type, dir_path, it.value());
+  }
+}
 
-    QString current_path_from_parent = current_path.right(current_path.size() - parent_path.size() - 1);
-    if (current_path_from_parent.indexOf('/') != -1) {
-      // The current element is not a direct child of our directory.
+/**
+ * @brief Determines the resource elements of a directory that are declared
+ * but whose files are missing on the filesystem.
+ * @param resource_type A type of resource.
+ * @param dir_path A directory.
+ * @param element_ids Elements of this type declared in this directory.
+ */
+void QuestFilesModel::build_extra_paths(
+    ResourceType resource_type,
+    const QString& dir_path,
+    const QStringList& element_ids) const {
+
+  // Note: we could check the existence of files faster by asking the source model,
+  // but we want this computation to work even from rowsAboutToBeRemoved(), that is,
+  // when model rows of files just deleted still exist in the source model.
+  const QStringList& file_names = QDir(dir_path).entryList(
+        QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+  const QSet<QString>& existing_file_names = file_names.toSet();
+
+  ExtraPaths* extra_paths = nullptr;
+  for (const QString& element_id : element_ids) {
+    const QString& path = quest.get_resource_element_path(resource_type, element_id);
+    if (existing_file_names.contains(path.section('/', -1))) {
       continue;
     }
 
-    // The current resource element is declared in this directory.
-    // Check that its file exists.
-    // Note: we could check the existence of the file faster by asking the source model,
-    // but we want this computation to work even from rowsAboutToBeRemoved(), that is,
-    // when model rows of files just deleted still exist in the source model.
-    if (!quest.exists(quest.get_resource_element_path(resource_type, element_id))) {
-      // This is an extra element. Insert it in the cache.
-      ExtraPathColumnPtrs columns;
-      for (int j = 0; j < NUM_COLUMNS; ++j) {
-        QString* path_internal_ptr = new QString(current_path);
-        columns[j] = path_internal_ptr;
-        all_extra_paths.insert(path_internal_ptr);
-      }
-      extra_paths.paths.append(columns);
-      extra_paths.path_indexes[current_path] = extra_paths.paths.size() - 1;
-      extra_paths.element_ids.append(element_id);
+    // This is an extra element. Insert it in the cache.
+    if (extra_paths == nullptr) {
+      extra_paths = &extra_paths_by_dir[dir_path];
+    }
+    ExtraPathColumnPtrs columns;
+    for (int j = 0; j < NUM_COLUMNS; ++j) {
+      QString* path_internal_ptr = new QString(path);
+      columns[j] = path_internal_ptr;
+      all_extra_paths.insert(path_internal_ptr);
     }
+    extra_paths->paths.append(columns);
+    extra_paths->path_indexes[path] = extra_paths->paths.size() - 1;
+    extra_paths->element_ids.append(element_id);
   }
 }
 
@@ -989,7 +1107,13 @@ void QuestFilesModel::resource_element_added(
   // Otherwise, we insert it as an extra path.
 
   const QString& path = quest.get_resource_element_path(resource_type, element_id);
+  invalidate_path_info(path);
   if (quest.exists(path)) {
+    const QModelIndex& index = get_file_index(path);
+    if (index.isValid()) {
+      // The file is now a declared element.
+      emit dataChanged(index, sibling(index.row(), NUM_COLUMNS - 1, index));
+    }
     return;
   }
 
@@ -1019,6 +1143,7 @@ void QuestFilesModel::resource_element_removed(
   // that there a row was removed.
 
   QString path = quest.get_resource_element_path(resource_type, element_id);
+  invalidate_path_info(path);
 
   QDir parent_dir(path);
   if (!parent_dir.cdUp()) {
@@ -1029,6 +1154,12 @@ void QuestFilesModel::resource_element_removed(
 
   // See if this was an extra path (not existing in the source model).
   remove_extra_path(parent, path);
+
+  const QModelIndex& index = get_file_index(path);
+  if (index.isValid()) {
+    // The file still exists but is no longer a declared element.
+    emit dataChanged(index, sibling(index.row(), NUM_COLUMNS - 1, index));
+  }
 }
 
 /**
@@ -1077,10 +1208,16 @@ void QuestFilesModel::resource_element_description_changed(
  */
 void QuestFilesModel::source_model_rows_inserted(const QModelIndex& source_parent, int first, int last) {
 
+  for (int source_row = first; source_row <= last; ++source_row) {
+    const QModelIndex& source_index = source_model->index(source_row, 0, source_parent);
+    invalidate_path_info(source_model->filePath(source_index));
+  }
+
   const QModelIndex& parent = mapFromSource(source_parent);
   if (!parent.isValid()) {
     // The parent item was not created yet in this model
     // or was filtered out.
+    forget_extra_paths(source_model->filePath(source_parent));
     return;
   }
 
@@ -1109,9 +1246,15 @@ void QuestFilesModel::source_model_rows_inserted(const QModelIndex& source_paren
  */
 void QuestFilesModel::source_model_rows_about_to_be_removed(const QModelIndex& source_parent, int first, int last) {
 
+  for (int source_row = first; source_row <= last; ++source_row) {
+    const QModelIndex& source_index = source_model->index(source_row, 0, source_parent);
+    invalidate_path_info(source_model->filePath(source_index));
+  }
+
   const QModelIndex& parent = mapFromSource(source_parent);
   if (!parent.isValid()) {
     // The parent item was filtered out.
+    forget_extra_paths(source_model->filePath(source_parent));
     return;
   }
 
@@ -1129,12 +1272,12 @@ void QuestFilesModel::source_model_rows_about_to_be_removed(const QModelIndex& s
  */
 void QuestFilesModel::insert_extra_path(const QModelIndex& parent, const QString& path) {
 
-  ResourceType resource_type;
-  QString element_id;
-  if (!quest.is_resource_element(path, resource_type, element_id)) {
+  const PathInfo& info = get_path_info(path);
+  if (!info.resource_element) {
     // Only resource elements can create extra paths.
     return;
   }
+  const QString& element_id = info.element_id;
 
   ExtraPaths* extra_paths = get_extra_paths(parent);
   if (extra_paths == nullptr) {
@@ -1221,6 +1364,29 @@ void QuestFilesModel::remove_extra_path(const QModelIndex& parent, const QString
   endRemoveRows();
 }
 
+/**
+ * @brief Forgets the extra paths of a directory that is not in the model.
+ *
+ * Call this function when files of the directory are created or removed
+ * while it has no item: its extra paths are computed again
+ * when its item is created.
+ *
+ * @param dir_path A directory.
+ */
+void QuestFilesModel::forget_extra_paths(const QString& dir_path) {
+
+  auto it = extra_paths_by_dir.find(dir_path);
+  if (it != extra_paths_by_dir.end()) {
+    for (const ExtraPathColumnPtrs& columns : it->paths) {
+      for (QString* path_internal_ptr : columns) {
+        all_extra_paths.remove(path_internal_ptr);
+      }
+    }
+    extra_paths_by_dir.erase(it);
+  }
+  outdated_extra_paths_dirs.insert(dir_path);
+}
+
 /**
  * @brief Destroys an extra paths objects.
  *
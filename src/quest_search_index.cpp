@@ -0,0 +1,872 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "editor_exception.h"
+#include "quest.h"
+#include "quest_search_index.h"
+#include <QAtomicInt>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegularExpression>
+#include <QRunnable>
+#include <algorithm>
+#include <vector>
+
+namespace SolarusEditor {
+
+namespace {
+
+/**
+ * @brief Files bigger than this are not indexed.
+ */
+constexpr qint64 max_file_size = 4 * 1024 * 1024;
+
+}
+
+/**
+ * @brief State shared by the worker threads of a build.
+ *
+ * Workers only hold this state and never the index itself,
+ * so the index can be cleared or destroyed while they are still running.
+ */
+struct QuestSearchIndex::BuildState {
+  QAtomicInt canceled;                 /**< Non-zero to stop reading files. */
+  int num_files = 0;                   /**< Number of files to read. */
+  QAtomicInt num_files_done;           /**< Number of files processed so far. */
+  QMutex mutex;                        /**< Protects the field below. */
+  QList<File> read_files;              /**< Files read and not merged yet. */
+};
+
+/**
+ * @brief Task that reads one file and computes its trigrams.
+ */
+class QuestSearchIndex::IndexTask : public QRunnable {
+
+public:
+
+  /**
+   * @brief Creates a task.
+   * @param state State shared by all tasks of the build.
+   * @param path The file to read.
+   */
+  IndexTask(const std::shared_ptr<BuildState>& state, const QString& path) :
+    state(state),
+    path(path) {
+  }
+
+  /**
+   * @brief Reads the file.
+   */
+  void run() override {
+
+    if (!state->canceled.load()) {
+      File file;
+      if (read_file(path, file)) {
+        QMutexLocker lock(&state->mutex);
+        state->read_files.append(file);
+      }
+    }
+    state->num_files_done.fetchAndAddRelaxed(1);
+  }
+
+private:
+
+  std::shared_ptr<BuildState> state;   /**< State shared by all tasks. */
+  QString path;                        /**< The file to read. */
+
+};
+
+/**
+ * @brief Task that finds the matches of a search in one file.
+ */
+class QuestSearchIndex::MatchTask : public QRunnable {
+
+public:
+
+  /**
+   * @brief Creates a task.
+   * @param file The file to search. It must not change until the task is done.
+   * @param expression The expression to search.
+   * @param max_matches Maximum number of matches to find.
+   * @param[out] matches Where to store the matches found.
+   */
+  MatchTask(const File& file,
+            const QRegularExpression& expression,
+            int max_matches,
+            QList<Match>& matches) :
+    file(file),
+    expression(expression),
+    max_matches(max_matches),
+    matches(matches) {
+  }
+
+  /**
+   * @brief Searches the file.
+   */
+  void run() override {
+
+    matches = find_matches(file, expression, max_matches);
+  }
+
+private:
+
+  const File& file;                    /**< The file to search. */
+  const QRegularExpression expression; /**< Own copy of the expression. */
+  const int max_matches;               /**< Maximum number of matches. */
+  QList<Match>& matches;               /**< Matches found. */
+
+};
+
+/**
+ * @brief Creates an empty search index for the specified quest.
+ * @param quest The quest.
+ */
+QuestSearchIndex::QuestSearchIndex(Quest& quest) :
+  quest(quest),
+  files(),
+  trigram_files(),
+  watcher(),
+  build_state(),
+  pending_paths(),
+  pending_directories(),
+  merge_timer(),
+  thread_pool() {
+
+  merge_timer.setInterval(100);
+
+  connect(&quest, SIGNAL(root_path_changed(const QString&)),
+          this, SLOT(clear()));
+  connect(&merge_timer, SIGNAL(timeout()),
+          this, SLOT(merge_built_files()));
+  connect(&watcher, SIGNAL(directoryChanged(const QString&)),
+          this, SLOT(directory_changed(const QString&)));
+}
+
+/**
+ * @brief Destructor.
+ */
+QuestSearchIndex::~QuestSearchIndex() {
+
+  clear();
+  thread_pool.waitForDone();
+}
+
+/**
+ * @brief Returns whether files are still being read by build().
+ * @return @c true if the index is not complete yet.
+ */
+bool QuestSearchIndex::is_building() const {
+  return build_state != nullptr;
+}
+
+/**
+ * @brief Returns the number of files currently in the index.
+ * @return The number of indexed files.
+ */
+int QuestSearchIndex::get_num_files() const {
+  return files.size();
+}
+
+/**
+ * @brief Returns whether a file is a text file that the index keeps.
+ * @param path Path of a file.
+ * @return @c true if this file can be searched.
+ */
+bool QuestSearchIndex::is_text_file(const QString& path) {
+
+  static const QSet<QString> text_extensions = {
+    "dat", "lua", "txt", "glsl"
+  };
+  return text_extensions.contains(QFileInfo(path).suffix().toLower());
+}
+
+/**
+ * @brief Indexes all text files of the data directory.
+ *
+ * Files are read by worker threads: this function returns immediately
+ * and build_finished() is emitted when they are all indexed.
+ * Searches made in the meantime wait for the end of the build.
+ */
+void QuestSearchIndex::build() {
+
+  clear();
+
+  const QString& data_path = quest.get_data_path();
+  if (data_path.isEmpty()) {
+    return;
+  }
+
+  watch_directories(data_path);
+
+  const QStringList& paths = list_text_files(data_path);
+  build_state = std::make_shared<BuildState>();
+  build_state->num_files = paths.size();
+  for (const QString& path : paths) {
+    thread_pool.start(new IndexTask(build_state, path));
+  }
+  merge_timer.start();
+}
+
+/**
+ * @brief Forgets all files and stops watching directories.
+ *
+ * Files still being read by a previous build are discarded.
+ */
+void QuestSearchIndex::clear() {
+
+  if (build_state != nullptr) {
+    build_state->canceled.store(1);
+    build_state = nullptr;
+  }
+  merge_timer.stop();
+  pending_paths.clear();
+  pending_directories.clear();
+
+  files.clear();
+  trigram_files.clear();
+
+  const QStringList& watched_directories = watcher.directories();
+  if (!watched_directories.isEmpty()) {
+    watcher.removePaths(watched_directories);
+  }
+}
+
+/**
+ * @brief Indexes a file again if it was created or modified since it was read.
+ *
+ * If the index is being built, this is done at the end of the build
+ * so that an older version read by the build does not override it.
+ *
+ * @param path Path of a file.
+ */
+void QuestSearchIndex::update_file(const QString& path) {
+
+  if (is_building()) {
+    pending_paths.insert(path);
+    return;
+  }
+
+  QFileInfo info(path);
+  if (!info.isFile() || !is_text_file(path)) {
+    remove_file(path);
+    return;
+  }
+
+  auto it = files.find(path);
+  if (it != files.end() &&
+      it->last_modified == info.lastModified() &&
+      it->size == info.size()) {
+    // Up to date.
+    return;
+  }
+
+  File file;
+  if (!read_file(path, file)) {
+    remove_file(path);
+    return;
+  }
+  add_file(file);
+}
+
+/**
+ * @brief Removes a file from the index.
+ * @param path Path of the file.
+ */
+void QuestSearchIndex::remove_file(const QString& path) {
+
+  auto it = files.find(path);
+  if (it == files.end()) {
+    return;
+  }
+
+  for (quint64 trigram : it->trigrams) {
+    auto trigram_it = trigram_files.find(trigram);
+    if (trigram_it != trigram_files.end()) {
+      trigram_it->remove(path);
+      if (trigram_it->isEmpty()) {
+        trigram_files.erase(trigram_it);
+      }
+    }
+  }
+  files.erase(it);
+}
+
+/**
+ * @brief Finds all occurrences of a text in the quest files.
+ *
+ * If the index is still being built, waits for the end of the build.
+ * Candidate files are searched in parallel by worker threads.
+ *
+ * @param pattern The text or regular expression to search.
+ * @param regex @c true if the pattern is a regular expression.
+ * @param case_sensitive @c true to match the case exactly.
+ * @param max_matches Maximum number of matches to return.
+ * @return The matches sorted by file and position.
+ * @throws EditorException If the regular expression is invalid.
+ */
+QList<QuestSearchIndex::Match> QuestSearchIndex::find_text(
+    const QString& pattern,
+    bool regex,
+    bool case_sensitive,
+    int max_matches) {
+
+  QList<Match> matches;
+  if (pattern.isEmpty()) {
+    return matches;
+  }
+
+  QRegularExpression::PatternOptions options = QRegularExpression::MultilineOption;
+  if (!case_sensitive) {
+    options |= QRegularExpression::CaseInsensitiveOption;
+  }
+  QRegularExpression expression(
+        regex ? pattern : QRegularExpression::escape(pattern),
+        options);
+  if (!expression.isValid()) {
+    throw EditorException(tr("Invalid regular expression: %1").arg(expression.errorString()));
+  }
+  expression.optimize();
+
+  wait_for_build();
+
+  const QString& literal = regex ? get_required_literal(pattern) : pattern;
+
+  // Files modified in place by other programs are only noticed here.
+  for (const QString& path : get_candidate_files(literal)) {
+    update_file(path);
+  }
+  const QStringList& candidate_paths = get_candidate_files(literal);
+
+  // Each task writes the matches of its file at its own place.
+  std::vector<QList<Match>> file_matches(candidate_paths.size());
+  for (int i = 0; i < candidate_paths.size(); ++i) {
+    const File& file = *files.constFind(candidate_paths.at(i));
+    thread_pool.start(new MatchTask(file, expression, max_matches, file_matches[i]));
+  }
+  thread_pool.waitForDone();
+
+  for (const QList<Match>& matches_in_file : file_matches) {
+    for (const Match& match : matches_in_file) {
+      matches << match;
+      if (matches.size() >= max_matches) {
+        return matches;
+      }
+    }
+  }
+
+  return matches;
+}
+
+/**
+ * @brief Finds the occurrences of a regular expression in a file.
+ *
+ * This function is called from worker threads.
+ *
+ * @param file The file to search.
+ * @param expression The expression to search.
+ * @param max_matches Maximum number of matches to return.
+ * @return The matches sorted by position.
+ */
+QList<QuestSearchIndex::Match> QuestSearchIndex::find_matches(
+    const File& file,
+    const QRegularExpression& expression,
+    int max_matches) {
+
+  QList<Match> matches;
+  const QString& content = file.content;
+  int line = 1;
+  int line_start = 0;
+  int position = 0;
+  QRegularExpressionMatchIterator it = expression.globalMatch(content);
+  while (it.hasNext()) {
+    const QRegularExpressionMatch& match = it.next();
+    if (match.capturedLength() == 0) {
+      // Ignore empty matches like ^ or $.
+      continue;
+    }
+
+    // Count lines since the previous match.
+    const int start = match.capturedStart();
+    for (; position < start; ++position) {
+      if (content.at(position) == '\n') {
+        ++line;
+        line_start = position + 1;
+      }
+    }
+
+    int line_end = content.indexOf('\n', line_start);
+    if (line_end == -1) {
+      line_end = content.size();
+    }
+
+    Match result;
+    result.path = file.path;
+    result.line = line;
+    result.column = start - line_start;
+    result.length = match.capturedLength();
+    result.line_text = content.mid(line_start, line_end - line_start);
+    matches << result;
+
+    if (matches.size() >= max_matches) {
+      break;
+    }
+  }
+
+  return matches;
+}
+
+/**
+ * @brief Moves the files read by workers into the index.
+ *
+ * Emits build_finished() when all files of the build are indexed.
+ */
+void QuestSearchIndex::merge_built_files() {
+
+  if (build_state == nullptr) {
+    merge_timer.stop();
+    return;
+  }
+
+  QList<File> read_files;
+  {
+    QMutexLocker lock(&build_state->mutex);
+    read_files.swap(build_state->read_files);
+  }
+  for (const File& file : read_files) {
+    add_file(file);
+  }
+
+  if (build_state->num_files_done.load() < build_state->num_files) {
+    return;
+  }
+
+  // The last files may have been added after the swap.
+  {
+    QMutexLocker lock(&build_state->mutex);
+    read_files.swap(build_state->read_files);
+  }
+  for (const File& file : read_files) {
+    add_file(file);
+  }
+
+  build_state = nullptr;
+  merge_timer.stop();
+
+  const QSet<QString> directories = pending_directories;
+  pending_directories.clear();
+  for (const QString& directory : directories) {
+    directory_changed(directory);
+  }
+
+  const QSet<QString> paths = pending_paths;
+  pending_paths.clear();
+  for (const QString& path : paths) {
+    update_file(path);
+  }
+
+  emit build_finished();
+}
+
+/**
+ * @brief Slot called when the content of a watched directory has changed.
+ *
+ * Files created, replaced or deleted in this directory are indexed again,
+ * as well as new subdirectories.
+ * If the index is being built, this is done at the end of the build
+ * so that older versions read by the build don't override them.
+ *
+ * @param path The directory.
+ */
+void QuestSearchIndex::directory_changed(const QString& path) {
+
+  if (is_building()) {
+    pending_directories.insert(path);
+    return;
+  }
+
+  const QString& prefix = path + '/';
+  QStringList removed_paths;
+  for (auto it = files.begin(); it != files.end(); ++it) {
+    const QString& file_path = it.key();
+    if (file_path.startsWith(prefix) && !QFileInfo(file_path).isFile()) {
+      removed_paths << file_path;
+    }
+  }
+  for (const QString& removed_path : removed_paths) {
+    remove_file(removed_path);
+  }
+
+  if (!QFileInfo(path).isDir()) {
+    // The directory itself was removed.
+    watcher.removePath(path);
+    return;
+  }
+
+  const QFileInfoList& entries = QDir(path).entryInfoList(
+        QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
+  const QStringList& watched_directories = watcher.directories();
+  for (const QFileInfo& entry : entries) {
+    const QString& entry_path = entry.filePath();
+    if (entry.isDir()) {
+      if (!watched_directories.contains(entry_path)) {
+        // New directory.
+        watch_directories(entry_path);
+        for (const QString& file_path : list_text_files(entry_path)) {
+          update_file(file_path);
+        }
+      }
+    }
+    else if (is_text_file(entry_path)) {
+      update_file(entry_path);
+    }
+  }
+}
+
+/**
+ * @brief Reads a file and computes its trigrams.
+ *
+ * This function is called from worker threads.
+ *
+ * @param[in] path Path of the file.
+ * @param[out] file The file read.
+ * @return @c false if the file could not be read or is too big.
+ */
+bool QuestSearchIndex::read_file(const QString& path, File& file) {
+
+  QFile input(path);
+  if (input.size() > max_file_size ||
+      !input.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    return false;
+  }
+
+  file.path = path;
+  const QFileInfo info(input);
+  file.last_modified = info.lastModified();
+  file.size = info.size();
+  file.content = QString::fromUtf8(input.readAll());
+  file.trigrams = get_trigrams(file.content);
+  return true;
+}
+
+/**
+ * @brief Returns the key of a trigram.
+ * @param characters Three lowercase characters.
+ * @return The corresponding key.
+ */
+quint64 QuestSearchIndex::get_trigram(const QChar* characters) {
+
+  return (static_cast<quint64>(characters[0].unicode()) << 32) |
+      (static_cast<quint64>(characters[1].unicode()) << 16) |
+      static_cast<quint64>(characters[2].unicode());
+}
+
+/**
+ * @brief Returns the lowercase trigrams of a text.
+ * @param text A text.
+ * @return The distinct trigrams of the text in lowercase.
+ */
+QSet<quint64> QuestSearchIndex::get_trigrams(const QString& text) {
+
+  QSet<quint64> trigrams;
+  const QString& lowercase_text = text.toLower();
+  const QChar* characters = lowercase_text.constData();
+  for (int i = 0; i + 3 <= lowercase_text.size(); ++i) {
+    trigrams.insert(get_trigram(characters + i));
+  }
+  return trigrams;
+}
+
+/**
+ * @brief Returns a text that any match of a regular expression contains.
+ *
+ * This is the longest sequence of plain characters of the pattern
+ * that is not optional.
+ * Optional groups and lookarounds are skipped.
+ * Patterns with alternatives or with constructs that are not understood
+ * here have no such text.
+ *
+ * @param regex_pattern A regular expression.
+ * @return A literal text required by the pattern, possibly empty.
+ */
+QString QuestSearchIndex::get_required_literal(const QString& regex_pattern) {
+
+  if (regex_pattern.contains('|')) {
+    return QString();
+  }
+
+  QString longest;
+  QString current;
+  const auto& end_sequence = [&]() {
+    if (current.size() > longest.size()) {
+      longest = current;
+    }
+    current.clear();
+  };
+
+  const QString special_characters = "^$.()[]{}?*+";
+  const QString multi_character_escapes = "cgkopxEGNPQ";
+  const int length = regex_pattern.size();
+  for (int i = 0; i < length; ++i) {
+    const QChar c = regex_pattern.at(i);
+
+    if (c == '\\') {
+      if (i + 1 >= length) {
+        break;
+      }
+      const QChar escaped = regex_pattern.at(i + 1);
+      if (!escaped.isLetterOrNumber()) {
+        // Escaped special character.
+        current += escaped;
+      }
+      else if (escaped.isDigit() || multi_character_escapes.contains(escaped)) {
+        // Back-reference, code point, quoted text...
+        return QString();
+      }
+      else {
+        // Character class like \w.
+        end_sequence();
+      }
+      ++i;
+    }
+    else if (c == '?' || c == '*' || c == '{') {
+      // The previous character is optional.
+      current.chop(1);
+      end_sequence();
+      if (c == '{') {
+        i = regex_pattern.indexOf('}', i + 1);
+        if (i == -1) {
+          break;
+        }
+      }
+    }
+    else if (c == '[') {
+      end_sequence();
+      i = find_class_end(regex_pattern, i);
+      if (i == -1) {
+        break;
+      }
+    }
+    else if (c == '(') {
+      end_sequence();
+      const int group_end = find_group_end(regex_pattern, i);
+      if (group_end == -1) {
+        break;
+      }
+      const QChar next = group_end + 1 < length ? regex_pattern.at(group_end + 1) : QChar();
+      const QStringRef& group_start = regex_pattern.midRef(i + 1, 4);
+      if (next == '?' || next == '*' || next == '{' ||
+          group_start.startsWith("?=") || group_start.startsWith("?!") ||
+          group_start.startsWith("?<=") || group_start.startsWith("?<!")) {
+        // Optional group or lookaround: its content is not required.
+        i = group_end;
+      }
+      else if (group_start.startsWith("?:")) {
+        // Non-capturing group.
+        i += 2;
+      }
+      else if (group_start.startsWith("?<") || group_start.startsWith("?P<")) {
+        // Named group.
+        i = regex_pattern.indexOf('>', i);
+        if (i == -1) {
+          break;
+        }
+      }
+      else if (group_start.startsWith("?")) {
+        // Option setting, comment, condition, recursion...
+        return QString();
+      }
+    }
+    else if (special_characters.contains(c)) {
+      end_sequence();
+    }
+    else {
+      current += c;
+    }
+  }
+  end_sequence();
+  return longest;
+}
+
+/**
+ * @brief Returns the end of a character class of a regular expression.
+ * @param regex_pattern A regular expression.
+ * @param start Index of the opening bracket of the class.
+ * @return Index of the closing bracket, or -1 if the class is not closed.
+ */
+int QuestSearchIndex::find_class_end(const QString& regex_pattern, int start) {
+
+  int i = start + 1;
+  if (i < regex_pattern.size() && regex_pattern.at(i) == '^') {
+    ++i;
+  }
+  if (i < regex_pattern.size() && regex_pattern.at(i) == ']') {
+    // A closing bracket right at the beginning is a normal character.
+    ++i;
+  }
+  for (; i < regex_pattern.size(); ++i) {
+    const QChar c = regex_pattern.at(i);
+    if (c == '\\') {
+      ++i;
+    }
+    else if (c == ']') {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief Returns the end of a group of a regular expression.
+ * @param regex_pattern A regular expression.
+ * @param start Index of the opening parenthesis of the group.
+ * @return Index of the matching closing parenthesis,
+ * or -1 if the group is not closed.
+ */
+int QuestSearchIndex::find_group_end(const QString& regex_pattern, int start) {
+
+  int depth = 0;
+  for (int i = start; i < regex_pattern.size(); ++i) {
+    const QChar c = regex_pattern.at(i);
+    if (c == '\\') {
+      ++i;
+    }
+    else if (c == '[') {
+      i = find_class_end(regex_pattern, i);
+      if (i == -1) {
+        return -1;
+      }
+    }
+    else if (c == '(') {
+      ++depth;
+    }
+    else if (c == ')') {
+      --depth;
+      if (depth == 0) {
+        return i;
+      }
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief Blocks until all files of the current build are indexed.
+ */
+void QuestSearchIndex::wait_for_build() {
+
+  if (build_state == nullptr) {
+    return;
+  }
+
+  thread_pool.waitForDone();
+  merge_built_files();
+}
+
+/**
+ * @brief Adds a file to the index, replacing any previous version.
+ * @param file The file to add.
+ */
+void QuestSearchIndex::add_file(const File& file) {
+
+  remove_file(file.path);
+
+  files.insert(file.path, file);
+  for (quint64 trigram : file.trigrams) {
+    trigram_files[trigram].insert(file.path);
+  }
+}
+
+/**
+ * @brief Watches a directory and all its subdirectories.
+ * @param root_path The directory to watch.
+ */
+void QuestSearchIndex::watch_directories(const QString& root_path) {
+
+  QStringList directories;
+  directories << root_path;
+  QDirIterator it(root_path, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    directories << it.next();
+  }
+  watcher.addPaths(directories);
+}
+
+/**
+ * @brief Returns the text files of a directory and its subdirectories.
+ * @param root_path A directory.
+ * @return Paths of the text files found.
+ */
+QStringList QuestSearchIndex::list_text_files(const QString& root_path) const {
+
+  QStringList paths;
+  QDirIterator it(root_path, QDir::Files, QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    const QString& path = it.next();
+    if (is_text_file(path)) {
+      paths << path;
+    }
+  }
+  return paths;
+}
+
+/**
+ * @brief Returns the files that may contain a text.
+ * @param literal A text that matches must contain, or an empty string.
+ * @return Paths of the files containing all trigrams of the text,
+ * or of all files if the text is shorter than a trigram. They are sorted.
+ */
+QStringList QuestSearchIndex::get_candidate_files(const QString& literal) const {
+
+  QStringList paths;
+  if (literal.size() < 3) {
+    paths = files.keys();
+  }
+  else {
+    // Start from the rarest trigram.
+    QList<const QSet<QString>*> trigram_sets;
+    for (quint64 trigram : get_trigrams(literal)) {
+      auto it = trigram_files.find(trigram);
+      if (it == trigram_files.end()) {
+        // No file has this trigram.
+        return paths;
+      }
+      trigram_sets << &it.value();
+    }
+    std::sort(trigram_sets.begin(), trigram_sets.end(),
+              [](const QSet<QString>* lhs, const QSet<QString>* rhs) {
+      return lhs->size() < rhs->size();
+    });
+
+    for (const QString& path : *trigram_sets.first()) {
+      bool candidate = true;
+      for (int i = 1; i < trigram_sets.size() && candidate; ++i) {
+        candidate = trigram_sets.at(i)->contains(path);
+      }
+      if (candidate) {
+        paths << path;
+      }
+    }
+  }
+
+  paths.sort();
+  return paths;
+}
+
+}
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "editor_exception.h"
+#include "quest.h"
+#include "quest_resources.h"
+#include "refactoring_engine.h"
+#include <QApplication>
+#include <QAtomicInt>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QProgressDialog>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QThreadPool>
+
+namespace SolarusEditor {
+
+namespace {
+
+/**
+ * @brief State shared by the worker threads of a scan.
+ */
+struct ScanState {
+  QRegularExpression regex;            /**< Text to replace. */
+  QString replacement;                 /**< Replacement text. */
+  QList<QByteArray> prefilters;        /**< Texts that a file must all contain. */
+  QAtomicInt canceled;                 /**< Non-zero to stop the scan. */
+  QAtomicInt num_files_done;           /**< Number of files processed so far. */
+  QMutex mutex;                        /**< Protects the fields below. */
+  QMap<QString, QByteArray>
+      new_contents;                    /**< New content of modified files. */
+  QString error_message;               /**< First error encountered if any. */
+};
+
+/**
+ * @brief Task that computes the new content of one file.
+ */
+class ScanTask : public QRunnable {
+
+public:
+
+  /**
+   * @brief Creates a task.
+   * @param state State shared by all tasks of the scan.
+   * @param path The file to process.
+   */
+  ScanTask(ScanState& state, const QString& path) :
+    state(state),
+    path(path) {
+  }
+
+  /**
+   * @brief Processes the file.
+   */
+  void run() override {
+
+    if (!state.canceled.load()) {
+      process();
+    }
+    state.num_files_done.fetchAndAddRelaxed(1);
+  }
+
+private:
+
+  /**
+   * @brief Reads the file and stores its new content if it changes.
+   */
+  void process() {
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+      QMutexLocker lock(&state.mutex);
+      if (state.error_message.isEmpty()) {
+        state.error_message = QApplication::tr("Cannot open file '%1'").arg(path);
+      }
+      state.canceled.store(1);
+      return;
+    }
+    const QByteArray bytes = file.readAll();
+    file.close();
+
+    // Most files don't refer to what is being refactored:
+    // skip them without decoding.
+    for (const QByteArray& prefilter : state.prefilters) {
+      if (!bytes.contains(prefilter)) {
+        return;
+      }
+    }
+
+    QString content = QString::fromUtf8(bytes);
+    const QString old_content = content;
+    content.replace(state.regex, state.replacement);
+    if (content == old_content) {
+      // No change.
+      return;
+    }
+
+    QMutexLocker lock(&state.mutex);
+    state.new_contents.insert(path, content.toUtf8());
+  }
+
+  ScanState& state;                    /**< State shared by all tasks. */
+  QString path;                        /**< The file to process. */
+
+};
+
+}
+
+/**
+ * @brief Creates a refactoring engine.
+ * @param regex The text to replace in files.
+ * @param replacement The replacement text.
+ */
+RefactoringEngine::RefactoringEngine(
+    const QRegularExpression& regex, const QString& replacement) :
+  regex(regex),
+  replacement(replacement),
+  prefilters(),
+  pending_contents() {
+
+  // Compile the pattern once here rather than concurrently in workers.
+  this->regex.optimize();
+}
+
+/**
+ * @brief Adds a text that files must contain to be processed.
+ *
+ * Files that do not contain all prefilter texts are left unchanged.
+ * The test is done on the raw bytes, before the file is decoded,
+ * which makes it very cheap.
+ *
+ * @param text A text that files to modify necessarily contain.
+ */
+void RefactoringEngine::add_prefilter(const QString& text) {
+
+  prefilters << text.toUtf8();
+}
+
+/**
+ * @brief Computes the new content of files without writing them yet.
+ *
+ * Files are processed in parallel.
+ * A progress dialog is shown if the operation takes some time.
+ *
+ * @param paths The files to process.
+ * @param parent Parent widget of the progress dialog.
+ * @return @c false if the user canceled the operation.
+ * @throws EditorException If a file could not be read.
+ */
+bool RefactoringEngine::scan(const QStringList& paths, QWidget* parent) {
+
+  pending_contents.clear();
+
+  ScanState state;
+  state.regex = regex;
+  state.replacement = replacement;
+  state.prefilters = prefilters;
+
+  QThreadPool thread_pool;
+  for (const QString& path : paths) {
+    thread_pool.start(new ScanTask(state, path));
+  }
+
+  QProgressDialog progress_dialog(
+        QApplication::tr("Updating files..."),
+        QApplication::tr("Cancel"),
+        0,
+        paths.size(),
+        parent);
+  progress_dialog.setWindowModality(Qt::WindowModal);
+  progress_dialog.setMinimumDuration(500);
+
+  bool canceled = false;
+  while (!thread_pool.waitForDone(20)) {
+    progress_dialog.setValue(state.num_files_done.load());
+    QApplication::processEvents();
+    if (progress_dialog.wasCanceled()) {
+      canceled = true;
+      state.canceled.store(1);
+    }
+  }
+  progress_dialog.setValue(paths.size());
+
+  if (!state.error_message.isEmpty()) {
+    throw EditorException(state.error_message);
+  }
+
+  if (canceled) {
+    return false;
+  }
+
+  pending_contents = state.new_contents;
+  return true;
+}
+
+/**
+ * @brief Computes the new content of all map data files of a quest.
+ * @param quest A quest.
+ * @param parent Parent widget of the progress dialog.
+ * @param excluded_map_id A map to ignore if any.
+ * @return @c false if the user canceled the operation.
+ * @throws EditorException If a map file could not be read.
+ */
+bool RefactoringEngine::scan_maps(
+    const Quest& quest, QWidget* parent, const QString& excluded_map_id) {
+
+  QStringList paths;
+  const QStringList& map_ids = quest.get_resources().get_elements(ResourceType::MAP);
+  for (const QString& map_id : map_ids) {
+    if (map_id != excluded_map_id) {
+      paths << quest.get_map_data_file_path(map_id);
+    }
+  }
+  return scan(paths, parent);
+}
+
+/**
+ * @brief Returns the files that the last scan found to modify.
+ * @return The paths of files to be written by commit().
+ */
+QStringList RefactoringEngine::get_pending_paths() const {
+
+  return pending_contents.keys();
+}
+
+/**
+ * @brief Notifies the engine that a file to modify was moved since the scan.
+ * @param old_path Path of the file when it was scanned.
+ * @param new_path Current path of the file.
+ */
+void RefactoringEngine::rename_pending_file(const QString& old_path, const QString& new_path) {
+
+  if (!pending_contents.contains(old_path)) {
+    return;
+  }
+  pending_contents.insert(new_path, pending_contents.take(old_path));
+}
+
+/**
+ * @brief Writes the files modified by the last scan.
+ *
+ * Each file is written atomically: a file is never left half written.
+ *
+ * @return The paths of files modified.
+ * @throws EditorException If a file could not be written.
+ */
+QStringList RefactoringEngine::commit() {
+
+  QStringList modified_paths;
+  for (auto it = pending_contents.cbegin(); it != pending_contents.cend(); ++it) {
+    QSaveFile file(it.key());
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text) ||
+        file.write(it.value()) != it.value().size() ||
+        !file.commit()) {
+      throw EditorException(QApplication::tr("Cannot open file '%1' for writing").arg(it.key()));
+    }
+    modified_paths << it.key();
+  }
+  pending_contents.clear();
+  return modified_paths;
+}
+
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "quest.h"
+#include "sprite_cache.h"
+#include "sprite_model.h"
+#include <QFileInfo>
+
+namespace SolarusEditor {
+
+/**
+ * @brief Creates an empty sprite cache for the specified quest.
+ * @param quest The quest.
+ */
+SpriteCache::SpriteCache(Quest& quest) :
+  quest(quest),
+  entries() {
+
+  connect(&quest, SIGNAL(root_path_changed(const QString&)),
+          this, SLOT(clear()));
+  connect(&quest.get_file_watcher(), SIGNAL(files_changed(QStringList)),
+          this, SLOT(files_changed(QStringList)));
+}
+
+/**
+ * @brief Returns a shared sprite model.
+ *
+ * The sprite is loaded only if nobody holds it yet with this tileset
+ * or if its data file has changed since it was loaded.
+ *
+ * @param sprite_id Id of the sprite to get.
+ * @param tileset_id Tileset to use for animations whose image is the tileset.
+ * @return The sprite model.
+ * @throws EditorException If the sprite could not be loaded.
+ */
+std::shared_ptr<const SpriteModel> SpriteCache::get_sprite(
+    const QString& sprite_id, const QString& tileset_id) {
+
+  const QDateTime last_modified =
+      QFileInfo(quest.get_sprite_path(sprite_id)).lastModified();
+  const Key key(sprite_id, tileset_id);
+
+  auto it = entries.find(key);
+  if (it != entries.end()) {
+    std::shared_ptr<const SpriteModel> sprite = it->sprite.lock();
+    if (sprite != nullptr && it->last_modified == last_modified) {
+      // Already loaded and still up to date.
+      return sprite;
+    }
+  }
+
+  // Not loaded yet, nobody uses it anymore or outdated.
+  remove_expired_entries();
+
+  std::shared_ptr<SpriteModel> sprite =
+      std::make_shared<SpriteModel>(quest, sprite_id);
+  sprite->set_tileset_id(tileset_id);
+
+  Entry& entry = entries[key];
+  entry.sprite = sprite;
+  entry.last_modified = last_modified;
+  entry.files = sprite->get_image_paths();
+  entry.files.prepend(quest.get_sprite_path(sprite_id));
+  quest.get_file_watcher().watch_files(entry.files);
+  return sprite;
+}
+
+/**
+ * @brief Returns the number of sprite models currently shared.
+ * @return The number of sprites alive in the cache.
+ */
+int SpriteCache::get_num_sprites() const {
+
+  int num_sprites = 0;
+  for (const Entry& entry : entries) {
+    if (!entry.sprite.expired()) {
+      ++num_sprites;
+    }
+  }
+  return num_sprites;
+}
+
+/**
+ * @brief Forgets all sprites.
+ *
+ * Sprites already handed out remain valid for their holders,
+ * but the next requests will load them again.
+ */
+void SpriteCache::clear() {
+
+  entries.clear();
+}
+
+/**
+ * @brief Forgets a sprite so that the next request loads it again.
+ *
+ * Emits sprites_changed() if the sprite is still held by someone.
+ *
+ * @param sprite_id Id of the sprite to forget, for all tilesets.
+ */
+void SpriteCache::invalidate(const QString& sprite_id) {
+
+  if (remove_entries(sprite_id)) {
+    emit sprites_changed(QStringList() << sprite_id);
+  }
+}
+
+/**
+ * @brief Slot called when files loaded by caches were modified externally.
+ *
+ * Sprites in memory that use one of these files are forgotten,
+ * even if they are still held.
+ * Emits sprites_changed() if there are some.
+ *
+ * @param paths Paths of the files that changed.
+ */
+void SpriteCache::files_changed(const QStringList& paths) {
+
+  QStringList sprite_ids;
+  for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+    const QString& sprite_id = it.key().first;
+    if (sprite_ids.contains(sprite_id) || it->sprite.expired()) {
+      continue;
+    }
+    for (const QString& path : paths) {
+      if (!it->files.contains(path)) {
+        continue;
+      }
+      if (path == it->files.first() &&
+          QFileInfo(path).lastModified() == it->last_modified) {
+        // Already reloaded since this change, for example after a save
+        // from the sprite editor.
+        continue;
+      }
+      sprite_ids << sprite_id;
+      break;
+    }
+  }
+
+  if (sprite_ids.isEmpty()) {
+    return;
+  }
+
+  for (const QString& sprite_id : sprite_ids) {
+    remove_entries(sprite_id);
+  }
+  emit sprites_changed(sprite_ids);
+}
+
+/**
+ * @brief Removes the entries of a sprite for all tilesets.
+ * @param sprite_id Id of the sprite to forget.
+ * @return @c true if one of them was still held by someone.
+ */
+bool SpriteCache::remove_entries(const QString& sprite_id) {
+
+  bool alive = false;
+  auto it = entries.begin();
+  while (it != entries.end()) {
+    if (it.key().first == sprite_id) {
+      alive = alive || !it->sprite.expired();
+      it = entries.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+  return alive;
+}
+
+/**
+ * @brief Removes entries of sprites that nobody holds anymore.
+ */
+void SpriteCache::remove_expired_entries() {
+
+  auto it = entries.begin();
+  while (it != entries.end()) {
+    if (it->sprite.expired()) {
+      it = entries.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+}
+
+}
@@ -1377,6 +1377,41 @@ QImage SpriteModel::get_animation_image(const Index& index) const {
   return animation.image;
 }
 
+/**
+ * @brief Returns the paths of all images used by the animations.
+ * @return The paths of the source images, without duplicates.
+ * The image of the tileset is included if an animation uses it.
+ */
+QStringList SpriteModel::get_image_paths() const {
+
+  QStringList paths;
+  for (const AnimationModel& animation : animations) {
+    const QString& path = get_animation_image_path(*animation.index);
+    if (!paths.contains(path)) {
+      paths << path;
+    }
+  }
+  return paths;
+}
+
+/**
+ * @brief Loads again the images of animations that use some files.
+ *
+ * Emits animation_image_changed() for each animation affected.
+ *
+ * @param paths Paths of image files that were modified.
+ */
+void SpriteModel::reload_images(const QStringList& paths) {
+
+  for (const AnimationModel& animation : animations) {
+    const Index& index = *animation.index;
+    if (paths.contains(get_animation_image_path(index))) {
+      set_animation_image_dirty(index);
+      emit animation_image_changed(index, get_animation_source_image(index));
+    }
+  }
+}
+
 /**
  * @brief Returns alls images representing frames of a specified direction.
  * @param index A direction index.
@@ -1630,6 +1665,22 @@ void SpriteModel::build_index_map() {
   }
 }
 
+/**
+ * @brief Returns the path of the image file of an animation.
+ *
+ * The animation must be exists (use animation_exists() method to check it).
+ *
+ * @param index Index of an animation.
+ * @return The source image or the entities image of the tileset.
+ */
+QString SpriteModel::get_animation_image_path(const Index& index) const {
+
+  if (is_animation_image_is_tileset(index)) {
+    return quest.get_tileset_entities_image_path(tileset_id);
+  }
+  return quest.get_sprite_image_path(get_animation_source_image(index));
+}
+
 /**
  * @brief Clears the image cache of an animation and notify views.
  *
@@ -874,11 +874,11 @@ QString StringsModel::get_translated_string(const QString& key) const {
  */
 void StringsModel::build_string_tree() {
 
-  string_tree.clear();
+  QStringList keys;
   for (const auto& kvp : resources.get_strings()) {
-    QString key = QString::fromStdString(kvp.first);
-    string_tree.add_key(key);
+    keys << QString::fromStdString(kvp.first);
   }
+  string_tree.build(keys);
 }
 
 /**
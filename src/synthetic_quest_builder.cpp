@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "entities/entity_model.h"
+#include "border_kind_traits.h"
+#include "dialogs_model.h"
+#include "map_model.h"
+#include "new_quest_builder.h"
+#include "quest.h"
+#include "strings_model.h"
+#include "synthetic_quest_builder.h"
+#include "tileset_model.h"
+#include <QImage>
+#include <QPainter>
+#include <QtMath>
+#include <random>
+
+namespace SolarusEditor {
+
+namespace SyntheticQuestBuilder {
+
+namespace {
+
+constexpr int tile_size = 16;          // Size of patterns and tiles.
+constexpr int tileset_columns = 32;    // Patterns per row in the tileset image.
+constexpr int dialogs_per_group = 100; // Dialogs with the same id prefix.
+
+/**
+ * @brief Returns the position of a pattern in the tileset image.
+ * @param pattern_index Index of a pattern.
+ * @return The frame of this pattern.
+ */
+QRect get_pattern_frame(int pattern_index) {
+
+  return QRect((pattern_index % tileset_columns) * tile_size,
+               (pattern_index / tileset_columns) * tile_size,
+               tile_size,
+               tile_size);
+}
+
+/**
+ * @brief Creates the tileset, its image, its patterns and its border set.
+ * @param quest The quest.
+ * @param parameters Size of the quest.
+ */
+void create_tileset(Quest& quest, const Parameters& parameters) {
+
+  const QString& tileset_id = get_tileset_id();
+  quest.create_resource_element(ResourceType::TILESET, tileset_id, "Synthetic tileset");
+
+  // Each pattern is a square of its own color.
+  const int num_rows = (parameters.num_patterns + tileset_columns - 1) / tileset_columns;
+  QImage image(tileset_columns * tile_size, qMax(1, num_rows) * tile_size, QImage::Format_ARGB32);
+  image.fill(Qt::transparent);
+  QPainter painter(&image);
+  for (int i = 0; i < parameters.num_patterns; ++i) {
+    const QRect& frame = get_pattern_frame(i);
+    painter.fillRect(frame, QColor::fromHsv((i * 37) % 360, 160, 200));
+    painter.setPen(QColor::fromHsv((i * 37) % 360, 160, 120));
+    painter.drawRect(frame.adjusted(0, 0, -1, -1));
+  }
+  painter.end();
+  image.save(quest.get_tileset_tiles_image_path(tileset_id));
+
+  TilesetModel tileset(quest, tileset_id);
+  for (int i = 0; i < parameters.num_patterns; ++i) {
+    tileset.create_pattern(get_pattern_id(i), get_pattern_frame(i));
+  }
+
+  // The border set uses the first patterns.
+  const QString& border_set_id = get_border_set_id();
+  tileset.create_border_set(border_set_id);
+  int pattern_index = 0;
+  for (BorderKind border_kind : BorderKindTraits::get_values()) {
+    if (border_kind == BorderKind::NONE) {
+      continue;
+    }
+    tileset.set_border_set_pattern(
+          border_set_id,
+          border_kind,
+          get_pattern_id(pattern_index % parameters.num_patterns));
+    ++pattern_index;
+  }
+
+  tileset.save();
+}
+
+/**
+ * @brief Creates a map filled with tiles.
+ *
+ * Tiles of each layer form a square grid.
+ * The first layer also has a destination and a teletransporter
+ * to the next map.
+ *
+ * @param quest The quest.
+ * @param map_index Index of the map to create.
+ * @param parameters Size of the quest.
+ */
+void create_map(Quest& quest, int map_index, const Parameters& parameters) {
+
+  const QString& map_id = get_map_id(map_index);
+  quest.create_resource_element(
+        ResourceType::MAP, map_id, QString("Synthetic map %1").arg(map_index));
+
+  const int num_tiles = parameters.num_tiles_per_layer;
+  const int side = qMax(2, qCeil(qSqrt(num_tiles)));
+  MapModel map(quest, map_id);
+  map.set_tileset_id(get_tileset_id());
+  map.set_size(QSize(side * tile_size, side * tile_size));
+  map.set_min_layer(0);
+  map.set_max_layer(parameters.num_layers - 1);
+
+  std::mt19937 random(static_cast<std::mt19937::result_type>(map_index + 1));
+  std::uniform_int_distribution<int> pattern_distribution(0, parameters.num_patterns - 1);
+
+  AddableEntities entities;
+  for (int layer = 0; layer < parameters.num_layers; ++layer) {
+    for (int i = 0; i < num_tiles; ++i) {
+      EntityModelPtr tile = EntityModel::create(map, EntityType::TILE);
+      tile->set_field("pattern", get_pattern_id(pattern_distribution(random)));
+      tile->set_xy(QPoint((i % side) * tile_size, (i / side) * tile_size));
+      tile->set_size(QSize(tile_size, tile_size));
+      entities.emplace_back(std::move(tile), EntityIndex(layer, i));
+    }
+
+    if (layer != 0) {
+      continue;
+    }
+
+    EntityModelPtr destination = EntityModel::create(map, EntityType::DESTINATION);
+    destination->set_name("start");
+    destination->set_xy(QPoint(tile_size * 2, tile_size * 2));
+    entities.emplace_back(std::move(destination), EntityIndex(layer, num_tiles));
+
+    EntityModelPtr teletransporter = EntityModel::create(map, EntityType::TELETRANSPORTER);
+    teletransporter->set_field("destination_map", get_map_id((map_index + 1) % parameters.num_maps));
+    teletransporter->set_field("destination", "start");
+    teletransporter->set_xy(QPoint((side - 2) * tile_size, (side - 2) * tile_size));
+    teletransporter->set_size(QSize(tile_size, tile_size));
+    entities.emplace_back(std::move(teletransporter), EntityIndex(layer, num_tiles + 1));
+  }
+
+  map.add_entities(std::move(entities));
+  map.save();
+}
+
+/**
+ * @brief Adds dialogs and strings to the language.
+ *
+ * Ids are grouped by prefix so that the trees of the editor
+ * have several levels.
+ *
+ * @param quest The quest.
+ * @param parameters Size of the quest.
+ */
+void create_texts(Quest& quest, const Parameters& parameters) {
+
+  const QString& language_id = get_language_id();
+  if (!quest.get_resources().exists(ResourceType::LANGUAGE, language_id)) {
+    quest.create_resource_element(ResourceType::LANGUAGE, language_id, "English");
+  }
+
+  DialogsModel dialogs(quest, language_id);
+  StringsModel strings(quest, language_id);
+  for (int i = 0; i < parameters.num_dialogs; ++i) {
+    const QString& prefix = QString("synthetic.group_%1.").arg(i / dialogs_per_group);
+    dialogs.create_dialog(
+          prefix + QString("dialog_%1").arg(i),
+          QString("Synthetic dialog number %1.\nIt has a second line.").arg(i),
+          QMap<QString, QString>());
+    strings.create_string(
+          prefix + QString("string_%1").arg(i),
+          QString("Synthetic string %1").arg(i));
+  }
+  dialogs.save();
+  strings.save();
+}
+
+}  // Anonymous namespace.
+
+/**
+ * @brief Returns the id of the generated tileset.
+ * @return The tileset id.
+ */
+QString get_tileset_id() {
+  return "synthetic";
+}
+
+/**
+ * @brief Returns the id of the border set of the generated tileset.
+ * @return The border set id.
+ */
+QString get_border_set_id() {
+  return "border";
+}
+
+/**
+ * @brief Returns the language that receives the generated dialogs and strings.
+ * @return The language id.
+ */
+QString get_language_id() {
+  return "en";
+}
+
+/**
+ * @brief Returns the id of a generated map.
+ * @param map_index Index of the map.
+ * @return The map id.
+ */
+QString get_map_id(int map_index) {
+  return QString("synthetic_map_%1").arg(map_index);
+}
+
+/**
+ * @brief Returns the id of a pattern of the generated tileset.
+ * @param pattern_index Index of the pattern.
+ * @return The pattern id.
+ */
+QString get_pattern_id(int pattern_index) {
+  return QString("pattern_%1").arg(pattern_index);
+}
+
+/**
+ * @brief Creates a synthetic quest.
+ * @param quest_path Root path of the quest to create.
+ * The data directory will be created there.
+ * @param parameters Size of the quest.
+ * @throws EditorException If the files creation failed.
+ */
+void create_quest(const QString& quest_path, const Parameters& parameters) {
+
+  NewQuestBuilder::create_initial_quest_files(quest_path);
+
+  Quest quest(quest_path);
+  create_tileset(quest, parameters);
+  for (int i = 0; i < parameters.num_maps; ++i) {
+    create_map(quest, i, parameters);
+  }
+  create_texts(quest, parameters);
+}
+
+}
+
+}
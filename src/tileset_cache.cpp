@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "quest.h"
+#include "tileset_cache.h"
+#include "tileset_model.h"
+
+namespace SolarusEditor {
+
+/**
+ * @brief Creates an empty tileset cache for the specified quest.
+ * @param quest The quest.
+ */
+TilesetCache::TilesetCache(Quest& quest) :
+  quest(quest),
+  tilesets(),
+  modified_tileset_ids() {
+
+  connect(&quest, SIGNAL(root_path_changed(const QString&)),
+          this, SLOT(clear()));
+  connect(&quest.get_file_watcher(), SIGNAL(files_changed(QStringList)),
+          this, SLOT(files_changed(QStringList)));
+}
+
+/**
+ * @brief Returns a shared tileset model.
+ *
+ * The tileset is loaded only if nobody holds it yet.
+ *
+ * @param tileset_id Id of the tileset to get.
+ * @return The tileset model.
+ * @throws EditorException If the tileset could not be loaded.
+ */
+std::shared_ptr<TilesetModel> TilesetCache::get_tileset(const QString& tileset_id) {
+
+  auto it = tilesets.find(tileset_id);
+  if (it != tilesets.end()) {
+    std::shared_ptr<TilesetModel> tileset = it->lock();
+    if (tileset != nullptr) {
+      return tileset;
+    }
+  }
+
+  remove_expired_entries();
+
+  // Views and scenes may still refer to the tileset when its last holder
+  // is destroyed, so let Qt delete it once they are gone.
+  std::shared_ptr<TilesetModel> tileset(
+        new TilesetModel(quest, tileset_id),
+        [](TilesetModel* tileset) { tileset->deleteLater(); }
+  );
+  tilesets[tileset_id] = tileset;
+  quest.get_file_watcher().watch_file(quest.get_tileset_tiles_image_path(tileset_id));
+  return tileset;
+}
+
+/**
+ * @brief Returns the number of tileset models currently shared.
+ * @return The number of tilesets alive in the cache.
+ */
+int TilesetCache::get_num_tilesets() const {
+
+  int num_tilesets = 0;
+  for (const std::weak_ptr<TilesetModel>& tileset : tilesets) {
+    if (!tileset.expired()) {
+      ++num_tilesets;
+    }
+  }
+  return num_tilesets;
+}
+
+/**
+ * @brief Returns whether a tileset has unsaved changes in the tileset editor.
+ * @param tileset_id Id of a tileset.
+ * @return @c true if the tileset is modified and not saved.
+ */
+bool TilesetCache::is_tileset_modified(const QString& tileset_id) const {
+
+  return modified_tileset_ids.contains(tileset_id);
+}
+
+/**
+ * @brief Sets whether a tileset has unsaved changes in the tileset editor.
+ * @param tileset_id Id of a tileset.
+ * @param modified @c true if the tileset is modified and not saved.
+ */
+void TilesetCache::set_tileset_modified(const QString& tileset_id, bool modified) {
+
+  if (modified) {
+    modified_tileset_ids.insert(tileset_id);
+  }
+  else {
+    modified_tileset_ids.remove(tileset_id);
+  }
+}
+
+/**
+ * @brief Forgets all tilesets.
+ *
+ * Tilesets already handed out remain valid for their holders,
+ * but the next requests will load them again.
+ */
+void TilesetCache::clear() {
+
+  tilesets.clear();
+}
+
+/**
+ * @brief Forgets a tileset and asks its holders to get it again.
+ *
+ * Call this function when the tileset files have changed on the disk
+ * or to discard unsaved modifications of the tileset.
+ * Holders of the tileset, including the tileset editor, must switch to the
+ * new tileset model when they receive tileset_reloaded().
+ *
+ * Emits tileset_reloaded().
+ *
+ * @param tileset_id Id of the tileset to reload.
+ */
+void TilesetCache::reload(const QString& tileset_id) {
+
+  tilesets.remove(tileset_id);
+  modified_tileset_ids.remove(tileset_id);
+  emit tileset_reloaded(tileset_id);
+}
+
+/**
+ * @brief Slot called when files loaded by caches were modified externally.
+ *
+ * Tilesets in memory whose image has changed reload it.
+ * Their patterns forget their pixmaps and maps using them are notified.
+ * Tilesets not in memory are not affected:
+ * they will read the new image when they are loaded.
+ *
+ * @param paths Paths of the files that changed.
+ */
+void TilesetCache::files_changed(const QStringList& paths) {
+
+  for (const QString& path : paths) {
+    QString tileset_id;
+    if (!quest.is_tileset_tiles_file(path, tileset_id)) {
+      continue;
+    }
+
+    auto it = tilesets.find(tileset_id);
+    if (it == tilesets.end()) {
+      continue;
+    }
+    std::shared_ptr<TilesetModel> tileset = it->lock();
+    if (tileset != nullptr) {
+      tileset->reload_patterns_image();
+    }
+  }
+}
+
+/**
+ * @brief Removes entries of tilesets that nobody holds anymore.
+ */
+void TilesetCache::remove_expired_entries() {
+
+  auto it = tilesets.begin();
+  while (it != tilesets.end()) {
+    if (it->expired()) {
+      it = tilesets.erase(it);
+    }
+    else {
+      ++it;
+    }
+  }
+}
+
+}
@@ -21,6 +21,9 @@
 #include "pattern_animation_traits.h"
 #include "tileset_model.h"
 #include <QIcon>
+#include <QPainter>
+#include <algorithm>
+#include <functional>
 
 namespace SolarusEditor {
 
@@ -40,7 +43,8 @@ TilesetModel::TilesetModel(
   QAbstractListModel(parent),
   quest(quest),
   tileset_id(tileset_id),
-  selection_model(this) {
+  first_stale_index(0),
+  selection_model(*this) {
 
   // Load the tileset data file.
   QString path = quest.get_tileset_data_file_path(tileset_id);
@@ -49,11 +53,16 @@ TilesetModel::TilesetModel(
     throw EditorException(tr("Cannot open tileset data file '%1'").arg(path));
   }
 
-  build_index_map();
-  for (const auto& kvp : ids_to_indexes) {
-    const QString& pattern_id = kvp.first;
+  // Use natural order instead of the order of the Solarus library.
+  QStringList pattern_ids;
+  for (const auto& kvp : tileset.get_patterns()) {
+    pattern_ids << QString::fromStdString(kvp.first);
+  }
+  std::sort(pattern_ids.begin(), pattern_ids.end(), comparator);
+  for (const QString& pattern_id : pattern_ids) {
     patterns.append(PatternModel(pattern_id));
   }
+  build_index_map();
 
   reload_patterns_image();
 }
@@ -186,11 +195,17 @@ bool TilesetModel::pattern_exists(const QString& pattern_id) const {
  */
 int TilesetModel::id_to_index(const QString& pattern_id) const {
 
-  auto it = ids_to_indexes.find(pattern_id);
-  if (it == ids_to_indexes.end()) {
+  auto it = ids_to_indexes.constFind(pattern_id);
+  if (it == ids_to_indexes.constEnd()) {
     return -1;
   }
-  return it->second;
+
+  if (it.value() >= first_stale_index) {
+    // Patterns were created, deleted or renamed before this one.
+    update_stale_indexes();
+    return ids_to_indexes.value(pattern_id);
+  }
+  return it.value();
 }
 
 /**
@@ -209,36 +224,64 @@ QString TilesetModel::index_to_id(int index) const {
 }
 
 /**
- * @brief Builds or rebuilds the internal mapping that gives indexes from ids.
+ * @brief Builds the internal mapping that gives indexes from ids.
  *
  * Tile patterns are indexed by string ids, but the model also treats them
  * as a linear list, so we need an additional integer index.
+ * The list of patterns must already be sorted.
  */
 void TilesetModel::build_index_map() {
 
-  // boost::multi_index_container could do that for us, but this feels a bit
-  // overkill to add a boost dependency just for this use case.
-
   ids_to_indexes.clear();
+  ids_to_indexes.reserve(patterns.size());
+  for (int i = 0; i < patterns.size(); ++i) {
+    ids_to_indexes.insert(patterns.at(i).id, i);
+  }
+  first_stale_index = patterns.size();
+}
+
+/**
+ * @brief Updates the indexes that changed since patterns were
+ * created, deleted or renamed.
+ *
+ * Such operations shift the index of all patterns after them.
+ * Instead of updating these indexes each time, they are updated here,
+ * the next time one of them is needed, so that deleting many patterns
+ * only updates them once.
+ */
+void TilesetModel::update_stale_indexes() const {
 
-  // This is a bit tricky because we change the order of
-  // the map from the Solarus library to use natural order instead.
+  for (int i = first_stale_index; i < patterns.size(); ++i) {
+    ids_to_indexes[patterns.at(i).id] = i;
+  }
+  first_stale_index = patterns.size();
+}
+
+/**
+ * @brief Returns where a pattern id would be in the sorted list of patterns.
+ * @param pattern_id A pattern id that is not in the list.
+ * @param ignored_index Index of a pattern to ignore, or -1.
+ * The result is then the index as if this pattern was not in the list.
+ * @return The index of the first pattern that should be after it.
+ */
+int TilesetModel::get_sorted_position(const QString& pattern_id, int ignored_index) const {
+
+  const auto& is_before = [this](const PatternModel& pattern, const QString& id) {
+    return comparator(pattern.id, id);
+  };
 
-  const std::map<std::string, TilePatternData>& pattern_map =
-      tileset.get_patterns();
-  // First, put the string keys to have natural sort.
-  for (const auto& kvp : pattern_map) {
-    QString pattern_id = QString::fromStdString(kvp.first);
-    ids_to_indexes.insert(std::make_pair(pattern_id, 0));
+  if (ignored_index == -1) {
+    return std::lower_bound(patterns.begin(), patterns.end(), pattern_id, is_before) -
+        patterns.begin();
   }
 
-  // Then, we can put the integer value.
-  int index = 0;
-  for (const auto& kvp : ids_to_indexes) {
-    QString pattern_id = kvp.first;
-    ids_to_indexes[pattern_id] = index;
-    ++index;
+  // The ignored pattern may be out of order: search on one side of it.
+  if (ignored_index > 0 && !is_before(patterns.at(ignored_index - 1), pattern_id)) {
+    return std::lower_bound(patterns.begin(), patterns.begin() + ignored_index, pattern_id, is_before) -
+        patterns.begin();
   }
+  return std::lower_bound(patterns.begin() + ignored_index + 1, patterns.end(), pattern_id, is_before) -
+      patterns.begin() - 1;
 }
 
 /**
@@ -286,15 +329,16 @@ int TilesetModel::create_pattern(const QString& pattern_id, const QRect& frame)
   TilePatternData pattern(Rectangle::to_solarus_rect(frame));
   tileset.add_pattern(pattern_id.toStdString(), pattern);
 
-  // Rebuild indexes in the list model (indexes were shifted).
-  build_index_map();
-  int index = id_to_index(pattern_id);
+  // Find the index in the list model (next indexes will be shifted).
+  int index = get_sorted_position(pattern_id);
 
   // Call beginInsertRows() as requested by QAbstractItemModel.
   beginInsertRows(QModelIndex(), index, index);
 
   // Update our pattern model list.
   patterns.insert(index, PatternModel(pattern_id));
+  ids_to_indexes.insert(pattern_id, index);
+  first_stale_index = qMin(first_stale_index, index);
 
   // Notify people before restoring the selection, so that they have a
   // chance to know new indexes before receiving selection signals.
@@ -351,14 +395,13 @@ void TilesetModel::delete_pattern(int index) {
   // Delete the pattern in the tileset file.
   tileset.remove_pattern(pattern_id.toStdString());
 
-  // Rebuild indexes in the list model (indexes were shifted).
-  build_index_map();
-
   // Call beginRemoveRows() as requested by QAbstractItemModel.
   beginRemoveRows(QModelIndex(), index, index);
 
-  // Update our pattern model list.
+  // Update our pattern model list (next indexes are shifted).
   patterns.removeAt(index);
+  ids_to_indexes.remove(pattern_id);
+  first_stale_index = qMin(first_stale_index, index);
 
   // Notify people before restoring the selection, so that they have a
   // chance to know new indexes before receiving selection signals.
@@ -397,8 +440,13 @@ void TilesetModel::delete_pattern(int index) {
  */
 void TilesetModel::delete_patterns(const QList<int>& indexes) {
 
+  // Delete patterns from the end, so that indexes of the remaining ones
+  // are only updated once.
+  QList<int> sorted_indexes = indexes;
+  std::sort(sorted_indexes.begin(), sorted_indexes.end(), std::greater<int>());
+
   QStringList ids_to_delete;
-  for (int index : indexes) {
+  for (int index : sorted_indexes) {
     QString pattern_id = index_to_id(index);
     if (pattern_id.isEmpty()) {
         throw EditorException(tr("Invalid tile pattern index: %1").arg(index));
@@ -415,7 +463,7 @@ void TilesetModel::delete_patterns(const QList<int>& indexes) {
   clear_selection();
 
   // Delete patterns.
-  for (const QString id : ids_to_delete) {
+  for (const QString& id : ids_to_delete) {
     int index = id_to_index(id);
     if (index == -1) {
       throw EditorException(tr("No such tile pattern: %1").arg(id));
@@ -487,8 +535,7 @@ int TilesetModel::set_pattern_id(int index, const QString& new_id) {
   tileset.set_pattern_id(old_id.toStdString(), new_id.toStdString());
 
   // Change the index in the list model (if the order has changed).
-  build_index_map();
-  int new_index = id_to_index(new_id);
+  int new_index = get_sorted_position(new_id, index);
 
   // Call beginMoveRows() if the index changes, as requested by
   // QAbstractItemModel.
@@ -505,6 +552,9 @@ int TilesetModel::set_pattern_id(int index, const QString& new_id) {
   }
 
   patterns[new_index].id = new_id;
+  ids_to_indexes.remove(old_id);
+  ids_to_indexes.insert(new_id, new_index);
+  first_stale_index = qMin(first_stale_index, qMin(index, new_index));
 
   // Notify people before restoring the selection, so that they have a
   // chance to know new indexes before receiving selection signals.
@@ -828,6 +878,10 @@ void TilesetModel::set_pattern_repeat_mode(int index, TilePatternRepeatMode repe
     return;
   }
   pattern.set_repeat_mode(repeat_mode);
+
+  // The tiled image depends on the repeat mode.
+  patterns[index].tiled_image = QPixmap();
+
   emit pattern_repeat_mode_changed(index, repeat_mode);
 }
 
@@ -1183,6 +1237,106 @@ QPixmap TilesetModel::get_pattern_image(int index) const {
   return pattern.image;
 }
 
+/**
+ * @brief Returns the image of one frame of the specified pattern.
+ * @param index Index of a tile pattern.
+ * @param frame_index Index of a frame of this pattern.
+ * @return The corresponding image.
+ * Returns a null pixmap if the tileset image is not loaded
+ * or if there is no such frame.
+ */
+QPixmap TilesetModel::get_pattern_frame_image(int index, int frame_index) const {
+
+  if (frame_index == 0) {
+    return get_pattern_image(index);
+  }
+
+  if (!pattern_exists(index)) {
+    // No such pattern.
+    return QPixmap();
+  }
+
+  if (patterns_image.isNull()) {
+    // No tileset image.
+    return QPixmap();
+  }
+
+  const PatternModel& pattern = patterns.at(index);
+  const int num_frames = get_pattern_num_frames(index);
+  if (frame_index < 0 || frame_index >= num_frames) {
+    // No such frame.
+    return QPixmap();
+  }
+
+  if (pattern.frame_images.size() != num_frames) {
+    pattern.frame_images.resize(num_frames);
+  }
+  QPixmap& frame_image = pattern.frame_images[frame_index];
+  if (frame_image.isNull()) {
+    // Lazily create the image.
+    frame_image = QPixmap::fromImage(patterns_image.copy(
+        get_pattern_frames(index).at(frame_index)));
+  }
+  return frame_image;
+}
+
+/**
+ * @brief Returns the image of a pattern repeated to form a bigger image.
+ *
+ * This is what tiles of the pattern draw: big tiles then repeat a few
+ * big images instead of many small ones.
+ * The pattern is repeated in the directions allowed by its repeat mode,
+ * to at least min_tiled_image_size pixels, so the image always contains
+ * a whole number of patterns.
+ * Like other pattern images, it is created once and shared by all tiles.
+ *
+ * @param index Index of a tile pattern.
+ * @return The tiled image, only of the first frame for multi-frame patterns.
+ * Returns a null pixmap if the tileset image is not loaded.
+ */
+QPixmap TilesetModel::get_pattern_tiled_image(int index) const {
+
+  const QPixmap& image = get_pattern_image(index);
+  if (image.isNull()) {
+    // No image available.
+    return QPixmap();
+  }
+
+  const PatternModel& pattern = patterns.at(index);
+  if (!pattern.tiled_image.isNull()) {
+    // Image already created.
+    return pattern.tiled_image;
+  }
+
+  int num_columns = 1;
+  int num_rows = 1;
+  const TilePatternRepeatMode repeat_mode = get_pattern_repeat_mode(index);
+  if (repeat_mode == TilePatternRepeatMode::ALL ||
+      repeat_mode == TilePatternRepeatMode::HORIZONTAL) {
+    num_columns = (min_tiled_image_size + image.width() - 1) / image.width();
+  }
+  if (repeat_mode == TilePatternRepeatMode::ALL ||
+      repeat_mode == TilePatternRepeatMode::VERTICAL) {
+    num_rows = (min_tiled_image_size + image.height() - 1) / image.height();
+  }
+
+  if (num_columns == 1 && num_rows == 1) {
+    // Already big enough: share the pattern image itself.
+    pattern.tiled_image = image;
+    return pattern.tiled_image;
+  }
+
+  // Lazily create the image.
+  QPixmap tiled_image(image.width() * num_columns, image.height() * num_rows);
+  tiled_image.fill(Qt::transparent);
+  QPainter painter(&tiled_image);
+  painter.drawTiledPixmap(tiled_image.rect(), image);
+  painter.end();
+
+  pattern.tiled_image = tiled_image;
+  return pattern.tiled_image;
+}
+
 /**
  * @brief Returns an image representing the specified pattern.
  *
@@ -1289,10 +1443,13 @@ void TilesetModel::reload_patterns_image() {
 }
 
 /**
- * @brief Returns the selection model of the tileset.
+ * @brief Returns the selection model of the tileset editor.
+ *
+ * Maps and dialogs showing this tileset have their own selection.
+ *
  * @return The selection info.
  */
-QItemSelectionModel& TilesetModel::get_selection_model() {
+TilesetSelectionModel& TilesetModel::get_selection_model() {
   return selection_model;
 }
 
@@ -1302,7 +1459,7 @@ QItemSelectionModel& TilesetModel::get_selection_model() {
  */
 bool TilesetModel::is_selection_empty() const {
 
-  return selection_model.selection().isEmpty();
+  return selection_model.is_selection_empty();
 }
 
 /**
@@ -1311,7 +1468,7 @@ bool TilesetModel::is_selection_empty() const {
  */
 int TilesetModel::get_selection_count() const {
 
-  return selection_model.selection().count();
+  return selection_model.get_selection_count();
 }
 
 /**
@@ -1321,11 +1478,7 @@ int TilesetModel::get_selection_count() const {
  */
 int TilesetModel::get_selected_index() const {
 
-  QModelIndexList selected_indexes = selection_model.selectedIndexes();
-  if (selected_indexes.size() != 1) {
-    return -1;
-  }
-  return selected_indexes.first().row();
+  return selection_model.get_selected_index();
 }
 
 /**
@@ -1334,12 +1487,7 @@ int TilesetModel::get_selected_index() const {
  */
 QList<int> TilesetModel::get_selected_indexes() const {
 
-  QList<int> result;
-  const QModelIndexList& selected_indexes = selection_model.selectedIndexes();
-  for (const QModelIndex& index : selected_indexes) {
-    result << index.row();
-  }
-  return result;
+  return selection_model.get_selected_indexes();
 }
 
 /**
@@ -1348,7 +1496,7 @@ QList<int> TilesetModel::get_selected_indexes() const {
  */
 void TilesetModel::set_selected_index(int index) {
 
-  set_selected_indexes({ index });
+  selection_model.set_selected_index(index);
 }
 
 /**
@@ -1357,20 +1505,7 @@ void TilesetModel::set_selected_index(int index) {
  */
 void TilesetModel::set_selected_indexes(const QList<int>& indexes) {
 
-  const QModelIndexList& current_selection = selection_model.selectedIndexes();
-
-  QItemSelection selection;
-  for (int index : indexes) {
-    QModelIndex model_index = this->index(index);
-    selection.select(model_index, model_index);
-  }
-
-  if (selection.indexes().toSet() == current_selection.toSet()) {
-    // No change.
-    return;
-  }
-
-  selection_model.select(selection, QItemSelectionModel::ClearAndSelect);
+  selection_model.set_selected_indexes(indexes);
 }
 
 /**
@@ -1379,7 +1514,7 @@ void TilesetModel::set_selected_indexes(const QList<int>& indexes) {
  */
 void TilesetModel::add_to_selected(int index) {
 
-  add_to_selected(QList<int>({ index }));
+  selection_model.add_to_selected(index);
 }
 
 /**
@@ -1389,13 +1524,7 @@ void TilesetModel::add_to_selected(int index) {
  */
 void TilesetModel::add_to_selected(const QList<int>& indexes) {
 
-  QItemSelection selection;
-  for (int index : indexes) {
-    QModelIndex model_index = this->index(index);
-    selection.select(model_index, model_index);
-  }
-
-  selection_model.select(selection, QItemSelectionModel::Select);
+  selection_model.add_to_selected(indexes);
 }
 
 /**
@@ -1405,7 +1534,7 @@ void TilesetModel::add_to_selected(const QList<int>& indexes) {
  */
 bool TilesetModel::is_selected(int index) const {
 
-  return selection_model.isSelected(this->index(index));
+  return selection_model.is_selected(index);
 }
 
 /**
@@ -1414,7 +1543,7 @@ bool TilesetModel::is_selected(int index) const {
  */
 void TilesetModel::toggle_selected(int index) {
 
-  selection_model.select(this->index(index), QItemSelectionModel::Toggle);
+  selection_model.toggle_selected(index);
 }
 
 /**
@@ -1422,11 +1551,7 @@ void TilesetModel::toggle_selected(int index) {
  */
 void TilesetModel::select_all() {
 
-  QItemSelection selection;
-  QModelIndex first_index = this->index(0);
-  QModelIndex last_index = this->index(get_num_patterns() - 1);
-  selection.select(first_index, last_index);
-  selection_model.select(selection, QItemSelectionModel::Select);
+  selection_model.select_all();
 }
 
 /**
@@ -1434,7 +1559,7 @@ void TilesetModel::select_all() {
  */
 void TilesetModel::clear_selection() {
 
-  selection_model.clear();
+  selection_model.clear_selection();
 }
 
 /**
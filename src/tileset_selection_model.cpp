@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "tileset_model.h"
+#include "tileset_selection_model.h"
+#include <QSet>
+
+namespace SolarusEditor {
+
+/**
+ * @brief Creates an empty selection of patterns.
+ * @param tileset The tileset whose patterns can be selected.
+ * @param parent The parent object or nullptr.
+ */
+TilesetSelectionModel::TilesetSelectionModel(TilesetModel& tileset, QObject* parent) :
+  QItemSelectionModel(&tileset, parent) {
+
+}
+
+/**
+ * @brief Returns whether no patterns are selected.
+ * @return @c true if the selection is empty.
+ */
+bool TilesetSelectionModel::is_selection_empty() const {
+
+  return selection().isEmpty();
+}
+
+/**
+ * @brief Returns the number of selected patterns.
+ * @return The number of selected pattern.
+ */
+int TilesetSelectionModel::get_selection_count() const {
+
+  return selection().count();
+}
+
+/**
+ * @brief Returns the index of the selected pattern.
+ * @return The selected pattern index.
+ * Returns -1 if no pattern is selected or if multiple patterns are selected.
+ */
+int TilesetSelectionModel::get_selected_index() const {
+
+  QModelIndexList selected_indexes = selectedIndexes();
+  if (selected_indexes.size() != 1) {
+    return -1;
+  }
+  return selected_indexes.first().row();
+}
+
+/**
+ * @brief Returns all selected pattern indexes.
+ * @return The selected pattern indexes.
+ */
+QList<int> TilesetSelectionModel::get_selected_indexes() const {
+
+  QList<int> result;
+  const QModelIndexList& selected_indexes = selectedIndexes();
+  for (const QModelIndex& index : selected_indexes) {
+    result << index.row();
+  }
+  return result;
+}
+
+/**
+ * @brief Selects a pattern and deselects all others.
+ * @param index The index to select.
+ */
+void TilesetSelectionModel::set_selected_index(int index) {
+
+  set_selected_indexes({ index });
+}
+
+/**
+ * @brief Selects the specified patterns and deselects others.
+ * @param indexes The indexes to select.
+ */
+void TilesetSelectionModel::set_selected_indexes(const QList<int>& indexes) {
+
+  const QModelIndexList& current_selection = selectedIndexes();
+
+  QItemSelection selection;
+  for (int index : indexes) {
+    QModelIndex model_index = model()->index(index, 0);
+    selection.select(model_index, model_index);
+  }
+
+  if (selection.indexes().toSet() == current_selection.toSet()) {
+    // No change.
+    return;
+  }
+
+  select(selection, QItemSelectionModel::ClearAndSelect);
+}
+
+/**
+ * @brief Selects a pattern and lets the rest of the selection unchanged.
+ * @param index The index to select.
+ */
+void TilesetSelectionModel::add_to_selected(int index) {
+
+  add_to_selected(QList<int>({ index }));
+}
+
+/**
+ * @brief Selects the specified patterns and lets the rest of the selection
+ * unchanged.
+ * @param indexes The indexes to select.
+ */
+void TilesetSelectionModel::add_to_selected(const QList<int>& indexes) {
+
+  QItemSelection selection;
+  for (int index : indexes) {
+    QModelIndex model_index = model()->index(index, 0);
+    selection.select(model_index, model_index);
+  }
+
+  select(selection, QItemSelectionModel::Select);
+}
+
+/**
+ * @brief Returns whether a pattern is selected.
+ * @param index A pattern index.
+ * @return @c true if this pattern is selected.
+ */
+bool TilesetSelectionModel::is_selected(int index) const {
+
+  return isSelected(model()->index(index, 0));
+}
+
+/**
+ * @brief Changes the selection state of an item.
+ * @param index Index of the pattern to toggle.
+ */
+void TilesetSelectionModel::toggle_selected(int index) {
+
+  select(model()->index(index, 0), QItemSelectionModel::Toggle);
+}
+
+/**
+ * @brief Selects all patterns of the tileset.
+ */
+void TilesetSelectionModel::select_all() {
+
+  QItemSelection selection;
+  QModelIndex first_index = model()->index(0, 0);
+  QModelIndex last_index = model()->index(model()->rowCount() - 1, 0);
+  selection.select(first_index, last_index);
+  select(selection, QItemSelectionModel::Select);
+}
+
+/**
+ * @brief Deselects all selected items.
+ */
+void TilesetSelectionModel::clear_selection() {
+
+  clear();
+}
+
+}
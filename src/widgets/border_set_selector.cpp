@@ -90,12 +90,13 @@ void BorderSetSelector::build() {
   }
 
   try {
-    TilesetModel tileset(*quest, tileset_id);
+    std::shared_ptr<TilesetModel> tileset =
+        quest->get_tileset_cache().get_tileset(tileset_id);
 
     // Add border sets.
-    const QStringList& border_set_ids = tileset.get_border_set_ids();
+    const QStringList& border_set_ids = tileset->get_border_set_ids();
     for (const QString& border_set_id : border_set_ids) {
-      addItem(tileset.get_border_set_icon(border_set_id), border_set_id, border_set_id);
+      addItem(tileset->get_border_set_icon(border_set_id), border_set_id, border_set_id);
     }
 
     if (!border_set_ids.isEmpty()) {
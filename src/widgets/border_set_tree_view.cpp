@@ -44,9 +44,16 @@ BorderSetTreeView::BorderSetTreeView(QWidget* parent) :
  */
 void BorderSetTreeView::set_tileset(TilesetModel& tileset) {
 
+  if (this->tileset != nullptr) {
+    disconnect(this->tileset, nullptr, this, nullptr);
+  }
+  if (model != nullptr) {
+    model->deleteLater();
+  }
+
   this->tileset = &tileset;
 
-  model = new BorderSetModel(tileset);
+  model = new BorderSetModel(tileset, this);
   setModel(model);
   if (tileset.get_num_border_sets() > 0) {
     resizeColumnToContents(0);
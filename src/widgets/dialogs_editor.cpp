@@ -582,6 +582,7 @@ void DialogsEditor::set_selected_property(const QString& key) {
 void DialogsEditor::save() {
 
   model->save();
+  get_quest().get_search_index().update_file(get_file_path());
 }
 
 /**
@@ -17,18 +17,24 @@
 #include "entities/entity_traits.h"
 #include "widgets/editor.h"
 #include "editor_exception.h"
+#include "editor_settings.h"
 #include "quest.h"
+#include "sized_undo_command.h"
 #include <solarus/core/SolarusFatal.h>
 #include <QApplication>
 #include <QMessageBox>
+#include <QSignalBlocker>
 #include <QUndoStack>
 #include <QVBoxLayout>
 #include <iostream>
+#include <vector>
 
 namespace SolarusEditor {
 
 namespace {
 
+constexpr qint64 default_command_size = 256;  // Estimation for commands that don't report it.
+
 /**
  * @brief Undo command that wraps another one and does nothing the first time.
  *
@@ -53,8 +59,62 @@ public:
   explicit UndoCommandSkipFirst(std::unique_ptr<QUndoCommand> wrapped_command):
     QUndoCommand(wrapped_command->text()),
     wrapped_command(std::move(wrapped_command)),
-    first_time(true) {
+    attached_commands(),
+    first_time(true),
+    mergeable(true) {
+
+  }
+
+  /**
+   * @brief Returns an estimation of the memory used by the wrapped command.
+   * @return The size in bytes.
+   */
+  qint64 get_memory_size() const {
+
+    qint64 size = get_command_memory_size(*wrapped_command);
+    for (const std::unique_ptr<QUndoCommand>& command : attached_commands) {
+      size += get_command_memory_size(*command);
+    }
+    return size;
+  }
+
+  /**
+   * @brief Gives the wrapped command to the caller.
+   *
+   * This command can only be deleted afterwards.
+   *
+   * @return The wrapped command.
+   */
+  std::unique_ptr<QUndoCommand> take_wrapped_command() {
+    return std::move(wrapped_command);
+  }
+
+  /**
+   * @brief Adds a command already done as a consequence of the wrapped one.
+   *
+   * Undoing this command undoes attached commands first.
+   * Redoing it redoes them after the wrapped one.
+   *
+   * @param command The command to attach.
+   */
+  void attach_command(std::unique_ptr<QUndoCommand> command) {
+    attached_commands.push_back(std::move(command));
+  }
 
+  /**
+   * @brief Gives the attached commands to the caller.
+   * @return The attached commands, in the order they were done.
+   */
+  std::vector<std::unique_ptr<QUndoCommand>> take_attached_commands() {
+    return std::move(attached_commands);
+  }
+
+  /**
+   * @brief Sets whether this command can be merged with the next one.
+   * @param mergeable @c false to never merge.
+   */
+  void set_mergeable(bool mergeable) {
+    this->mergeable = mergeable;
   }
 
   /**
@@ -67,6 +127,9 @@ public:
   void undo() override {
 
     try {
+      for (auto it = attached_commands.rbegin(); it != attached_commands.rend(); ++it) {
+        (*it)->undo();
+      }
       wrapped_command->undo();
     }
     catch (const std::exception& ex) {
@@ -94,6 +157,9 @@ public:
 
     try {
       wrapped_command->redo();
+      for (const std::unique_ptr<QUndoCommand>& command : attached_commands) {
+        command->redo();
+      }
     }
     catch (const std::exception& ex) {
       // This is a bug in the editor.
@@ -103,10 +169,10 @@ public:
 
   /**
    * @brief Returns a value identifying this type of command.
-   * @return 0.
+   * @return 0, or -1 if merging is disabled.
    */
   int id() const override {
-    return 0;
+    return mergeable ? 0 : -1;
   }
 
   /**
@@ -114,13 +180,14 @@ public:
    *
    * If the other command is also an UndoCommandSkipFirst, this function
    * attempts to merge both wrapped comands.
+   * Commands that have attached commands are never merged.
    *
    * @param other Another command.
    * @return @c true if they could be merged.
    */
   bool mergeWith(const QUndoCommand* other) override {
 
-    if (other->id() != id()) {
+    if (other->id() != id() || !attached_commands.empty()) {
       return false;
     }
     const UndoCommandSkipFirst& other_skip = *static_cast<const UndoCommandSkipFirst*>(other);
@@ -130,10 +197,29 @@ public:
 
 private:
 
+  /**
+   * @brief Returns an estimation of the memory used by a command.
+   * @param command A command.
+   * @return The size in bytes.
+   */
+  static qint64 get_command_memory_size(const QUndoCommand& command) {
+
+    const SizedUndoCommand* sized_command =
+        dynamic_cast<const SizedUndoCommand*>(&command);
+    if (sized_command == nullptr) {
+      return default_command_size;
+    }
+    return sized_command->get_memory_size();
+  }
+
   std::unique_ptr<QUndoCommand>
       wrapped_command;     /**< The text editor widget to
                             * forward undo/redo commands to. */
+  std::vector<std::unique_ptr<QUndoCommand>>
+      attached_commands;   /**< Commands done as a consequence of
+                            * the wrapped one. */
   bool first_time;         /**< \c true if redo has not been called yet. */
+  bool mergeable;          /**< \c false to prevent merging with other commands. */
 };
 
 }
@@ -170,6 +256,8 @@ Editor::Editor(Quest& quest, const QString& file_path, QWidget* parent) :
 
   connect(qApp, SIGNAL(applicationStateChanged(Qt::ApplicationState)),
           this, SLOT(application_state_changed(Qt::ApplicationState)));
+  connect(undo_stack, SIGNAL(indexChanged(int)),
+          this, SLOT(undo_stack_index_changed()));
 }
 
 /**
@@ -351,14 +439,59 @@ void Editor::set_common_actions(const QMap<QString, QAction*>& common_actions) {
  */
 bool Editor::try_command(QUndoCommand* command) {
 
+  return try_command(command, false);
+}
+
+/**
+ * @brief Attempts to perform an action as a consequence of the last one.
+ *
+ * The command becomes part of the last command of the undo stack:
+ * undoing or redoing it does both.
+ * If there is no last command to attach to, this is the same as try_command().
+ *
+ * @param command The command to do.
+ * This function takes ownership of the pointer.
+ * @return @c true in case of success, @c false if an exception occurred.
+ */
+bool Editor::try_attached_command(QUndoCommand* command) {
+
+  return try_command(command, true);
+}
+
+/**
+ * @brief Attempts to perform an action and adds it to the undo stack.
+ * @param command The command to do.
+ * This function takes ownership of the pointer.
+ * @param attach_to_last @c true to make it part of the last command
+ * of the undo stack if there is one.
+ * @return @c true in case of success, @c false if an exception occurred.
+ */
+bool Editor::try_command(QUndoCommand* command, bool attach_to_last) {
+
   std::unique_ptr<QUndoCommand> command_ptr(command);
+
+  UndoCommandSkipFirst* last_command = nullptr;
+  const int index = undo_stack->index();
+  if (attach_to_last && index > 0 && index == undo_stack->count()) {
+    // Commands are only modified here and while rebuilding the stack.
+    last_command = dynamic_cast<UndoCommandSkipFirst*>(
+          const_cast<QUndoCommand*>(undo_stack->command(index - 1)));
+  }
+
   try {
     command_ptr->redo();  // Exceptions are allowed here.
     // Now we know that the command succeeds.
-    // Unfortunately, we cannot directly add it to the undo stack because
-    // the undo stack would execute it again.
-    // So let's wrap it in a special command.
-    get_undo_stack().push(new UndoCommandSkipFirst(std::move(command_ptr)));
+    if (last_command != nullptr) {
+      last_command->attach_command(std::move(command_ptr));
+      undo_stack_index_changed();  // The memory size has changed.
+    }
+    else {
+      // Unfortunately, we cannot directly add it to the undo stack because
+      // the undo stack would execute it again.
+      // So let's wrap it in a special command.
+      get_undo_stack().push(new UndoCommandSkipFirst(std::move(command_ptr)));
+    }
+    limit_undo_memory();
     return true;
   }
   catch (const EditorException& ex) {
@@ -377,6 +510,118 @@ bool Editor::try_command(QUndoCommand* command) {
   return false;
 }
 
+/**
+ * @brief Returns an estimation of the memory used by the undo/redo history.
+ * @return The size in bytes.
+ */
+qint64 Editor::get_undo_memory_size() const {
+
+  qint64 size = 0;
+  for (int i = 0; i < undo_stack->count(); ++i) {
+    const UndoCommandSkipFirst* command =
+        dynamic_cast<const UndoCommandSkipFirst*>(undo_stack->command(i));
+    size += (command != nullptr) ? command->get_memory_size() : default_command_size;
+  }
+  return size;
+}
+
+/**
+ * @brief Forgets the oldest commands of the undo/redo history if it uses
+ * more memory than the limit of the settings.
+ *
+ * QUndoStack cannot remove its oldest commands, so the commands to keep
+ * are taken out of their wrappers, the stack is cleared and they are
+ * pushed again without being executed.
+ * Commands are forgotten until the history uses less than 3/4 of the limit,
+ * so that the stack is not rebuilt again at each new command.
+ * This must be called right after a push, when no command can be redone.
+ */
+void Editor::limit_undo_memory() {
+
+  EditorSettings settings;
+  const qint64 limit = settings.get_value_int(EditorSettings::undo_memory_limit) * 1024LL * 1024LL;
+  if (limit <= 0) {
+    // No limit.
+    return;
+  }
+
+  const int num_commands = undo_stack->count();
+  Q_ASSERT(undo_stack->index() == num_commands);
+
+  std::vector<UndoCommandSkipFirst*> commands;
+  qint64 size = 0;
+  for (int i = 0; i < num_commands; ++i) {
+    // Commands are only modified here and when attaching a command to them.
+    UndoCommandSkipFirst* command = dynamic_cast<UndoCommandSkipFirst*>(
+          const_cast<QUndoCommand*>(undo_stack->command(i)));
+    if (command == nullptr) {
+      // Not pushed by try_command(): this stack cannot be rebuilt.
+      return;
+    }
+    commands.push_back(command);
+    size += command->get_memory_size();
+  }
+  if (size <= limit) {
+    return;
+  }
+
+  // Find how many old commands to forget. The last one is always kept.
+  const qint64 target_size = limit / 4 * 3;
+  int num_forgotten = 0;
+  while (size > target_size && num_forgotten < num_commands - 1) {
+    size -= commands[num_forgotten]->get_memory_size();
+    ++num_forgotten;
+  }
+  if (num_forgotten == 0) {
+    return;
+  }
+
+  std::vector<std::unique_ptr<QUndoCommand>> kept_commands;
+  std::vector<std::vector<std::unique_ptr<QUndoCommand>>> kept_attached_commands;
+  for (int i = num_forgotten; i < num_commands; ++i) {
+    kept_commands.push_back(commands[i]->take_wrapped_command());
+    kept_attached_commands.push_back(commands[i]->take_attached_commands());
+  }
+
+  // The clean state may be among the forgotten commands.
+  const int clean_index = undo_stack->cleanIndex() - num_forgotten;
+  const bool was_clean = undo_stack->isClean();
+  {
+    // Only notify the final state of the stack.
+    QSignalBlocker blocker(undo_stack);
+    undo_stack->clear();
+    for (size_t i = 0; i < kept_commands.size(); ++i) {
+      UndoCommandSkipFirst* command = new UndoCommandSkipFirst(std::move(kept_commands[i]));
+      for (std::unique_ptr<QUndoCommand>& attached_command : kept_attached_commands[i]) {
+        command->attach_command(std::move(attached_command));
+      }
+      command->set_mergeable(false);
+      undo_stack->push(command);
+      if (undo_stack->index() == clean_index) {
+        undo_stack->setClean();
+      }
+      command->set_mergeable(true);
+    }
+    if (clean_index < 0) {
+      undo_stack->resetClean();
+    }
+  }
+
+  // The last command and the redo state did not change.
+  emit undo_stack->indexChanged(undo_stack->index());
+  if (undo_stack->isClean() != was_clean) {
+    emit undo_stack->cleanChanged(undo_stack->isClean());
+  }
+}
+
+/**
+ * @brief Slot called when commands are done, undone or redone.
+ */
+void Editor::undo_stack_index_changed() {
+
+  emit undo_memory_size_changed(get_undo_memory_size());
+}
+
 /**
  * @brief Undoes the last command from the undo/redo history.
  */
@@ -393,9 +638,34 @@ void Editor::undo() {
  * You don't have to call QUndoStack::setClean() from your save() function:
  * this is automatically done if the save operation is successful.
  *
+ * The file may still be being written when this function returns:
+ * see wait_for_save().
+ *
  * @throws EditorException In case of failure.
  */
 
+/**
+ * @brief Waits until the file is written if save() returned before.
+ *
+ * Editors that write their file in a worker thread reimplement this function.
+ * The default implementation does nothing.
+ *
+ * @throws EditorException If the file could not be written.
+ */
+void Editor::wait_for_save() {
+}
+
+/**
+ * @brief Returns whether the file is still being written after save().
+ *
+ * The default implementation returns @c false.
+ *
+ * @return @c true if a save is in progress.
+ */
+bool Editor::is_saving() const {
+  return false;
+}
+
 /**
  * @brief Returns whether the user made changes that are not saved yet.
  * @return @c true if there are unsaved changes.
@@ -409,13 +679,24 @@ bool Editor::has_unsaved_changes() const {
  * @brief Function called when the user wants to close the editor.
  *
  * If the file is not saved, a dialog proposes to save it.
+ * If it is still being written, waits for the end and reports a failure.
  *
  * @return @c false to cancel the closing operation.
  */
 bool Editor::confirm_before_closing() {
 
   if (!has_unsaved_changes()) {
-    // The file is saved.
+    // The file is saved, unless writing it in the background fails.
+    if (is_saving()) {
+      try {
+        wait_for_save();
+      }
+      catch (const EditorException& ex) {
+        get_undo_stack().resetClean();
+        ex.show_dialog();
+        return false;
+      }
+    }
     return true;
   }
 
@@ -433,6 +714,7 @@ bool Editor::confirm_before_closing() {
     // Save and close.
     try {
       save();
+      wait_for_save();
       get_undo_stack().setClean();
       return true;
     }
@@ -465,6 +465,10 @@ bool EditorTabs::save_file_requested(int index) {
 
 /**
  * @brief Slot called when the user attempts to save all tabs.
+ *
+ * Files are written concurrently.
+ * Returns when they are all written.
+ *
  * @return @c true in case of success.
  */
 bool EditorTabs::save_all_files_requested() {
@@ -473,6 +477,23 @@ bool EditorTabs::save_all_files_requested() {
   for (int i = 0; i < count(); ++i) {
     success = success && save_file_requested(i);
   }
+
+  for (int i = 0; i < count(); ++i) {
+    Editor* editor = get_editor(i);
+    if (editor == nullptr) {
+      continue;
+    }
+
+    try {
+      editor->wait_for_save();
+    }
+    catch (const EditorException& ex) {
+      editor->get_undo_stack().resetClean();
+      modification_state_changed(i, false);
+      ex.show_dialog();
+      success = false;
+    }
+  }
   return success;
 }
 
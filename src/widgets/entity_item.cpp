@@ -31,7 +31,8 @@ namespace SolarusEditor {
 EntityItem::EntityItem(EntityModel& entity, QGraphicsItem* parent) :
   QGraphicsItem(parent),
   entity(entity),
-  size(entity.get_size()) {
+  size(entity.get_size()),
+  content_cached(false) {
 
   update_xy();
   setFlags(ItemIsSelectable | ItemIsFocusable);
@@ -107,6 +108,28 @@ void EntityItem::update_size() {
   this->size = entity.get_size();  // TODO this is not true for entities whose sprite is larger, like NPCs
 }
 
+/**
+ * @brief Returns whether the content of the entity is drawn by another item.
+ * @return @c true if this item only draws the selection marker.
+ */
+bool EntityItem::is_content_cached() const {
+  return content_cached;
+}
+
+/**
+ * @brief Sets whether the content of the entity is drawn by another item.
+ *
+ * Static tiles are drawn by the LayerTilesItem of their layer,
+ * except animated ones.
+ *
+ * @param content_cached @c true to only draw the selection marker.
+ */
+void EntityItem::set_content_cached(bool content_cached) {
+
+  this->content_cached = content_cached;
+  update();
+}
+
 /**
  * @brief Paints the pattern item.
  *
@@ -125,7 +148,15 @@ void EntityItem::paint(QPainter* painter,
   const bool selected = option->state & QStyle::State_Selected;
   QStyleOptionGraphicsItem option_deselected = *option;
   option_deselected.state &= ~QStyle::State_Selected;
-  entity.draw(*painter);
+  if (!content_cached) {
+    const MapScene* map_scene = qobject_cast<const MapScene*>(scene());
+    if (map_scene != nullptr && entity.is_animated()) {
+      entity.draw_animated(*painter, map_scene->get_animation_time());
+    }
+    else {
+      entity.draw(*painter);
+    }
+  }
 
   // Add our selection marker.
   if (selected) {
@@ -15,8 +15,7 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "widgets/entity_selector.h"
-#include "editor_exception.h"
-#include "map_model.h"
+#include "map_index.h"
 #include "quest.h"
 
 namespace SolarusEditor {
@@ -142,30 +141,25 @@ void EntitySelector::build() {
     return;
   }
 
-  try {
-    MapModel map(*quest, map_id);
+  const MapIndex::MapInfo& map_info = quest->get_map_index().get_map_info(map_id);
+  if (!map_info.valid) {
+    // The map file could not be opened: the map id is probably unset or incorrect.
+    return;
+  }
 
-    // Add special value items first.
-    for (const SpecialValue& special_value : special_values) {
-      addItem(special_value.second, special_value.first);
-    }
+  // Add special value items first.
+  for (const SpecialValue& special_value : special_values) {
+    addItem(special_value.second, special_value.first);
+  }
 
-    // Add entities.
-    const QMap<QString, EntityIndex>& indexes = map.get_named_entities();
-    for (auto it = indexes.begin(); it != indexes.end(); ++it) {
-      const QString& name = it.key();
-      const EntityIndex& index = it.value();
-      if (is_filtered_by_entity_type() &&
-          map.get_entity_type(index) != get_entity_type_filter()) {
-        // Not the wanted entity type.
-        continue;
-      }
-      addItem(name, name);
+  // Add entities.
+  for (const MapIndex::NamedEntity& entity : map_info.named_entities) {
+    if (is_filtered_by_entity_type() &&
+        entity.type != get_entity_type_filter()) {
+      // Not the wanted entity type.
+      continue;
     }
-  }
-  catch (const EditorException& ex) {
-    // The map file could not be opened: the map id is probably unset or incorrect.
-    Q_UNUSED(ex);
+    addItem(entity.name, entity.name);
   }
 }
 
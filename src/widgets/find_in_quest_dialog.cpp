@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "widgets/find_in_quest_dialog.h"
+#include "editor_exception.h"
+#include "quest.h"
+#include <QCheckBox>
+#include <QDir>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+namespace SolarusEditor {
+
+namespace {
+
+/**
+ * @brief Item data roles used in the results tree.
+ */
+enum {
+  PathRole = Qt::UserRole,
+  LineRole
+};
+
+}
+
+/**
+ * @brief Creates a find in quest dialog.
+ * @param quest The quest to search.
+ * @param parent The parent object or nullptr.
+ */
+FindInQuestDialog::FindInQuestDialog(Quest& quest, QWidget* parent) :
+  QDialog(parent),
+  quest(quest),
+  find_field(new QLineEdit(this)),
+  regex_check_box(new QCheckBox(tr("Regular expression"), this)),
+  case_check_box(new QCheckBox(tr("Case sensitive"), this)),
+  results_tree(new QTreeWidget(this)),
+  status_label(new QLabel(this)) {
+
+  setWindowTitle(tr("Find in quest"));
+  resize(640, 480);
+
+  QPushButton* find_button = new QPushButton(tr("Find"), this);
+  find_button->setDefault(true);
+
+  QHBoxLayout* find_layout = new QHBoxLayout();
+  find_layout->addWidget(find_field);
+  find_layout->addWidget(find_button);
+
+  QHBoxLayout* options_layout = new QHBoxLayout();
+  options_layout->addWidget(regex_check_box);
+  options_layout->addWidget(case_check_box);
+  options_layout->addStretch();
+
+  results_tree->setColumnCount(1);
+  results_tree->header()->hide();
+  results_tree->setUniformRowHeights(true);
+
+  QVBoxLayout* layout = new QVBoxLayout(this);
+  layout->addLayout(find_layout);
+  layout->addLayout(options_layout);
+  layout->addWidget(results_tree);
+  layout->addWidget(status_label);
+
+  connect(find_button, SIGNAL(clicked()),
+          this, SLOT(find()));
+  connect(find_field, SIGNAL(returnPressed()),
+          this, SLOT(find()));
+  connect(results_tree, SIGNAL(itemActivated(QTreeWidgetItem*, int)),
+          this, SLOT(item_activated(QTreeWidgetItem*)));
+  connect(&quest.get_search_index(), SIGNAL(build_finished()),
+          this, SLOT(update_status()));
+
+  update_status();
+}
+
+/**
+ * @brief Searches the text of the find field and shows the results.
+ */
+void FindInQuestDialog::find() {
+
+  results_tree->clear();
+
+  const QString& pattern = find_field->text();
+  if (pattern.isEmpty()) {
+    update_status();
+    return;
+  }
+
+  QList<QuestSearchIndex::Match> matches;
+  try {
+    matches = quest.get_search_index().find_text(
+          pattern,
+          regex_check_box->isChecked(),
+          case_check_box->isChecked()
+    );
+  }
+  catch (const EditorException& ex) {
+    status_label->setText(ex.get_message());
+    return;
+  }
+
+  const QDir data_dir(quest.get_data_path());
+  QTreeWidgetItem* file_item = nullptr;
+  int num_files = 0;
+  for (const QuestSearchIndex::Match& match : matches) {
+
+    if (file_item == nullptr || file_item->data(0, PathRole).toString() != match.path) {
+      file_item = new QTreeWidgetItem(results_tree);
+      file_item->setText(0, data_dir.relativeFilePath(match.path));
+      file_item->setData(0, PathRole, match.path);
+      file_item->setData(0, LineRole, 0);
+      file_item->setExpanded(true);
+      ++num_files;
+    }
+
+    QTreeWidgetItem* match_item = new QTreeWidgetItem(file_item);
+    match_item->setText(0, QString("%1: %2").arg(match.line).arg(match.line_text.trimmed()));
+    match_item->setData(0, PathRole, match.path);
+    match_item->setData(0, LineRole, match.line);
+  }
+
+  status_label->setText(tr("%1 matches in %2 files").arg(matches.size()).arg(num_files));
+}
+
+/**
+ * @brief Slot called when the user double-clicks or validates a result.
+ * @param item The result.
+ */
+void FindInQuestDialog::item_activated(QTreeWidgetItem* item) {
+
+  if (item == nullptr) {
+    return;
+  }
+
+  emit open_file_requested(item->data(0, PathRole).toString(),
+                           item->data(0, LineRole).toInt());
+}
+
+/**
+ * @brief Shows the state of the index in the status label.
+ */
+void FindInQuestDialog::update_status() {
+
+  const QuestSearchIndex& index = quest.get_search_index();
+  if (index.is_building()) {
+    status_label->setText(tr("Indexing quest files..."));
+  }
+  else {
+    status_label->setText(tr("%1 files indexed").arg(index.get_num_files()));
+  }
+}
+
+}
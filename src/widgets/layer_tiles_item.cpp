@@ -0,0 +1,315 @@
+/*
+ * Copyright (C) 2014-2018 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus Quest Editor is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus Quest Editor is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "widgets/layer_tiles_item.h"
+#include "widgets/map_scene.h"
+#include "entities/entity_model.h"
+#include "map_model.h"
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+namespace SolarusEditor {
+
+/**
+ * @brief Creates a tiles item for a layer.
+ * @param scene The map scene.
+ * @param layer The layer whose tiles to draw.
+ * @param parent The parent item or nullptr.
+ */
+LayerTilesItem::LayerTilesItem(const MapScene& scene, int layer, QGraphicsItem* parent) :
+  QGraphicsItem(parent),
+  scene(scene),
+  layer(layer),
+  size(scene.get_model().get_size()),
+  chunks(max_cached_chunks) {
+
+  setPos(MapScene::get_margin_top_left());
+
+  // Below all entity items of the layer.
+  setZValue(-1);
+
+  // To know the exposed rectangle in paint().
+  setFlag(ItemUsesExtendedStyleOption);
+}
+
+/**
+ * @brief Returns the layer drawn by this item.
+ * @return The layer.
+ */
+int LayerTilesItem::get_layer() const {
+  return layer;
+}
+
+/**
+ * @brief Returns the bounding rectangle of the item.
+ * @return The bounding rectangle: the whole map.
+ */
+QRectF LayerTilesItem::boundingRect() const {
+
+  return QRect(QPoint(), size);
+}
+
+/**
+ * @brief Updates the size of this item to reflect the size of the map.
+ */
+void LayerTilesItem::update_size() {
+
+  // prepareGeometryChange() tells Qt the result of boundingRect() will change.
+  prepareGeometryChange();
+  size = scene.get_model().get_size();
+  invalidate_all();
+}
+
+/**
+ * @brief Forgets the chunks overlapping an area and schedules a repaint.
+ * @param area The area that changed, in map coordinates.
+ */
+void LayerTilesItem::invalidate(const QRect& area) {
+
+  const QRect& map_area = area.intersected(QRect(QPoint(), size));
+  if (map_area.isEmpty()) {
+    return;
+  }
+
+  for (int level = 0; level <= max_level; ++level) {
+    const QRect& range = get_chunk_range(level, map_area);
+    for (int chunk_y = range.top(); chunk_y <= range.bottom(); ++chunk_y) {
+      for (int chunk_x = range.left(); chunk_x <= range.right(); ++chunk_x) {
+        chunks.remove(get_chunk_key(level, chunk_x, chunk_y));
+      }
+    }
+  }
+  update(map_area);
+}
+
+/**
+ * @brief Forgets all chunks and schedules a repaint.
+ */
+void LayerTilesItem::invalidate_all() {
+
+  chunks.clear();
+  update();
+}
+
+/**
+ * @brief Paints the chunks exposed.
+ *
+ * The level of detail of chunks depends on the current zoom.
+ * Chunks not rendered yet are rendered now.
+ *
+ * @param painter The painter.
+ * @param option Style option of the item.
+ * @param widget The widget being painted or nullptr.
+ */
+void LayerTilesItem::paint(QPainter* painter,
+                           const QStyleOptionGraphicsItem* option,
+                           QWidget* /* widget */) {
+
+  const QRect& exposed_area = option->exposedRect.toAlignedRect().intersected(
+        QRect(QPoint(), size));
+  if (exposed_area.isEmpty()) {
+    return;
+  }
+
+  const int level = get_level(
+        option->levelOfDetailFromTransform(painter->worldTransform()));
+  const QRect& range = get_chunk_range(level, exposed_area);
+  for (int chunk_y = range.top(); chunk_y <= range.bottom(); ++chunk_y) {
+    for (int chunk_x = range.left(); chunk_x <= range.right(); ++chunk_x) {
+      const QPixmap& chunk = get_chunk(level, chunk_x, chunk_y);
+      if (!chunk.isNull()) {
+        painter->drawPixmap(get_chunk_area(level, chunk_x, chunk_y), chunk);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Returns the level of chunks to paint for a zoom.
+ * @param level_of_detail Scale of the view: 1.0 means no zoom.
+ * @return The coarsest level whose chunks still have at least one pixel
+ * per pixel of the screen.
+ */
+int LayerTilesItem::get_level(qreal level_of_detail) {
+
+  int level = 0;
+  while (level < max_level && level_of_detail * (2 << level) <= 1.0) {
+    ++level;
+  }
+  return level;
+}
+
+/**
+ * @brief Returns the key of a chunk in the cache.
+ * @param level Level of detail of the chunk.
+ * @param chunk_x X coordinate of the chunk in the grid of chunks of this level.
+ * @param chunk_y Y coordinate of the chunk in the grid of chunks of this level.
+ * @return The corresponding key.
+ */
+quint64 LayerTilesItem::get_chunk_key(int level, int chunk_x, int chunk_y) {
+
+  // Chunks are inside the map, so coordinates are positive.
+  return (static_cast<quint64>(level) << 56) |
+      (static_cast<quint64>(chunk_x & 0x0FFFFFFF) << 28) |
+      static_cast<quint64>(chunk_y & 0x0FFFFFFF);
+}
+
+/**
+ * @brief Returns the area of the map covered by a chunk.
+ * @param level Level of detail of the chunk.
+ * @param chunk_x X coordinate of the chunk in the grid of chunks of this level.
+ * @param chunk_y Y coordinate of the chunk in the grid of chunks of this level.
+ * @return The area in map coordinates.
+ */
+QRect LayerTilesItem::get_chunk_area(int level, int chunk_x, int chunk_y) {
+
+  const int area_size = chunk_size << level;
+  return QRect(chunk_x * area_size, chunk_y * area_size, area_size, area_size);
+}
+
+/**
+ * @brief Returns the chunks of a level overlapped by an area.
+ * @param level A level of detail.
+ * @param area A non-empty rectangle inside the map.
+ * @return The range of chunks, in chunk coordinates (inclusive).
+ */
+QRect LayerTilesItem::get_chunk_range(int level, const QRect& area) {
+
+  const int area_size = chunk_size << level;
+  return QRect(QPoint(area.left() / area_size, area.top() / area_size),
+               QPoint(area.right() / area_size, area.bottom() / area_size));
+}
+
+/**
+ * @brief Returns a chunk, rendering it if it is not in the cache.
+ * @param level Level of detail of the chunk.
+ * @param chunk_x X coordinate of the chunk in the grid of chunks of this level.
+ * @param chunk_y Y coordinate of the chunk in the grid of chunks of this level.
+ * @return The chunk image, or a null pixmap if there is no tile to draw there.
+ */
+QPixmap LayerTilesItem::get_chunk(int level, int chunk_x, int chunk_y) {
+
+  const quint64 key = get_chunk_key(level, chunk_x, chunk_y);
+  const QPixmap* chunk = chunks.object(key);
+  if (chunk != nullptr) {
+    return *chunk;
+  }
+
+  const QPixmap& rendered_chunk = render_chunk(level, chunk_x, chunk_y);
+
+  // Empty chunks cost nothing and are always kept.
+  chunks.insert(key, new QPixmap(rendered_chunk), rendered_chunk.isNull() ? 0 : 1);
+  return rendered_chunk;
+}
+
+/**
+ * @brief Renders a chunk.
+ *
+ * Chunks of level 0 are drawn from tiles.
+ * Chunks of other levels are downsampled from the four chunks of the
+ * previous level that they cover.
+ * These finer chunks are taken from the cache if they are there,
+ * but are not added to it: they are not displayed at this zoom.
+ *
+ * @param level Level of detail of the chunk.
+ * @param chunk_x X coordinate of the chunk in the grid of chunks of this level.
+ * @param chunk_y Y coordinate of the chunk in the grid of chunks of this level.
+ * @return The chunk image, or a null pixmap if there is no tile to draw there.
+ */
+QPixmap LayerTilesItem::render_chunk(int level, int chunk_x, int chunk_y) const {
+
+  if (level == 0) {
+    return render_tiles(chunk_x, chunk_y);
+  }
+
+  QPixmap chunk;
+  QPainter painter;
+  const int half_size = chunk_size / 2;
+  for (int j = 0; j < 2; ++j) {
+    for (int i = 0; i < 2; ++i) {
+      const int finer_x = chunk_x * 2 + i;
+      const int finer_y = chunk_y * 2 + j;
+      if (!get_chunk_area(level - 1, finer_x, finer_y).intersects(QRect(QPoint(), size))) {
+        continue;
+      }
+
+      const QPixmap* cached_finer_chunk =
+          chunks.object(get_chunk_key(level - 1, finer_x, finer_y));
+      const QPixmap& finer_chunk = cached_finer_chunk != nullptr ?
+            *cached_finer_chunk : render_chunk(level - 1, finer_x, finer_y);
+      if (finer_chunk.isNull()) {
+        continue;
+      }
+
+      if (chunk.isNull()) {
+        chunk = QPixmap(chunk_size, chunk_size);
+        chunk.fill(Qt::transparent);
+        painter.begin(&chunk);
+        painter.setRenderHint(QPainter::SmoothPixmapTransform);
+      }
+      painter.drawPixmap(QRect(i * half_size, j * half_size, half_size, half_size),
+                         finer_chunk);
+    }
+  }
+
+  if (painter.isActive()) {
+    painter.end();
+  }
+  return chunk;
+}
+
+/**
+ * @brief Draws the visible static tiles that overlap a chunk of level 0.
+ *
+ * Animated tiles are drawn by their own item.
+ *
+ * @param chunk_x X coordinate of the chunk in the grid of chunks.
+ * @param chunk_y Y coordinate of the chunk in the grid of chunks.
+ * @return The chunk image, or a null pixmap if there is no tile to draw there.
+ */
+QPixmap LayerTilesItem::render_tiles(int chunk_x, int chunk_y) const {
+
+  const MapModel& map = scene.get_model();
+  const QRect& chunk_area = get_chunk_area(0, chunk_x, chunk_y);
+
+  // Indexes are sorted, so tiles are drawn in the order of the map.
+  const EntityIndexes& indexes = map.find_entities_in_rectangle(layer, chunk_area);
+  QPixmap chunk;
+  QPainter painter;
+  for (const EntityIndex& index : indexes) {
+    const EntityModel& entity = map.get_entity(index);
+    if (!scene.is_entity_content_cached(index) || !scene.is_entity_visible(index)) {
+      continue;
+    }
+
+    if (chunk.isNull()) {
+      chunk = QPixmap(chunk_size, chunk_size);
+      chunk.fill(Qt::transparent);
+      painter.begin(&chunk);
+    }
+    painter.save();
+    painter.translate(entity.get_top_left() - chunk_area.topLeft());
+    entity.draw(painter);
+    painter.restore();
+  }
+
+  if (painter.isActive()) {
+    painter.end();
+  }
+  return chunk;
+}
+
+}
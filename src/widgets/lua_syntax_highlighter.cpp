@@ -15,7 +15,6 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "widgets/lua_syntax_highlighter.h"
-#include <QVariant>
 
 namespace SolarusEditor {
 
@@ -26,69 +25,36 @@ namespace SolarusEditor {
 LuaSyntaxHighlighter::LuaSyntaxHighlighter(QTextDocument* document) :
     QSyntaxHighlighter(document) {
 
-  HighlightingRule rule;
-
-  // The following awful regexp beginning can be used to match things that are
-  // not in a string.
-  // To do that, we check that the number of quotes and double-quotes is even.
-  // (Keeping state information would probably be more readable.)
-  QString not_in_a_single_line_string = "^[^\"']*(?:\"[^\"]*\"[^\"'']*|\'[^\']*\'[^\"']*)*";
-
   // Keywords.
   keyword_format.setForeground(Qt::darkRed);
   keyword_format.setFontWeight(QFont::Bold);
-  QStringList keyword_patterns;
-  keyword_patterns << "\\band\\b"
-                   << "\\bbreak\\b"
-                   << "\\bdo\\b"
-                   << "\\belse\\b"
-                   << "\\belseif\\b"
-                   << "\\bend\\b"
-                   << "\\bfalse\\b"
-                   << "\\bfor\\b"
-                   << "\\bfunction\\b"
-                   << "\\bif\\b"
-                   << "\\bin\\b"
-                   << "\\blocal\\b"
-                   << "\\bnil\\b"
-                   << "\\bnot\\b"
-                   << "\\bor\\b"
-                   << "\\brepeat\\b"
-                   << "\\breturn\\b"
-                   << "\\bthen\\b"
-                   << "\\btrue\\b"
-                   << "\\buntil\\b"
-                   << "\\bwhile\\b";
-
-  for (const QString& pattern : keyword_patterns) {
-    rule.pattern = QRegExp(pattern);
-    rule.format = keyword_format;
-    rules.append(rule);
-  }
+  keywords << "and"
+           << "break"
+           << "do"
+           << "else"
+           << "elseif"
+           << "end"
+           << "false"
+           << "for"
+           << "function"
+           << "if"
+           << "in"
+           << "local"
+           << "nil"
+           << "not"
+           << "or"
+           << "repeat"
+           << "return"
+           << "then"
+           << "true"
+           << "until"
+           << "while";
 
   // Strings.
   string_format.setForeground(Qt::blue);
-  rule.pattern = QRegExp("\"[^\"]*\"");
-  rule.format = string_format;
-  rules.append(rule);
-
-  rule.pattern = QRegExp("'[^']*'");
-  rule.format = string_format;
-  rules.append(rule);
 
   // Comments.
   single_line_comment_format.setForeground(Qt::darkGreen);
-  // Avoid to highlight comments in strings,
-  // and don't match --[[ or --]] markers.
-  rule.pattern = QRegExp(
-        not_in_a_single_line_string +
-        R"((--([^\[\]]|\[[^\[]|\][^\]])[^\n]*$)$)"
-  );
-  rule.format = single_line_comment_format;
-  rules.append(rule);
-
-  comment_start_pattern = QRegExp("--\\[\\[");
-  comment_end_pattern = QRegExp("--\\]\\]");
   multi_line_comment_format.setForeground(
         single_line_comment_format.foreground());
 }
@@ -99,41 +65,176 @@ LuaSyntaxHighlighter::LuaSyntaxHighlighter(QTextDocument* document) :
  */
 void LuaSyntaxHighlighter::highlightBlock(const QString& text) {
 
-  for (const HighlightingRule& rule : rules) {
-    QRegExp pattern(rule.pattern);
-    int index = pattern.indexIn(text);
-    if (pattern.captureCount() > 0) {
-      index = pattern.pos(1);
+  const int length = text.length();
+  int index = 0;
+
+  // Continue a long string or long comment from the previous block.
+  const int previous_state = qMax(0, previousBlockState());
+  const LongBracketKind previous_kind = static_cast<LongBracketKind>(previous_state & 3);
+  if (previous_kind != NO_LONG_BRACKET) {
+    index = highlight_long_bracket(text, 0, previous_kind, previous_state >> 2);
+    if (index == -1) {
+      // Still not closed.
+      return;
     }
-    while (index >= 0) {
-      int length = pattern.matchedLength();
-      if (pattern.captureCount() > 0) {
-        length = pattern.capturedTexts()[0].size();
+  }
+
+  while (index < length) {
+
+    const QChar c = text.at(index);
+
+    if (c == '-' && index + 1 < length && text.at(index + 1) == '-') {
+      // Comment.
+      const int level = get_long_bracket_level(text, index + 2);
+      if (level == -1) {
+        setFormat(index, length - index, single_line_comment_format);
+        break;
+      }
+      index = highlight_long_bracket(text, index, LONG_COMMENT, level);
+      if (index == -1) {
+        return;
+      }
+    }
+    else if (c == '[') {
+      // Maybe a long string.
+      const int level = get_long_bracket_level(text, index);
+      if (level == -1) {
+        ++index;
+        continue;
+      }
+      index = highlight_long_bracket(text, index, LONG_STRING, level);
+      if (index == -1) {
+        return;
       }
-      setFormat(index, length, rule.format);
-      index = pattern.indexIn(text, index + length);
+    }
+    else if (c == '"' || c == '\'') {
+      // Single-line string.
+      const int start = index;
+      ++index;
+      while (index < length && text.at(index) != c) {
+        if (text.at(index) == '\\') {
+          // Skip the escaped character.
+          ++index;
+        }
+        ++index;
+      }
+      index = qMin(index + 1, length);
+      setFormat(start, index - start, string_format);
+    }
+    else if (c.isLetterOrNumber() || c == '_') {
+      // Identifier, keyword or number.
+      const int start = index;
+      while (index < length &&
+             (text.at(index).isLetterOrNumber() || text.at(index) == '_')) {
+        ++index;
+      }
+      if (c.isLetter() && keywords.contains(text.mid(start, index - start))) {
+        setFormat(start, index - start, keyword_format);
+      }
+    }
+    else {
+      ++index;
     }
   }
-  setCurrentBlockState(0);
 
-  int start_index = 0;
-  if (previousBlockState() != 1) {
-    start_index = comment_start_pattern.indexIn(text);
+  setCurrentBlockState(get_block_state(NO_LONG_BRACKET, 0));
+}
+
+/**
+ * @brief Returns the state of a block from how it ends.
+ * @param kind The multi-line token the block ends in if any.
+ * @param level Level of the long bracket if any.
+ * @return The block state.
+ */
+int LuaSyntaxHighlighter::get_block_state(LongBracketKind kind, int level) {
+
+  return kind | (level << 2);
+}
+
+/**
+ * @brief Returns the level of an opening long bracket.
+ * @param text The text of a block.
+ * @param index Index of a character in the text.
+ * @return The number of equal signs if there is an opening long bracket
+ * at this index ([[, [=[, [==[...), or -1 otherwise.
+ */
+int LuaSyntaxHighlighter::get_long_bracket_level(const QString& text, int index) {
+
+  const int length = text.length();
+  if (index >= length || text.at(index) != '[') {
+    return -1;
+  }
+
+  int level = 0;
+  ++index;
+  while (index < length && text.at(index) == '=') {
+    ++level;
+    ++index;
   }
+  if (index >= length || text.at(index) != '[') {
+    return -1;
+  }
+  return level;
+}
+
+/**
+ * @brief Finds the closing long bracket of a given level.
+ * @param text The text of a block.
+ * @param index Where to start the search.
+ * @param level Number of equal signs of the bracket to find.
+ * @return The index just after the closing bracket, or -1 if it is not
+ * in this block.
+ */
+int LuaSyntaxHighlighter::find_long_bracket_end(const QString& text, int index, int level) {
+
+  const int length = text.length();
+  while (index < length) {
+    index = text.indexOf(']', index);
+    if (index == -1) {
+      return -1;
+    }
 
-  while (start_index >= 0) {
-    int end_index = comment_end_pattern.indexIn(text, start_index);
-    int comment_length;
-    if (end_index == -1) {
-      setCurrentBlockState(1);
-      comment_length = text.length() - start_index;
-    } else {
-      comment_length = end_index - start_index
-          + comment_end_pattern.matchedLength();
+    int end = index + 1;
+    while (end < length && text.at(end) == '=') {
+      ++end;
+    }
+    if (end < length && end - index - 1 == level && text.at(end) == ']') {
+      return end + 1;
     }
-    setFormat(start_index, comment_length, multi_line_comment_format);
-    start_index = comment_start_pattern.indexIn(text, start_index + comment_length);
+    ++index;
+  }
+  return -1;
+}
+
+/**
+ * @brief Highlights a long string or a long comment.
+ *
+ * If it is not closed in this block, the block state is set so that
+ * the next block continues it.
+ *
+ * @param text The text of the block.
+ * @param index Where the token starts: its opening bracket, or the
+ * start of the block if it comes from the previous one.
+ * @param kind Long string or long comment.
+ * @param level Number of equal signs of its brackets.
+ * @return The index just after the token, or -1 if the token is not
+ * closed in this block.
+ */
+int LuaSyntaxHighlighter::highlight_long_bracket(
+    const QString& text, int index, LongBracketKind kind, int level) {
+
+  const QTextCharFormat& format = kind == LONG_COMMENT ?
+        multi_line_comment_format : string_format;
+
+  const int end = find_long_bracket_end(text, index, level);
+  if (end == -1) {
+    setFormat(index, text.length() - index, format);
+    setCurrentBlockState(get_block_state(kind, level));
+    return -1;
   }
+
+  setFormat(index, end - index, format);
+  return end;
 }
 
 }
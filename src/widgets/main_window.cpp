@@ -19,9 +19,11 @@
 #include "widgets/editor.h"
 #include "widgets/enum_menus.h"
 #include "widgets/external_script_dialog.h"
+#include "widgets/find_in_quest_dialog.h"
 #include "widgets/gui_tools.h"
 #include "widgets/main_window.h"
 #include "widgets/pair_spin_box.h"
+#include "widgets/text_editor.h"
 #include "audio.h"
 #include "file_tools.h"
 #include "map_model.h"
@@ -30,6 +32,7 @@
 #include "obsolete_quest_exception.h"
 #include "quest.h"
 #include "refactoring.h"
+#include "refactoring_engine.h"
 #include "version.h"
 #include <solarus/gui/quest_runner.h>
 #include <QActionGroup>
@@ -188,6 +191,7 @@ MainWindow::MainWindow(QWidget* parent) :
   addAction(ui.action_select_all);
   addAction(ui.action_unselect_all);
   addAction(ui.action_find);
+  addAction(ui.action_find_in_quest);
   addAction(ui.action_save_all);
   addAction(ui.action_close_all);
   addAction(ui.action_open_quest_properties);
@@ -565,6 +569,7 @@ void MainWindow::close_quest() {
   quest.set_root_path("");
   update_title();
   ui.action_run_quest->setEnabled(false);
+  ui.action_find_in_quest->setEnabled(false);
   ui.quest_tree_view->set_quest(quest);
 
   EditorSettings settings;
@@ -646,6 +651,11 @@ bool MainWindow::open_quest(const QString& quest_path) {
   if (!success) {
     quest.set_root_path("");
   }
+  else {
+    // Index text files in the background for "Find in quest".
+    quest.get_search_index().build();
+  }
+  ui.action_find_in_quest->setEnabled(success);
 
   update_title();
   ui.quest_tree_view->set_quest(quest);
@@ -937,6 +947,26 @@ void MainWindow::on_action_find_triggered() {
   }
 }
 
+/**
+ * @brief Slot called when the user triggers the "Find in quest" action.
+ */
+void MainWindow::on_action_find_in_quest_triggered() {
+
+  if (!quest.exists()) {
+    return;
+  }
+
+  FindInQuestDialog* dialog = new FindInQuestDialog(quest, this);
+  dialog->setAttribute(Qt::WA_DeleteOnClose);
+
+  connect(dialog, SIGNAL(open_file_requested(QString, int)),
+          this, SLOT(open_file_at_line_requested(QString, int)));
+
+  dialog->show();
+  dialog->raise();  // Put the dialog on top.
+  dialog->activateWindow();
+}
+
 /**
  * @brief Slot called when the user triggers the "Run quest" action.
  */
@@ -1793,6 +1823,25 @@ void MainWindow::rename_file_requested(Quest& quest, const QString& path) {
 
 }
 
+/**
+ * @brief Slot called when the user wants to open a file at a specific line.
+ * @param path The file to open.
+ * @param line The line to show, starting at 1, or 0 to keep the position.
+ */
+void MainWindow::open_file_at_line_requested(const QString& path, int line) {
+
+  open_file(quest, path);
+
+  if (line <= 0) {
+    return;
+  }
+
+  TextEditor* editor = qobject_cast<TextEditor*>(get_current_editor());
+  if (editor != nullptr && editor->get_file_path() == path) {
+    editor->go_to_line(line);
+  }
+}
+
 /**
  * @brief Slot called when the user wants to perform some refactoring.
  *
@@ -1853,56 +1902,60 @@ void MainWindow::refactoring_requested(const Refactoring& refactoring) {
 }
 
 /**
- * @brief Changes the id of a map and updates teletransporters leading to it.
- * @param map_id_before Current map id.
- * @param map_id_after New map id.
- */
-void MainWindow::refactor_map_id(const QString& map_id_before, const QString& map_id_after) {
-
+ * @brief Changes the id of a resource element and updates maps referring to it.
+ *
+ * Maps are not loaded: the appropriate field is replaced textually
+ * in their data files.
+ *
+ * @param resource_type Type of resource.
+ * @param field Name of the entity or map field that refers to the element.
+ * @param id_before Current id of the element.
+ * @param id_after New id of the element.
+ */
+void MainWindow::refactor_resource_id_in_maps(
+    ResourceType resource_type,
+    const QString& field,
+    const QString& id_before,
+    const QString& id_after
+) {
   Refactoring refactoring([=]() {
 
+    // Find the maps to update before changing anything.
+    QString pattern = QString("\n  %1 = \"?%2\"?,\n").arg(
+          field, QRegularExpression::escape(id_before));
+    QString replacement = QString("\n  %1 = \"%2\",\n").arg(field, id_after);
+    RefactoringEngine engine(QRegularExpression(pattern), replacement);
+    engine.add_prefilter(id_before);
+    if (!engine.scan_maps(quest, this)) {
+      // Canceled.
+      return QStringList();
+    }
+
     // Change the id.
-    quest.rename_resource_element(ResourceType::MAP, map_id_before, map_id_after);
-
-    // Update teletransporters in all maps.
-    QStringList modified_paths;
-    const QStringList& map_ids = quest.get_resources().get_elements(ResourceType::MAP);
-    for (const QString& map_id : map_ids) {
-      if (update_destination_map_in_map(map_id, map_id_before, map_id_after)) {
-        modified_paths << quest.get_map_data_file_path(map_id);
-      }
+    quest.rename_resource_element(resource_type, id_before, id_after);
+
+    if (resource_type == ResourceType::MAP) {
+      // The renamed map may itself refer to its old id.
+      engine.rename_pending_file(
+            quest.get_map_data_file_path(id_before),
+            quest.get_map_data_file_path(id_after));
     }
-    return modified_paths;
+
+    // Update maps.
+    return engine.commit();
   });
 
   refactoring_requested(refactoring);
 }
 
 /**
- * @brief Updates existing teletransporters in a map when a map id was changed.
- * @param map_id Id of the map to update.
- * @param map_id_before Id of the map that has changed.
- * @param map_id_after New id of the changed map.
- * @return @c true if there was a change.
- * @throws EditorException In case of error.
+ * @brief Changes the id of a map and updates teletransporters leading to it.
+ * @param map_id_before Current map id.
+ * @param map_id_after New map id.
  */
-bool MainWindow::update_destination_map_in_map(
-    const QString& map_id,
-    const QString& map_id_before,
-    const QString& map_id_after
-) {
-  // We don't load the entire map with all its entities for performance.
-  // Instead, we just find and replace the appropriate text in the map
-  // data file.
-
-  QString path = get_quest().get_map_data_file_path(map_id);
-
-  QString pattern = QString("\n  destination_map = \"?%1\"?,\n").arg(
-        QRegularExpression::escape(map_id_before));
-
-  QString replacement = QString("\n  destination_map = \"%1\",\n").arg(map_id_after);
+void MainWindow::refactor_map_id(const QString& map_id_before, const QString& map_id_after) {
 
-  return FileTools::replace_in_file(path, QRegularExpression(pattern), replacement);
+  refactor_resource_id_in_maps(ResourceType::MAP, "destination_map", map_id_before, map_id_after);
 }
 
 /**
@@ -1912,50 +1965,7 @@ bool MainWindow::update_destination_map_in_map(
  */
 void MainWindow::refactor_tileset_id(const QString& tileset_id_before, const QString& tileset_id_after) {
 
-  Refactoring refactoring([=]() {
-
-    // Change the id.
-    quest.rename_resource_element(ResourceType::TILESET, tileset_id_before, tileset_id_after);
-
-    // Update all maps.
-    QStringList modified_paths;
-    const QStringList& map_ids = quest.get_resources().get_elements(ResourceType::MAP);
-    for (const QString& map_id : map_ids) {
-      if (update_tileset_in_map(map_id, tileset_id_before, tileset_id_after)) {
-        modified_paths << quest.get_map_data_file_path(map_id);
-      }
-    }
-    return modified_paths;
-  });
-
-  refactoring_requested(refactoring);
-}
-
-/**
- * @brief Updates the tileset id in a map file.
- * @param map_id Id of the map to update.
- * @param tileset_id_before Id of the tileset that has changed.
- * @param tileset_id_after New id of the changed tileset.
- * @return @c true if there was a change.
- * @throws EditorException In case of error.
- */
-bool MainWindow::update_tileset_in_map(
-    const QString& map_id,
-    const QString& tileset_id_before,
-    const QString& tileset_id_after
-) {
-  // We don't load the entire map with all its entities for performance.
-  // Instead, we just find and replace the appropriate text in the map
-  // data file.
-
-  QString path = get_quest().get_map_data_file_path(map_id);
-
-  QString pattern = QString("\n  tileset = \"?%1\"?,\n").arg(
-        QRegularExpression::escape(tileset_id_before));
-
-  QString replacement = QString("\n  tileset = \"%1\",\n").arg(tileset_id_after);
-
-  return FileTools::replace_in_file(path, QRegularExpression(pattern), replacement);
+  refactor_resource_id_in_maps(ResourceType::TILESET, "tileset", tileset_id_before, tileset_id_after);
 }
 
 /**
@@ -1965,50 +1975,7 @@ bool MainWindow::update_tileset_in_map(
  */
 void MainWindow::refactor_music_id(const QString& music_id_before, const QString& music_id_after) {
 
-  Refactoring refactoring([=]() {
-
-    // Change the id.
-    quest.rename_resource_element(ResourceType::MUSIC, music_id_before, music_id_after);
-
-    // Update all maps.
-    QStringList modified_paths;
-    const QStringList& map_ids = quest.get_resources().get_elements(ResourceType::MAP);
-    for (const QString& map_id : map_ids) {
-      if (update_music_in_map(map_id, music_id_before, music_id_after)) {
-        modified_paths << quest.get_map_data_file_path(map_id);
-      }
-    }
-    return modified_paths;
-  });
-
-  refactoring_requested(refactoring);
-}
-
-/**
- * @brief Updates the music id in a map file.
- * @param map_id Id of the map to update.
- * @param music_id_before Id of the music that has changed.
- * @param music_id_after New id of the changed music.
- * @return @c true if there was a change.
- * @throws EditorException In case of error.
- */
-bool MainWindow::update_music_in_map(
-    const QString& map_id,
-    const QString& music_id_before,
-    const QString& music_id_after
-) {
-  // We don't load the entire map with all its entities for performance.
-  // Instead, we just find and replace the appropriate text in the map
-  // data file.
-
-  QString path = get_quest().get_map_data_file_path(map_id);
-
-  QString pattern = QString("\n  music = \"?%1\"?,\n").arg(
-        QRegularExpression::escape(music_id_before));
-
-  QString replacement = QString("\n  music = \"%1\",\n").arg(music_id_after);
-
-  return FileTools::replace_in_file(path, QRegularExpression(pattern), replacement);
+  refactor_resource_id_in_maps(ResourceType::MUSIC, "music", music_id_before, music_id_after);
 }
 
 /**
@@ -2018,50 +1985,7 @@ bool MainWindow::update_music_in_map(
  */
 void MainWindow::refactor_enemy_id(const QString& enemy_id_before, const QString& enemy_id_after) {
 
-  Refactoring refactoring([=]() {
-
-    // Change the id.
-    quest.rename_resource_element(ResourceType::ENEMY, enemy_id_before, enemy_id_after);
-
-    // Update enemies in all maps.
-    QStringList modified_paths;
-    const QStringList& map_ids = quest.get_resources().get_elements(ResourceType::MAP);
-    for (const QString& map_id : map_ids) {
-      if (update_enemy_breed_in_map(map_id, enemy_id_before, enemy_id_after)) {
-        modified_paths << quest.get_map_data_file_path(map_id);
-      }
-    }
-    return modified_paths;
-  });
-
-  refactoring_requested(refactoring);
-}
-
-/**
- * @brief Updates existing enemies in a map when an enemy breed id was changed.
- * @param map_id Id of the map to update.
- * @param enemy_id_before Id of the enemy breed that has changed.
- * @param enemy_id_after New id of the enemy breed.
- * @return @c true if there was a change.
- * @throws EditorException In case of error.
- */
-bool MainWindow::update_enemy_breed_in_map(
-    const QString& map_id,
-    const QString& enemy_id_before,
-    const QString& enemy_id_after
-) {
-  // We don't load the entire map with all its entities for performance.
-  // Instead, we just find and replace the appropriate text in the map
-  // data file.
-
-  QString path = get_quest().get_map_data_file_path(map_id);
-
-  QString pattern = QString("\n  breed = \"?%1\"?,\n").arg(
-        QRegularExpression::escape(enemy_id_before));
-
-  QString replacement = QString("\n  breed = \"%1\",\n").arg(enemy_id_after);
-
-  return FileTools::replace_in_file(path, QRegularExpression(pattern), replacement);
+  refactor_resource_id_in_maps(ResourceType::ENEMY, "breed", enemy_id_before, enemy_id_after);
 }
 
 /**
@@ -2071,50 +1995,7 @@ bool MainWindow::update_enemy_breed_in_map(
  */
 void MainWindow::refactor_custom_entity_id(const QString& entity_id_before, const QString& entity_id_after) {
 
-  Refactoring refactoring([=]() {
-
-    // Change the id.
-    quest.rename_resource_element(ResourceType::ENTITY, entity_id_before, entity_id_after);
-
-    // Update enemies in all maps.
-    QStringList modified_paths;
-    const QStringList& map_ids = quest.get_resources().get_elements(ResourceType::MAP);
-    for (const QString& map_id : map_ids) {
-      if (update_custom_entity_model_in_map(map_id, entity_id_before, entity_id_after)) {
-        modified_paths << quest.get_map_data_file_path(map_id);
-      }
-    }
-    return modified_paths;
-  });
-
-  refactoring_requested(refactoring);
-}
-
-/**
- * @brief Updates existing enemies in a map when an custom entity model id was changed.
- * @param map_id Id of the map to update.
- * @param entity_id_before Id of the custom entity model that has changed.
- * @param entity_id_after New id of the custom entity model.
- * @return @c true if there was a change.
- * @throws EditorException In case of error.
- */
-bool MainWindow::update_custom_entity_model_in_map(
-    const QString& map_id,
-    const QString& entity_id_before,
-    const QString& entity_id_after
-) {
-  // We don't load the entire map with all its entities for performance.
-  // Instead, we just find and replace the appropriate text in the map
-  // data file.
-
-  QString path = get_quest().get_map_data_file_path(map_id);
-
-  QString pattern = QString("\n  model = \"?%1\"?,\n").arg(
-        QRegularExpression::escape(entity_id_before));
-
-  QString replacement = QString("\n  model = \"%1\",\n").arg(entity_id_after);
-
-  return FileTools::replace_in_file(path, QRegularExpression(pattern), replacement);
+  refactor_resource_id_in_maps(ResourceType::ENTITY, "model", entity_id_before, entity_id_after);
 }
 
 }
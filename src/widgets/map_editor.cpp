@@ -25,15 +25,18 @@
 #include "audio.h"
 #include "editor_exception.h"
 #include "editor_settings.h"
-#include "file_tools.h"
+#include "entity_clipboard.h"
 #include "map_model.h"
 #include "point.h"
 #include "quest.h"
 #include "quest_resources.h"
 #include "refactoring.h"
+#include "refactoring_engine.h"
+#include "sized_undo_command.h"
 #include "tileset_model.h"
 #include "view_settings.h"
 #include <QItemSelectionModel>
+#include <QLabel>
 #include <QMessageBox>
 #include <QStatusBar>
 #include <QToolBar>
@@ -47,15 +50,63 @@ namespace {
 constexpr int move_entities_command_id = 1;
 constexpr int resize_entities_command_id = 2;
 
+/**
+ * @brief Entities kept by a command while they are not on the map.
+ *
+ * Entity models can hold images and sprites, so removed entities
+ * are stored in the binary clipboard format instead,
+ * and their models are created again when they are restored.
+ * Restoring throws an EditorException if the data cannot be decoded.
+ */
+class StoredEntities {
+
+public:
+
+  void store(AddableEntities&& entities) {
+    indexes.clear();
+    for (const AddableEntity& entity : entities) {
+      indexes.append(entity.index);
+    }
+    data = EntityClipboard::entities_to_binary(entities);
+  }
+
+  AddableEntities restore(MapModel& map) {
+    if (indexes.isEmpty()) {
+      return AddableEntities();
+    }
+    EntityModels entity_models = EntityClipboard::create_entities_from_binary(map, data);
+    if (static_cast<int>(entity_models.size()) != indexes.size()) {
+      // Keep the data: nothing is restored.
+      throw EditorException(MapEditor::tr("Failed to restore %1 entities").arg(indexes.size()));
+    }
+
+    AddableEntities entities;
+    for (int i = 0; i < indexes.size(); ++i) {
+      entities.emplace_back(std::move(entity_models[i]), indexes[i]);
+    }
+    data.clear();
+    indexes.clear();
+    return entities;
+  }
+
+  qint64 get_memory_size() const {
+    return data.capacity() + indexes.size() * static_cast<qint64>(sizeof(EntityIndex));
+  }
+
+private:
+  QByteArray data;        // Entities in the binary clipboard format.
+  EntityIndexes indexes;  // Index of each entity (sorted).
+};
+
 /**
  * @brief Parent class of all undoable commands of the map editor.
  */
-class MapEditorCommand : public QUndoCommand {
+class MapEditorCommand : public SizedUndoCommand {
 
 public:
 
   MapEditorCommand(MapEditor& editor, const QString& text) :
-    QUndoCommand(text),
+    SizedUndoCommand(text),
     editor(editor) {
   }
 
@@ -114,17 +165,21 @@ public:
   void undo() override {
     get_map().set_min_layer(min_layer_before);
     // Restore entities.
-    get_map().add_entities(std::move(entities_removed));
+    get_map().add_entities(entities_removed.restore(get_map()));
   }
 
   void redo() override {
-    entities_removed = get_map().set_min_layer(min_layer_after);
+    entities_removed.store(get_map().set_min_layer(min_layer_after));
+  }
+
+  qint64 get_memory_size() const override {
+    return sizeof(*this) + entities_removed.get_memory_size();
   }
 
 private:
   int min_layer_before;
   int min_layer_after;
-  AddableEntities entities_removed;  // Entities that were on removed layers.
+  StoredEntities entities_removed;  // Entities that were on removed layers.
 };
 
 /**
@@ -142,17 +197,21 @@ public:
   void undo() override {
     get_map().set_max_layer(max_layer_before);
     // Restore entities.
-    get_map().add_entities(std::move(entities_removed));
+    get_map().add_entities(entities_removed.restore(get_map()));
   }
 
   void redo() override {
-    entities_removed = get_map().set_max_layer(max_layer_after);
+    entities_removed.store(get_map().set_max_layer(max_layer_after));
+  }
+
+  qint64 get_memory_size() const override {
+    return sizeof(*this) + entities_removed.get_memory_size();
   }
 
 private:
   int max_layer_before;
   int max_layer_after;
-  AddableEntities entities_removed;  // Entities that were on removed layers.
+  StoredEntities entities_removed;  // Entities that were on removed layers.
 };
 
 /**
@@ -343,17 +402,13 @@ public:
     allow_merge_to_previous(allow_merge_to_previous) { }
 
   void undo() override {
-    for (const EntityIndex& index : indexes) {
-      get_map().add_entity_xy(index, -translation);
-    }
+    get_map().add_entities_xy(indexes, -translation);
     // Select impacted entities.
     get_map_view().set_selected_entities(indexes);
   }
 
   void redo() override {
-    for (const EntityIndex& index : indexes) {
-      get_map().add_entity_xy(index, translation);
-    }
+    get_map().add_entities_xy(indexes, translation);
     // Select impacted entities.
     get_map_view().set_selected_entities(indexes);
   }
@@ -405,20 +460,15 @@ public:
 
   void undo() override {
 
-    EntityIndexes indexes;
-    for (auto it = boxes_before.begin(); it != boxes_before.end(); ++it) {
-      const EntityIndex& index = it.key();
-      get_map().set_entity_bounding_box(index, it.value());
-      indexes.append(index);
-    }
+    get_map().set_entities_bounding_box(boxes_before);
 
     // Select impacted entities.
-    get_map_view().set_selected_entities(indexes);
+    get_map_view().set_selected_entities(boxes_before.keys());
   }
 
   void redo() override {
 
-    EntityIndexes indexes;
+    QMap<EntityIndex, QRect> boxes;
     for (auto it = boxes_after.begin(); it != boxes_after.end(); ++it) {
       const EntityIndex& index = it.key();
       QRect box_after = it.value();
@@ -427,12 +477,12 @@ public:
         // Invalid size: refuse the change.
         box_after.setSize(boxes_before.value(index).size());
       }
-      get_map().set_entity_bounding_box(index, it.value());
-      indexes.append(index);
+      boxes.insert(index, box_after);
     }
+    get_map().set_entities_bounding_box(boxes);
 
     // Select impacted entities.
-    get_map_view().set_selected_entities(indexes);
+    get_map_view().set_selected_entities(boxes.keys());
   }
 
   int id() const override {
@@ -479,10 +529,15 @@ public:
 
   void undo() override {
     get_map().remove_entities(indexes_after);
-    get_map().add_entities(std::move(removed_tiles));
+    get_map().add_entities(removed_tiles.restore(get_map()));
     get_map_view().set_selected_entities(indexes_before);
   }
 
+  qint64 get_memory_size() const override {
+    return sizeof(*this) + removed_tiles.get_memory_size() +
+        (indexes_before.size() + indexes_after.size()) * static_cast<qint64>(sizeof(EntityIndex));
+  }
+
   void redo() override {
     MapModel& map = get_map();
     AddableEntities dynamic_tiles;
@@ -496,7 +551,7 @@ public:
     }
 
     // Remove the static ones.
-    removed_tiles = map.remove_entities(indexes_before);
+    removed_tiles.store(map.remove_entities(indexes_before));
 
     // Determine the indexes where to place the dynamic ones.
     indexes_after.clear();
@@ -518,7 +573,7 @@ public:
 private:
   EntityIndexes indexes_before;
   EntityIndexes indexes_after;
-  AddableEntities removed_tiles;
+  StoredEntities removed_tiles;
 };
 
 /**
@@ -536,10 +591,15 @@ public:
 
   void undo() override {
     get_map().remove_entities(indexes_after);
-    get_map().add_entities(std::move(removed_tiles));
+    get_map().add_entities(removed_tiles.restore(get_map()));
     get_map_view().set_selected_entities(indexes_before);
   }
 
+  qint64 get_memory_size() const override {
+    return sizeof(*this) + removed_tiles.get_memory_size() +
+        (indexes_before.size() + indexes_after.size()) * static_cast<qint64>(sizeof(EntityIndex));
+  }
+
   void redo() override {
     MapModel& map = get_map();
     AddableEntities tiles;
@@ -553,7 +613,7 @@ public:
     }
 
     // Remove the dynamic ones.
-    removed_tiles = map.remove_entities(indexes_before);
+    removed_tiles.store(map.remove_entities(indexes_before));
 
     // Determine the indexes where to place the dynamic ones.
     indexes_after.clear();
@@ -575,7 +635,7 @@ public:
 private:
   EntityIndexes indexes_before;
   EntityIndexes indexes_after;
-  AddableEntities removed_tiles;
+  StoredEntities removed_tiles;
 };
 
 /**
@@ -605,25 +665,33 @@ public:
 
   void undo() override {
     MapModel& map = get_map();
-    int i = 0;
-    for (const EntityIndex& index : indexes) {
-      map.set_entity_field(index, "pattern", pattern_ids_before[i]);
-      map.set_entity_size(index, sizes_before[i]);
-      ++i;
+
+    // Tiles usually had only a few different patterns.
+    QMap<QString, EntityIndexes> indexes_by_pattern;
+    QMap<EntityIndex, QSize> sizes;
+    for (int i = 0; i < indexes.size(); ++i) {
+      indexes_by_pattern[pattern_ids_before[i]].append(indexes[i]);
+      sizes.insert(indexes[i], sizes_before[i]);
+    }
+    for (auto it = indexes_by_pattern.begin(); it != indexes_by_pattern.end(); ++it) {
+      map.set_entities_field(it.value(), "pattern", it.key());
     }
+    map.set_entities_size(sizes);
     get_map_view().set_selected_entities(indexes);
     get_map_view().get_scene()->redraw_entities(indexes);
   }
 
   void redo() override {
     MapModel& map = get_map();
+    map.set_entities_field(indexes, "pattern", pattern_id_after);
+    QMap<EntityIndex, QSize> sizes;
     for (const EntityIndex& index : indexes) {
-      map.set_entity_field(index, "pattern", pattern_id_after);
       const QSize& size = map.get_entity_closest_base_size_multiple(index);
       if (map.is_entity_size_valid(index, size)) {
-        map.set_entity_size(index, size);
+        sizes.insert(index, size);
       }
     }
+    map.set_entities_size(sizes);
     get_map_view().set_selected_entities(indexes);
     get_map_view().get_scene()->redraw_entities(indexes);
   }
@@ -651,12 +719,18 @@ public:
   }
 
   void undo() override {
-    int i = 0;
-    for (const EntityIndex& index : indexes) {
-      get_map().set_entity_direction(index, directions_before.at(i));
-      get_map().set_entity_size(index, sizes_before.at(i));
-      ++i;
+    MapModel& map = get_map();
+
+    QMap<int, EntityIndexes> indexes_by_direction;
+    QMap<EntityIndex, QSize> sizes;
+    for (int i = 0; i < indexes.size(); ++i) {
+      indexes_by_direction[directions_before.at(i)].append(indexes[i]);
+      sizes.insert(indexes[i], sizes_before.at(i));
+    }
+    for (auto it = indexes_by_direction.begin(); it != indexes_by_direction.end(); ++it) {
+      map.set_entities_direction(it.value(), it.key());
     }
+    map.set_entities_size(sizes);
     get_map_view().set_selected_entities(indexes);
     get_map_view().get_scene()->redraw_entities(indexes);
   }
@@ -668,20 +742,26 @@ public:
     // Change the direction.
     directions_before.clear();
     sizes_before.clear();
+    QList<bool> were_sizes_valid;
     for (const EntityIndex& index : indexes) {
-      bool was_size_valid = map.is_entity_size_valid(index);
+      were_sizes_valid.append(map.is_entity_size_valid(index));
       directions_before.append(map.get_entity_direction(index));
       sizes_before.append(map.get_entity_size(index));
-
-      map.set_entity_direction(index, direction_after);
-
-      // Check that the size is still okay in the new direction.
-      if (was_size_valid && !map.is_entity_size_valid(index)) {
-        // The entity size is no longer valid in the new direction:
-        // set a new size right now if there is only one entity selected.
-        map.set_entity_size(index, map.get_entity_valid_size(index));
+    }
+    map.set_entities_direction(indexes, direction_after);
+
+    // Check that the sizes are still okay in the new direction.
+    QMap<EntityIndex, QSize> sizes;
+    for (int i = 0; i < indexes.size(); ++i) {
+      const EntityIndex& index = indexes[i];
+      if (were_sizes_valid.at(i) && !map.is_entity_size_valid(index)) {
+        // The entity size is no longer valid in the new direction.
+        sizes.insert(index, map.get_entity_valid_size(index));
       }
+    }
+    map.set_entities_size(sizes);
 
+    for (const EntityIndex& index : indexes) {
       map.get_entity(index).reload_sprite();
     }
 
@@ -958,12 +1038,15 @@ public:
 
   void undo() override {
     // Remove entities that were added, keep them in this class.
-    entities = get_map().remove_entities(indexes);
+    stored_entities.store(get_map().remove_entities(indexes));
     get_map_view().set_selected_entities(previous_selected_indexes);
   }
 
   void redo() override {
     // Add entities and make them selected.
+    if (entities.empty()) {
+      entities = stored_entities.restore(get_map());
+    }
     get_map().add_entities(std::move(entities));
 
     EntityIndexes selected_indexes = indexes;
@@ -973,8 +1056,14 @@ public:
     get_map_view().set_selected_entities(selected_indexes);
   }
 
+  qint64 get_memory_size() const override {
+    return sizeof(*this) + stored_entities.get_memory_size() +
+        (indexes.size() + previous_selected_indexes.size()) * static_cast<qint64>(sizeof(EntityIndex));
+  }
+
 private:
-  AddableEntities entities;    // Entities to be added and where (sorted).
+  AddableEntities entities;    // Entities to be added and where (sorted), until the first redo.
+  StoredEntities stored_entities;  // Entities removed by undo.
   EntityIndexes indexes;  // Indexes where they should be added (redundant info).
   EntityIndexes previous_selected_indexes;  // Selection to keep after adding entities.
 };
@@ -995,20 +1084,71 @@ public:
 
   void undo() override {
     // Restore entities with their old index.
-    get_map().add_entities(std::move(entities));
+    get_map().add_entities(entities.restore(get_map()));
     get_map_view().set_selected_entities(indexes);
   }
 
   void redo() override {
     // Remove entities from the map, keep them and their index in this class.
-    entities = get_map().remove_entities(indexes);
+    entities.store(get_map().remove_entities(indexes));
+  }
+
+  qint64 get_memory_size() const override {
+    return sizeof(*this) + entities.get_memory_size() +
+        indexes.size() * static_cast<qint64>(sizeof(EntityIndex));
   }
 
 private:
-  AddableEntities entities;    // Entities to remove and their indexes before removal (sorted).
+  StoredEntities entities;     // Entities to remove and their indexes before removal (sorted).
   EntityIndexes indexes;  // Indexes before removal (redundant info).
 };
 
+/**
+ * @brief Replacing border tiles after an automatic border update.
+ */
+class ReplaceBorderTilesCommand : public MapEditorCommand {
+
+public:
+  ReplaceBorderTilesCommand(MapEditor& editor, const EntityIndexes& tiles_to_remove, AddableEntities&& tiles_to_add) :
+    MapEditorCommand(editor, MapEditor::tr("Update borders")),
+    removed_tiles(),
+    removed_indexes(tiles_to_remove),
+    added_tiles(std::move(tiles_to_add)),
+    added_indexes() {
+
+    std::sort(removed_indexes.begin(), removed_indexes.end());
+    std::sort(added_tiles.begin(), added_tiles.end());
+    for (const AddableEntity& tile : added_tiles) {
+      added_indexes.append(tile.index);
+    }
+  }
+
+  void undo() override {
+    stored_added_tiles.store(get_map().remove_entities(added_indexes));
+    get_map().add_entities(removed_tiles.restore(get_map()));
+  }
+
+  void redo() override {
+    removed_tiles.store(get_map().remove_entities(removed_indexes));
+    if (added_tiles.empty()) {
+      added_tiles = stored_added_tiles.restore(get_map());
+    }
+    get_map().add_entities(std::move(added_tiles));
+  }
+
+  qint64 get_memory_size() const override {
+    return sizeof(*this) + removed_tiles.get_memory_size() + stored_added_tiles.get_memory_size() +
+        (removed_indexes.size() + added_indexes.size()) * static_cast<qint64>(sizeof(EntityIndex));
+  }
+
+private:
+  StoredEntities removed_tiles;     // Obsolete border tiles and their indexes before removal (sorted).
+  EntityIndexes removed_indexes;    // Indexes of obsolete border tiles (redundant info).
+  AddableEntities added_tiles;      // New border tiles and where (sorted), until the first redo.
+  StoredEntities stored_added_tiles;  // New border tiles removed by undo.
+  EntityIndexes added_indexes;      // Indexes of new border tiles (redundant info).
+};
+
 }  // Anonymous namespace.
 
 /**
@@ -1023,7 +1163,8 @@ MapEditor::MapEditor(Quest& quest, const QString& path, QWidget* parent) :
   map_id(),
   map(nullptr),
   entity_creation_toolbar(nullptr),
-  status_bar(nullptr) {
+  status_bar(nullptr),
+  undo_memory_label(nullptr) {
 
   ui.setupUi(this);
   build_entity_creation_toolbar();
@@ -1136,6 +1277,8 @@ MapEditor::MapEditor(Quest& quest, const QString& path, QWidget* parent) :
           this, SLOT(tileset_selector_activated()));
   connect(map, SIGNAL(tileset_id_changed(QString)),
           this, SLOT(tileset_id_changed(QString)));
+  connect(map, SIGNAL(tileset_reloaded()),
+          this, SLOT(update_tileset_view()));
   connect(ui.tileset_refresh_button, SIGNAL(clicked()),
           this, SLOT(refresh_tileset_requested()));
   connect(ui.tileset_edit_button, SIGNAL(clicked()),
@@ -1146,6 +1289,9 @@ MapEditor::MapEditor(Quest& quest, const QString& path, QWidget* parent) :
   connect(map, SIGNAL(music_id_changed(QString)),
           this, SLOT(update_music_field()));
 
+  connect(map, SIGNAL(save_failed(QString)),
+          this, SLOT(map_save_failed(QString)));
+
   connect(ui.current_border_sets_selector, SIGNAL(activated(QString)),
           this, SLOT(border_set_selector_activated()));
 
@@ -1178,6 +1324,8 @@ MapEditor::MapEditor(Quest& quest, const QString& path, QWidget* parent) :
           this, SLOT(add_entities_requested(AddableEntities&, bool)));
   connect(ui.map_view, SIGNAL(remove_entities_requested(EntityIndexes)),
           this, SLOT(remove_entities_requested(EntityIndexes)));
+  connect(ui.map_view, SIGNAL(replace_border_tiles_requested(EntityIndexes, AddableEntities&)),
+          this, SLOT(replace_border_tiles_requested(EntityIndexes, AddableEntities&)));
   connect(ui.map_view, SIGNAL(stopped_state()),
           this, SLOT(uncheck_entity_creation_buttons()));
   connect(ui.map_view, SIGNAL(undo_requested()),
@@ -1273,14 +1421,38 @@ void MapEditor::build_status_bar() {
           this, SLOT(update_status_bar()));
   connect(ui.map_view, SIGNAL(mouse_left()),
           this, SLOT(update_status_bar()));
+
+  undo_memory_label = new QLabel();
+  status_bar->addPermanentWidget(undo_memory_label);
+  update_undo_memory_label(get_undo_memory_size());
+  connect(this, SIGNAL(undo_memory_size_changed(qint64)),
+          this, SLOT(update_undo_memory_label(qint64)));
 }
 
 /**
  * @copydoc Editor::save
+ *
+ * The map file is written in a worker thread.
  */
 void MapEditor::save() {
 
-  map->save();
+  map->start_save();
+}
+
+/**
+ * @copydoc Editor::wait_for_save
+ */
+void MapEditor::wait_for_save() {
+
+  map->wait_for_save();
+}
+
+/**
+ * @copydoc Editor::is_saving
+ */
+bool MapEditor::is_saving() const {
+
+  return map->is_saving();
 }
 
 /**
@@ -1750,7 +1922,13 @@ void MapEditor::tileset_selector_activated() {
 void MapEditor::refresh_tileset_requested() {
 
   // Refresh the map model.
-  get_map().reload_tileset();
+  try {
+    get_map().reload_tileset();
+  }
+  catch (const EditorException& ex) {
+    ex.show_dialog();
+    return;
+  }
 
   // Rebuild the tileset view.
   update_tileset_view();
@@ -1799,7 +1977,13 @@ void MapEditor::music_selector_activated() {
 void MapEditor::update_tileset_view() {
 
   TilesetModel* tileset = map->get_tileset_model();
-  ui.tileset_view->set_model(tileset);
+  TilesetSelectionModel* selection_model = map->get_tileset_selection_model();
+  if (ui.tileset_view->get_model() == tileset &&
+      ui.tileset_view->get_selection_model() == selection_model) {
+    // Same tileset model: the view already follows its changes.
+    return;
+  }
+  ui.tileset_view->set_model(tileset, selection_model);
 }
 
 /**
@@ -1880,7 +2064,8 @@ void MapEditor::map_selection_changed() {
 
   // Nofify the tileset view of selected tile patterns.
   TilesetModel* tileset = ui.tileset_view->get_model();
-  if (tileset != nullptr) {
+  TilesetSelectionModel* selection_model = ui.tileset_view->get_selection_model();
+  if (tileset != nullptr && selection_model != nullptr) {
     const EntityIndexes& entity_indexes = ui.map_view->get_selected_entities();
     MapModel& map = get_map();
     QList<int> pattern_indexes;
@@ -1890,7 +2075,7 @@ void MapEditor::map_selection_changed() {
         pattern_indexes << tileset->id_to_index(pattern_id);
       }
     }
-    tileset->set_selected_indexes(pattern_indexes);
+    selection_model->set_selected_indexes(pattern_indexes);
   }
 }
 
@@ -1908,8 +2093,17 @@ void MapEditor::refactor_destination_name(
 ) {
   Refactoring refactoring([=]() {
 
+    std::unique_ptr<QUndoCommand> command_ptr(command);
+
+    // Find teletransporters to update in other maps before changing anything.
+    RefactoringEngine engine = create_destination_name_refactoring(name_before, name_after);
+    if (!engine.scan_maps(get_quest(), this, map_id)) {
+      // Canceled.
+      return QStringList();
+    }
+
     // Perform the entity edition.
-    if (!try_command(command)) {
+    if (!try_command(command_ptr.release())) {
       return QStringList();
     }
 
@@ -1933,7 +2127,7 @@ void MapEditor::refactor_destination_name(
     get_undo_stack().clear();
 
     // Update teletransporters in all other maps.
-    return update_destination_name_in_other_maps(name_before, name_after);
+    return engine.commit();
   });
 
   refactoring.set_file_unsaved_allowed(get_file_path(), true);
@@ -1942,49 +2136,21 @@ void MapEditor::refactor_destination_name(
 }
 
 /**
- * @brief Updates existing teletransporters in other maps when a destination
- * of this map is renamed.
- * @param name_before The old destination name.
- * @param name_after The new destination name.
- * @return The list of files that were modified.
- * @throws EditorException In case of error.
- */
-QStringList MapEditor::update_destination_name_in_other_maps(
-    const QString& name_before,
-    const QString& name_after
-) {
-  QStringList modified_paths;
-  const QStringList& map_ids = get_resources().get_elements(ResourceType::MAP);
-  for (const QString& map_id : map_ids) {
-    if (map_id != this->map_id) {
-      if (update_destination_name_in_map(map_id, name_before, name_after)) {
-        modified_paths << get_quest().get_map_data_file_path(map_id);
-      }
-    }
-  }
-  return modified_paths;
-}
-
-/**
- * @brief Updates existing teletransporters in a map when a destination
- * of this map is renamed.
- * @param map_id Id of the map to update.
+ * @brief Creates the refactoring that updates existing teletransporters
+ * in other maps when a destination of this map is renamed.
+ *
+ * We don't load the entire maps with all their entities for performance.
+ * Instead, we just find and replace the appropriate text in the map
+ * data files.
+ *
  * @param name_before The old destination name.
  * @param name_after The new destination name.
- * @return @c true if there was a change.
- * @throws EditorException In case of error.
+ * @return The refactoring engine, ready to scan maps.
  */
-bool MapEditor::update_destination_name_in_map(
-    const QString& map_id,
+RefactoringEngine MapEditor::create_destination_name_refactoring(
     const QString& name_before,
     const QString& name_after
-) {
-  // We don't load the entire map with all its entities for performance.
-  // Instead, we just find and replace the appropriate text in the map
-  // data file.
-
-  QString path = get_quest().get_map_data_file_path(map_id);
-
+) const {
   QString pattern = QString(
         "\n  destination_map = \"?%1\"?,\n"
         "  destination = \"%2\",\n").arg(
@@ -2002,7 +2168,9 @@ bool MapEditor::update_destination_name_in_map(
               this->map_id, name_after);
   }
 
-  return FileTools::replace_in_file(path, QRegularExpression(pattern), replacement);
+  RefactoringEngine engine(QRegularExpression(pattern), replacement);
+  engine.add_prefilter(QString("  destination = \"%1\",\n").arg(name_before));
+  return engine;
 }
 
 /**
@@ -2052,6 +2220,32 @@ void MapEditor::update_status_bar() {
   }
 }
 
+/**
+ * @brief Shows in the status bar the memory used by the undo/redo history.
+ * @param size The size in bytes.
+ */
+void MapEditor::update_undo_memory_label(qint64 size) {
+
+  if (undo_memory_label == nullptr) {
+    return;
+  }
+
+  undo_memory_label->setText(tr("Undo history: %1 KiB").arg((size + 1023) / 1024));
+}
+
+/**
+ * @brief Slot called when writing the map file failed in the background.
+ *
+ * The map is marked as modified again.
+ *
+ * @param message The error message.
+ */
+void MapEditor::map_save_failed(const QString& message) {
+
+  get_undo_stack().resetClean();
+  EditorException(message).show_dialog();
+}
+
 /**
  * @brief Slot called when the user wants to edit an entity.
  * @param index Index of the entity to change.
@@ -2310,6 +2504,25 @@ void MapEditor::remove_entities_requested(const EntityIndexes& indexes) {
   try_command(new RemoveEntitiesCommand(*this, indexes));
 }
 
+/**
+ * @brief Slot called when border tiles need to be updated after an edit.
+ *
+ * The update becomes part of the undo command of the edit.
+ *
+ * @param tiles_to_remove Indexes of obsolete border tiles.
+ * @param tiles_to_add New border tiles and their index once obsolete
+ * ones are removed.
+ */
+void MapEditor::replace_border_tiles_requested(const EntityIndexes& tiles_to_remove,
+                                               AddableEntities& tiles_to_add) {
+
+  if (tiles_to_remove.isEmpty() && tiles_to_add.empty()) {
+    return;
+  }
+
+  try_attached_command(new ReplaceBorderTilesCommand(*this, tiles_to_remove, std::move(tiles_to_add)));
+}
+
 /**
  * @brief This function is called when the user checks or unchecks a button of
  * the entity creation toolbar.
@@ -2326,9 +2539,9 @@ void MapEditor::entity_creation_button_triggered(EntityType type, bool checked)
     ui.map_view->start_state_adding_entities(std::move(entities), guess_layer);
 
     // Unselect patterns in the tileset.
-    TilesetModel* tileset = map->get_tileset_model();
-    if (tileset != nullptr) {
-      tileset->clear_selection();
+    TilesetSelectionModel* selection_model = map->get_tileset_selection_model();
+    if (selection_model != nullptr) {
+      selection_model->clear_selection();
     }
 
     // Uncheck other entity creation buttons.
@@ -15,10 +15,14 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "widgets/entity_item.h"
+#include "widgets/layer_tiles_item.h"
 #include "widgets/map_scene.h"
+#include "entities/tile.h"
 #include "map_model.h"
 #include "tileset_model.h"
 #include "view_settings.h"
+#include <QGraphicsView>
+#include <QHash>
 #include <QPainter>
 
 namespace SolarusEditor {
@@ -33,7 +37,16 @@ MapScene::MapScene(MapModel& map, QObject* parent) :
   map(map),
   entity_items(),
   layer_parent_items(),
-  view_settings(nullptr) {
+  layer_tiles_items(),
+  view_settings(nullptr),
+  animation_clock(),
+  animation_timer(),
+  animated_items() {
+
+  animation_clock.start();
+  animation_timer.setInterval(Tile::pattern_frame_delay);
+  connect(&animation_timer, SIGNAL(timeout()),
+          this, SLOT(update_animations()));
 
   build();
 
@@ -45,14 +58,26 @@ MapScene::MapScene(MapModel& map, QObject* parent) :
           this, SLOT(entities_added(EntityIndexes)));
   connect(&map, SIGNAL(entities_about_to_be_removed(EntityIndexes)),
           this, SLOT(entities_about_to_be_removed(EntityIndexes)));
-  connect(&map, SIGNAL(entity_layer_changed(EntityIndex, EntityIndex)),
-          this, SLOT(entity_layer_changed(EntityIndex, EntityIndex)));
+  connect(&map, SIGNAL(entities_layer_changed(EntityIndexes, EntityIndexes)),
+          this, SLOT(entities_layer_changed(EntityIndexes, EntityIndexes)));
   connect(&map, SIGNAL(entity_order_changed(EntityIndex, int)),
           this, SLOT(entity_order_changed(EntityIndex, int)));
   connect(&map, SIGNAL(entity_xy_changed(EntityIndex, QPoint)),
           this, SLOT(entity_xy_changed(EntityIndex, QPoint)));
+  connect(&map, SIGNAL(entities_xy_changed(EntityIndexes)),
+          this, SLOT(entities_xy_changed(EntityIndexes)));
   connect(&map, SIGNAL(entity_size_changed(EntityIndex, QSize)),
           this, SLOT(entity_size_changed(EntityIndex, QSize)));
+  connect(&map, SIGNAL(entities_size_changed(EntityIndexes)),
+          this, SLOT(entities_size_changed(EntityIndexes)));
+  connect(&map, SIGNAL(entity_field_changed(EntityIndex, QString, QVariant)),
+          this, SLOT(entity_field_changed(EntityIndex, QString, QVariant)));
+  connect(&map, SIGNAL(entities_field_changed(EntityIndexes, QString, QVariant)),
+          this, SLOT(entities_field_changed(EntityIndexes, QString, QVariant)));
+  connect(&map, SIGNAL(tileset_reloaded()),
+          this, SLOT(tileset_reloaded()));
+  connect(&map, SIGNAL(sprites_reloaded(EntityIndexes)),
+          this, SLOT(sprites_reloaded(EntityIndexes)));
 }
 
 /**
@@ -141,6 +166,9 @@ void MapScene::create_layer_parent_item(int layer) {
   layer_parent_items[layer]->setZValue(layer);
   addItem(layer_parent_items[layer]);
 
+  // Static tiles are drawn by a single item below entities of the layer.
+  layer_tiles_items[layer] = new LayerTilesItem(*this, layer, layer_parent_items[layer]);
+
 }
 
 /**
@@ -170,6 +198,8 @@ void MapScene::create_entity_item(EntityModel& entity) {
   if (view_settings != nullptr) {
     item->update_visibility(*view_settings);
   }
+
+  update_item_caching(*item);
 }
 
 /**
@@ -209,6 +239,218 @@ const MapScene::ByLayer<MapScene::EntityItems>& MapScene::get_entity_items() con
   return entity_items;
 }
 
+/**
+ * @brief Returns the area of the map currently covered by an entity item.
+ * @param item An entity item.
+ * @return Its position and size on the scene, in map coordinates.
+ */
+QRect MapScene::get_item_area(const EntityItem& item) {
+
+  return QRect(item.pos().toPoint() - get_margin_top_left(),
+               item.boundingRect().size().toSize());
+}
+
+/**
+ * @brief Redraws the static tiles under an entity item.
+ *
+ * Does nothing if the item does not represent a static tile.
+ *
+ * @param layer Layer whose tiles to redraw.
+ * @param item An entity item. Its current position and size on the scene
+ * give the area to redraw, even if the entity has already changed.
+ */
+void MapScene::invalidate_tiles(int layer, const EntityItem& item) {
+
+  if (!item.is_content_cached()) {
+    return;
+  }
+
+  LayerTilesItem* tiles_item = layer_tiles_items.value(layer);
+  if (tiles_item == nullptr) {
+    return;
+  }
+
+  tiles_item->invalidate(get_item_area(item));
+}
+
+/**
+ * @brief Redraws the static tiles in an area of each layer.
+ * @param areas The area to redraw on each layer, in map coordinates.
+ */
+void MapScene::invalidate_tiles(const ByLayer<QRect>& areas) {
+
+  for (auto it = areas.begin(); it != areas.end(); ++it) {
+    LayerTilesItem* tiles_item = layer_tiles_items.value(it.key());
+    if (tiles_item != nullptr) {
+      tiles_item->invalidate(it.value());
+    }
+  }
+}
+
+/**
+ * @brief Redraws the static tiles of all layers.
+ */
+void MapScene::invalidate_all_tiles() {
+
+  for (LayerTilesItem* tiles_item : layer_tiles_items) {
+    if (tiles_item != nullptr) {
+      tiles_item->invalidate_all();
+    }
+  }
+}
+
+/**
+ * @brief Updates whether an entity is drawn by the tiles item of its layer
+ * or by its own item.
+ *
+ * Static tiles are drawn by the tiles item unless they are animated
+ * or overlap an animated tile.
+ * This should be called when the entity is created or when its look may
+ * have changed.
+ * When the entity starts or stops being animated, tiles under it
+ * are updated too.
+ *
+ * @param item The item of an entity on the map.
+ */
+void MapScene::update_item_caching(EntityItem& item) {
+
+  const EntityModel& entity = item.get_entity();
+  const int layer = entity.get_layer();
+  const bool animated = entity.is_animated();
+  const bool was_animated = animated_items.contains(&item);
+  const bool cached = !entity.is_dynamic() && !animated &&
+      !overlaps_animated_item(item);
+
+  if (cached != item.is_content_cached()) {
+    if (cached) {
+      item.set_content_cached(true);
+      invalidate_tiles(layer, item);
+    }
+    else {
+      invalidate_tiles(layer, item);
+      item.set_content_cached(false);
+    }
+  }
+
+  if (animated) {
+    animated_items.insert(&item);
+    if (!animation_timer.isActive()) {
+      animation_timer.start();
+    }
+  }
+  else {
+    animated_items.remove(&item);
+  }
+
+  if (animated != was_animated) {
+    update_tiles_caching(layer, get_item_area(item));
+  }
+}
+
+/**
+ * @brief Updates whether tiles in an area are drawn by the tiles item
+ * of their layer.
+ *
+ * This should be called when an animated tile appears, disappears
+ * or moves in this area.
+ *
+ * @param layer Layer of the tiles.
+ * @param area Area to update, in map coordinates.
+ */
+void MapScene::update_tiles_caching(int layer, const QRect& area) {
+
+  const QGraphicsItem* parent_item = layer_parent_items.value(layer);
+  if (parent_item == nullptr || area.isEmpty()) {
+    return;
+  }
+
+  const QList<QGraphicsItem*>& area_items = items(
+        QRectF(area.translated(get_margin_top_left())),
+        Qt::IntersectsItemBoundingRect);
+  for (QGraphicsItem* area_item : area_items) {
+    EntityItem* item = qgraphicsitem_cast<EntityItem*>(area_item);
+    if (item != nullptr && item->parentItem() == parent_item) {
+      update_item_caching(*item);
+    }
+  }
+}
+
+/**
+ * @brief Updates how tiles are drawn after an item was moved or resized.
+ * @param item The item of an entity on the map, already moved.
+ * @param old_layer Layer of the item before the change.
+ * @param old_area Area of the item before the change.
+ */
+void MapScene::update_moved_item_caching(
+    EntityItem& item, int old_layer, const QRect& old_area) {
+
+  if (animated_items.contains(&item)) {
+    // Tiles may no longer overlap it or start overlapping it.
+    update_tiles_caching(old_layer, old_area);
+    update_tiles_caching(item.get_entity().get_layer(), get_item_area(item));
+  }
+  else {
+    update_item_caching(item);
+  }
+}
+
+/**
+ * @brief Returns whether an item overlaps an animated item of its layer.
+ * @param item An entity item.
+ * @return @c true if an animated item of the same layer overlaps it.
+ */
+bool MapScene::overlaps_animated_item(const EntityItem& item) const {
+
+  const QRect& area = get_item_area(item);
+  for (const EntityItem* animated_item : animated_items) {
+    if (animated_item != &item &&
+        animated_item->parentItem() == item.parentItem() &&
+        get_item_area(*animated_item).intersects(area)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Returns the current time of the animation clock.
+ *
+ * All animated entities of the scene are drawn at this time.
+ *
+ * @return The time in milliseconds.
+ */
+qint64 MapScene::get_animation_time() const {
+  return animation_clock.elapsed();
+}
+
+/**
+ * @brief Returns whether the item of an entity is currently shown.
+ * @param index Index of a map entity.
+ * @return @c true if the entity exists and its item is visible.
+ */
+bool MapScene::is_entity_visible(const EntityIndex& index) const {
+
+  const EntityItems& items = entity_items.value(index.layer);
+  if (index.order < 0 || index.order >= items.size()) {
+    return false;
+  }
+  return items.at(index.order)->isVisible();
+}
+
+/**
+ * @brief Returns whether an entity is drawn by the tiles item of its layer.
+ * @param index Index of a map entity.
+ * @return @c true if the entity exists and its item does not draw it.
+ */
+bool MapScene::is_entity_content_cached(const EntityIndex& index) const {
+
+  const EntityItems& items = entity_items.value(index.layer);
+  if (index.order < 0 || index.order >= items.size()) {
+    return false;
+  }
+  return items.at(index.order)->is_content_cached();
+}
+
 /**
  * @brief Shows or hides entities on a layer.
  * @param layer The layer to update.
@@ -226,6 +468,11 @@ void MapScene::update_layer_visibility(int layer, const ViewSettings& view_setti
   for (EntityItem* item : get_entity_items(layer)) {
     item->update_visibility(view_settings);
   }
+
+  LayerTilesItem* tiles_item = layer_tiles_items.value(layer);
+  if (tiles_item != nullptr) {
+    tiles_item->invalidate_all();
+  }
 }
 
 /**
@@ -267,6 +514,7 @@ void MapScene::update_traversables_visibility(const ViewSettings& view_settings)
       }
     }
   }
+  invalidate_all_tiles();
 }
 
 /**
@@ -283,6 +531,7 @@ void MapScene::update_obstacles_visibility(const ViewSettings& view_settings) {
       }
     }
   }
+  invalidate_all_tiles();
 }
 
 /**
@@ -300,6 +549,10 @@ void MapScene::update_entity_type_visibility(EntityType type, const ViewSettings
       }
     }
   }
+
+  if (type == EntityType::TILE) {
+    invalidate_all_tiles();
+  }
 }
 
 /**
@@ -367,6 +620,12 @@ void MapScene::size_changed(const QSize& size) {
 
   Q_UNUSED(size);
   update_scene_size();
+
+  for (LayerTilesItem* tiles_item : layer_tiles_items) {
+    if (tiles_item != nullptr) {
+      tiles_item->update_size();
+    }
+  }
 }
 
 /**
@@ -393,6 +652,7 @@ void MapScene::layer_range_changed(int min_layer, int max_layer) {
     }
     entity_items.remove(layer);
     layer_parent_items.remove(layer);
+    layer_tiles_items.remove(layer);
   }
   for (int layer = max_layer + 1; layer <= old_max_layer; ++layer) {
     Q_ASSERT(entity_items[layer].isEmpty());
@@ -402,6 +662,7 @@ void MapScene::layer_range_changed(int min_layer, int max_layer) {
     }
     entity_items.remove(layer);
     layer_parent_items.remove(layer);
+    layer_tiles_items.remove(layer);
   }
 
   // Increasing the number of layers.
@@ -453,53 +714,106 @@ void MapScene::entities_about_to_be_removed(const EntityIndexes& indexes) {
     Q_ASSERT(entity.get_index() == index);
     Q_ASSERT(&item->get_entity() == &entity);
     Q_ASSERT(entity_items[index.layer][index.order] == item);
+    invalidate_tiles(index.layer, *item);
+    const QRect& area = get_item_area(*item);
+    const bool animated = animated_items.remove(item);
     removeItem(item);
     entity_items[index.layer].removeAt(index.order);
     delete item;
+
+    if (animated) {
+      // Tiles under it can be drawn by the tiles item again.
+      update_tiles_caching(index.layer, area);
+    }
   }
 }
 
 /**
- * @brief Slot called when the layer of an entity has changed.
+ * @brief Slot called when the layer of entities has changed.
  *
- * Its item on the scene is updated accordingly.
+ * Their items on the scene are updated accordingly.
  *
- * @param index_before Index of the entity before the change.
- * @param index_after Index of the entity after the change.
+ * @param indexes_before Indexes of the entities before the change.
+ * @param indexes_after Indexes of the entities after the change,
+ * in the same order.
  */
-void MapScene::entity_layer_changed(const EntityIndex& index_before,
-                                    const EntityIndex& index_after) {
+void MapScene::entities_layer_changed(const EntityIndexes& indexes_before,
+                                      const EntityIndexes& indexes_after) {
+
+  Q_ASSERT(indexes_after.size() == indexes_before.size());
+
+  // Get the graphic items and redraw tiles at their old place.
+  EntityItems items;
+  QList<QRect> areas_before;
+  ByLayer<QRect> tile_areas;
+  QSet<int> changed_layers;
+  for (const EntityIndex& index_before : indexes_before) {
+    EntityItem* item = get_entity_item(index_before);
+    Q_ASSERT(item != nullptr);
+    items.append(item);
+    const QRect& area_before = get_item_area(*item);
+    areas_before.append(area_before);
+    if (item->is_content_cached()) {
+      tile_areas[index_before.layer] |= area_before;
+    }
+    changed_layers << index_before.layer;
+  }
+  for (const EntityIndex& index_after : indexes_after) {
+    changed_layers << index_after.layer;
+  }
 
-  // Get the graphic item.
-  EntityItem* item = get_entity_item(index_before);
-  Q_ASSERT(item != nullptr);
+  // Rebuild the items lists of changed layers once.
+  QHash<const EntityModel*, EntityItem*> items_by_entity;
+  for (int layer : changed_layers) {
+    for (EntityItem* item : entity_items[layer]) {
+      items_by_entity.insert(&item->get_entity(), item);
+    }
+  }
+  for (int layer : changed_layers) {
+    EntityItems& layer_items = entity_items[layer];
+    layer_items.clear();
+    for (int order = 0; order < map.get_num_entities(layer); ++order) {
+      EntityItem* item = items_by_entity.value(&map.get_entity(EntityIndex(layer, order)));
+      Q_ASSERT(item != nullptr);
+      layer_items.append(item);
+    }
+  }
 
-  // Get the entity.
-  EntityModel& entity = map.get_entity(index_after);
-  Q_UNUSED(entity);
-  Q_ASSERT(entity.get_index() == index_after);
-  Q_ASSERT(&item->get_entity() == &entity);
-  Q_ASSERT(get_entity_item(index_before) == item);
+  // Move items to their new layer, from the top one so that the item
+  // above each one is already at its place.
+  QMap<EntityIndex, int> ranks_by_index_after;
+  for (int i = 0; i < indexes_after.size(); ++i) {
+    ranks_by_index_after.insert(indexes_after[i], i);
+  }
+  for (auto it = ranks_by_index_after.end(); it != ranks_by_index_after.begin(); ) {
+    --it;
+    const EntityIndex& index_after = it.key();
+    EntityItem* item = items[it.value()];
+    Q_ASSERT(&item->get_entity() == &map.get_entity(index_after));
 
-  // Remove it from items of the old layer.
-  entity_items[index_before.layer].removeAt(index_before.order);
-  removeItem(item);
+    removeItem(item);
+    addItem(item);
+    item->setParentItem(layer_parent_items[index_after.layer]);
+    const EntityItems& layer_items = entity_items[index_after.layer];
+    if (index_after.order + 1 < layer_items.size()) {
+      item->stackBefore(layer_items[index_after.order + 1]);
+    }
 
-  // Add it to items of the new layer.
-  addItem(item);
-  int layer_after = index_after.layer;
-  int order_after = index_after.order;
-  item->setParentItem(layer_parent_items[layer_after]);
-  if (order_after < entity_items[layer_after].size()) {
-    item->stackBefore(get_entity_item(index_after));
+    // The visibility of the new layer may be different from the old one.
+    if (view_settings != nullptr) {
+      item->update_visibility(*view_settings);
+    }
   }
 
-  entity_items[layer_after].insert(order_after, item);
-
-  // The visibility of the new layer may be different from the old one.
-  if (view_settings != nullptr) {
-    item->update_visibility(*view_settings);
+  // Redraw tiles at the new place of items.
+  for (int i = 0; i < items.size(); ++i) {
+    EntityItem* item = items[i];
+    update_moved_item_caching(*item, indexes_before[i].layer, areas_before[i]);
+    if (item->is_content_cached()) {
+      tile_areas[indexes_after[i].layer] |= get_item_area(*item);
+    }
   }
+  invalidate_tiles(tile_areas);
 }
 
 /**
@@ -528,7 +842,9 @@ void MapScene::entity_order_changed(const EntityIndex& index_before,
   // Delete and recreate the item again.
   // Just removing and adding it does not seem to work when bringing entities
   // to the front.
+  // Recreating a tile item redraws the tiles under it.
   entity_items[layer].removeAt(order_before);
+  animated_items.remove(item);
   delete item;
   create_entity_item(entity);
 }
@@ -548,7 +864,43 @@ void MapScene::entity_xy_changed(const EntityIndex& index, const QPoint& xy) {
   EntityItem* item = get_entity_item(index);
   Q_ASSERT(item != nullptr);
 
+  // Redraw tiles at the old and the new position.
+  const QRect& area_before = get_item_area(*item);
+  invalidate_tiles(index.layer, *item);
   item->update_xy();
+  update_moved_item_caching(*item, index.layer, area_before);
+  invalidate_tiles(index.layer, *item);
+}
+
+/**
+ * @brief Slot called when the position of several entities has changed.
+ *
+ * Their items on the scene are updated accordingly,
+ * and tiles are redrawn only once for all of them.
+ *
+ * @param indexes Indexes of the entities.
+ */
+void MapScene::entities_xy_changed(const EntityIndexes& indexes) {
+
+  // Old and new areas of tiles on each layer.
+  ByLayer<QRect> tile_areas;
+  for (const EntityIndex& index : indexes) {
+    EntityItem* item = get_entity_item(index);
+    Q_ASSERT(item != nullptr);
+
+    const QRect& area_before = get_item_area(*item);
+    if (item->is_content_cached()) {
+      QRect& area = tile_areas[index.layer];
+      area |= area_before;
+      item->update_xy();
+      area |= get_item_area(*item);
+    }
+    else {
+      item->update_xy();
+    }
+    update_moved_item_caching(*item, index.layer, area_before);
+  }
+  invalidate_tiles(tile_areas);
 }
 
 /**
@@ -566,7 +918,152 @@ void MapScene::entity_size_changed(const EntityIndex& index, const QSize& size)
   EntityItem* item = get_entity_item(index);
   Q_ASSERT(item != nullptr);
 
+  // Redraw tiles with the old and the new size.
+  const QRect& area_before = get_item_area(*item);
+  invalidate_tiles(index.layer, *item);
   item->update_size();
+  update_moved_item_caching(*item, index.layer, area_before);
+  invalidate_tiles(index.layer, *item);
+}
+
+/**
+ * @brief Slot called when the size of several entities has changed.
+ *
+ * Their items on the scene are updated accordingly,
+ * and tiles are redrawn only once for all of them.
+ *
+ * @param indexes Indexes of the entities.
+ */
+void MapScene::entities_size_changed(const EntityIndexes& indexes) {
+
+  // Old and new areas of tiles on each layer.
+  ByLayer<QRect> tile_areas;
+  for (const EntityIndex& index : indexes) {
+    EntityItem* item = get_entity_item(index);
+    Q_ASSERT(item != nullptr);
+
+    const QRect& area_before = get_item_area(*item);
+    if (item->is_content_cached()) {
+      QRect& area = tile_areas[index.layer];
+      area |= area_before;
+      item->update_size();
+      area |= get_item_area(*item);
+    }
+    else {
+      item->update_size();
+    }
+    update_moved_item_caching(*item, index.layer, area_before);
+  }
+  invalidate_tiles(tile_areas);
+}
+
+/**
+ * @brief Slot called when a field of an entity has changed.
+ *
+ * The entity is redrawn because it may look different, like a tile
+ * whose pattern changed.
+ *
+ * @param index Index of an entity.
+ * @param key Key of the field.
+ * @param value The new value.
+ */
+void MapScene::entity_field_changed(
+    const EntityIndex& index, const QString& key, const QVariant& value) {
+
+  Q_UNUSED(key);
+  Q_UNUSED(value);
+
+  // The entity may start or stop being animated, like a tile
+  // whose pattern changed.
+  EntityItem* item = get_entity_item(index);
+  if (item != nullptr) {
+    update_item_caching(*item);
+  }
+
+  redraw_entity(index);
+}
+
+/**
+ * @brief Slot called when a field of several entities has changed.
+ * @param indexes Indexes of the entities.
+ * @param key Key of the field.
+ * @param value The new value.
+ */
+void MapScene::entities_field_changed(
+    const EntityIndexes& indexes, const QString& key, const QVariant& value) {
+
+  Q_UNUSED(key);
+  Q_UNUSED(value);
+
+  for (const EntityIndex& index : indexes) {
+    EntityItem* item = get_entity_item(index);
+    if (item != nullptr) {
+      update_item_caching(*item);
+    }
+  }
+
+  redraw_entities(indexes);
+}
+
+/**
+ * @brief Slot called when the tileset of the map was loaded again or modified.
+ *
+ * All tiles are redrawn.
+ */
+void MapScene::tileset_reloaded() {
+
+  // Patterns may have become animated or static.
+  for (const EntityItems& items : entity_items) {
+    for (EntityItem* item : items) {
+      update_item_caching(*item);
+    }
+  }
+
+  invalidate_all_tiles();
+}
+
+/**
+ * @brief Slot called when sprites shown by entities were reloaded.
+ * @param indexes Indexes of the entities to redraw.
+ */
+void MapScene::sprites_reloaded(const EntityIndexes& indexes) {
+
+  redraw_entities(indexes);
+}
+
+/**
+ * @brief Slot called at each frame of animations.
+ *
+ * Repaints animated items that are visible in a view.
+ * Stops the animation timer if there is no animated item anymore.
+ */
+void MapScene::update_animations() {
+
+  if (animated_items.isEmpty()) {
+    animation_timer.stop();
+    return;
+  }
+
+  QList<QRectF> visible_areas;
+  const QList<QGraphicsView*> scene_views = views();
+  for (const QGraphicsView* view : scene_views) {
+    if (view->isVisible()) {
+      visible_areas << view->mapToScene(view->viewport()->rect()).boundingRect();
+    }
+  }
+
+  for (EntityItem* item : animated_items) {
+    if (!item->isVisible()) {
+      continue;
+    }
+    const QRectF& item_area = item->sceneBoundingRect();
+    for (const QRectF& visible_area : visible_areas) {
+      if (visible_area.intersects(item_area)) {
+        item->update();
+        break;
+      }
+    }
+  }
 }
 
 /**
@@ -721,6 +1218,7 @@ void MapScene::redraw_entity(const EntityIndex& index) {
   if (item == nullptr) {
     return;
   }
+  invalidate_tiles(index.layer, *item);
   item->update();
 }
 
@@ -730,9 +1228,18 @@ void MapScene::redraw_entity(const EntityIndex& index) {
  */
 void MapScene::redraw_entities(const EntityIndexes& indexes) {
 
+  ByLayer<QRect> tile_areas;
   for (const EntityIndex& index : indexes) {
-    redraw_entity(index);
+    EntityItem* item = get_entity_item(index);
+    if (item == nullptr) {
+      continue;
+    }
+    if (item->is_content_cached()) {
+      tile_areas[index.layer] |= get_item_area(*item);
+    }
+    item->update();
   }
+  invalidate_tiles(tile_areas);
 }
 
 
@@ -746,34 +1253,18 @@ void MapScene::redraw_entities(const EntityIndexes& indexes) {
  */
 int MapScene::get_layer_in_rectangle(const QRect& rectangle) const {
 
-  QRect scene_rectangle = rectangle;
-  scene_rectangle.translate(get_margin_top_left());
-  const QList<QGraphicsItem*>& items_in_rectangle = items(
-        scene_rectangle, Qt::IntersectsItemBoundingRect
-  );
-
-  int max_layer = map.get_min_layer();
-  for (QGraphicsItem* item : items_in_rectangle) {
-
-    if (item->zValue() > map.get_max_layer()) {
-      // This is the case of the selection rectangle and
-      // of entities being added.
-      continue;
-    }
-    const EntityModel* entity = get_entity_from_item(*item);
-    if (entity == nullptr) {
-      // Not a map entity.
-      continue;
-    }
+  // Look for a visible entity from the highest layer.
+  for (int layer = map.get_max_layer(); layer > map.get_min_layer(); --layer) {
 
-    if (!item->isVisible()) {
-      // The item is hidden by view settings.
-      continue;
+    const EntityItems& items = entity_items.value(layer);
+    const EntityIndexes& indexes = map.find_entities_in_rectangle(layer, rectangle);
+    for (const EntityIndex& index : indexes) {
+      if (index.order < items.size() && items.at(index.order)->isVisible()) {
+        return layer;
+      }
     }
-
-    max_layer = qMax(max_layer, entity->get_layer());
   }
-  return max_layer;
+  return map.get_min_layer();
 }
 
 }
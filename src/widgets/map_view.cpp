@@ -25,6 +25,7 @@
 #include "widgets/pan_tool.h"
 #include "widgets/zoom_tool.h"
 #include "auto_tiler.h"
+#include "entity_clipboard.h"
 #include "point.h"
 #include "rectangle.h"
 #include "tileset_model.h"
@@ -35,6 +36,7 @@
 #include <QDebug>
 #include <QGraphicsItem>
 #include <QMap>
+#include <QMimeData>
 #include <QMenu>
 #include <QMouseEvent>
 #include <QScrollBar>
@@ -104,6 +106,7 @@ private:
   QPoint initial_point;      /**< Point where the dragging started, in scene coordinates. */
   QPoint last_point;         /**< Point where the mouse was last time it moved, in scene coordinates. */
   bool first_move_done;      /**< Whether at least one move was done during the state. */
+  QRect initial_area;        /**< Area of the entities before the move. */
 };
 
 /**
@@ -463,7 +466,7 @@ void MapView::start_adding_entities_from_tileset_selection() {
   // Create a tile from each selected pattern.
   // Arrange the relative position of tiles as in the tileset.
   EntityModels tiles;
-  const QList<int>& pattern_indexes = tileset->get_selected_indexes();
+  const QList<int>& pattern_indexes = map->get_tileset_selection_model()->get_selected_indexes();
   if (pattern_indexes.isEmpty()) {
     return;
   }
@@ -562,6 +565,11 @@ void MapView::build_context_menu_actions() {
           this, SLOT(add_border_to_selection()));
   addAction(add_border_action);
 
+  auto_border_action = new QAction(
+        tr("Update borders automatically"), this);
+  auto_border_action->setCheckable(true);
+  addAction(auto_border_action);
+
   up_one_layer_action = new QAction(
         tr("One layer up"), this);
   up_one_layer_action->setShortcut(tr("+"));
@@ -737,6 +745,7 @@ QMenu* MapView::create_context_menu() {
 
     // Borders.
     menu->addAction(add_border_action);
+    menu->addAction(auto_border_action);
     menu->addSeparator();
 
     // Layer.
@@ -878,25 +887,12 @@ void MapView::copy() {
     return;
   }
 
-  EntityIndexes indexes = get_selected_entities();
+  const EntityIndexes& indexes = get_selected_entities();
   if (indexes.isEmpty()) {
     return;
   }
 
-  // Sort entities to respect their relative order on the map when pasting.
-  std::sort(indexes.begin(), indexes.end());
-
-  QStringList entity_strings;
-  for (const EntityIndex& index : indexes) {
-    Q_ASSERT(map->entity_exists(index));
-    const EntityModel& entity = map->get_entity(index);
-    QString entity_string = entity.to_string();
-    Q_ASSERT(!entity_string.isEmpty());
-    entity_strings << entity_string;
-  }
-
-  QString text = entity_strings.join("");
-  QApplication::clipboard()->setText(text);
+  QApplication::clipboard()->setMimeData(EntityClipboard::create_mime_data(*map, indexes));
 }
 
 /**
@@ -908,35 +904,12 @@ void MapView::paste() {
     return;
   }
 
-  QString text = QApplication::clipboard()->text();
-  if (text.isEmpty()) {
+  const QMimeData* mime_data = QApplication::clipboard()->mimeData();
+  if (mime_data == nullptr) {
     return;
   }
 
-  QStringList entity_strings = text.split(QRegExp("[\n\r]\\}[\n\r]"), QString::SkipEmptyParts);
-
-  EntityModels entities;
-  for (int i = 0; i < entity_strings.size(); ++i) {
-
-    QString entity_string = entity_strings.at(i);
-
-    if (entity_string.simplified().isEmpty()) {
-      // Only whitespaces: skip.
-      continue;
-    }
-
-    if (i < entity_strings.size() - 1) {
-      entity_string = entity_string + "}";  // Restore the closing brace removed by split().
-    }
-    EntityModelPtr entity = EntityModel::create(*get_map(), entity_string);
-    if (entity == nullptr) {
-      // The text data from the clipboard is not a valid entity.
-      return;
-    }
-
-    entities.push_back(std::move(entity));
-  }
-
+  EntityModels entities = EntityClipboard::create_entities(*get_map(), *mime_data);
   if (entities.empty()) {
     return;
   }
@@ -1257,17 +1230,9 @@ void MapView::mouseDoubleClickEvent(QMouseEvent* event) {
 
   if (get_num_selected_entities() == 1) {
 
-    QList<QGraphicsItem*> items_under_mouse = items(
-          QRect(event->pos(), QSize(1, 1)),
-          Qt::IntersectsItemBoundingRect  // Pick transparent items too.
-    );
-    if (!items_under_mouse.isEmpty()) {
-      QGraphicsItem* item = items_under_mouse.first();
-      EntityModel* entity = scene->get_entity_from_item(*item);
-      if (entity != nullptr) {
-        start_state_doing_nothing();
-        edit_selected_entity();
-      }
+    if (get_entity_item_at(event->pos()) != nullptr) {
+      start_state_doing_nothing();
+      edit_selected_entity();
     }
   }
 }
@@ -1409,19 +1374,125 @@ EntityIndex MapView::get_entity_index_under_cursor() const {
     return EntityIndex();
   }
 
-  QGraphicsItem* item = itemAt(xy);
+  const EntityItem* item = get_entity_item_at(xy);
   if (item == nullptr) {
     // No entity under the mouse.
     return EntityIndex();
   }
 
-  EntityModel* entity = scene->get_entity_from_item(*item);
-  if (entity == nullptr) {
-    // Not an entity.
-    return EntityIndex();
+  return item->get_index();
+}
+
+/**
+ * @brief Returns the topmost entity item at a point of the view.
+ *
+ * Transparent pixels of entities are picked too.
+ * Other items, like the static tiles of each layer, are ignored.
+ *
+ * @param xy A point in view coordinates.
+ * @return The entity item at this point, or nullptr.
+ */
+EntityItem* MapView::get_entity_item_at(const QPoint& xy) const {
+
+  const QList<QGraphicsItem*>& items_under_mouse = items(
+        QRect(xy, QSize(1, 1)),
+        Qt::IntersectsItemBoundingRect  // Pick transparent items too.
+  );
+  for (QGraphicsItem* item : items_under_mouse) {
+    EntityItem* entity_item = qgraphicsitem_cast<EntityItem*>(item);
+    if (entity_item != nullptr) {
+      return entity_item;
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * @brief Returns the rectangle containing some entities.
+ * @param indexes Indexes of entities.
+ * @return The union of their bounding boxes.
+ */
+QRect MapView::get_entities_area(const EntityIndexes& indexes) const {
+
+  QRect area;
+  if (map.isNull()) {
+    return area;
+  }
+
+  for (const EntityIndex& index : indexes) {
+    if (map->entity_exists(index)) {
+      area |= map->get_entity_bounding_box(index);
+    }
+  }
+  return area;
+}
+
+/**
+ * @brief Returns the patterns of the tiles among some entities.
+ * @param indexes Indexes of entities.
+ * @return The patterns of tiles and dynamic tiles, by layer.
+ */
+QMap<int, QSet<QString>> MapView::get_tile_patterns_by_layer(const EntityIndexes& indexes) const {
+
+  QMap<int, QSet<QString>> pattern_ids;
+  if (map.isNull()) {
+    return pattern_ids;
+  }
+
+  for (const EntityIndex& index : indexes) {
+    if (!map->entity_exists(index)) {
+      continue;
+    }
+    EntityType type = map->get_entity_type(index);
+    if (type == EntityType::TILE || type == EntityType::DYNAMIC_TILE) {
+      pattern_ids[index.layer].insert(map->get_entity_field(index, "pattern").toString());
+    }
+  }
+  return pattern_ids;
+}
+
+/**
+ * @brief Returns whether borders are updated automatically after edits.
+ * @return @c true if auto-bordering is on.
+ */
+bool MapView::is_auto_border_enabled() const {
+
+  return auto_border_action != nullptr && auto_border_action->isChecked();
+}
+
+/**
+ * @brief Updates the borders of regions that were just edited.
+ *
+ * Does nothing unless auto-bordering is on.
+ * Only border tiles near the dirty area that actually change are replaced.
+ * This must be called right after the edit, so that the replacement
+ * is undone and redone with it.
+ *
+ * @param dirty_area The area that was edited.
+ * @param region_pattern_ids Patterns of the edited tiles, by layer.
+ * A region is made of the tiles of a layer having one of these patterns.
+ */
+void MapView::update_borders(
+    const QRect& dirty_area,
+    const QMap<int, QSet<QString>>& region_pattern_ids
+) {
+  if (!is_auto_border_enabled() || map.isNull() || dirty_area.isEmpty()) {
+    return;
+  }
+
+  const QString& border_set_id = map->get_current_border_set_id();
+  if (border_set_id.isEmpty()) {
+    return;
   }
 
-  return entity->get_index();
+  for (auto it = region_pattern_ids.begin(); it != region_pattern_ids.end(); ++it) {
+    AutoTiler::BorderTilesUpdate update = AutoTiler::update_border_tiles(
+          *map, border_set_id, it.key(), it.value(), dirty_area);
+    if (update.tiles_to_remove.isEmpty() && update.tiles_to_add.empty()) {
+      continue;
+    }
+    emit replace_border_tiles_requested(update.tiles_to_remove, update.tiles_to_add);
+  }
 }
 
 /**
@@ -1547,7 +1618,16 @@ void MapView::resize_entities(const QMap<EntityIndex, QRect>& boxes, bool allow_
  */
 void MapView::remove_selected_entities() {
 
-  emit remove_entities_requested(get_selected_entities());
+  const EntityIndexes indexes = get_selected_entities();
+  if (!is_auto_border_enabled()) {
+    emit remove_entities_requested(indexes);
+    return;
+  }
+
+  const QRect& dirty_area = get_entities_area(indexes);
+  const QMap<int, QSet<QString>>& region_pattern_ids = get_tile_patterns_by_layer(indexes);
+  emit remove_entities_requested(indexes);
+  update_borders(dirty_area, region_pattern_ids);
 }
 
 /**
@@ -1734,12 +1814,7 @@ void DoingNothingState::mouse_pressed(const QMouseEvent& event) {
   mouse_pressed_point = event.pos();
 
   // Left or right button: possibly change the selection.
-  QList<QGraphicsItem*> items_under_mouse = view.items(
-        QRect(event.pos(), QSize(1, 1)),
-        Qt::IntersectsItemBoundingRect  // Pick transparent items too.
-  );
-  QGraphicsItem* item = items_under_mouse.isEmpty() ? nullptr : items_under_mouse.first();
-  const EntityItem* entity_item = qgraphicsitem_cast<const EntityItem*>(item);
+  const EntityItem* entity_item = view.get_entity_item_at(event.pos());
 
   const bool control_or_shift = (event.modifiers() & (Qt::ControlModifier | Qt::ShiftModifier));
 
@@ -1748,7 +1823,7 @@ void DoingNothingState::mouse_pressed(const QMouseEvent& event) {
     // If ctrl or shift is pressed, keep the existing selection.
     keep_selected = true;
   }
-  else if (item != nullptr && item->isSelected()) {
+  else if (entity_item != nullptr && entity_item->isSelected()) {
     // When clicking an already selected item, keep the existing selection too.
     keep_selected = true;
   }
@@ -1759,7 +1834,7 @@ void DoingNothingState::mouse_pressed(const QMouseEvent& event) {
 
   if (event.button() == Qt::LeftButton) {
 
-    if (item != nullptr) {
+    if (entity_item != nullptr) {
 
       if (control_or_shift) {
         // Either toggle the clicked item or start a selection rectangle.
@@ -1767,18 +1842,16 @@ void DoingNothingState::mouse_pressed(const QMouseEvent& event) {
         clicked_with_control_or_shift = true;
       }
       else {
-        if (!item->isSelected()) {
+        if (!entity_item->isSelected()) {
           // Select the item.
-          if (entity_item != nullptr) {
-            const EntityIndex& index = entity_item->get_index();
-            if (!view.get_view_settings()->is_layer_locked(index.layer)) {
-              view.select_entity(index, true);
-            }
-            else {
-              // Left click on a locked layer: trace a selection rectangle.
-              view.start_state_drawing_rectangle(event.pos());
-              return;
-            }
+          const EntityIndex& index = entity_item->get_index();
+          if (!view.get_view_settings()->is_layer_locked(index.layer)) {
+            view.select_entity(index, true);
+          }
+          else {
+            // Left click on a locked layer: trace a selection rectangle.
+            view.start_state_drawing_rectangle(event.pos());
+            return;
           }
         }
         // Allow to move selected items.
@@ -1839,14 +1912,9 @@ void DoingNothingState::mouse_released(const QMouseEvent& event) {
     // a selection rectangle.
     MapView& view = get_view();
 
-    QList<QGraphicsItem*> items_under_mouse = view.items(
-          QRect(event.pos(), QSize(1, 1)),
-          Qt::IntersectsItemBoundingRect  // Pick transparent items too.
-    );
-    QGraphicsItem* item = items_under_mouse.isEmpty() ? nullptr : items_under_mouse.first();
-    const EntityItem* entity_item = qgraphicsitem_cast<const EntityItem*>(item);
+    const EntityItem* entity_item = view.get_entity_item_at(event.pos());
     if (entity_item != nullptr) {
-      const bool was_selected = item->isSelected();
+      const bool was_selected = entity_item->isSelected();
       if (was_selected) {
         view.select_entity(entity_item->get_index(), false);
       }
@@ -1876,11 +1944,11 @@ void DoingNothingState::context_menu_requested(const QPoint& where) {
  */
 void DoingNothingState::tileset_selection_changed() {
 
-  TilesetModel* tileset = get_map().get_tileset_model();
-  if (tileset == nullptr) {
+  const TilesetSelectionModel* selection_model = get_map().get_tileset_selection_model();
+  if (selection_model == nullptr) {
     return;
   }
-  if (tileset->is_selection_empty()) {
+  if (selection_model->is_selection_empty()) {
     return;
   }
 
@@ -1999,7 +2067,8 @@ MovingEntitiesState::MovingEntitiesState(MapView& view, const QPoint& initial_po
   MapView::State(view),
   initial_point(Point::floor_8(view.mapToScene(initial_point))),
   last_point(this->initial_point),
-  first_move_done(false) {
+  first_move_done(false),
+  initial_area(view.get_entities_area(view.get_selected_entities())) {
 
 }
 
@@ -2042,7 +2111,15 @@ void MovingEntitiesState::mouse_released(const QMouseEvent& event) {
 
   Q_UNUSED(event);
 
-  get_view().start_state_doing_nothing();
+  MapView& view = get_view();
+  if (first_move_done && view.is_auto_border_enabled()) {
+    const EntityIndexes& indexes = view.get_selected_entities();
+    view.update_borders(
+          initial_area | view.get_entities_area(indexes),
+          view.get_tile_patterns_by_layer(indexes));
+  }
+
+  view.start_state_doing_nothing();
 }
 
 /**
@@ -2278,7 +2355,15 @@ void ResizingEntitiesState::mouse_released(const QMouseEvent& event) {
     view.start_state_adding_entities(std::move(clones), guess_layer);
   }
   else {
-    get_view().start_state_doing_nothing();
+    if (first_resize_done && view.is_auto_border_enabled()) {
+      QRect dirty_area;
+      for (const QRect& old_box : old_boxes) {
+        dirty_area |= old_box;
+      }
+      dirty_area |= view.get_entities_area(old_boxes.keys());
+      view.update_borders(dirty_area, view.get_tile_patterns_by_layer(old_boxes.keys()));
+    }
+    view.start_state_doing_nothing();
   }
 }
 
@@ -2902,11 +2987,11 @@ void AddingEntitiesState::mouse_moved(const QMouseEvent& event) {
  */
 void AddingEntitiesState::tileset_selection_changed() {
 
-  TilesetModel* tileset = get_map().get_tileset_model();
-  if (tileset == nullptr) {
+  const TilesetSelectionModel* selection_model = get_map().get_tileset_selection_model();
+  if (selection_model == nullptr) {
     return;
   }
-  if (tileset->is_selection_empty()) {
+  if (selection_model->is_selection_empty()) {
     // Stop adding the tiles that were selected.
     get_view().start_state_doing_nothing();
     return;
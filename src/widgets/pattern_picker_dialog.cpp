@@ -31,7 +31,8 @@ PatternPickerDialog::PatternPickerDialog(
 
   ui.setupUi(this);
 
-  ui.tileset_view->set_model(&tileset);
+  // The tileset is shared: don't change the selection of other views.
+  ui.tileset_view->set_model(&tileset, new TilesetSelectionModel(tileset, this));
   ui.tileset_view->set_read_only(true);
   // TODO disable multi-selection
   // TODO make sure that Return and Escape shortcuts act on the dialog
@@ -44,10 +45,11 @@ PatternPickerDialog::PatternPickerDialog(
 QString PatternPickerDialog::get_pattern_id() const {
 
   TilesetModel* tileset = ui.tileset_view->get_model();
-  if (tileset == nullptr) {
+  TilesetSelectionModel* selection_model = ui.tileset_view->get_selection_model();
+  if (tileset == nullptr || selection_model == nullptr) {
     return QString();
   }
-  int pattern_index = tileset->get_selected_index();
+  int pattern_index = selection_model->get_selected_index();
 
   return tileset->index_to_id(pattern_index);
 }
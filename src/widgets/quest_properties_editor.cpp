@@ -494,6 +494,7 @@ QuestProperties& QuestPropertiesEditor::get_model() {
 void QuestPropertiesEditor::save() {
 
   model.save();
+  get_quest().get_search_index().update_file(get_file_path());
 }
 
 /**
@@ -814,6 +814,16 @@ SpriteEditor::SpriteEditor(Quest& quest, const QString& path, QWidget* parent) :
   connect(model, SIGNAL(animation_image_changed(Index,QString)),
           this, SLOT(update_animation_source_image_field()));
 
+  // Images modified externally are reloaded, but not the sprite data file:
+  // it may have unsaved changes here.
+  watch_image_files();
+  connect(model, SIGNAL(animation_created(Index)),
+          this, SLOT(watch_image_files()));
+  connect(model, SIGNAL(animation_image_changed(Index,QString)),
+          this, SLOT(watch_image_files()));
+  connect(&quest.get_file_watcher(), SIGNAL(files_changed(QStringList)),
+          model, SLOT(reload_images(QStringList)));
+
   connect(ui.src_image_button, SIGNAL(clicked()),
           this, SLOT(change_animation_source_image_requested()));
   connect(ui.src_image_refresh_button, SIGNAL(clicked(bool)),
@@ -932,6 +942,12 @@ SpriteModel& SpriteEditor::get_model() {
 void SpriteEditor::save() {
 
   model->save();
+
+  // Let searches find the new content.
+  quest.get_search_index().update_file(get_file_path());
+
+  // Maps will load the new version of the sprite.
+  quest.get_sprite_cache().invalidate(sprite_id);
 }
 
 /**
@@ -1346,6 +1362,16 @@ void SpriteEditor::refresh_animation_source_image() {
 void SpriteEditor::tileset_selector_activated() {
 
   model->set_tileset_id(ui.tileset_field->get_selected_id());
+  watch_image_files();
+}
+
+/**
+ * @brief Asks the quest file watcher to notify changes of the images
+ * used by the sprite.
+ */
+void SpriteEditor::watch_image_files() {
+
+  quest.get_file_watcher().watch_files(model->get_image_paths());
 }
 
 /**
@@ -390,6 +390,7 @@ StringsModel& StringsEditor::get_model() {
 void StringsEditor::save() {
 
   model->save();
+  get_quest().get_search_index().update_file(get_file_path());
 }
 
 /**
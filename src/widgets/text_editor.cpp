@@ -26,6 +26,7 @@
 #include <QList>
 #include <QPlainTextEdit>
 #include <QScrollBar>
+#include <QTextBlock>
 #include <QTextStream>
 
 namespace SolarusEditor {
@@ -158,7 +159,12 @@ void TextEditor::save() {
   QTextStream out(&file);
   out.setCodec("UTF-8");
   out << text_widget->toPlainText();
+  out.flush();
+  file.close();
   text_widget->document()->setModified(false);
+
+  // The file was modified in place: its directory did not change.
+  get_quest().get_search_index().update_file(get_file_path());
 }
 
 /**
@@ -257,6 +263,22 @@ void TextEditor::reload_settings() {
     settings.get_value_bool(EditorSettings::replace_tab_by_spaces));
 }
 
+/**
+ * @brief Moves the cursor to the beginning of a line and shows it.
+ * @param line The line, starting at 1.
+ */
+void TextEditor::go_to_line(int line) {
+
+  const QTextBlock& block = text_widget->document()->findBlockByNumber(line - 1);
+  if (!block.isValid()) {
+    return;
+  }
+
+  text_widget->setTextCursor(QTextCursor(block));
+  text_widget->centerCursor();
+  text_widget->setFocus();
+}
+
 /**
  * @brief Slot called when the user searches an occurence of some text.
  * @param text The text to find.
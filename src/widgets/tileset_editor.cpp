@@ -24,18 +24,16 @@
 #include "quest.h"
 #include "quest_resources.h"
 #include "refactoring.h"
+#include "refactoring_engine.h"
 #include "tileset_model.h"
 #include <QGuiApplication>
 #include <QColorDialog>
 #include <QDebug>
-#include <QFile>
-#include <QFileSystemWatcher>
 #include <QInputDialog>
 #include <QItemSelectionModel>
 #include <QMessageBox>
 #include <QRegExp>
 #include <QUndoStack>
-#include <QTextStream>
 
 namespace SolarusEditor {
 
@@ -791,7 +789,7 @@ private:
 TilesetEditor::TilesetEditor(Quest& quest, const QString& path, QWidget* parent) :
   Editor(quest, path, parent),
   model(nullptr),
-  tileset_image_dirty(false) {
+  tileset_image_reloaded(false) {
 
   ui.setupUi(this);
 
@@ -815,20 +813,16 @@ TilesetEditor::TilesetEditor(Quest& quest, const QString& path, QWidget* parent)
   ViewSettings& view_settings = get_view_settings();
   set_grid_supported(true);
 
-  // Open the file.
-  model = new TilesetModel(quest, tileset_id, this);
-  get_undo_stack().setClean();
-
   // Prepare the gui.
   const int side_width = 400;
   ui.splitter->setSizes({ side_width, width() - side_width });
-  ui.patterns_list_view->set_model(*model);
-  ui.border_sets_tree_view->set_tileset(*model);
-  ui.tileset_view->set_model(model);
   ui.tileset_view->set_view_settings(view_settings);
 
+  // Open the file, or get it from open maps.
+  set_model(quest.get_tileset_cache().get_tileset(tileset_id));
+  get_undo_stack().setClean();
+
   load_settings();
-  update();
 
   // Make connections.
   connect(&get_resources(), SIGNAL(element_description_changed(ResourceType, const QString&, const QString&)),
@@ -838,8 +832,6 @@ TilesetEditor::TilesetEditor(Quest& quest, const QString& path, QWidget* parent)
 
   connect(ui.background_field, SIGNAL(color_changed(QColor)),
           this, SLOT(change_background_color()));
-  connect(model, SIGNAL(background_color_changed(const QColor&)),
-          this, SLOT(update_background_color()));
 
   connect(ui.pattern_id_button, SIGNAL(clicked()),
           this, SLOT(change_selected_pattern_id_requested()));
@@ -847,8 +839,6 @@ TilesetEditor::TilesetEditor(Quest& quest, const QString& path, QWidget* parent)
           this, SLOT(change_selected_pattern_id_requested()));
   connect(ui.patterns_list_view, SIGNAL(change_selected_pattern_id_requested()),
           this, SLOT(change_selected_pattern_id_requested()));
-  connect(model, SIGNAL(pattern_id_changed(int, QString, int, QString)),
-          this, SLOT(update_pattern_id_field()));
 
   connect(ui.tileset_view, SIGNAL(change_selected_patterns_position_requested(QPoint)),
           this, SLOT(change_selected_patterns_position_requested(QPoint)));
@@ -857,38 +847,26 @@ TilesetEditor::TilesetEditor(Quest& quest, const QString& path, QWidget* parent)
           this, SLOT(ground_selector_activated()));
   connect(ui.tileset_view, SIGNAL(change_selected_patterns_ground_requested(Ground)),
           this, SLOT(change_selected_patterns_ground_requested(Ground)));
-  connect(model, SIGNAL(pattern_ground_changed(int, Ground)),
-          this, SLOT(update_ground_field()));
 
   connect(ui.default_layer_field, SIGNAL(valueChanged(int)),
           this, SLOT(change_selected_patterns_default_layer_requested(int)));
   connect(ui.tileset_view, SIGNAL(change_selected_patterns_default_layer_requested(int)),
           this, SLOT(change_selected_patterns_default_layer_requested(int)));
-  connect(model, SIGNAL(pattern_default_layer_changed(int, int)),
-          this, SLOT(update_default_layer_field()));
 
   connect(ui.repeat_mode_field, SIGNAL(activated(QString)),
           this, SLOT(repeat_mode_selector_activated()));
   connect(ui.tileset_view, SIGNAL(change_selected_patterns_repeat_mode_requested(TilePatternRepeatMode)),
           this, SLOT(change_selected_patterns_repeat_mode_requested(TilePatternRepeatMode)));
-  connect(model, SIGNAL(pattern_repeat_mode_changed(int, TilePatternRepeatMode)),
-          this, SLOT(update_repeat_mode_field()));
 
   connect(ui.animation_type_field, SIGNAL(activated(QString)),
           this, SLOT(animation_type_selector_activated()));
   connect(ui.tileset_view, SIGNAL(change_selected_patterns_animation_requested(PatternAnimation)),
           this, SLOT(change_selected_patterns_animation_requested(PatternAnimation)));
-  connect(model, SIGNAL(pattern_animation_changed(int, PatternAnimation)),
-          this, SLOT(update_animation_type_field()));
-  connect(model, SIGNAL(pattern_animation_changed(int, PatternAnimation)),
-          this, SLOT(update_animation_separation_field()));
 
   connect(ui.animation_separation_field, SIGNAL(activated(QString)),
           this, SLOT(animation_separation_selector_activated()));
   connect(ui.tileset_view, SIGNAL(change_selected_patterns_separation_requested(PatternSeparation)),
           this, SLOT(change_selected_patterns_separation_requested(PatternSeparation)));
-  connect(model, SIGNAL(pattern_separation_changed(int, PatternSeparation)),
-          this, SLOT(update_animation_separation_field()));
 
   connect(ui.tileset_view, SIGNAL(create_pattern_requested(QString, QRect, Ground)),
           this, SLOT(create_pattern_requested(QString, QRect, Ground)));
@@ -911,26 +889,34 @@ TilesetEditor::TilesetEditor(Quest& quest, const QString& path, QWidget* parent)
           this, SLOT(create_border_set_requested()));
   connect(ui.border_sets_tree_view, SIGNAL(change_border_set_patterns_requested(QString, QStringList)),
           this, SLOT(change_border_set_patterns_requested(QString, QStringList)));
-  connect(&model->get_selection_model(), SIGNAL(selectionChanged(QItemSelection, QItemSelection)),
-          this, SLOT(update_pattern_view()));
 
   connect(ui.rename_border_set_button, SIGNAL(clicked()),
           this, SLOT(change_selected_border_set_id_requested()));
   connect(ui.border_set_id_button, SIGNAL(clicked()),
           this, SLOT(change_selected_border_set_id_requested()));
-  connect(model, SIGNAL(border_set_id_changed(QString, QString)),
-          this, SLOT(update_border_set_id_field()));
   connect(ui.border_set_inner_field, SIGNAL(activated(QString)),
           this, SLOT(border_set_inner_selector_activated()));
-  connect(model, SIGNAL(border_set_inner_changed(QString, bool)),
-          this, SLOT(update_border_set_inner_field()));
-  connect(ui.border_sets_tree_view->selectionModel(), SIGNAL(selectionChanged(QItemSelection, QItemSelection)),
-          this, SLOT(update_border_set_view()));
 
-  QFileSystemWatcher* watcher = new QFileSystemWatcher(this);
-  watcher->addPath(quest.get_tileset_tiles_image_path(tileset_id));
-  connect(watcher, SIGNAL(fileChanged(QString)),
-          this, SLOT(tileset_image_changed()));
+  connect(&get_undo_stack(), SIGNAL(cleanChanged(bool)),
+          this, SLOT(update_tileset_modified()));
+  connect(&quest.get_tileset_cache(), SIGNAL(tileset_reloaded(QString)),
+          this, SLOT(cached_tileset_reloaded(QString)));
+}
+
+/**
+ * @brief Destroys the tileset editor.
+ *
+ * The tileset model is shared with open maps:
+ * if the user has chosen to discard unsaved changes,
+ * maps get the tileset from its files again.
+ */
+TilesetEditor::~TilesetEditor() {
+
+  TilesetCache& tileset_cache = get_quest().get_tileset_cache();
+  disconnect(&tileset_cache, nullptr, this, nullptr);
+  if (has_unsaved_changes()) {
+    tileset_cache.reload(tileset_id);
+  }
 }
 
 /**
@@ -941,6 +927,56 @@ TilesetModel& TilesetEditor::get_model() {
   return *model;
 }
 
+/**
+ * @brief Sets the tileset model to edit.
+ *
+ * This is called at creation and when the tileset is reloaded from its files.
+ *
+ * @param model The tileset model, shared with open maps.
+ */
+void TilesetEditor::set_model(const std::shared_ptr<TilesetModel>& model) {
+
+  if (this->model != nullptr) {
+    disconnect(this->model.get(), nullptr, this, nullptr);
+    disconnect(&this->model->get_selection_model(), nullptr, this, nullptr);
+  }
+
+  this->model = model;
+
+  ui.patterns_list_view->set_model(*model);
+  ui.border_sets_tree_view->set_tileset(*model);
+  ui.tileset_view->set_model(model.get());
+
+  connect(model.get(), SIGNAL(background_color_changed(const QColor&)),
+          this, SLOT(update_background_color()));
+  connect(model.get(), SIGNAL(image_changed()),
+          this, SLOT(tileset_image_changed()));
+  connect(model.get(), SIGNAL(pattern_id_changed(int, QString, int, QString)),
+          this, SLOT(update_pattern_id_field()));
+  connect(model.get(), SIGNAL(pattern_ground_changed(int, Ground)),
+          this, SLOT(update_ground_field()));
+  connect(model.get(), SIGNAL(pattern_default_layer_changed(int, int)),
+          this, SLOT(update_default_layer_field()));
+  connect(model.get(), SIGNAL(pattern_repeat_mode_changed(int, TilePatternRepeatMode)),
+          this, SLOT(update_repeat_mode_field()));
+  connect(model.get(), SIGNAL(pattern_animation_changed(int, PatternAnimation)),
+          this, SLOT(update_animation_type_field()));
+  connect(model.get(), SIGNAL(pattern_animation_changed(int, PatternAnimation)),
+          this, SLOT(update_animation_separation_field()));
+  connect(model.get(), SIGNAL(pattern_separation_changed(int, PatternSeparation)),
+          this, SLOT(update_animation_separation_field()));
+  connect(&model->get_selection_model(), SIGNAL(selectionChanged(QItemSelection, QItemSelection)),
+          this, SLOT(update_pattern_view()));
+  connect(model.get(), SIGNAL(border_set_id_changed(QString, QString)),
+          this, SLOT(update_border_set_id_field()));
+  connect(model.get(), SIGNAL(border_set_inner_changed(QString, bool)),
+          this, SLOT(update_border_set_inner_field()));
+  connect(ui.border_sets_tree_view->selectionModel(), SIGNAL(selectionChanged(QItemSelection, QItemSelection)),
+          this, SLOT(update_border_set_view()));
+
+  update();
+}
+
 /**
  * @copydoc Editor::save
  */
@@ -950,6 +986,36 @@ void TilesetEditor::save() {
     return;
   }
   model->save();
+  get_quest().get_search_index().update_file(get_file_path());
+}
+
+/**
+ * @brief Slot called when the undo/redo history becomes clean or modified.
+ *
+ * Lets maps know that the shared tileset has unsaved changes.
+ */
+void TilesetEditor::update_tileset_modified() {
+
+  get_quest().get_tileset_cache().set_tileset_modified(
+        tileset_id, has_unsaved_changes());
+}
+
+/**
+ * @brief Slot called when a tileset is reloaded from its files.
+ *
+ * Maps now use a new tileset model: edit the same one.
+ * The undo/redo history refers to the old content and is cleared.
+ *
+ * @param tileset_id Id of the tileset reloaded.
+ */
+void TilesetEditor::cached_tileset_reloaded(const QString& tileset_id) {
+
+  if (tileset_id != this->tileset_id) {
+    return;
+  }
+
+  set_model(get_quest().get_tileset_cache().get_tileset(tileset_id));
+  get_undo_stack().clear();
 }
 
 /**
@@ -1099,14 +1165,6 @@ void TilesetEditor::update_pattern_view() {
   ui.pattern_properties_group_box->setEnabled(!model->is_selection_empty());
 }
 
-/**
- * @brief Slot called when the PNG file of the tileset has changed.
- */
-void TilesetEditor::tileset_image_changed() {
-
-  tileset_image_dirty = true;
-}
-
 /**
  * @brief Slot called when the user wants to move tile pattern(s).
  */
@@ -1175,6 +1233,13 @@ void TilesetEditor::change_selected_pattern_id_requested() {
     // (not as an undoable command).
     Refactoring refactoring([=]() {
 
+      // Find the maps to update before changing anything.
+      RefactoringEngine engine = create_pattern_id_refactoring(old_id, new_id);
+      if (!engine.scan_maps(get_quest(), this)) {
+        // Canceled.
+        return QStringList();
+      }
+
       // Do the change in the tileset.
       model->set_pattern_id(old_index, new_id);
 
@@ -1183,81 +1248,35 @@ void TilesetEditor::change_selected_pattern_id_requested() {
       get_undo_stack().clear();
 
       // Update all maps that use this tileset.
-      return change_pattern_id_in_maps(old_id, new_id);
+      return engine.commit();
     });
     emit refactoring_requested(refactoring);
   }
 }
 
 /**
- * @brief Replaces a pattern id by a new value in all maps that use this tileset.
- * @param old_pattern_id The pattern id to change.
- * @param new_pattern_id The new value.
- * @return The list of files that were modified.
- * @throws EditorException In case of error.
- */
-QStringList TilesetEditor::change_pattern_id_in_maps(
-    const QString& old_pattern_id, const QString& new_pattern_id) {
-
-  QStringList modified_paths;
-  const QStringList& map_ids = get_resources().get_elements(ResourceType::MAP);
-  for (const QString& map_id : map_ids) {
-    if (change_pattern_id_in_map(map_id, old_pattern_id, new_pattern_id)) {
-      modified_paths << get_quest().get_map_data_file_path(map_id);
-    }
-  }
-  return modified_paths;
-}
-
-/**
- * @brief Replaces a pattern id by a new value in a map if it uses this tileset.
- * @param map_id Id of the map to update.
+ * @brief Creates the refactoring that replaces a pattern id by a new value
+ * in all maps that use this tileset.
+ *
+ * We don't load the entire maps with all their entities for performance.
+ * Instead, we just find and replace the appropriate text in the map
+ * data files.
+ *
  * @param old_pattern_id The pattern id to change.
  * @param new_pattern_id The new value.
- * @return @c true if there was a change.
- * @throws EditorException In case of error.
+ * @return The refactoring engine, ready to scan maps.
  */
-bool TilesetEditor::change_pattern_id_in_map(
-    const QString& map_id, const QString& old_pattern_id, const QString& new_pattern_id) {
-
-  // We don't load the entire map with all its entities for performance.
-  // Instead, we just find and replace the appropriate text in the map
-  // data file.
-
-  QFile file(get_quest().get_map_data_file_path(map_id));
-
-  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-    throw EditorException(tr("Cannot open map file '%1'").arg(file.fileName()));
-  }
-  QTextStream in(&file);
-  in.setCodec("UTF-8");
-  QString content = in.readAll();
-  file.close();
-
-  QString tileset_line = "\n  tileset = \"" + model->get_tileset_id() + "\",\n";
-  if (!content.contains(tileset_line)) {
-    // This map uses another tileset: nothing to do.
-    return false;
-  }
+RefactoringEngine TilesetEditor::create_pattern_id_refactoring(
+    const QString& old_pattern_id, const QString& new_pattern_id) const {
 
   QRegularExpression regex("\n  pattern = \"?" + QRegularExpression::escape(old_pattern_id) + "\"?,\n");
   QString replacement("\n  pattern = \"" + new_pattern_id + "\",\n");
-  QString old_content = content;
-  content.replace(regex, replacement);
+  RefactoringEngine engine(regex, replacement);
 
-  if (content == old_content) {
-    // No change.
-    return false;
-  }
-
-  if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-    throw EditorException(tr("Cannot open map file '%1' for writing").arg(file.fileName()));
-  }
-  QTextStream out(&file);
-  out.setCodec("UTF-8");
-  out << content;
-  file.close();
-  return true;
+  // Maps that use another tileset are left unchanged.
+  engine.add_prefilter("\n  tileset = \"" + model->get_tileset_id() + "\",\n");
+  engine.add_prefilter(old_pattern_id);
+  return engine;
 }
 
 /**
@@ -1737,6 +1756,15 @@ void TilesetEditor::border_set_inner_selector_activated() {
   try_command(new SetBorderSetInnerCommand(*this, border_set_id, new_inner));
 }
 
+/**
+ * @brief Slot called when the PNG file of the tileset was reloaded
+ * because it was modified externally.
+ */
+void TilesetEditor::tileset_image_changed() {
+
+  tileset_image_reloaded = true;
+}
+
 /**
  * @copydoc Editor::editor_made_visible
  */
@@ -1744,25 +1772,13 @@ void TilesetEditor::editor_made_visible() {
 
   Editor::editor_made_visible();
 
-  if (tileset_image_dirty) {
-    tileset_image_dirty = false;
-    QMessageBox::StandardButton answer = QMessageBox::question(
+  if (tileset_image_reloaded) {
+    tileset_image_reloaded = false;
+    QMessageBox::information(
           this,
           tr("Image was modified externally"),
-          tr("The tileset image was modified.\nDo you want to refresh the tileset?"),
-          QMessageBox::Yes | QMessageBox::No,
-          QMessageBox::Yes
+          tr("The tileset image was modified.\nThe tileset was refreshed.")
           );
-
-    if (answer == QMessageBox::QMessageBox::No) {
-      return;
-    }
-
-    model->reload_patterns_image();
-
-    // Refresh both views.
-    ui.tileset_view->update();
-    // TODO ui.patterns_list_view->
   }
 }
 
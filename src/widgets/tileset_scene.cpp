@@ -67,16 +67,19 @@ private:
 /**
  * @brief Creates a tileset scene.
  * @param model The tileset data to represent in the scene.
+ * @param selection_model The selection of patterns to show and modify.
  * @param parent The parent object or nullptr.
  */
-TilesetScene::TilesetScene(TilesetModel& model, QObject* parent) :
+TilesetScene::TilesetScene(
+    TilesetModel& model, TilesetSelectionModel& selection_model, QObject* parent) :
   QGraphicsScene(parent),
-  model(model) {
+  model(model),
+  selection_model(selection_model) {
 
   build();
 
   // Synchronize the scene selection with the tileset selection model.
-  connect(&model.get_selection_model(), SIGNAL(selectionChanged(QItemSelection, QItemSelection)),
+  connect(&selection_model, SIGNAL(selectionChanged(QItemSelection, QItemSelection)),
           this, SLOT(update_selection_to_scene(QItemSelection, QItemSelection)));
   connect(this, SIGNAL(selectionChanged()),
           this, SLOT(set_selection_from_scene()));
@@ -224,7 +227,7 @@ void TilesetScene::update_selection_to_scene(
 /**
  * @brief Slot called when the scene selection has changed.
  *
- * The new selection is forwarded to the tileset model.
+ * The new selection is forwarded to the selection model.
  */
 void TilesetScene::set_selection_from_scene() {
 
@@ -238,7 +241,7 @@ void TilesetScene::set_selection_from_scene() {
     }
   }
 
-  model.set_selected_indexes(indexes);
+  selection_model.set_selected_indexes(indexes);
 }
 
 /**
@@ -100,11 +100,26 @@ TilesetModel* TilesetView::get_model() {
   return this->model;
 }
 
+/**
+ * @brief Returns the patterns selected in this view.
+ * @return The selection, or nullptr if there is currently no tileset.
+ */
+TilesetSelectionModel* TilesetView::get_selection_model() {
+
+  return this->selection_model;
+}
+
 /**
  * @brief Sets the tileset to represent in this view.
+ *
+ * Tileset models are shared, so each view of a tileset may have its own
+ * selection of patterns.
+ *
  * @param model The tileset model, or nullptr to remove any model.
+ * @param selection_model The selection of patterns to use in this view,
+ * or nullptr to use the selection of the tileset editor.
  */
-void TilesetView::set_model(TilesetModel* model) {
+void TilesetView::set_model(TilesetModel* model, TilesetSelectionModel* selection_model) {
 
   int horizontal_scrollbar_value = 0;
   int vertical_scrollbar_value = 0;
@@ -112,6 +127,7 @@ void TilesetView::set_model(TilesetModel* model) {
 
   if (this->model != nullptr) {
     this->model = nullptr;
+    this->selection_model = nullptr;
     this->scene = nullptr;
     horizontal_scrollbar_value = horizontalScrollBar()->value();
     vertical_scrollbar_value = verticalScrollBar()->value();
@@ -123,8 +139,13 @@ void TilesetView::set_model(TilesetModel* model) {
   this->model = model;
 
   if (model != nullptr) {
+    if (selection_model == nullptr) {
+      selection_model = &model->get_selection_model();
+    }
+    this->selection_model = selection_model;
+
     // Create the scene from the model.
-    scene = new TilesetScene(*model, this);
+    scene = new TilesetScene(*model, *selection_model, this);
     setScene(scene);
 
     if (model->get_patterns_image().isNull()) {
@@ -369,7 +390,7 @@ void TilesetView::mousePressEvent(QMouseEvent* event) {
     if (event->button() == Qt::LeftButton) {
       if (item != nullptr &&
           item->isSelected() &&
-          !model->is_selection_empty() &&
+          !selection_model->is_selection_empty() &&
           !control_or_shift &&
           !is_read_only()) {
         // Clicking on an already selected item: allow to move it.
@@ -435,7 +456,7 @@ void TilesetView::mouseReleaseEvent(QMouseEvent* event) {
       }
 
       if (!keep_selected) {
-        bool selection_was_empty = get_model()->is_selection_empty();
+        bool selection_was_empty = selection_model->is_selection_empty();
         scene->clearSelection();
 
         if (item == nullptr && selection_was_empty) {
@@ -546,7 +567,7 @@ void TilesetView::show_context_menu(const QPoint& where) {
     return;
   }
 
-  QList<int> selected_indexes = model->get_selected_indexes();
+  QList<int> selected_indexes = selection_model->get_selected_indexes();
   if (selected_indexes.empty()) {
     return;
   }
@@ -576,7 +597,7 @@ void TilesetView::show_context_menu(const QPoint& where) {
 
   // Change pattern id.
   menu->addSeparator();
-  change_pattern_id_action->setEnabled(model->get_selected_index() != -1);
+  change_pattern_id_action->setEnabled(selection_model->get_selected_index() != -1);
   menu->addAction(change_pattern_id_action);
 
   // Delete patterns.
@@ -771,7 +792,7 @@ void TilesetView::end_state_drawing_rectangle() {
   if (!rectangle.isEmpty() &&
       sceneRect().contains(rectangle) &&
       get_items_intersecting_current_areas().isEmpty() &&
-      model->is_selection_empty() &&
+      selection_model->is_selection_empty() &&
       !is_read_only()) {
 
     // Context menu to create a pattern.
@@ -820,7 +841,7 @@ void TilesetView::end_state_drawing_rectangle() {
  */
 void TilesetView::start_state_moving_patterns(const QPoint& initial_point) {
 
-  if (model->is_selection_empty()) {
+  if (selection_model->is_selection_empty()) {
     return;
   }
 
@@ -828,7 +849,7 @@ void TilesetView::start_state_moving_patterns(const QPoint& initial_point) {
   dragging_start_point = Point::floor_8(mapToScene(initial_point));
   dragging_current_point = dragging_start_point;
 
-  const QList<int>& selected_indexes = model->get_selected_indexes();
+  const QList<int>& selected_indexes = selection_model->get_selected_indexes();
   for (int index : selected_indexes) {
     const QRect& box = model->get_pattern_frames_bounding_box(index);
     QGraphicsRectItem *item = new QGraphicsRectItem(box);
@@ -879,7 +900,7 @@ void TilesetView::end_state_moving_patterns() {
   if (!box.isEmpty() &&
       sceneRect().contains(box) &&
       get_items_intersecting_current_areas().isEmpty() &&
-      !model->is_selection_empty() &&
+      !selection_model->is_selection_empty() &&
       !is_read_only() &&
       dragging_current_point != dragging_start_point) {
 
@@ -930,7 +951,7 @@ void TilesetView::dragMoveEvent(QDragMoveEvent* event) {
   clear_current_areas();
 
   bool valid_move = true;
-  const QList<int>& selected_indexes = model->get_selected_indexes();
+  const QList<int>& selected_indexes = selection_model->get_selected_indexes();
   for (int index : selected_indexes) {
 
     QRect area = model->get_pattern_frames_bounding_box(index);
@@ -1062,7 +1083,7 @@ QList<QGraphicsItem*> TilesetView::get_items_intersecting_current_areas(
 QRect TilesetView::get_selection_bounding_box() const {
 
   QRect bounding_box;
-  const QList<int> selected_indexes = model->get_selected_indexes();
+  const QList<int> selected_indexes = selection_model->get_selected_indexes();
   for (int index : selected_indexes) {
     bounding_box = bounding_box.united(
       model->get_pattern_frames_bounding_box(index));